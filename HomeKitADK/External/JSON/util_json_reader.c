@@ -36,6 +36,7 @@ void util_json_reader_init(struct util_json_reader* r) {
     HAPPrecondition(r != NULL);
     r->state = util_JSON_READER_STATE_READING_WHITESPACE;
     r->substate = SUBSTATE_NONE;
+    r->string_has_escapes = 0;
 }
 
 HAP_RESULT_USE_CHECK
@@ -412,6 +413,7 @@ size_t util_json_reader_read(struct util_json_reader* r, const char* buffer, siz
                     if (buffer[n] == '"') {
                         n++;
                         r->state = util_JSON_READER_STATE_READING_STRING;
+                        r->string_has_escapes = 0;
                     } else {
                         r->state = util_JSON_READER_STATE_ERROR;
                     }
@@ -423,6 +425,7 @@ size_t util_json_reader_read(struct util_json_reader* r, const char* buffer, siz
                             case SUBSTATE_NONE:
                                 if (buffer[n] == '\\') {
                                     r->substate = SUBSTATE_READING_STRING_AFTER_ESCAPE;
+                                    r->string_has_escapes = 1;
                                 }
                                 break;
                             case SUBSTATE_READING_STRING_AFTER_ESCAPE:
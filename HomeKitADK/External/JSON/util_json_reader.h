@@ -45,6 +45,7 @@
 struct util_json_reader {
     int state;
     int substate;
+    int string_has_escapes; // Whether the most recently read string contains escape sequences.
 };
 
 void util_json_reader_init(struct util_json_reader* r);
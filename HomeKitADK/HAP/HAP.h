@@ -227,7 +227,7 @@ void HAPTLVWriterGetScratchBytes(
  * HomeKit Accessory server.
  */
 #ifndef HAP_ACCESSORY_SERVER_SIZE
-#define HAP_ACCESSORY_SERVER_SIZE 1912
+#define HAP_ACCESSORY_SERVER_SIZE 2160
 #endif
 typedef HAP_OPAQUE(HAP_ACCESSORY_SERVER_SIZE) HAPAccessoryServerRef;
 HAP_NONNULL_SUPPORT(HAPAccessoryServerRef)
@@ -4246,6 +4246,35 @@ void HAPAccessoryServerRaiseEvent(
         const HAPService* service,
         const HAPAccessory* accessory);
 
+/**
+ * Characteristic whose value has changed, for use with HAPAccessoryServerRaiseEvents.
+ */
+typedef struct {
+    /** The characteristic whose value has changed. */
+    const HAPCharacteristic* characteristic;
+
+    /** The service that contains the characteristic. */
+    const HAPService* service;
+
+    /** The accessory that provides the service. */
+    const HAPAccessory* accessory;
+} HAPCharacteristicEvent;
+
+/**
+ * Raises event notifications for multiple characteristics at once.
+ *
+ * - Equivalent to calling HAPAccessoryServerRaiseEvent for each characteristic, but sessions are only scanned once
+ *   and a single event notification flush is scheduled for all of them.
+ *
+ * @param      server               Accessory server.
+ * @param      events               Characteristics whose values have changed.
+ * @param      numEvents            Number of characteristics.
+ */
+void HAPAccessoryServerRaiseEvents(
+        HAPAccessoryServerRef* server,
+        const HAPCharacteristicEvent* _Nullable events,
+        size_t numEvents);
+
 /**
  * Raises an event notification for a given characteristic in a given service provided by a given accessory object
  * on a given session.
@@ -4263,6 +4292,72 @@ void HAPAccessoryServerRaiseEventOnSession(
         const HAPAccessory* accessory,
         HAPSessionRef* session);
 
+/**
+ * Token that identifies a deferred characteristic read or write request.
+ *
+ * - Contents are private and must not be modified.
+ */
+typedef struct {
+    HAPSessionRef* _Nullable session; /**< Session on which the request was received. */
+    uint32_t requestID;               /**< Identifier of the deferred request. */
+    uint32_t writeIndex;              /**< Index of the deferred write within the request. */
+    bool isWrite;                     /**< Whether a write has been deferred. */
+} HAPCharacteristicRequestToken;
+
+/**
+ * Defers completion of the characteristic read or write request that is currently being handled.
+ *
+ * - Must be called from within a read or write handler, which must then return kHAPError_Busy. If the request
+ *   cannot be deferred, returning kHAPError_Busy reports the resource as busy to the controller.
+ *
+ * - The session is parked until all deferred reads or writes of the request have been completed with
+ *   HAPAccessoryServerCompleteCharacteristicRequest. Other sessions continue to be served in the meantime.
+ *
+ * - If the request is not completed within 10 seconds, pending writes are reported to the controller as timed out.
+ *   Pending reads are handled again, and reads whose handlers still return kHAPError_Busy are reported as timed out.
+ *
+ * - Reads: Once completed, the request is handled again and the read handler is invoked again.
+ *   It must then complete synchronously, e.g. with the value that has been fetched in the meantime.
+ *   Deferring again is rejected with kHAPError_InvalidState.
+ *
+ * - Writes: The write handler is not invoked again. The result of the write is passed on completion.
+ *   Until the response has been sent, events for the written characteristics are not sent to the writing controller.
+ *
+ * - Only reads and writes of IP controllers may be deferred. Reads for event notifications, reads during accessory
+ *   attribute database serialization and writes with write response cannot be deferred.
+ *
+ * @param      server               Accessory server.
+ * @param      session              The session on which the request was received.
+ * @param[out] token                Token to complete the request with.
+ *
+ * @return kHAPError_None           If successful.
+ * @return kHAPError_InvalidState   If the request that is currently being handled cannot be deferred.
+ * @return kHAPError_OutOfResources If out of resources to defer the request.
+ */
+HAP_RESULT_USE_CHECK
+HAPError HAPAccessoryServerDeferCharacteristicRequest(
+        HAPAccessoryServerRef* server,
+        HAPSessionRef* session,
+        HAPCharacteristicRequestToken* token);
+
+/**
+ * Completes a deferred characteristic read or write request.
+ *
+ * - Each token must be completed exactly once. Completion may be reported from any context, including from within
+ *   characteristic handlers. The request is resumed asynchronously from the run loop.
+ *
+ * - If the session has been closed or the request has timed out in the meantime, the completion is ignored.
+ *   Sessions with deferred requests are closed when the accessory server is stopped.
+ *
+ * @param      server               Accessory server.
+ * @param      token                Token from HAPAccessoryServerDeferCharacteristicRequest.
+ * @param      error                Result of a deferred write. Ignored for deferred reads.
+ */
+void HAPAccessoryServerCompleteCharacteristicRequest(
+        HAPAccessoryServerRef* server,
+        const HAPCharacteristicRequestToken* token,
+        HAPError error);
+
 /**
  * Restores the given key-value store to factory settings.
  *
@@ -183,6 +183,26 @@ typedef struct {
             const HAPAccessory* _Nullable accessory;
         } characteristicWriteRequestContext;
 
+        /**
+         * Context of the characteristic request whose handler is currently being invoked, if it may be deferred.
+         */
+        struct {
+            /** The session over which the request has been received. NULL if the request may not be deferred. */
+            const HAPIPSession* _Nullable ipSession;
+
+            /** Write context of a write request. NULL for read requests. */
+            HAPIPWriteContextRef* _Nullable writeContext;
+
+            /** Index of the write context within the request. */
+            uint32_t writeIndex;
+
+            /** Whether or not the handler has deferred the request. */
+            bool isDeferred;
+        } deferrableRequestContext;
+
+        /** Identifier of the most recently deferred characteristic request. */
+        uint32_t lastDeferredRequestID;
+
         /** Timer that on expiry triggers a server state transition. */
         HAPPlatformTimerRef stateTransitionTimer;
 
@@ -235,6 +255,16 @@ typedef struct {
             /** Connection handle of the connected controller, if applicable. */
             HAPPlatformBLEPeripheralManagerConnectionHandle connectionHandle;
 
+            /**
+             * Queue of GATT table elements with pending HAP events, in the order in which they were raised.
+             *
+             * - Elements are referenced by their index in the GATT table + 1. 0 if the queue is empty.
+             */
+            struct {
+                uint16_t first; /**< First element. */
+                uint16_t last;  /**< Last element. */
+            } pendingEvents;
+
             /** Whether a HomeKit controller is connected. */
             bool connected : 1;
 
@@ -242,8 +272,33 @@ typedef struct {
             bool procedureAttached : 1;
         } connection;
 
-        /** Timestamp for Least Recently Used scheme in Pair Resume session cache. */
-        uint32_t sessionCacheTimestamp;
+        /** Pair Resume session cache index. */
+        HAPPairingBLESessionCacheIndex sessionCache;
+
+        /**
+         * GSN state.
+         *
+         * - Only an upper bound for the GSN is stored in the key-value store.
+         *   See kHAPBLEAccessoryServer_NumReservedGSNs.
+         */
+        struct {
+            HAPBLEAccessoryServerGSN state; /**< Current GSN state. */
+            uint16_t reservedGSN;           /**< Upper bound for the GSN that is stored in the key-value store. */
+            bool isLoaded : 1;              /**< Whether the GSN state has been loaded. */
+        } gsn;
+
+        /**
+         * Broadcast encryption key parameters cached from the key-value store.
+         */
+        struct {
+            HAPBLEAccessoryServerBroadcastParameters parameters; /**< Parameters. */
+            bool isLoaded : 1;                                   /**< Whether the parameters have been loaded. */
+        } broadcast;
+
+        /**
+         * Characteristic broadcast configuration cached from the key-value store.
+         */
+        HAPBLECharacteristicBroadcastConfiguration broadcastConfiguration;
 
         /**
          * Advertisement state.
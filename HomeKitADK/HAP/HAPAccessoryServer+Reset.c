@@ -18,12 +18,18 @@ HAPError HAPRestoreFactorySettings(HAPPlatformKeyValueStoreRef keyValueStore) {
         kHAPKeyValueStoreDomain_CharacteristicConfiguration,
         kHAPKeyValueStoreDomain_Pairings
     };
-    for (size_t i = 0; i < HAPArrayCount(domainsToPurge); i++) {
+    HAPPlatformKeyValueStoreBeginBatch(keyValueStore);
+    err = kHAPError_None;
+    for (size_t i = 0; !err && i < HAPArrayCount(domainsToPurge); i++) {
         err = HAPPlatformKeyValueStorePurgeDomain(keyValueStore, domainsToPurge[i]);
-        if (err) {
-            HAPAssert(err == kHAPError_Unknown);
-            return err;
-        }
+    }
+    HAPError commitErr = HAPPlatformKeyValueStoreCommitBatch(keyValueStore);
+    if (!err) {
+        err = commitErr;
+    }
+    if (err) {
+        HAPAssert(err == kHAPError_Unknown);
+        return err;
     }
 
     return kHAPError_None;
@@ -56,38 +62,43 @@ HAPError HAPHandleFirmwareUpdate(HAPAccessoryServerRef* server_) {
 
     HAPError err;
 
+    // CN, GSN and broadcast encryption key are updated together.
+    HAPPlatformKeyValueStoreBeginBatch(keyValueStore);
+
     // Increment CN.
     // See HomeKit Accessory Protocol Specification R14
     // Table 6-7 _hap._tcp Bonjour TXT Record Keys
     // See HomeKit Accessory Protocol Specification R14
     // Section 7.4.2.1.2 Manufacturer Data
     err = HAPAccessoryServerIncrementCN(keyValueStore);
-    if (err) {
-        HAPAssert(err == kHAPError_Unknown);
-        return err;
-    }
 
     // BLE: Reset GSN.
     // See HomeKit Accessory Protocol Specification R14
     // Section 7.4.1.8 Global State Number (GSN)
-    if (server->transports.ble) {
+    if (!err && server->transports.ble) {
         err = HAPPlatformKeyValueStoreRemove(
                 keyValueStore, kHAPKeyValueStoreDomain_Configuration, kHAPKeyValueStoreKey_Configuration_BLEGSN);
-        if (err) {
-            HAPAssert(err == kHAPError_Unknown);
-            return err;
-        }
     }
 
     // BLE: Reset Broadcast Encryption Key.
     // See HomeKit Accessory Protocol Specification R14
     // Section 7.4.7.4 Broadcast Encryption Key expiration and refresh
+    if (!err && server->transports.ble) {
+        err = HAPNonnull(server->transports.ble)->broadcast.expireKey(server_);
+    }
+
+    HAPError commitErr = HAPPlatformKeyValueStoreCommitBatch(keyValueStore);
+    if (!err) {
+        err = commitErr;
+    }
+
+    // BLE: Reload GSN and broadcast encryption key from the key-value store on next access.
     if (server->transports.ble) {
-        err = HAPNonnull(server->transports.ble)->broadcast.expireKey(keyValueStore);
-        if (err) {
-            HAPAssert(err == kHAPError_Unknown);
-            return err;
-        }
+        HAPNonnull(server->transports.ble)->invalidateCachedState(server_);
+    }
+    if (err) {
+        HAPAssert(err == kHAPError_Unknown);
+        return err;
     }
 
     return kHAPError_None;
@@ -1033,31 +1033,36 @@ HAPError HAPAccessoryServerCleanupPairings(HAPAccessoryServerRef* server_) {
 
     // If there is no admin, delete all pairings.
     if (!context.adminFound) {
+        HAPPlatformKeyValueStoreBeginBatch(server->platform.keyValueStore);
         if (context.hasPairings) {
             // Remove all pairings.
             HAPLogInfo(&logObject, "No admin pairing found. Removing all pairings.");
             HAPAccessoryServerDelegateScheduleHandleUpdatedState(server_);
             err = HAPPlatformKeyValueStorePurgeDomain(server->platform.keyValueStore, kHAPKeyValueStoreDomain_Pairings);
-            if (err) {
-                HAPAssert(err == kHAPError_Unknown);
-                return err;
-            }
         }
 #if HAP_BLE
         // Purge Pair Resume cache.
         if (server->transports.ble) {
-            HAPRawBufferZero(
-                    server->ble.storage->sessionCacheElements,
-                    server->ble.storage->numSessionCacheElements * sizeof *server->ble.storage->sessionCacheElements);
+            HAPNonnull(server->transports.ble)->sessionCache.invalidateAllEntries(server_);
         }
 #endif
-        // Purge broadcast encryption key and advertising identifier.
-        // See HomeKit Certification Test Cases R7.2
-        // Test Case TCB052
-        err = HAPPlatformKeyValueStoreRemove(
-                server->platform.keyValueStore,
-                kHAPKeyValueStoreDomain_Configuration,
-                kHAPKeyValueStoreKey_Configuration_BLEBroadcastParameters);
+        if (!err) {
+            // Purge broadcast encryption key and advertising identifier.
+            // See HomeKit Certification Test Cases R7.2
+            // Test Case TCB052
+            err = HAPPlatformKeyValueStoreRemove(
+                    server->platform.keyValueStore,
+                    kHAPKeyValueStoreDomain_Configuration,
+                    kHAPKeyValueStoreKey_Configuration_BLEBroadcastParameters);
+        }
+        HAPError commitErr = HAPPlatformKeyValueStoreCommitBatch(server->platform.keyValueStore);
+        if (!err) {
+            err = commitErr;
+        }
+        // The GSN is not affected, only the broadcast encryption key parameters need to be reloaded.
+        if (server->transports.ble) {
+            HAPNonnull(server->transports.ble)->broadcast.invalidateCachedParameters(server_);
+        }
         if (err) {
             HAPAssert(err == kHAPError_Unknown);
             return err;
@@ -1184,33 +1189,59 @@ HAPError HAPAccessoryServerIncrementCN(HAPPlatformKeyValueStoreRef keyValueStore
 }
 
 void HAPAccessoryServerRaiseEvent(
-        HAPAccessoryServerRef* server_,
+        HAPAccessoryServerRef* server,
         const HAPCharacteristic* characteristic,
         const HAPService* service,
         const HAPAccessory* accessory) {
-    HAPPrecondition(server_);
-    HAPAccessoryServer* server = (HAPAccessoryServer*) server_;
+    HAPPrecondition(server);
     HAPPrecondition(characteristic);
     HAPPrecondition(service);
     HAPPrecondition(accessory);
 
+    const HAPCharacteristicEvent event = { .characteristic = characteristic,
+                                           .service = service,
+                                           .accessory = accessory };
+    HAPAccessoryServerRaiseEvents(server, &event, 1);
+}
+
+void HAPAccessoryServerRaiseEvents(
+        HAPAccessoryServerRef* server_,
+        const HAPCharacteristicEvent* _Nullable events,
+        size_t numEvents) {
+    HAPPrecondition(server_);
+    HAPAccessoryServer* server = (HAPAccessoryServer*) server_;
+    HAPPrecondition(!numEvents || events);
+
     HAPError err;
 
-    HAPLogCharacteristicDebug(&logObject, characteristic, service, accessory, "Marking characteristic as modified.");
+    for (size_t i = 0; i < numEvents; i++) {
+        const HAPCharacteristicEvent* event = &HAPNonnull(events)[i];
+        HAPPrecondition(event->characteristic);
+        HAPPrecondition(event->service);
+        HAPPrecondition(event->accessory);
 
-    if (server->transports.ble) {
-        err = HAPNonnull(server->transports.ble)->didRaiseEvent(server_, characteristic, service, accessory, NULL);
-        if (err) {
-            HAPAssert(err == kHAPError_Unknown);
-            HAPFatalError();
+        HAPLogCharacteristicDebug(
+                &logObject,
+                event->characteristic,
+                event->service,
+                event->accessory,
+                "Marking characteristic as modified.");
+
+        if (server->transports.ble) {
+            err = HAPNonnull(server->transports.ble)
+                          ->didRaiseEvent(server_, event->characteristic, event->service, event->accessory, NULL);
+            if (err) {
+                HAPAssert(err == kHAPError_Unknown);
+                HAPFatalError();
+            }
         }
     }
 
-    if (server->transports.ip) {
+    if (numEvents && server->transports.ip) {
         const HAPAccessoryServerServerEngine* _Nullable serverEngine =
                 HAPNonnull(server->transports.ip)->serverEngine.get();
-        if (serverEngine && serverEngine->raise_event) {
-            err = serverEngine->raise_event(server_, characteristic, service, accessory);
+        if (serverEngine && serverEngine->raise_events) {
+            err = serverEngine->raise_events(server_, HAPNonnull(events), numEvents);
             if (err) {
                 HAPFatalError();
             }
@@ -1253,6 +1284,48 @@ void HAPAccessoryServerRaiseEventOnSession(
     }
 }
 
+HAP_RESULT_USE_CHECK
+HAPError HAPAccessoryServerDeferCharacteristicRequest(
+        HAPAccessoryServerRef* server_,
+        HAPSessionRef* session_,
+        HAPCharacteristicRequestToken* token) {
+    HAPPrecondition(server_);
+    HAPAccessoryServer* server = (HAPAccessoryServer*) server_;
+    HAPPrecondition(session_);
+    HAPSession* session = (HAPSession*) session_;
+    HAPPrecondition(token);
+
+    HAPRawBufferZero(token, sizeof *token);
+
+    if (session->transportType != kHAPTransportType_IP || !server->transports.ip) {
+        HAPLog(&logObject, "Deferring characteristic requests is only supported over IP.");
+        return kHAPError_InvalidState;
+    }
+    const HAPAccessoryServerServerEngine* _Nullable serverEngine = HAPNonnull(server->transports.ip)->serverEngine.get();
+    if (!serverEngine || !serverEngine->defer_request) {
+        return kHAPError_InvalidState;
+    }
+    return serverEngine->defer_request(server_, session_, token);
+}
+
+void HAPAccessoryServerCompleteCharacteristicRequest(
+        HAPAccessoryServerRef* server_,
+        const HAPCharacteristicRequestToken* token,
+        HAPError error) {
+    HAPPrecondition(server_);
+    HAPAccessoryServer* server = (HAPAccessoryServer*) server_;
+    HAPPrecondition(token);
+    HAPPrecondition(token->session);
+
+    if (server->transports.ip) {
+        const HAPAccessoryServerServerEngine* _Nullable serverEngine =
+                HAPNonnull(server->transports.ip)->serverEngine.get();
+        if (serverEngine && serverEngine->complete_request) {
+            serverEngine->complete_request(server_, token, error);
+        }
+    }
+}
+
 void HAPAccessoryServerHandleSubscribe(
         HAPAccessoryServerRef* server,
         HAPSessionRef* session_,
@@ -8,18 +8,75 @@
 
 static const HAPLogObject logObject = { .subsystem = kHAP_LogSubsystem, .category = "BLEAccessoryServer" };
 
+/**
+ * Advances a GSN by a number of increments, wrapping around from 65535 to 1.
+ *
+ * @param      gsn                  GSN.
+ * @param      numIncrements        Number of increments.
+ *
+ * @return Advanced GSN.
+ */
 HAP_RESULT_USE_CHECK
-HAPError HAPBLEAccessoryServerGetGSN(HAPPlatformKeyValueStoreRef keyValueStore, HAPBLEAccessoryServerGSN* gsn) {
-    HAPPrecondition(keyValueStore);
+static uint16_t AdvanceGSN(uint16_t gsn, uint16_t numIncrements) {
     HAPPrecondition(gsn);
 
+    return (uint16_t)((((uint32_t) gsn - 1 + numIncrements) % UINT16_MAX) + 1);
+}
+
+/**
+ * Reserves GSN increments up to and including a given GSN in the key-value store.
+ *
+ * @param      server               Accessory server.
+ * @param      reservedGSN          Highest GSN that may be used before another reservation is necessary.
+ *
+ * @return kHAPError_None           If successful.
+ * @return kHAPError_Unknown        If an I/O error occurred.
+ */
+HAP_RESULT_USE_CHECK
+static HAPError ReserveGSN(HAPAccessoryServer* server, uint16_t reservedGSN) {
+    HAPPrecondition(server);
+    HAPPrecondition(reservedGSN);
+
+    HAPError err;
+
+    uint8_t gsnBytes[] = { HAPExpandLittleUInt16(reservedGSN), 0x00 };
+    err = HAPPlatformKeyValueStoreSet(
+            server->platform.keyValueStore,
+            kHAPKeyValueStoreDomain_Configuration,
+            kHAPKeyValueStoreKey_Configuration_BLEGSN,
+            gsnBytes,
+            sizeof gsnBytes);
+    if (err) {
+        HAPAssert(err == kHAPError_Unknown);
+        return err;
+    }
+    server->ble.gsn.reservedGSN = reservedGSN;
+    return kHAPError_None;
+}
+
+/**
+ * Loads GSN state from the key-value store.
+ *
+ * - The GSN continues after the stored reservation, as any GSN up to it may have been used already.
+ *   If the broadcast encryption key would have expired within the skipped range, it is expired now.
+ *
+ * @param      server               Accessory server.
+ *
+ * @return kHAPError_None           If successful.
+ * @return kHAPError_Unknown        If an I/O error occurred.
+ */
+HAP_RESULT_USE_CHECK
+static HAPError LoadGSN(HAPAccessoryServer* server) {
+    HAPPrecondition(server);
+    HAPPrecondition(!server->ble.gsn.isLoaded);
+
     HAPError err;
 
     bool found;
     size_t numBytes;
     uint8_t gsnBytes[sizeof(uint16_t) + sizeof(uint8_t)];
     err = HAPPlatformKeyValueStoreGet(
-            keyValueStore,
+            server->platform.keyValueStore,
             kHAPKeyValueStoreDomain_Configuration,
             kHAPKeyValueStoreKey_Configuration_BLEGSN,
             gsnBytes,
@@ -30,20 +87,79 @@ HAPError HAPBLEAccessoryServerGetGSN(HAPPlatformKeyValueStoreRef keyValueStore,
         HAPAssert(err == kHAPError_Unknown);
         return err;
     }
-    if (!found) {
-        HAPWriteLittleUInt16(&gsnBytes[0], 1U);
-        gsnBytes[2] = 0x00;
-    } else if (numBytes != sizeof gsnBytes) {
+    if (found && numBytes != sizeof gsnBytes) {
         HAPLog(&logObject, "Invalid GSN length %lu.", (unsigned long) numBytes);
         return kHAPError_Unknown;
     }
 
-    HAPRawBufferZero(gsn, sizeof *gsn);
-    gsn->gsn = HAPReadLittleUInt16(&gsnBytes[0]);
-    gsn->didIncrement = (gsnBytes[2] & 0x01u) == 0x01;
+    uint16_t gsn = 1;
+    if (found) {
+        uint16_t storedGSN = HAPReadLittleUInt16(&gsnBytes[0]);
+        if (!storedGSN) {
+            HAPLog(&logObject, "Invalid stored GSN.");
+            return kHAPError_Unknown;
+        }
+        gsn = AdvanceGSN(storedGSN, 1);
+
+        // Expire broadcast encryption key if its expiration GSN may have been passed.
+        uint16_t keyExpirationGSN;
+        err = HAPBLEAccessoryServerBroadcastGetParameters(
+                (HAPAccessoryServerRef*) server, &keyExpirationGSN, NULL, NULL);
+        if (err) {
+            HAPAssert(err == kHAPError_Unknown);
+            return err;
+        }
+        uint16_t numSkippedGSNs = (uint16_t)(((uint32_t) storedGSN + UINT16_MAX - keyExpirationGSN) % UINT16_MAX);
+        if (keyExpirationGSN && numSkippedGSNs <= kHAPBLEAccessoryServer_NumReservedGSNs) {
+            err = HAPBLEAccessoryServerBroadcastExpireKey((HAPAccessoryServerRef*) server);
+            if (err) {
+                HAPAssert(err == kHAPError_Unknown);
+                return err;
+            }
+        }
+    }
+
+    err = ReserveGSN(server, AdvanceGSN(gsn, kHAPBLEAccessoryServer_NumReservedGSNs));
+    if (err) {
+        HAPAssert(err == kHAPError_Unknown);
+        return err;
+    }
+    HAPRawBufferZero(&server->ble.gsn.state, sizeof server->ble.gsn.state);
+    server->ble.gsn.state.gsn = gsn;
+    server->ble.gsn.isLoaded = true;
+    HAPLogInfo(&logObject, "GSN: %u (reserved up to %u).", gsn, server->ble.gsn.reservedGSN);
     return kHAPError_None;
 }
 
+HAP_RESULT_USE_CHECK
+HAPError HAPBLEAccessoryServerGetGSN(HAPAccessoryServerRef* server_, HAPBLEAccessoryServerGSN* gsn) {
+    HAPPrecondition(server_);
+    HAPAccessoryServer* server = (HAPAccessoryServer*) server_;
+    HAPPrecondition(gsn);
+
+    HAPError err;
+
+    if (!server->ble.gsn.isLoaded) {
+        err = LoadGSN(server);
+        if (err) {
+            HAPAssert(err == kHAPError_Unknown);
+            return err;
+        }
+    }
+
+    *gsn = server->ble.gsn.state;
+    return kHAPError_None;
+}
+
+void HAPBLEAccessoryServerInvalidateCachedState(HAPAccessoryServerRef* server_) {
+    HAPPrecondition(server_);
+    HAPAccessoryServer* server = (HAPAccessoryServer*) server_;
+
+    HAPRawBufferZero(&server->ble.gsn, sizeof server->ble.gsn);
+    HAPRawBufferZero(&server->ble.broadcast, sizeof server->ble.broadcast);
+    HAPRawBufferZero(&server->ble.broadcastConfiguration, sizeof server->ble.broadcastConfiguration);
+}
+
 HAP_RESULT_USE_CHECK
 HAPError HAPBLEAccessoryServerGetAdvertisingParameters(
         HAPAccessoryServerRef* server_,
@@ -91,7 +207,7 @@ HAPError HAPBLEAccessoryServerGetAdvertisingParameters(
         HAPBLEAccessoryServerBroadcastEncryptionKey broadcastKey;
         HAPDeviceID advertisingID;
         err = HAPBLEAccessoryServerBroadcastGetParameters(
-                server->platform.keyValueStore, &keyExpirationGSN, &broadcastKey, &advertisingID);
+                server_, &keyExpirationGSN, &broadcastKey, &advertisingID);
         if (err) {
             HAPAssert(err == kHAPError_Unknown);
             return err;
@@ -101,7 +217,7 @@ HAPError HAPBLEAccessoryServerGetAdvertisingParameters(
             return kHAPError_Unknown;
         }
         HAPBLEAccessoryServerGSN gsn;
-        err = HAPBLEAccessoryServerGetGSN(server->platform.keyValueStore, &gsn);
+        err = HAPBLEAccessoryServerGetGSN(server_, &gsn);
         if (err) {
             HAPAssert(err == kHAPError_Unknown);
             return err;
@@ -299,7 +415,7 @@ HAPError HAPBLEAccessoryServerGetAdvertisingParameters(
         adv += 2;
         /* 0x0F   GSN */ {
             HAPBLEAccessoryServerGSN gsn;
-            err = HAPBLEAccessoryServerGetGSN(server->platform.keyValueStore, &gsn);
+            err = HAPBLEAccessoryServerGetGSN(server_, &gsn);
             if (err) {
                 HAPAssert(err == kHAPError_Unknown);
                 return err;
@@ -545,23 +661,12 @@ HAPError HAPBLEAccessoryServerDidConnect(HAPAccessoryServerRef* server_) {
 
     // Reset disconnected events coalescing.
     HAPBLEAccessoryServerGSN gsn;
-    err = HAPBLEAccessoryServerGetGSN(server->platform.keyValueStore, &gsn);
-    if (err) {
-        HAPAssert(err == kHAPError_Unknown);
-        return err;
-    }
-    gsn.didIncrement = false;
-    uint8_t gsnBytes[] = { HAPExpandLittleUInt16(gsn.gsn), gsn.didIncrement ? (uint8_t) 0x01 : (uint8_t) 0x00 };
-    err = HAPPlatformKeyValueStoreSet(
-            server->platform.keyValueStore,
-            kHAPKeyValueStoreDomain_Configuration,
-            kHAPKeyValueStoreKey_Configuration_BLEGSN,
-            gsnBytes,
-            sizeof gsnBytes);
+    err = HAPBLEAccessoryServerGetGSN(server_, &gsn);
     if (err) {
         HAPAssert(err == kHAPError_Unknown);
         return err;
     }
+    server->ble.gsn.state.didIncrement = false;
 
     // Reset broadcasted events.
     HAPRawBufferZero(&server->ble.adv.broadcastedEvent, sizeof server->ble.adv.broadcastedEvent);
@@ -598,23 +703,12 @@ HAPError HAPBLEAccessoryServerDidDisconnect(HAPAccessoryServerRef* server_) {
 
     // Reset GSN update coalescing.
     HAPBLEAccessoryServerGSN gsn;
-    err = HAPBLEAccessoryServerGetGSN(server->platform.keyValueStore, &gsn);
-    if (err) {
-        HAPAssert(err == kHAPError_Unknown);
-        return err;
-    }
-    gsn.didIncrement = false;
-    uint8_t gsnBytes[] = { HAPExpandLittleUInt16(gsn.gsn), gsn.didIncrement ? (uint8_t) 0x01 : (uint8_t) 0x00 };
-    err = HAPPlatformKeyValueStoreSet(
-            server->platform.keyValueStore,
-            kHAPKeyValueStoreDomain_Configuration,
-            kHAPKeyValueStoreKey_Configuration_BLEGSN,
-            gsnBytes,
-            sizeof gsnBytes);
+    err = HAPBLEAccessoryServerGetGSN(server_, &gsn);
     if (err) {
         HAPAssert(err == kHAPError_Unknown);
         return err;
     }
+    server->ble.gsn.state.didIncrement = false;
 
     HAPAssert(!server->ble.adv.broadcastedEvent.iid);
 
@@ -646,7 +740,7 @@ static HAPError HAPBLEAccessoryServerIncrementGSN(HAPAccessoryServerRef* server_
 
     // Get key expiration GSN.
     uint16_t keyExpirationGSN;
-    err = HAPBLEAccessoryServerBroadcastGetParameters(server->platform.keyValueStore, &keyExpirationGSN, NULL, NULL);
+    err = HAPBLEAccessoryServerBroadcastGetParameters(server_, &keyExpirationGSN, NULL, NULL);
     if (err) {
         HAPAssert(err == kHAPError_Unknown);
         return err;
@@ -654,7 +748,7 @@ static HAPError HAPBLEAccessoryServerIncrementGSN(HAPAccessoryServerRef* server_
 
     // Get GSN.
     HAPBLEAccessoryServerGSN gsn;
-    err = HAPBLEAccessoryServerGetGSN(server->platform.keyValueStore, &gsn);
+    err = HAPBLEAccessoryServerGetGSN(server_, &gsn);
     if (err) {
         HAPAssert(err == kHAPError_Unknown);
         return err;
@@ -662,34 +756,26 @@ static HAPError HAPBLEAccessoryServerIncrementGSN(HAPAccessoryServerRef* server_
 
     // Expire broadcast encryption key if necessary.
     if (gsn.gsn == keyExpirationGSN) {
-        err = HAPBLEAccessoryServerBroadcastExpireKey(server->platform.keyValueStore);
+        err = HAPBLEAccessoryServerBroadcastExpireKey(server_);
         if (err) {
             HAPAssert(err == kHAPError_Unknown);
             return err;
         }
     }
 
-    // Increment GSN.
-    if (gsn.gsn == UINT16_MAX) {
-        gsn.gsn = 1;
-    } else {
-        gsn.gsn++;
+    // Extend reservation if necessary. Only the reservation is persisted, not every increment.
+    if (gsn.gsn == server->ble.gsn.reservedGSN) {
+        err = ReserveGSN(server, AdvanceGSN(gsn.gsn, kHAPBLEAccessoryServer_NumReservedGSNs));
+        if (err) {
+            HAPAssert(err == kHAPError_Unknown);
+            return err;
+        }
     }
-    gsn.didIncrement = true;
-    HAPLogInfo(&logObject, "New GSN: %u.", gsn.gsn);
 
-    // Save GSN state.
-    uint8_t gsnBytes[] = { HAPExpandLittleUInt16(gsn.gsn), gsn.didIncrement ? (uint8_t) 0x01 : (uint8_t) 0x00 };
-    err = HAPPlatformKeyValueStoreSet(
-            server->platform.keyValueStore,
-            kHAPKeyValueStoreDomain_Configuration,
-            kHAPKeyValueStoreKey_Configuration_BLEGSN,
-            gsnBytes,
-            sizeof gsnBytes);
-    if (err) {
-        HAPAssert(err == kHAPError_Unknown);
-        return err;
-    }
+    // Increment GSN.
+    server->ble.gsn.state.gsn = AdvanceGSN(gsn.gsn, 1);
+    server->ble.gsn.state.didIncrement = true;
+    HAPLogInfo(&logObject, "New GSN: %u.", server->ble.gsn.state.gsn);
 
     return kHAPError_None;
 }
@@ -744,13 +830,13 @@ HAPError HAPBLEAccessoryServerDidRaiseEvent(
         if (!server->ble.adv.connected) {
             uint16_t keyExpirationGSN;
             err = HAPBLEAccessoryServerBroadcastGetParameters(
-                    server->platform.keyValueStore, &keyExpirationGSN, NULL, NULL);
+                    server_, &keyExpirationGSN, NULL, NULL);
             if (err) {
                 HAPAssert(err == kHAPError_Unknown);
                 return err;
             }
             HAPBLEAccessoryServerGSN gsn;
-            err = HAPBLEAccessoryServerGetGSN(server->platform.keyValueStore, &gsn);
+            err = HAPBLEAccessoryServerGetGSN(server_, &gsn);
             if (err) {
                 HAPAssert(err == kHAPError_Unknown);
                 return err;
@@ -765,7 +851,7 @@ HAPError HAPBLEAccessoryServerDidRaiseEvent(
                 HAPBLECharacteristicBroadcastInterval interval;
                 bool enabled;
                 err = HAPBLECharacteristicGetBroadcastConfiguration(
-                        characteristic, service, accessory, &enabled, &interval, server->platform.keyValueStore);
+                        characteristic, service, accessory, &enabled, &interval, server_);
                 if (err) {
                     HAPAssert(err == kHAPError_Unknown);
                     return err;
@@ -1027,7 +1113,7 @@ HAPError HAPBLEAccessoryServerDidRaiseEvent(
         // Section 7.4.6.3 Disconnected Events
 
         HAPBLEAccessoryServerGSN gsn;
-        err = HAPBLEAccessoryServerGetGSN(server->platform.keyValueStore, &gsn);
+        err = HAPBLEAccessoryServerGetGSN(server_, &gsn);
         if (err) {
             HAPAssert(err == kHAPError_Unknown);
             return err;
@@ -1113,7 +1199,7 @@ HAPError HAPBLEAccessoryServerDidSendEventNotification(
     // See HomeKit Accessory Protocol Specification R14
     // Section 7.4.6.1 Connected Events
     HAPBLEAccessoryServerGSN gsn;
-    err = HAPBLEAccessoryServerGetGSN(server->platform.keyValueStore, &gsn);
+    err = HAPBLEAccessoryServerGetGSN(server_, &gsn);
     if (err) {
         HAPAssert(err == kHAPError_Unknown);
         return err;
@@ -25,17 +25,38 @@ typedef struct {
     bool didIncrement : 1; /**< Whether GSN has been incremented in the current connect / disconnect cycle. */
 } HAPBLEAccessoryServerGSN;
 
+/**
+ * BLE: Number of GSN increments that are reserved in the key-value store at a time.
+ *
+ * - The key-value store only holds an upper bound for the GSN. Increments up to that bound are kept in RAM.
+ *   When the bound is reached, it is raised by this amount. After a restart the GSN continues after the stored
+ *   bound, so it never goes backwards even if the accessory lost power.
+ */
+#define kHAPBLEAccessoryServer_NumReservedGSNs ((uint16_t) 64)
+
 /**
  * BLE: Fetches GSN state.
  *
- * @param      keyValueStore        Key-value store
+ * - The GSN state is loaded from the key-value store once and then kept in the accessory server.
+ *
+ * @param      server               Accessory server.
  * @param[out] gsn                  GSN.
  *
  * @return kHAPError_None           If successful.
  * @return kHAPError_Unknown        If an I/O error occurred.
  */
 HAP_RESULT_USE_CHECK
-HAPError HAPBLEAccessoryServerGetGSN(HAPPlatformKeyValueStoreRef keyValueStore, HAPBLEAccessoryServerGSN* gsn);
+HAPError HAPBLEAccessoryServerGetGSN(HAPAccessoryServerRef* server, HAPBLEAccessoryServerGSN* gsn);
+
+/**
+ * BLE: Discards GSN state, broadcast encryption key parameters and characteristic broadcast configuration
+ *      cached in the accessory server.
+ *
+ * - Must be called after modifying the corresponding key-value store entries directly.
+ *
+ * @param      server               Accessory server.
+ */
+void HAPBLEAccessoryServerInvalidateCachedState(HAPAccessoryServerRef* server);
 
 /**
  * BLE: Get advertisement parameters.
@@ -8,61 +8,127 @@
 
 static const HAPLogObject logObject = { .subsystem = kHAP_LogSubsystem, .category = "BLEAccessoryServer" };
 
-typedef struct {
-    uint16_t keyExpirationGSN;
-    HAPBLEAccessoryServerBroadcastEncryptionKey key;
-    bool hasAdvertisingID;
-    HAPDeviceID advertisingID;
-} HAPBLEAccessoryServerBroadcastParameters;
-
-#define HAP_BLE_ACCESSORY_SERVER_GET_BROADCAST_PARAMETERS_OR_RETURN_ERROR(keyValueStore, parameters) \
-    do { \
-        bool found; \
-        size_t numBytes; \
-        uint8_t parametersBytes \
-                [sizeof(uint16_t) + sizeof(HAPBLEAccessoryServerBroadcastEncryptionKey) + sizeof(uint8_t) + \
-                 sizeof(HAPDeviceID)]; \
-        err = HAPPlatformKeyValueStoreGet( \
-                (keyValueStore), \
-                kHAPKeyValueStoreDomain_Configuration, \
-                kHAPKeyValueStoreKey_Configuration_BLEBroadcastParameters, \
-                parametersBytes, \
-                sizeof parametersBytes, \
-                &numBytes, \
-                &found); \
-        if (err) { \
-            HAPAssert(err == kHAPError_Unknown); \
-            return err; \
-        } \
-        if (!found) { \
-            HAPRawBufferZero(parametersBytes, sizeof parametersBytes); \
-        } else if (numBytes != sizeof parametersBytes) { \
-            HAPLog(&logObject, "Invalid BLE broadcast state length: %lu.", (unsigned long) numBytes); \
-            return kHAPError_Unknown; \
-        } \
-        HAPRawBufferZero((parameters), sizeof *(parameters)); \
-        (parameters)->keyExpirationGSN = HAPReadLittleUInt16(&parametersBytes[0]); \
-        HAPAssert(sizeof(parameters)->key.value == 32); \
-        HAPRawBufferCopyBytes((parameters)->key.value, &parametersBytes[2], 32); \
-        (parameters)->hasAdvertisingID = (uint8_t)(parametersBytes[34] & 0x01U) == 0x01; \
-        HAPAssert(sizeof(parameters)->advertisingID.bytes == 6); \
-        HAPRawBufferCopyBytes((parameters)->advertisingID.bytes, &parametersBytes[35], 6); \
-    } while (0)
+/**
+ * Gets the broadcast encryption key parameters, loading them from the key-value store if not yet cached.
+ *
+ * @param      server               Accessory server.
+ * @param[out] parameters           Broadcast encryption key parameters.
+ *
+ * @return kHAPError_None           If successful.
+ * @return kHAPError_Unknown        If an I/O error occurred.
+ */
+HAP_RESULT_USE_CHECK
+static HAPError GetParameters(HAPAccessoryServer* server, HAPBLEAccessoryServerBroadcastParameters* parameters) {
+    HAPPrecondition(server);
+    HAPPrecondition(parameters);
+
+    HAPError err;
+
+    if (!server->ble.broadcast.isLoaded) {
+        bool found;
+        size_t numBytes;
+        uint8_t parametersBytes
+                [sizeof(uint16_t) + sizeof(HAPBLEAccessoryServerBroadcastEncryptionKey) + sizeof(uint8_t) +
+                 sizeof(HAPDeviceID)];
+        err = HAPPlatformKeyValueStoreGet(
+                server->platform.keyValueStore,
+                kHAPKeyValueStoreDomain_Configuration,
+                kHAPKeyValueStoreKey_Configuration_BLEBroadcastParameters,
+                parametersBytes,
+                sizeof parametersBytes,
+                &numBytes,
+                &found);
+        if (err) {
+            HAPAssert(err == kHAPError_Unknown);
+            return err;
+        }
+        if (!found) {
+            HAPRawBufferZero(parametersBytes, sizeof parametersBytes);
+        } else if (numBytes != sizeof parametersBytes) {
+            HAPLog(&logObject, "Invalid BLE broadcast state length: %lu.", (unsigned long) numBytes);
+            return kHAPError_Unknown;
+        }
+        HAPBLEAccessoryServerBroadcastParameters* cached = &server->ble.broadcast.parameters;
+        HAPRawBufferZero(cached, sizeof *cached);
+        cached->keyExpirationGSN = HAPReadLittleUInt16(&parametersBytes[0]);
+        HAPAssert(sizeof cached->key.value == 32);
+        HAPRawBufferCopyBytes(cached->key.value, &parametersBytes[2], 32);
+        cached->hasAdvertisingID = (uint8_t)(parametersBytes[34] & 0x01U) == 0x01;
+        HAPAssert(sizeof cached->advertisingID.bytes == 6);
+        HAPRawBufferCopyBytes(cached->advertisingID.bytes, &parametersBytes[35], 6);
+        server->ble.broadcast.isLoaded = true;
+    }
+
+    HAPRawBufferCopyBytes(parameters, &server->ble.broadcast.parameters, sizeof *parameters);
+    return kHAPError_None;
+}
+
+/**
+ * Saves the broadcast encryption key parameters to the key-value store and updates the cache.
+ *
+ * @param      server               Accessory server.
+ * @param      parameters           Broadcast encryption key parameters.
+ *
+ * @return kHAPError_None           If successful.
+ * @return kHAPError_Unknown        If an I/O error occurred.
+ */
+HAP_RESULT_USE_CHECK
+static HAPError SaveParameters(HAPAccessoryServer* server, const HAPBLEAccessoryServerBroadcastParameters* parameters) {
+    HAPPrecondition(server);
+    HAPPrecondition(server->ble.broadcast.isLoaded);
+    HAPPrecondition(parameters);
+
+    HAPError err;
+
+    if (HAPRawBufferAreEqual(&server->ble.broadcast.parameters, parameters, sizeof *parameters)) {
+        return kHAPError_None;
+    }
+
+    uint8_t parametersBytes
+            [sizeof(uint16_t) + sizeof(HAPBLEAccessoryServerBroadcastEncryptionKey) + sizeof(uint8_t) +
+             sizeof(HAPDeviceID)];
+    HAPWriteLittleUInt16(&parametersBytes[0], parameters->keyExpirationGSN);
+    HAPAssert(sizeof parameters->key.value == 32);
+    HAPRawBufferCopyBytes(&parametersBytes[2], parameters->key.value, 32);
+    parametersBytes[34] = parameters->hasAdvertisingID ? (uint8_t) 0x01 : (uint8_t) 0x00;
+    HAPAssert(sizeof parameters->advertisingID.bytes == 6);
+    HAPRawBufferCopyBytes(&parametersBytes[35], parameters->advertisingID.bytes, 6);
+    err = HAPPlatformKeyValueStoreSet(
+            server->platform.keyValueStore,
+            kHAPKeyValueStoreDomain_Configuration,
+            kHAPKeyValueStoreKey_Configuration_BLEBroadcastParameters,
+            parametersBytes,
+            sizeof parametersBytes);
+    if (err) {
+        HAPAssert(err == kHAPError_Unknown);
+        // The stored state is unknown. Reload on next access.
+        server->ble.broadcast.isLoaded = false;
+        return err;
+    }
+
+    HAPRawBufferCopyBytes(&server->ble.broadcast.parameters, parameters, sizeof server->ble.broadcast.parameters);
+    return kHAPError_None;
+}
 
 HAP_RESULT_USE_CHECK
 HAPError HAPBLEAccessoryServerBroadcastGetParameters(
-        HAPPlatformKeyValueStoreRef keyValueStore,
+        HAPAccessoryServerRef* server_,
         uint16_t* keyExpirationGSN,
         HAPBLEAccessoryServerBroadcastEncryptionKey* _Nullable broadcastKey,
         HAPDeviceID* _Nullable advertisingID) {
-    HAPPrecondition(keyValueStore);
+    HAPPrecondition(server_);
+    HAPAccessoryServer* server = (HAPAccessoryServer*) server_;
     HAPPrecondition(keyExpirationGSN);
 
     HAPError err;
 
     // Get parameters.
     HAPBLEAccessoryServerBroadcastParameters parameters;
-    HAP_BLE_ACCESSORY_SERVER_GET_BROADCAST_PARAMETERS_OR_RETURN_ERROR(keyValueStore, &parameters);
+    err = GetParameters(server, &parameters);
+    if (err) {
+        HAPAssert(err == kHAPError_Unknown);
+        return err;
+    }
 
     // Copy result.
     *keyExpirationGSN = parameters.keyExpirationGSN;
@@ -84,7 +150,7 @@ HAPError HAPBLEAccessoryServerBroadcastGetParameters(
             // Fallback to Device ID.
             // See HomeKit Accessory Protocol Specification R14
             // Section 7.4.2.2.2 Manufacturer Data
-            err = HAPDeviceIDGet(keyValueStore, HAPNonnull(advertisingID));
+            err = HAPDeviceIDGet(server->platform.keyValueStore, HAPNonnull(advertisingID));
             if (err) {
                 HAPAssert(err == kHAPError_Unknown);
                 return err;
@@ -107,11 +173,15 @@ HAPError
 
     // Get state.
     HAPBLEAccessoryServerBroadcastParameters parameters;
-    HAP_BLE_ACCESSORY_SERVER_GET_BROADCAST_PARAMETERS_OR_RETURN_ERROR(server->platform.keyValueStore, &parameters);
+    err = GetParameters(server, &parameters);
+    if (err) {
+        HAPAssert(err == kHAPError_Unknown);
+        return err;
+    }
 
     // Get GSN.
     HAPBLEAccessoryServerGSN gsn;
-    err = HAPBLEAccessoryServerGetGSN(server->platform.keyValueStore, &gsn);
+    err = HAPBLEAccessoryServerGetGSN(session->server, &gsn);
     if (err) {
         HAPAssert(err == kHAPError_Unknown);
         return err;
@@ -188,21 +258,7 @@ HAPError
     }
 
     // Save.
-    uint8_t parametersBytes
-            [sizeof(uint16_t) + sizeof(HAPBLEAccessoryServerBroadcastEncryptionKey) + sizeof(uint8_t) +
-             sizeof(HAPDeviceID)];
-    HAPWriteLittleUInt16(&parametersBytes[0], parameters.keyExpirationGSN);
-    HAPAssert(sizeof parameters.key.value == 32);
-    HAPRawBufferCopyBytes(&parametersBytes[2], parameters.key.value, 32);
-    parametersBytes[34] = parameters.hasAdvertisingID ? (uint8_t) 0x01 : (uint8_t) 0x00;
-    HAPAssert(sizeof parameters.advertisingID.bytes == 6);
-    HAPRawBufferCopyBytes(&parametersBytes[35], parameters.advertisingID.bytes, 6);
-    err = HAPPlatformKeyValueStoreSet(
-            server->platform.keyValueStore,
-            kHAPKeyValueStoreDomain_Configuration,
-            kHAPKeyValueStoreKey_Configuration_BLEBroadcastParameters,
-            parametersBytes,
-            sizeof parametersBytes);
+    err = SaveParameters(server, &parameters);
     if (err) {
         HAPAssert(err == kHAPError_Unknown);
         return err;
@@ -213,16 +269,21 @@ HAPError
 
 HAP_RESULT_USE_CHECK
 HAPError HAPBLEAccessoryServerBroadcastSetAdvertisingID(
-        HAPPlatformKeyValueStoreRef keyValueStore,
+        HAPAccessoryServerRef* server_,
         const HAPDeviceID* advertisingID) {
-    HAPPrecondition(keyValueStore);
+    HAPPrecondition(server_);
+    HAPAccessoryServer* server = (HAPAccessoryServer*) server_;
     HAPPrecondition(advertisingID);
 
     HAPError err;
 
     // Get state.
     HAPBLEAccessoryServerBroadcastParameters parameters;
-    HAP_BLE_ACCESSORY_SERVER_GET_BROADCAST_PARAMETERS_OR_RETURN_ERROR(keyValueStore, &parameters);
+    err = GetParameters(server, &parameters);
+    if (err) {
+        HAPAssert(err == kHAPError_Unknown);
+        return err;
+    }
 
     // Copy advertising identifier.
     parameters.hasAdvertisingID = true;
@@ -230,21 +291,7 @@ HAPError HAPBLEAccessoryServerBroadcastSetAdvertisingID(
     HAPRawBufferCopyBytes(&parameters.advertisingID, advertisingID, sizeof parameters.advertisingID);
 
     // Save.
-    uint8_t parametersBytes
-            [sizeof(uint16_t) + sizeof(HAPBLEAccessoryServerBroadcastEncryptionKey) + sizeof(uint8_t) +
-             sizeof(HAPDeviceID)];
-    HAPWriteLittleUInt16(&parametersBytes[0], parameters.keyExpirationGSN);
-    HAPAssert(sizeof parameters.key.value == 32);
-    HAPRawBufferCopyBytes(&parametersBytes[2], parameters.key.value, 32);
-    parametersBytes[34] = parameters.hasAdvertisingID ? (uint8_t) 0x01 : (uint8_t) 0x00;
-    HAPAssert(sizeof parameters.advertisingID.bytes == 6);
-    HAPRawBufferCopyBytes(&parametersBytes[35], parameters.advertisingID.bytes, 6);
-    err = HAPPlatformKeyValueStoreSet(
-            keyValueStore,
-            kHAPKeyValueStoreDomain_Configuration,
-            kHAPKeyValueStoreKey_Configuration_BLEBroadcastParameters,
-            parametersBytes,
-            sizeof parametersBytes);
+    err = SaveParameters(server, &parameters);
     if (err) {
         HAPAssert(err == kHAPError_Unknown);
         return err;
@@ -254,8 +301,9 @@ HAPError HAPBLEAccessoryServerBroadcastSetAdvertisingID(
 }
 
 HAP_RESULT_USE_CHECK
-HAPError HAPBLEAccessoryServerBroadcastExpireKey(HAPPlatformKeyValueStoreRef keyValueStore) {
-    HAPPrecondition(keyValueStore);
+HAPError HAPBLEAccessoryServerBroadcastExpireKey(HAPAccessoryServerRef* server_) {
+    HAPPrecondition(server_);
+    HAPAccessoryServer* server = (HAPAccessoryServer*) server_;
 
     HAPError err;
 
@@ -263,28 +311,18 @@ HAPError HAPBLEAccessoryServerBroadcastExpireKey(HAPPlatformKeyValueStoreRef key
 
     // Get state.
     HAPBLEAccessoryServerBroadcastParameters parameters;
-    HAP_BLE_ACCESSORY_SERVER_GET_BROADCAST_PARAMETERS_OR_RETURN_ERROR(keyValueStore, &parameters);
+    err = GetParameters(server, &parameters);
+    if (err) {
+        HAPAssert(err == kHAPError_Unknown);
+        return err;
+    }
 
     // Expire encryption key.
     parameters.keyExpirationGSN = 0;
     HAPRawBufferZero(&parameters.key, sizeof parameters.key);
 
     // Save.
-    uint8_t parametersBytes
-            [sizeof(uint16_t) + sizeof(HAPBLEAccessoryServerBroadcastEncryptionKey) + sizeof(uint8_t) +
-             sizeof(HAPDeviceID)];
-    HAPWriteLittleUInt16(&parametersBytes[0], parameters.keyExpirationGSN);
-    HAPAssert(sizeof parameters.key.value == 32);
-    HAPRawBufferCopyBytes(&parametersBytes[2], parameters.key.value, 32);
-    parametersBytes[34] = parameters.hasAdvertisingID ? (uint8_t) 0x01 : (uint8_t) 0x00;
-    HAPAssert(sizeof parameters.advertisingID.bytes == 6);
-    HAPRawBufferCopyBytes(&parametersBytes[35], parameters.advertisingID.bytes, 6);
-    err = HAPPlatformKeyValueStoreSet(
-            keyValueStore,
-            kHAPKeyValueStoreDomain_Configuration,
-            kHAPKeyValueStoreKey_Configuration_BLEBroadcastParameters,
-            parametersBytes,
-            sizeof parametersBytes);
+    err = SaveParameters(server, &parameters);
     if (err) {
         HAPAssert(err == kHAPError_Unknown);
         return err;
@@ -292,3 +330,10 @@ HAPError HAPBLEAccessoryServerBroadcastExpireKey(HAPPlatformKeyValueStoreRef key
 
     return kHAPError_None;
 }
+
+void HAPBLEAccessoryServerBroadcastInvalidateCachedParameters(HAPAccessoryServerRef* server_) {
+    HAPPrecondition(server_);
+    HAPAccessoryServer* server = (HAPAccessoryServer*) server_;
+
+    HAPRawBufferZero(&server->ble.broadcast, sizeof server->ble.broadcast);
+}
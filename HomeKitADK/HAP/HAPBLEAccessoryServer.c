@@ -21,6 +21,7 @@ static void Create(HAPAccessoryServerRef* server_, const HAPAccessoryServerOptio
     HAPPrecondition(storage->gattTableElements);
     HAPPrecondition(storage->sessionCacheElements);
     HAPPrecondition(storage->numSessionCacheElements >= kHAPBLESessionCache_MinElements);
+    HAPPrecondition(storage->numSessionCacheElements < UINT16_MAX);
     HAPPrecondition(storage->session);
     HAPPrecondition(storage->procedures);
     HAPPrecondition(storage->numProcedures >= 1);
@@ -65,11 +66,13 @@ static void PrepareStart(HAPAccessoryServerRef* server_) {
 
     HAPBLEAccessoryServerStorage* storage = HAPNonnull(server->ble.storage);
     HAPRawBufferZero(storage->gattTableElements, storage->numGATTTableElements * sizeof *storage->gattTableElements);
-    HAPRawBufferZero(
-            storage->sessionCacheElements, storage->numSessionCacheElements * sizeof *storage->sessionCacheElements);
+    HAPPairingBLESessionCacheInvalidateAllEntries(server_);
     HAPRawBufferZero(storage->session, sizeof *storage->session);
     HAPRawBufferZero(storage->procedures, storage->numProcedures * sizeof *storage->procedures);
     HAPRawBufferZero(storage->procedureBuffer.bytes, storage->procedureBuffer.numBytes);
+
+    // The key-value store may have been modified while the server was stopped.
+    HAPBLEAccessoryServerInvalidateCachedState(server_);
 }
 
 static void Start(HAPAccessoryServerRef* server_) {
@@ -206,13 +209,16 @@ const HAPBLEAccessoryServerTransport kHAPAccessoryServerTransport_BLE = {
     .didRaiseEvent = HAPBLEAccessoryServerDidRaiseEvent,
     .updateAdvertisingData = UpdateAdvertisingData,
     .getGSN = HAPBLEAccessoryServerGetGSN,
-    .broadcast = { .expireKey = HAPBLEAccessoryServerBroadcastExpireKey },
+    .invalidateCachedState = HAPBLEAccessoryServerInvalidateCachedState,
+    .broadcast = { .expireKey = HAPBLEAccessoryServerBroadcastExpireKey,
+                   .invalidateCachedParameters = HAPBLEAccessoryServerBroadcastInvalidateCachedParameters },
     .peripheralManager = { .release = HAPBLEPeripheralManagerRelease,
                            .handleSessionAccept = HAPBLEPeripheralManagerHandleSessionAccept,
                            .handleSessionInvalidate = HAPBLEPeripheralManagerHandleSessionInvalidate },
     .sessionCache = { .fetch = HAPPairingBLESessionCacheFetch,
                       .save = HAPPairingBLESessionCacheSave,
-                      .invalidateEntriesForPairing = HAPPairingBLESessionCacheInvalidateEntriesForPairing },
+                      .invalidateEntriesForPairing = HAPPairingBLESessionCacheInvalidateEntriesForPairing,
+                      .invalidateAllEntries = HAPPairingBLESessionCacheInvalidateAllEntries },
     .session = { .create = HAPBLESessionCreate,
                  .release = HAPBLESessionRelease,
                  .invalidate = HAPBLESessionInvalidate,
@@ -39,11 +39,15 @@ struct HAPBLEAccessoryServerTransport {
     void (*updateAdvertisingData)(HAPAccessoryServerRef* server);
 
     HAP_RESULT_USE_CHECK
-    HAPError (*getGSN)(HAPPlatformKeyValueStoreRef keyValueStore, HAPBLEAccessoryServerGSN* gsn);
+    HAPError (*getGSN)(HAPAccessoryServerRef* server, HAPBLEAccessoryServerGSN* gsn);
+
+    void (*invalidateCachedState)(HAPAccessoryServerRef* server);
 
     struct {
         HAP_RESULT_USE_CHECK
-        HAPError (*expireKey)(HAPPlatformKeyValueStoreRef keyValueStore);
+        HAPError (*expireKey)(HAPAccessoryServerRef* server);
+
+        void (*invalidateCachedParameters)(HAPAccessoryServerRef* server);
     } broadcast;
 
     struct {
@@ -68,6 +72,8 @@ struct HAPBLEAccessoryServerTransport {
                 int pairingID);
 
         void (*invalidateEntriesForPairing)(HAPAccessoryServerRef* server_, int pairingID);
+
+        void (*invalidateAllEntries)(HAPAccessoryServerRef* server_);
     } sessionCache;
 
     struct {
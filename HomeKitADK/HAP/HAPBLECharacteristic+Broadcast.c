@@ -85,49 +85,154 @@ static HAPError GetBroadcastConfigurationEnumerateCallback(
 /**
  * Fetches the characteristic configuration for an accessory.
  *
+ * - The configuration is loaded from the key-value store once and then kept in the accessory server.
+ *
+ * @param      server               Accessory server.
  * @param      aid                  Accessory ID.
- * @param[out] found                Whether the characteristic configuration has been found.
- * @param[out] bytes                Buffer to store characteristic configuration, if found.
- * @param      maxBytes             Capacity of buffer. Must be at least 2 + 3 * #<concurrent active broadcasts> + 1.
- * @param[out] numBytes             Effective length of buffer, if found.
- * @param[out] key                  Key, if found.
- * @param      keyValueStore        Key-value store.
+ * @param[out] configuration        Characteristic configuration.
  *
  * @return kHAPError_None           If successful.
  * @return kHAPError_Unknown        If an I/O error occurred.
  */
 HAP_RESULT_USE_CHECK
 static HAPError GetBroadcastConfiguration(
+        HAPAccessoryServer* server,
         uint16_t aid,
-        bool* found,
-        void* bytes,
-        size_t maxBytes,
-        size_t* numBytes,
-        HAPPlatformKeyValueStoreKey* key,
-        HAPPlatformKeyValueStoreRef keyValueStore) {
+        HAPBLECharacteristicBroadcastConfiguration** configuration) {
+    HAPPrecondition(server);
     HAPPrecondition(aid);
-    HAPPrecondition(found);
+    HAPPrecondition(configuration);
+
+    HAPError err;
+
+    HAPBLECharacteristicBroadcastConfiguration* cache = &server->ble.broadcastConfiguration;
+    if (!cache->isLoaded) {
+        HAPRawBufferZero(cache, sizeof *cache);
+
+        bool found = false;
+        size_t numBytes;
+        uint8_t bytes[sizeof cache->bytes + 1];
+        HAPPlatformKeyValueStoreKey key;
+        GetBroadcastParametersEnumerateContext context = {
+            .aid = aid, .found = &found, .bytes = bytes, .maxBytes = sizeof bytes, .numBytes = &numBytes, .key = &key
+        };
+        err = HAPPlatformKeyValueStoreEnumerate(
+                server->platform.keyValueStore,
+                kHAPKeyValueStoreDomain_CharacteristicConfiguration,
+                GetBroadcastConfigurationEnumerateCallback,
+                &context);
+        if (err) {
+            HAPAssert(err == kHAPError_Unknown);
+            return err;
+        }
+        if (found) {
+            HAPAssert(numBytes >= 2 && numBytes <= sizeof cache->bytes && !((numBytes - 2) % 3));
+            HAPRawBufferCopyBytes(cache->bytes, bytes, numBytes);
+            cache->numBytes = (uint8_t) numBytes;
+            cache->key = key;
+            cache->found = true;
+        } else {
+            HAPWriteLittleUInt16(cache->bytes, aid);
+            cache->numBytes = 2;
+        }
+        cache->isLoaded = true;
+    }
+
+    HAPAssert(HAPReadLittleUInt16(cache->bytes) == aid);
+    *configuration = cache;
+    return kHAPError_None;
+}
+
+/**
+ * Finds the position of a characteristic in a characteristic configuration.
+ *
+ * - Entries are sorted by characteristic instance ID, so a binary search is used.
+ *
+ * @param      configuration        Characteristic configuration.
+ * @param      cid                  Characteristic instance ID.
+ * @param[out] offset               Offset of the entry, or offset at which the entry would need to be inserted.
+ *
+ * @return true                     If an entry for the characteristic exists.
+ * @return false                    Otherwise.
+ */
+HAP_RESULT_USE_CHECK
+static bool FindCharacteristic(
+        const HAPBLECharacteristicBroadcastConfiguration* configuration,
+        uint16_t cid,
+        size_t* offset) {
+    HAPPrecondition(configuration);
+    HAPPrecondition(configuration->numBytes >= 2 && !((configuration->numBytes - 2) % 3));
+    HAPPrecondition(offset);
+
+    size_t lo = 0;
+    size_t hi = (size_t)(configuration->numBytes - 2) / 3;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        uint16_t itemCID = HAPReadLittleUInt16(&configuration->bytes[2 + 3 * mid]);
+        if (itemCID < cid) {
+            lo = mid + 1;
+        } else if (itemCID > cid) {
+            hi = mid;
+        } else {
+            *offset = 2 + 3 * mid;
+            return true;
+        }
+    }
+    *offset = 2 + 3 * lo;
+    return false;
+}
+
+/**
+ * Saves a modified characteristic configuration to the key-value store and updates the cache.
+ *
+ * @param      server               Accessory server.
+ * @param      bytes                Characteristic configuration.
+ * @param      numBytes             Length of characteristic configuration.
+ *
+ * @return kHAPError_None           If successful.
+ * @return kHAPError_Unknown        If an I/O error occurred.
+ */
+HAP_RESULT_USE_CHECK
+static HAPError SaveBroadcastConfiguration(HAPAccessoryServer* server, const uint8_t* bytes, size_t numBytes) {
+    HAPPrecondition(server);
+    HAPBLECharacteristicBroadcastConfiguration* cache = &server->ble.broadcastConfiguration;
+    HAPPrecondition(cache->isLoaded);
     HAPPrecondition(bytes);
-    HAPPrecondition(maxBytes >= 3);
-    HAPPrecondition(numBytes);
-    HAPPrecondition(key);
-    HAPPrecondition(keyValueStore);
+    HAPPrecondition(numBytes >= 2 && numBytes <= sizeof cache->bytes && !((numBytes - 2) % 3));
 
     HAPError err;
 
-    *found = false;
-    GetBroadcastParametersEnumerateContext context = {
-        .aid = aid, .found = found, .bytes = bytes, .maxBytes = maxBytes, .numBytes = numBytes, .key = key
-    };
-    err = HAPPlatformKeyValueStoreEnumerate(
-            keyValueStore,
-            kHAPKeyValueStoreDomain_CharacteristicConfiguration,
-            GetBroadcastConfigurationEnumerateCallback,
-            &context);
+    if (numBytes == 2) {
+        if (cache->found) {
+            err = HAPPlatformKeyValueStoreRemove(
+                    server->platform.keyValueStore, kHAPKeyValueStoreDomain_CharacteristicConfiguration, cache->key);
+        } else {
+            err = kHAPError_None;
+        }
+    } else {
+        err = HAPPlatformKeyValueStoreSet(
+                server->platform.keyValueStore,
+                kHAPKeyValueStoreDomain_CharacteristicConfiguration,
+                cache->found ? cache->key : (HAPPlatformKeyValueStoreKey) 0,
+                bytes,
+                numBytes);
+    }
     if (err) {
         HAPAssert(err == kHAPError_Unknown);
+        // The stored state is unknown. Reload on next access.
+        cache->isLoaded = false;
         return err;
     }
+
+    HAPRawBufferCopyBytes(cache->bytes, bytes, numBytes);
+    cache->numBytes = (uint8_t) numBytes;
+    if (numBytes == 2) {
+        cache->key = 0;
+        cache->found = false;
+    } else if (!cache->found) {
+        cache->key = 0;
+        cache->found = true;
+    }
     return kHAPError_None;
 }
 
@@ -138,7 +243,7 @@ HAPError HAPBLECharacteristicGetBroadcastConfiguration(
         const HAPAccessory* accessory,
         bool* broadcastsEnabled,
         HAPBLECharacteristicBroadcastInterval* broadcastInterval,
-        HAPPlatformKeyValueStoreRef keyValueStore) {
+        HAPAccessoryServerRef* server_) {
     HAPPrecondition(characteristic_);
     const HAPBaseCharacteristic* characteristic = characteristic_;
     HAPPrecondition(characteristic->properties.ble.supportsBroadcastNotification);
@@ -146,7 +251,8 @@ HAPError HAPBLECharacteristicGetBroadcastConfiguration(
     HAPPrecondition(accessory);
     HAPPrecondition(broadcastsEnabled);
     HAPPrecondition(broadcastInterval);
-    HAPPrecondition(keyValueStore);
+    HAPPrecondition(server_);
+    HAPAccessoryServer* server = (HAPAccessoryServer*) server_;
 
     HAPError err;
 
@@ -156,51 +262,34 @@ HAPError HAPBLECharacteristicGetBroadcastConfiguration(
     uint16_t cid = (uint16_t) characteristic->iid;
 
     // Get configuration.
-    HAPPlatformKeyValueStoreKey key;
-    size_t numBytes;
-    uint8_t bytes[2 + 3 * 42 + 1]; // 128 + 1, allows for 42 concurrent broadcasts on a single KVS key.
-    bool found;
-    err = GetBroadcastConfiguration(aid, &found, bytes, sizeof bytes, &numBytes, &key, keyValueStore);
+    HAPBLECharacteristicBroadcastConfiguration* configuration;
+    err = GetBroadcastConfiguration(server, aid, &configuration);
     if (err) {
         HAPAssert(err == kHAPError_Unknown);
         return err;
     }
-    if (!found) {
-        *broadcastsEnabled = false;
-        return kHAPError_None;
-    }
-    HAPAssert(numBytes >= 2 && !((numBytes - 2) % 3));
-    HAPAssert(HAPReadLittleUInt16(bytes) == aid);
 
     // Find characteristic.
-    for (size_t i = 2; i < numBytes; i += 3) {
-        uint16_t itemCID = HAPReadLittleUInt16(&bytes[i]);
-        if (itemCID < cid) {
-            continue;
-        }
-        if (itemCID > cid) {
-            break;
-        }
-
-        // Found. Extract configuration.
-        uint8_t broadcastConfiguration = bytes[i + 2];
-        if (!HAPBLECharacteristicIsValidBroadcastInterval(broadcastConfiguration)) {
-            HAPLogCharacteristic(
-                    &logObject,
-                    characteristic,
-                    service,
-                    accessory,
-                    "Invalid stored broadcast interval: 0x%02x.",
-                    broadcastConfiguration);
-            return kHAPError_Unknown;
-        }
-        *broadcastsEnabled = true;
-        *broadcastInterval = (HAPBLECharacteristicBroadcastInterval) broadcastConfiguration;
+    size_t i;
+    if (!FindCharacteristic(configuration, cid, &i)) {
+        *broadcastsEnabled = false;
         return kHAPError_None;
     }
 
-    // Not found.
-    *broadcastsEnabled = false;
+    // Found. Extract configuration.
+    uint8_t broadcastConfiguration = configuration->bytes[i + 2];
+    if (!HAPBLECharacteristicIsValidBroadcastInterval(broadcastConfiguration)) {
+        HAPLogCharacteristic(
+                &logObject,
+                characteristic,
+                service,
+                accessory,
+                "Invalid stored broadcast interval: 0x%02x.",
+                broadcastConfiguration);
+        return kHAPError_Unknown;
+    }
+    *broadcastsEnabled = true;
+    *broadcastInterval = (HAPBLECharacteristicBroadcastInterval) broadcastConfiguration;
     return kHAPError_None;
 }
 
@@ -210,14 +299,15 @@ HAPError HAPBLECharacteristicEnableBroadcastNotifications(
         const HAPService* service,
         const HAPAccessory* accessory,
         HAPBLECharacteristicBroadcastInterval broadcastInterval,
-        HAPPlatformKeyValueStoreRef keyValueStore) {
+        HAPAccessoryServerRef* server_) {
     HAPPrecondition(characteristic_);
     const HAPBaseCharacteristic* characteristic = characteristic_;
     HAPPrecondition(characteristic->properties.ble.supportsBroadcastNotification);
     HAPPrecondition(service);
     HAPPrecondition(accessory);
     HAPPrecondition(HAPBLECharacteristicIsValidBroadcastInterval(broadcastInterval));
-    HAPPrecondition(keyValueStore);
+    HAPPrecondition(server_);
+    HAPAccessoryServer* server = (HAPAccessoryServer*) server_;
 
     HAPError err;
 
@@ -235,34 +325,19 @@ HAPError HAPBLECharacteristicEnableBroadcastNotifications(
     uint16_t cid = (uint16_t) characteristic->iid;
 
     // Get configuration.
-    HAPPlatformKeyValueStoreKey key;
-    size_t numBytes;
-    uint8_t bytes[2 + 3 * 42 + 1]; // 128 + 1, allows for 42 concurrent broadcasts on a single KVS key.
-    bool found;
-    err = GetBroadcastConfiguration(aid, &found, bytes, sizeof bytes, &numBytes, &key, keyValueStore);
+    HAPBLECharacteristicBroadcastConfiguration* configuration;
+    err = GetBroadcastConfiguration(server, aid, &configuration);
     if (err) {
         HAPAssert(err == kHAPError_Unknown);
         return err;
     }
-    if (!found) {
-        key = 0;
-        HAPWriteLittleUInt16(bytes, aid);
-        numBytes = 2;
-    }
-    HAPAssert(numBytes >= 2 && !((numBytes - 2) % 3));
-    HAPAssert(HAPReadLittleUInt16(bytes) == aid);
+    uint8_t bytes[sizeof configuration->bytes];
+    size_t numBytes = configuration->numBytes;
+    HAPRawBufferCopyBytes(bytes, configuration->bytes, numBytes);
 
     // Find characteristic.
     size_t i;
-    for (i = 2; i < numBytes; i += 3) {
-        uint16_t itemCID = HAPReadLittleUInt16(&bytes[i]);
-        if (itemCID < cid) {
-            continue;
-        }
-        if (itemCID > cid) {
-            break;
-        }
-
+    if (FindCharacteristic(configuration, cid, &i)) {
         // Found. Extract configuration.
         uint8_t broadcastConfiguration = bytes[i + 2];
         if (!HAPBLECharacteristicIsValidBroadcastInterval(broadcastConfiguration)) {
@@ -281,8 +356,7 @@ HAPError HAPBLECharacteristicEnableBroadcastNotifications(
             return kHAPError_None;
         }
         bytes[i + 2] = broadcastInterval;
-        err = HAPPlatformKeyValueStoreSet(
-                keyValueStore, kHAPKeyValueStoreDomain_CharacteristicConfiguration, key, bytes, numBytes);
+        err = SaveBroadcastConfiguration(server, bytes, numBytes);
         if (err) {
             HAPAssert(err == kHAPError_Unknown);
             return err;
@@ -291,7 +365,7 @@ HAPError HAPBLECharacteristicEnableBroadcastNotifications(
     }
 
     // Add configuration.
-    if (numBytes >= sizeof bytes - 1 - 3) {
+    if (numBytes + 3 > sizeof bytes) {
         HAPLogCharacteristic(
                 &logObject,
                 characteristic,
@@ -304,8 +378,7 @@ HAPError HAPBLECharacteristicEnableBroadcastNotifications(
     HAPWriteLittleUInt16(&bytes[i], cid);
     bytes[i + 2] = broadcastInterval;
     numBytes += 3;
-    err = HAPPlatformKeyValueStoreSet(
-            keyValueStore, kHAPKeyValueStoreDomain_CharacteristicConfiguration, key, bytes, numBytes);
+    err = SaveBroadcastConfiguration(server, bytes, numBytes);
     if (err) {
         HAPAssert(err == kHAPError_Unknown);
         return err;
@@ -318,13 +391,14 @@ HAPError HAPBLECharacteristicDisableBroadcastNotifications(
         const HAPCharacteristic* characteristic_,
         const HAPService* service,
         const HAPAccessory* accessory,
-        HAPPlatformKeyValueStoreRef keyValueStore) {
+        HAPAccessoryServerRef* server_) {
     HAPPrecondition(characteristic_);
     const HAPBaseCharacteristic* characteristic = characteristic_;
     HAPPrecondition(characteristic->properties.ble.supportsBroadcastNotification);
     HAPPrecondition(service);
     HAPPrecondition(accessory);
-    HAPPrecondition(keyValueStore);
+    HAPPrecondition(server_);
+    HAPAccessoryServer* server = (HAPAccessoryServer*) server_;
 
     HAPError err;
 
@@ -336,60 +410,42 @@ HAPError HAPBLECharacteristicDisableBroadcastNotifications(
     uint16_t cid = (uint16_t) characteristic->iid;
 
     // Get configuration.
-    HAPPlatformKeyValueStoreKey key;
-    size_t numBytes;
-    uint8_t bytes[2 + 3 * 42 + 1]; // 128 + 1, allows for 42 concurrent broadcasts on a single KVS key.
-    bool found;
-    err = GetBroadcastConfiguration(aid, &found, bytes, sizeof bytes, &numBytes, &key, keyValueStore);
+    HAPBLECharacteristicBroadcastConfiguration* configuration;
+    err = GetBroadcastConfiguration(server, aid, &configuration);
     if (err) {
         HAPAssert(err == kHAPError_Unknown);
         return err;
     }
-    if (!found) {
-        return kHAPError_None;
-    }
-    HAPAssert(numBytes >= 2 && !((numBytes - 2) % 3));
-    HAPAssert(HAPReadLittleUInt16(bytes) == aid);
 
     // Find characteristic.
     size_t i;
-    for (i = 2; i < numBytes; i += 3) {
-        uint16_t itemCID = HAPReadLittleUInt16(&bytes[i]);
-        if (itemCID < cid) {
-            continue;
-        }
-        if (itemCID > cid) {
-            break;
-        }
+    if (!FindCharacteristic(configuration, cid, &i)) {
+        return kHAPError_None;
+    }
 
-        // Found. Extract configuration.
-        uint8_t broadcastConfiguration = bytes[i + 2];
-        if (!HAPBLECharacteristicIsValidBroadcastInterval(broadcastConfiguration)) {
-            HAPLogCharacteristic(
-                    &logObject,
-                    characteristic,
-                    service,
-                    accessory,
-                    "Invalid stored broadcast interval: 0x%02x.",
-                    broadcastConfiguration);
-            return kHAPError_Unknown;
-        }
+    // Found. Extract configuration.
+    uint8_t broadcastConfiguration = configuration->bytes[i + 2];
+    if (!HAPBLECharacteristicIsValidBroadcastInterval(broadcastConfiguration)) {
+        HAPLogCharacteristic(
+                &logObject,
+                characteristic,
+                service,
+                accessory,
+                "Invalid stored broadcast interval: 0x%02x.",
+                broadcastConfiguration);
+        return kHAPError_Unknown;
+    }
 
-        // Remove configuration.
-        numBytes -= 3;
-        HAPRawBufferCopyBytes(&bytes[i], &bytes[i + 3], numBytes - i);
-        if (numBytes == 2) {
-            err = HAPPlatformKeyValueStoreRemove(
-                    keyValueStore, kHAPKeyValueStoreDomain_CharacteristicConfiguration, key);
-        } else {
-            err = HAPPlatformKeyValueStoreSet(
-                    keyValueStore, kHAPKeyValueStoreDomain_CharacteristicConfiguration, key, bytes, numBytes);
-        }
-        if (err) {
-            HAPAssert(err == kHAPError_Unknown);
-            return err;
-        }
-        return kHAPError_None;
+    // Remove configuration.
+    uint8_t bytes[sizeof configuration->bytes];
+    size_t numBytes = configuration->numBytes;
+    HAPRawBufferCopyBytes(bytes, configuration->bytes, numBytes);
+    numBytes -= 3;
+    HAPRawBufferCopyBytes(&bytes[i], &bytes[i + 3], numBytes - i);
+    err = SaveBroadcastConfiguration(server, bytes, numBytes);
+    if (err) {
+        HAPAssert(err == kHAPError_Unknown);
+        return err;
     }
     return kHAPError_None;
 }
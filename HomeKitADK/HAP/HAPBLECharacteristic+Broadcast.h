@@ -44,6 +44,37 @@ HAP_ENUM_BEGIN(uint8_t, HAPBLECharacteristicBroadcastInterval) { /** 20 ms (Defa
 HAP_RESULT_USE_CHECK
 bool HAPBLECharacteristicIsValidBroadcastInterval(uint8_t value);
 
+/**
+ * Maximum number of characteristics of an accessory for which broadcasts may be enabled at the same time.
+ */
+#define kHAPBLECharacteristic_MaxBroadcastConfigurations ((size_t) 42)
+
+/**
+ * Broadcast configuration of the characteristics of an accessory, as kept in the accessory server.
+ *
+ * - This mirrors the key-value store entry so that it does not have to be searched for each broadcasted event.
+ */
+typedef struct {
+    /**
+     * Serialized configuration: Accessory instance ID (UInt16), followed by one entry per characteristic
+     * for which broadcasts are enabled, sorted by characteristic instance ID.
+     * Each entry is made up of characteristic instance ID (UInt16) and broadcast interval (UInt8).
+     */
+    uint8_t bytes[2 + 3 * kHAPBLECharacteristic_MaxBroadcastConfigurations];
+
+    /** Length of the serialized configuration. */
+    uint8_t numBytes;
+
+    /** Key-value store key, if the configuration has been stored. */
+    HAPPlatformKeyValueStoreKey key;
+
+    /** Whether the configuration has been stored in the key-value store. */
+    bool found : 1;
+
+    /** Whether the configuration has been loaded from the key-value store. */
+    bool isLoaded : 1;
+} HAPBLECharacteristicBroadcastConfiguration;
+
 /**
  * Gets the broadcast configuration of a characteristic.
  *
@@ -52,7 +83,7 @@ bool HAPBLECharacteristicIsValidBroadcastInterval(uint8_t value);
  * @param      accessory            The accessory that provides the service.
  * @param[out] broadcastsEnabled    Whether broadcast notifications are enabled.
  * @param[out] broadcastInterval    Broadcast interval, if broadcast notifications are enabled.
- * @param      keyValueStore        Key-value store.
+ * @param      server               Accessory server.
  *
  * @return kHAPError_None           If successful.
  * @return kHAPError_Unknown        If an I/O error occurred.
@@ -67,7 +98,7 @@ HAPError HAPBLECharacteristicGetBroadcastConfiguration(
         const HAPAccessory* accessory,
         bool* broadcastsEnabled,
         HAPBLECharacteristicBroadcastInterval* broadcastInterval,
-        HAPPlatformKeyValueStoreRef keyValueStore);
+        HAPAccessoryServerRef* server);
 
 /**
  * Enables broadcasts for a characteristic.
@@ -76,7 +107,7 @@ HAPError HAPBLECharacteristicGetBroadcastConfiguration(
  * @param      service              The service that contains the characteristic.
  * @param      accessory            The accessory that provides the service.
  * @param      broadcastInterval    Broadcast interval.
- * @param      keyValueStore        Key-value store.
+ * @param      server               Accessory server.
  *
  * @return kHAPError_None           If successful.
  * @return kHAPError_Unknown        If an I/O error occurred.
@@ -90,7 +121,7 @@ HAPError HAPBLECharacteristicEnableBroadcastNotifications(
         const HAPService* service,
         const HAPAccessory* accessory,
         HAPBLECharacteristicBroadcastInterval broadcastInterval,
-        HAPPlatformKeyValueStoreRef keyValueStore);
+        HAPAccessoryServerRef* server);
 
 /**
  * Disables broadcasts for a characteristic.
@@ -98,7 +129,7 @@ HAPError HAPBLECharacteristicEnableBroadcastNotifications(
  * @param      characteristic       Characteristic. Characteristic must support broadcasts.
  * @param      service              The service that contains the characteristic.
  * @param      accessory            The accessory that provides the service.
- * @param      keyValueStore        Key-value store.
+ * @param      server               Accessory server.
  *
  * @return kHAPError_None           If successful.
  * @return kHAPError_Unknown        If an I/O error occurred.
@@ -111,7 +142,7 @@ HAPError HAPBLECharacteristicDisableBroadcastNotifications(
         const HAPCharacteristic* characteristic,
         const HAPService* service,
         const HAPAccessory* accessory,
-        HAPPlatformKeyValueStoreRef keyValueStore);
+        HAPAccessoryServerRef* server);
 
 #if __has_feature(nullability)
 #pragma clang assume_nonnull end
@@ -39,13 +39,13 @@ HAPError HAPBLECharacteristicHandleConfigurationRequest(
         const HAPService* service,
         const HAPAccessory* accessory,
         HAPTLVReaderRef* requestReader,
-        HAPPlatformKeyValueStoreRef keyValueStore) {
+        HAPAccessoryServerRef* server) {
     HAPPrecondition(characteristic_);
     const HAPBaseCharacteristic* characteristic = characteristic_;
     HAPPrecondition(service);
     HAPPrecondition(accessory);
     HAPPrecondition(requestReader);
-    HAPPrecondition(keyValueStore);
+    HAPPrecondition(server);
 
     HAPError err;
 
@@ -125,7 +125,7 @@ HAPError HAPBLECharacteristicHandleConfigurationRequest(
 
             // Enable broadcasts.
             err = HAPBLECharacteristicEnableBroadcastNotifications(
-                    characteristic, service, accessory, broadcastInterval, keyValueStore);
+                    characteristic, service, accessory, broadcastInterval, server);
             if (err) {
                 HAPAssert(err == kHAPError_Unknown);
                 return err;
@@ -145,7 +145,7 @@ HAPError HAPBLECharacteristicHandleConfigurationRequest(
             // Disable broadcasts if characteristic supports broadcasts.
             if (characteristic->properties.ble.supportsBroadcastNotification) {
                 err = HAPBLECharacteristicDisableBroadcastNotifications(
-                        characteristic, service, accessory, keyValueStore);
+                        characteristic, service, accessory, server);
                 if (err) {
                     HAPAssert(err == kHAPError_Unknown);
                     return err;
@@ -174,13 +174,13 @@ HAPError HAPBLECharacteristicGetConfigurationResponse(
         const HAPService* service,
         const HAPAccessory* accessory,
         HAPTLVWriterRef* responseWriter,
-        HAPPlatformKeyValueStoreRef keyValueStore) {
+        HAPAccessoryServerRef* server) {
     HAPPrecondition(characteristic_);
     const HAPBaseCharacteristic* characteristic = characteristic_;
     HAPPrecondition(service);
     HAPPrecondition(accessory);
     HAPPrecondition(responseWriter);
-    HAPPrecondition(keyValueStore);
+    HAPPrecondition(server);
 
     HAPError err;
     uint16_t properties = 0;
@@ -188,7 +188,7 @@ HAPError HAPBLECharacteristicGetConfigurationResponse(
         HAPBLECharacteristicBroadcastInterval broadcastInterval;
         bool broadcastsEnabled;
         err = HAPBLECharacteristicGetBroadcastConfiguration(
-                characteristic, service, accessory, &broadcastsEnabled, &broadcastInterval, keyValueStore);
+                characteristic, service, accessory, &broadcastsEnabled, &broadcastInterval, server);
         if (err) {
             HAPAssert(err == kHAPError_Unknown);
             return err;
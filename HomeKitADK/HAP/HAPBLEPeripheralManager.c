@@ -115,8 +115,15 @@ typedef struct {
          * Whether or not the characteristic value changed since the last read by the connected controller.
          *
          * - This is only maintained for HomeKit characteristics that support HAP Events.
+         *
+         * - If this is set, the element is part of the pending events queue.
          */
         bool pendingEvent : 1;
+
+        /**
+         * Next element in the pending events queue (index in the GATT table + 1). 0 if this is the last element.
+         */
+        uint16_t nextPendingEvent;
     } connectionState;
 } HAPBLEGATTTableElement;
 HAP_STATIC_ASSERT(sizeof(HAPBLEGATTTableElementRef) >= sizeof(HAPBLEGATTTableElement), HAPBLEGATTTableElement);
@@ -142,7 +149,9 @@ static void ResetEventState(HAPAccessoryServerRef* server_) {
 
         gattAttribute->connectionState.centralSubscribed = false;
         gattAttribute->connectionState.pendingEvent = false;
+        gattAttribute->connectionState.nextPendingEvent = 0;
     }
+    HAPRawBufferZero(&server->ble.connection.pendingEvents, sizeof server->ble.connection.pendingEvents);
 }
 
 /**
@@ -271,9 +280,28 @@ static void HandleDisconnectedCentral(
     }
 }
 
+/**
+ * Gets a GATT table element from the pending events queue.
+ *
+ * @param      server               Accessory server.
+ * @param      element              Element in the pending events queue (index in the GATT table + 1).
+ *
+ * @return GATT table element.
+ */
+HAP_RESULT_USE_CHECK
+static HAPBLEGATTTableElement* GetPendingEventGATTAttribute(HAPAccessoryServer* server, uint16_t element) {
+    HAPPrecondition(server);
+    HAPPrecondition(element && element <= server->ble.storage->numGATTTableElements);
+
+    return (HAPBLEGATTTableElement*) &server->ble.storage->gattTableElements[element - 1];
+}
+
 /**
  * Continues sending of pending HAP event notifications.
  *
+ * - Only the pending events queue is visited, in the order in which the events were raised.
+ *   Events that cannot be sent yet remain queued.
+ *
  * @param      server_              Accessory server.
  */
 static void SendPendingEventNotifications(HAPAccessoryServerRef* server_) {
@@ -287,23 +315,19 @@ static void SendPendingEventNotifications(HAPAccessoryServerRef* server_) {
 
     HAPError err;
 
-    for (size_t i = 0; i < server->ble.storage->numGATTTableElements; i++) {
-        HAPBLEGATTTableElement* gattAttribute = (HAPBLEGATTTableElement*) &server->ble.storage->gattTableElements[i];
+    uint16_t previous = 0;
+    uint16_t current = server->ble.connection.pendingEvents.first;
+    while (current) {
+        HAPBLEGATTTableElement* gattAttribute = GetPendingEventGATTAttribute(server, current);
+        uint16_t next = gattAttribute->connectionState.nextPendingEvent;
         const HAPBaseCharacteristic* characteristic = gattAttribute->characteristic;
         const HAPService* service = gattAttribute->service;
         const HAPAccessory* accessory = gattAttribute->accessory;
-        if (!accessory) {
-            break;
-        }
+        HAPAssert(accessory);
         HAPAssert(service);
-        if (!characteristic) {
-            continue;
-        }
-        if (!characteristic->properties.supportsEventNotification) {
-            HAPAssert(!gattAttribute->connectionState.centralSubscribed);
-            HAPAssert(!gattAttribute->connectionState.pendingEvent);
-            continue;
-        }
+        HAPAssert(characteristic);
+        HAPAssert(characteristic->properties.supportsEventNotification);
+        HAPAssert(gattAttribute->connectionState.pendingEvent);
         if (characteristic->iid > UINT16_MAX) {
             HAPLogCharacteristicError(
                     &logObject,
@@ -311,6 +335,8 @@ static void SendPendingEventNotifications(HAPAccessoryServerRef* server_) {
                     service,
                     accessory,
                     "Not sending Handle Value Indication because characteristic instance ID is not supported.");
+            previous = current;
+            current = next;
             continue;
         }
         HAPAssert(gattAttribute->valueHandle);
@@ -318,9 +344,8 @@ static void SendPendingEventNotifications(HAPAccessoryServerRef* server_) {
         HAPAssert(gattAttribute->iidHandle);
 
         if (!gattAttribute->connectionState.centralSubscribed) {
-            continue;
-        }
-        if (!gattAttribute->connectionState.pendingEvent) {
+            previous = current;
+            current = next;
             continue;
         }
         if (!HAPSessionIsSecured(session)) {
@@ -349,6 +374,8 @@ static void SendPendingEventNotifications(HAPAccessoryServerRef* server_) {
                     accessory,
                     "Not sending Handle Value Indication because event notification values will only be delivered to "
                     "controllers with admin permissions.");
+            previous = current;
+            current = next;
             continue;
         }
 
@@ -370,7 +397,18 @@ static void SendPendingEventNotifications(HAPAccessoryServerRef* server_) {
             HAPAssert(err == kHAPError_OutOfResources);
             HAPFatalError();
         }
+
+        // Remove from queue.
+        if (previous) {
+            GetPendingEventGATTAttribute(server, previous)->connectionState.nextPendingEvent = next;
+        } else {
+            server->ble.connection.pendingEvents.first = next;
+        }
+        if (server->ble.connection.pendingEvents.last == current) {
+            server->ble.connection.pendingEvents.last = previous;
+        }
         gattAttribute->connectionState.pendingEvent = false;
+        gattAttribute->connectionState.nextPendingEvent = 0;
         HAPLogCharacteristicInfo(&logObject, characteristic, service, accessory, "Sent event.");
 
         err = HAPBLEAccessoryServerDidSendEventNotification(server_, characteristic, service, accessory);
@@ -378,6 +416,10 @@ static void SendPendingEventNotifications(HAPAccessoryServerRef* server_) {
             HAPAssert(err == kHAPError_Unknown);
             HAPFatalError();
         }
+
+        // The queue may have been modified while the event was processed. Continue after the previous element.
+        current = previous ? GetPendingEventGATTAttribute(server, previous)->connectionState.nextPendingEvent :
+                             server->ble.connection.pendingEvents.first;
     }
 }
 
@@ -1654,8 +1696,22 @@ void HAPBLEPeripheralManagerRaiseEvent(
 
         if (gattAttribute->characteristic == characteristic && gattAttribute->service == service &&
             gattAttribute->accessory == accessory) {
-            HAPLogCharacteristicInfo(&logObject, characteristic, service, accessory, "Scheduling event.");
-            gattAttribute->connectionState.pendingEvent = true;
+            if (!gattAttribute->connectionState.pendingEvent) {
+                HAPLogCharacteristicInfo(&logObject, characteristic, service, accessory, "Scheduling event.");
+                HAPAssert(i < UINT16_MAX);
+                uint16_t element = (uint16_t)(i + 1);
+                if (server->ble.connection.pendingEvents.last) {
+                    GetPendingEventGATTAttribute(server, server->ble.connection.pendingEvents.last)
+                            ->connectionState.nextPendingEvent = element;
+                } else {
+                    server->ble.connection.pendingEvents.first = element;
+                }
+                server->ble.connection.pendingEvents.last = element;
+                gattAttribute->connectionState.pendingEvent = true;
+                gattAttribute->connectionState.nextPendingEvent = 0;
+            } else {
+                HAPLogCharacteristicInfo(&logObject, characteristic, service, accessory, "Event already scheduled.");
+            }
             SendPendingEventNotifications(server_);
             return;
         }
@@ -374,7 +374,7 @@ static HAPError HAPBLEProcedureProcessTransaction(HAPBLEProcedureRef* bleProcedu
 
             // Handle HAP-Characteristic-Configuration-Request.
             err = HAPBLECharacteristicHandleConfigurationRequest(
-                    characteristic, service, accessory, &request.bodyReader, server->platform.keyValueStore);
+                    characteristic, service, accessory, &request.bodyReader, bleProcedure->server);
             if (err) {
                 HAPAssert(err == kHAPError_Unknown || err == kHAPError_InvalidData);
                 HAPLogCharacteristic(
@@ -394,7 +394,7 @@ static HAPError HAPBLEProcedureProcessTransaction(HAPBLEProcedureRef* bleProcedu
 
             // Serialize HAP-Characteristic-Configuration-Response.
             err = HAPBLECharacteristicGetConfigurationResponse(
-                    characteristic, service, accessory, &writer, server->platform.keyValueStore);
+                    characteristic, service, accessory, &writer, bleProcedure->server);
             if (err) {
                 HAPAssert(err == kHAPError_Unknown || err == kHAPError_OutOfResources);
                 SEND_ERROR_AND_RETURN(kHAPBLEPDUStatus_InvalidRequest);
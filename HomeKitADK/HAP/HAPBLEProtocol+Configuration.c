@@ -35,7 +35,6 @@ HAPError HAPBLEProtocolHandleConfigurationRequest(
         bool* didRequestGetAll,
         HAPPlatformKeyValueStoreRef keyValueStore) {
     HAPPrecondition(server_);
-    HAPAccessoryServer* server = (HAPAccessoryServer*) server_;
     HAPPrecondition(session);
     HAPPrecondition(service);
     HAPPrecondition(accessory);
@@ -98,7 +97,7 @@ HAPError HAPBLEProtocolHandleConfigurationRequest(
             return err;
         }
     } else if (advertisingID) {
-        err = HAPBLEAccessoryServerBroadcastSetAdvertisingID(server->platform.keyValueStore, advertisingID);
+        err = HAPBLEAccessoryServerBroadcastSetAdvertisingID(server_, advertisingID);
         if (err) {
             HAPAssert(err == kHAPError_Unknown);
             return err;
@@ -148,7 +147,7 @@ HAPError HAPBLEProtocolGetConfigurationResponse(
 
     // HAP-Param-Current-State-Number.
     HAPBLEAccessoryServerGSN gsn;
-    err = HAPBLEAccessoryServerGetGSN(server->platform.keyValueStore, &gsn);
+    err = HAPBLEAccessoryServerGetGSN(server_, &gsn);
     if (err) {
         HAPAssert(err == kHAPError_Unknown);
         return err;
@@ -185,8 +184,7 @@ HAPError HAPBLEProtocolGetConfigurationResponse(
     uint16_t keyExpirationGSN;
     HAPBLEAccessoryServerBroadcastEncryptionKey broadcastKey;
     HAPDeviceID advertisingID;
-    err = HAPBLEAccessoryServerBroadcastGetParameters(
-            server->platform.keyValueStore, &keyExpirationGSN, &broadcastKey, &advertisingID);
+    err = HAPBLEAccessoryServerBroadcastGetParameters(server_, &keyExpirationGSN, &broadcastKey, &advertisingID);
     if (err) {
         HAPAssert(err == kHAPError_Unknown);
         return err;
@@ -52,6 +52,10 @@ void HAPIPByteBufferFlip(HAPIPByteBuffer* byteBuffer);
 /**
  * Discards bytes form a byte buffer.
  *
+ * - The bytes between @p numBytes and position are moved to the start of the buffer, e.g., data of a pipelined
+ *   request that has been received but not yet processed. Bytes after position are not moved.
+ * - Position and limit are reduced by @p numBytes.
+ *
  * @param      byteBuffer           Byte buffer.
  * @param      numBytes             Number of bytes to discard.
  */
@@ -270,7 +270,6 @@ HAPError HAPIPAccessorySerializeReadResponse(
         HAPAccessoryServerRef* server_,
         HAPIPSessionDescriptorRef* session,
         char* bytes,
-        size_t minBytes,
         size_t maxBytes,
         size_t* numBytes) {
     HAPPrecondition(context);
@@ -280,8 +279,7 @@ HAPError HAPIPAccessorySerializeReadResponse(
     HAPPrecondition(server->primaryAccessory);
     HAPPrecondition(session);
     HAPPrecondition(bytes);
-    HAPPrecondition(minBytes >= 1);
-    HAPPrecondition(maxBytes >= minBytes);
+    HAPPrecondition(maxBytes >= 1);
     HAPPrecondition(numBytes);
 
     HAPError err;
@@ -303,13 +301,23 @@ HAPError HAPIPAccessorySerializeReadResponse(
 
 #define GET_CURRENT_CHARACTERISTIC() ((const HAPBaseCharacteristic*) GetCurrentCharacteristic(context, server_))
 
+// Elements are only appended as a whole. If an element does not fit into the remaining space, the chunk is complete
+// and the element is serialized at the beginning of the next chunk instead.
+#define RETURN_CHUNK_FULL_OR_ERROR() \
+    do { \
+        if (*numBytes > 0) { \
+            return kHAPError_None; \
+        } \
+        HAPLogError(&logObject, "Not enough resources to serialize GET /accessories response."); \
+        return kHAPError_OutOfResources; \
+    } while (0)
+
 #define APPEND_STRING_OR_RETURN_ERROR(string) \
     do { \
         HAPAssert(*numBytes <= maxBytes); \
         size_t numStringBytes = HAPStringGetNumBytes(string); \
         if (maxBytes - *numBytes < numStringBytes) { \
-            HAPLogError(&logObject, "Not enough resources to serialize GET /accessories response."); \
-            return kHAPError_OutOfResources; \
+            RETURN_CHUNK_FULL_OR_ERROR(); \
         } \
         HAPRawBufferCopyBytes(&bytes[*numBytes], string, numStringBytes); \
         *numBytes += numStringBytes; \
@@ -326,8 +334,7 @@ HAPError HAPIPAccessorySerializeReadResponse(
         scratchBytes[0] = '"'; \
         scratchBytes[numScratchBytes - 1] = '"'; \
         if (maxBytes - *numBytes < numScratchBytes) { \
-            HAPLogError(&logObject, "Not enough resources to serialize GET /accessories response."); \
-            return kHAPError_OutOfResources; \
+            RETURN_CHUNK_FULL_OR_ERROR(); \
         } \
         HAPRawBufferCopyBytes(&bytes[*numBytes], scratchBytes, numScratchBytes); \
         *numBytes += numScratchBytes; \
@@ -341,8 +348,7 @@ HAPError HAPIPAccessorySerializeReadResponse(
         HAPAssert(!err); \
         size_t numScratchBytes = HAPStringGetNumBytes(scratchBytes); \
         if (maxBytes - *numBytes < numScratchBytes) { \
-            HAPLogError(&logObject, "Not enough resources to serialize GET /accessories response."); \
-            return kHAPError_OutOfResources; \
+            RETURN_CHUNK_FULL_OR_ERROR(); \
         } \
         HAPRawBufferCopyBytes(&bytes[*numBytes], scratchBytes, numScratchBytes); \
         *numBytes += numScratchBytes; \
@@ -356,8 +362,7 @@ HAPError HAPIPAccessorySerializeReadResponse(
         HAPAssert(!err); \
         size_t numScratchBytes = HAPStringGetNumBytes(scratchBytes); \
         if (maxBytes - *numBytes < numScratchBytes) { \
-            HAPLogError(&logObject, "Not enough resources to serialize GET /accessories response."); \
-            return kHAPError_OutOfResources; \
+            RETURN_CHUNK_FULL_OR_ERROR(); \
         } \
         HAPRawBufferCopyBytes(&bytes[*numBytes], scratchBytes, numScratchBytes); \
         *numBytes += numScratchBytes; \
@@ -371,8 +376,7 @@ HAPError HAPIPAccessorySerializeReadResponse(
         HAPAssert(!err); \
         size_t numScratchBytes = HAPStringGetNumBytes(scratchBytes); \
         if (maxBytes - *numBytes < numScratchBytes) { \
-            HAPLogError(&logObject, "Not enough resources to serialize GET /accessories response."); \
-            return kHAPError_OutOfResources; \
+            RETURN_CHUNK_FULL_OR_ERROR(); \
         } \
         HAPRawBufferCopyBytes(&bytes[*numBytes], scratchBytes, numScratchBytes); \
         *numBytes += numScratchBytes; \
@@ -862,8 +866,7 @@ HAPError HAPIPAccessorySerializeReadResponse(
 
                 HAPAssert(*numBytes <= maxBytes);
                 if (maxBytes - *numBytes < 2) {
-                    HAPLogError(&logObject, "Not enough resources to serialize GET /accessories response.");
-                    return kHAPError_OutOfResources;
+                    RETURN_CHUNK_FULL_OR_ERROR();
                 }
                 // Buffer 'bytes' has enough capacity to store at least an empty string including quotation marks.
 
@@ -904,6 +907,29 @@ HAPError HAPIPAccessorySerializeReadResponse(
                         baseCharacteristic->properties.ip.controlPoint &&
                         (baseCharacteristic->format == kHAPCharacteristicFormat_TLV8)) {
                     APPEND_STRING_OR_RETURN_ERROR("\"\"");
+                } else if (
+                        readResult.status == kHAPIPAccessoryServerStatusCode_OutOfResources &&
+                        (baseCharacteristic->format == kHAPCharacteristicFormat_String ||
+                         baseCharacteristic->format == kHAPCharacteristicFormat_Data ||
+                         baseCharacteristic->format == kHAPCharacteristicFormat_TLV8) &&
+                        *numBytes > 0) {
+                    // The value does not fit into the remaining space. Retry at the beginning of the next chunk.
+                    return kHAPError_None;
+                } else if (
+                        readResult.status == kHAPIPAccessoryServerStatusCode_OutOfResources &&
+                        (baseCharacteristic->format == kHAPCharacteristicFormat_String ||
+                         baseCharacteristic->format == kHAPCharacteristicFormat_Data ||
+                         baseCharacteristic->format == kHAPCharacteristicFormat_TLV8)) {
+                    HAPLogCharacteristicError(
+                            &logObject,
+                            baseCharacteristic,
+                            service,
+                            accessory,
+                            "Value does not fit into a chunk of %zu bytes. Sending %s value.",
+                            maxBytes,
+                            baseCharacteristic->format == kHAPCharacteristicFormat_TLV8 ? "empty" : "null");
+                    APPEND_STRING_OR_RETURN_ERROR(
+                            baseCharacteristic->format == kHAPCharacteristicFormat_TLV8 ? "\"\"" : "null");
                 } else if (readResult.status != 0) {
                     if (baseCharacteristic->format == kHAPCharacteristicFormat_TLV8) {
                         HAPLogCharacteristicInfo(
@@ -942,8 +968,20 @@ HAPError HAPIPAccessorySerializeReadResponse(
                                     &readResult.value.stringValue.numBytes);
                             if (err) {
                                 HAPAssert(err == kHAPError_OutOfResources);
-                                HAPLogError(&logObject, "Not enough resources to serialize GET /accessories response.");
-                                return err;
+                                if (*numBytes > 0) {
+                                    return kHAPError_None;
+                                }
+                                HAPLogCharacteristicError(
+                                        &logObject,
+                                        baseCharacteristic,
+                                        service,
+                                        accessory,
+                                        "Escaped value does not fit into a chunk of %zu bytes. Sending %s value.",
+                                        maxBytes,
+                                        baseCharacteristic->format == kHAPCharacteristicFormat_TLV8 ? "empty" : "null");
+                                APPEND_STRING_OR_RETURN_ERROR(
+                                        baseCharacteristic->format == kHAPCharacteristicFormat_TLV8 ? "\"\"" : "null");
+                                break;
                             }
                             bytes[*numBytes] = '"';
                             bytes[*numBytes + 1 + readResult.value.stringValue.numBytes] = '"';
@@ -1124,24 +1162,21 @@ HAPError HAPIPAccessorySerializeReadResponse(
 
                 HAPAssert(*numBytes <= maxBytes);
                 if (maxBytes - *numBytes < 2) {
-                    HAPLogError(&logObject, "Not enough resources to serialize GET /accessories response.");
-                    return kHAPError_OutOfResources;
+                    RETURN_CHUNK_FULL_OR_ERROR();
                 }
                 // Buffer 'bytes' has enough capacity to store at least an empty string including quotation marks.
 
                 const char* manufacturerDescription = HAPNonnull(baseCharacteristic->manufacturerDescription);
                 size_t numManufacturerDescriptionBytes = HAPStringGetNumBytes(manufacturerDescription);
                 if (maxBytes - *numBytes - 2 < numManufacturerDescriptionBytes) {
-                    HAPLogError(&logObject, "Not enough resources to serialize GET /accessories response.");
-                    return kHAPError_OutOfResources;
+                    RETURN_CHUNK_FULL_OR_ERROR();
                 }
                 HAPRawBufferCopyBytes(&bytes[*numBytes + 1], manufacturerDescription, numManufacturerDescriptionBytes);
                 err = HAPJSONUtilsEscapeStringData(
                         &bytes[*numBytes + 1], maxBytes - *numBytes - 2, &numManufacturerDescriptionBytes);
                 if (err) {
                     HAPAssert(err == kHAPError_OutOfResources);
-                    HAPLogError(&logObject, "Not enough resources to serialize GET /accessories response.");
-                    return err;
+                    RETURN_CHUNK_FULL_OR_ERROR();
                 }
                 bytes[*numBytes] = '"';
                 bytes[*numBytes + 1 + numManufacturerDescriptionBytes] = '"';
@@ -1739,13 +1774,14 @@ HAPError HAPIPAccessorySerializeReadResponse(
                 HAPFatalError();
         }
         HAPFatalError();
-    } while ((*numBytes < minBytes) && (context->state != kHAPIPAccessorySerializationState_ResponseIsComplete));
+    } while (context->state != kHAPIPAccessorySerializationState_ResponseIsComplete);
 
 #undef APPEND_FLOAT_OR_RETURN_ERROR
 #undef APPEND_INT32_OR_RETURN_ERROR
 #undef APPEND_UINT64_OR_RETURN_ERROR
 #undef APPEND_UUID_OR_RETURN_ERROR
 #undef APPEND_STRING_OR_RETURN_ERROR
+#undef RETURN_CHUNK_FULL_OR_ERROR
 
 #undef GET_CURRENT_CHARACTERISTIC
 #undef GET_CURRENT_SERVICE
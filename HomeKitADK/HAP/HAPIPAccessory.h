@@ -67,16 +67,21 @@ bool HAPIPAccessorySerializationIsComplete(HAPIPAccessorySerializationContext* c
 /**
  * Incrementally serializes a GET /accessories response.
  *
+ * - Serializes as much of the response as fits into @p bytes. Serialization stops before the first element that
+ *   does not fit into the remaining space and continues with it on the next invocation.
+ *
+ * - Characteristic values are read when they are serialized. If a read fails while the buffer is not empty,
+ *   the value is read again on the next invocation in case it did not fit into the remaining space.
+ *
  * @param      context              Serialization context to incrementally serialize the response.
  * @param      server               Accessory server.
  * @param      session              IP session descriptor.
  * @param[out] bytes                Buffer to fill.
- * @param      minBytes             Minimum number of bytes to serialize, until the response is complete.
- * @param      maxBytes             Maximum number of bytes to serialize in a single invocation of this function.
+ * @param      maxBytes             Capacity of @p bytes.
  * @param      numBytes             Number of bytes serialized.
  *
  * @return kHAPError_None           If successful.
- * @return kHAPError_OutOfResources If the supplied buffer is not large enough.
+ * @return kHAPError_OutOfResources If the next element does not fit into an empty buffer of @p maxBytes.
  */
 HAP_RESULT_USE_CHECK
 HAPError HAPIPAccessorySerializeReadResponse(
@@ -84,7 +89,6 @@ HAPError HAPIPAccessorySerializeReadResponse(
         HAPAccessoryServerRef* server,
         HAPIPSessionDescriptorRef* session,
         char* bytes,
-        size_t minBytes,
         size_t maxBytes,
         size_t* numBytes);
 
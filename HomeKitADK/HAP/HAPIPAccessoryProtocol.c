@@ -1059,6 +1059,50 @@ error:
     return kHAPError_OutOfResources;
 }
 
+/**
+ * Extracts the contents of a JSON string that has just been read, in place.
+ *
+ * - The returned string data points into @p bytes. Escape sequences are only resolved
+ *   if the reader encountered any while reading the string.
+ *
+ * @param      r                    Reader that has just completed reading the string.
+ * @param      bytes                JSON string including the enclosing quotation marks.
+ * @param      numBytes             Length of @p bytes.
+ * @param[out] stringBytes          String data.
+ * @param[out] numStringBytes       Length of @p stringBytes.
+ *
+ * @return kHAPError_None           If successful.
+ * @return kHAPError_InvalidData    If the string is not valid UTF-8 or contains invalid escape sequences.
+ */
+HAP_RESULT_USE_CHECK
+static HAPError get_string_value(
+        const struct util_json_reader* r,
+        char* bytes,
+        size_t numBytes,
+        char* _Nullable* _Nonnull stringBytes,
+        size_t* numStringBytes) {
+    HAPAssert(r != NULL);
+    HAPAssert(r->state == util_JSON_READER_STATE_COMPLETED_STRING);
+    HAPAssert(bytes != NULL);
+    HAPAssert(numBytes >= 2);
+    HAPAssert(stringBytes != NULL);
+    HAPAssert(numStringBytes != NULL);
+
+    *stringBytes = &bytes[1];
+    *numStringBytes = numBytes - 2;
+    if (!HAPUTF8IsValidData(&bytes[1], numBytes - 2)) {
+        return kHAPError_InvalidData;
+    }
+    if (r->string_has_escapes) {
+        HAPError err = HAPJSONUtilsUnescapeStringData(&bytes[1], numStringBytes);
+        if (err) {
+            HAPAssert(err == kHAPError_InvalidData);
+            return err;
+        }
+    }
+    return kHAPError_None;
+}
+
 HAP_RESULT_USE_CHECK
 static size_t read_characteristic_write_request_parameters(
         struct util_json_reader* r,
@@ -1236,16 +1280,12 @@ static size_t read_characteristic_write_request_parameters(
                 }
                 HAPAssert(i <= k);
                 HAPAssert(k <= length);
-                HAPAssert(k - i >= 2);
-                parameters->value.stringValue.bytes = &buffer[i + 1];
-                parameters->value.stringValue.numBytes = k - i - 2;
-                if (!HAPUTF8IsValidData(
-                            HAPNonnull(parameters->value.stringValue.bytes), parameters->value.stringValue.numBytes)) {
-                    *err = kHAPError_InvalidData;
-                    goto exit;
-                }
-                *err = HAPJSONUtilsUnescapeStringData(
-                        HAPNonnull(parameters->value.stringValue.bytes), &parameters->value.stringValue.numBytes);
+                *err = get_string_value(
+                        r,
+                        &buffer[i],
+                        k - i,
+                        &parameters->value.stringValue.bytes,
+                        &parameters->value.stringValue.numBytes);
                 if (*err) {
                     HAPAssert(*err == kHAPError_InvalidData);
                     goto exit;
@@ -1342,16 +1382,12 @@ static size_t read_characteristic_write_request_parameters(
         }
         HAPAssert(i <= k);
         HAPAssert(k <= length);
-        HAPAssert(k - i >= 2);
-        parameters->authorizationData.bytes = &buffer[i + 1];
-        parameters->authorizationData.numBytes = k - i - 2;
-        if (!HAPUTF8IsValidData(
-                    HAPNonnull(parameters->authorizationData.bytes), parameters->authorizationData.numBytes)) {
-            *err = kHAPError_InvalidData;
-            goto exit;
-        }
-        *err = HAPJSONUtilsUnescapeStringData(
-                HAPNonnull(parameters->authorizationData.bytes), &parameters->authorizationData.numBytes);
+        *err = get_string_value(
+                r,
+                &buffer[i],
+                k - i,
+                &parameters->authorizationData.bytes,
+                &parameters->authorizationData.numBytes);
         if (*err) {
             HAPAssert(*err == kHAPError_InvalidData);
             goto exit;
@@ -1478,6 +1514,7 @@ static size_t read_characteristic_write_request(
         size_t length,
         HAPIPWriteContextRef** contexts,
         size_t* numWriteContexts,
+        size_t* maxWriteContexts,
         HAPError* err) {
     size_t k;
     HAPIPWriteRequestParameters parameters;
@@ -1485,6 +1522,8 @@ static size_t read_characteristic_write_request(
     HAPAssert(buffer != NULL);
     HAPAssert(contexts != NULL);
     HAPAssert(numWriteContexts != NULL);
+    HAPAssert(maxWriteContexts != NULL);
+    HAPAssert(*numWriteContexts <= *maxWriteContexts);
     HAPAssert(err != NULL);
     *err = kHAPError_None;
     HAPRawBufferZero(&parameters, sizeof parameters);
@@ -1508,7 +1547,15 @@ static size_t read_characteristic_write_request(
         goto exit;
     }
     if ((parameters.aid.isDefined) && (parameters.iid.isDefined)) {
-        HAPIPWriteContextRef* contexts2 = realloc(*contexts, (*numWriteContexts + 1) * sizeof *contexts2);
+        // Grow the context array geometrically so that large batches do not reallocate per write request.
+        HAPIPWriteContextRef* contexts2 = *contexts;
+        if (*numWriteContexts == *maxWriteContexts) {
+            size_t maxWriteContexts2 = *maxWriteContexts ? *maxWriteContexts * 2 : 4;
+            contexts2 = realloc(*contexts, maxWriteContexts2 * sizeof *contexts2);
+            if (contexts2 != NULL) {
+                *maxWriteContexts = maxWriteContexts2;
+            }
+        }
         if (contexts2 != NULL) {
             HAPIPWriteContext* writeContext = (HAPIPWriteContext*) &contexts2[*numWriteContexts];
             HAPRawBufferZero(writeContext, sizeof *writeContext);
@@ -1543,6 +1590,7 @@ static size_t read_characteristic_write_request(
             free(*contexts);
             *contexts = NULL;
             *numWriteContexts = 0;
+            *maxWriteContexts = 0;
             *err = kHAPError_OutOfResources;
         }
     } else {
@@ -1566,6 +1614,7 @@ HAPError HAPIPAccessoryProtocolGetCharacteristicWriteRequests(
     // Section 6.7.2 Writing Characteristics
     struct util_json_reader json_reader;
     size_t i, j, k, n;
+    size_t maxWriteContexts = 0;
     uint64_t x;
 
     HAPAssert(bytes != NULL);
@@ -1613,7 +1662,13 @@ HAPError HAPIPAccessoryProtocolGetCharacteristicWriteRequests(
             HAPAssert(k <= numBytes);
             do {
                 k += read_characteristic_write_request(
-                        &json_reader, &bytes[k], numBytes - k, writeContexts, numWriteContexts, &err);
+                        &json_reader,
+                        &bytes[k],
+                        numBytes - k,
+                        writeContexts,
+                        numWriteContexts,
+                        &maxWriteContexts,
+                        &err);
                 if (err) {
                     return err;
                 }
@@ -1681,62 +1736,11 @@ HAPError HAPIPAccessoryProtocolGetCharacteristicWriteRequests(
     return kHAPError_None;
 }
 
-HAP_RESULT_USE_CHECK
-size_t HAPIPAccessoryProtocolGetNumCharacteristicWriteResponseBytes(
-        HAPAccessoryServerRef* server,
-        HAPIPWriteContextRef* writeContexts,
-        size_t numWriteContexts) {
-    HAPPrecondition(server);
-    HAPPrecondition(writeContexts);
-
-    size_t r, i;
-
-    r = 22;
-    for (i = 0; i < numWriteContexts; i++) {
-        HAPIPWriteContext* writeContext = (HAPIPWriteContext*) &writeContexts[i];
-        r += (i == 0 ? 25 : 26) + HAPUInt64GetNumDescriptionBytes(writeContext->aid) +
-             HAPUInt64GetNumDescriptionBytes(writeContext->iid) + HAPInt32GetNumDescriptionBytes(writeContext->status);
-        if ((writeContext->status == 0) && writeContext->response) {
-            r += 9;
-            const HAPBaseCharacteristic* chr_ = GetCharacteristic(server, writeContext->aid, writeContext->iid);
-            HAPAssert(chr_);
-            switch (chr_->format) {
-                case kHAPCharacteristicFormat_Bool: {
-                    r += 1;
-                } break;
-                case kHAPCharacteristicFormat_UInt8:
-                case kHAPCharacteristicFormat_UInt16:
-                case kHAPCharacteristicFormat_UInt32:
-                case kHAPCharacteristicFormat_UInt64: {
-                    r += HAPUInt64GetNumDescriptionBytes(writeContext->value.unsignedIntValue);
-                } break;
-                case kHAPCharacteristicFormat_Int: {
-                    r += HAPInt32GetNumDescriptionBytes(writeContext->value.intValue);
-                } break;
-                case kHAPCharacteristicFormat_Float: {
-                    r += HAPJSONUtilsGetFloatNumDescriptionBytes(writeContext->value.floatValue);
-                } break;
-                case kHAPCharacteristicFormat_String:
-                case kHAPCharacteristicFormat_TLV8:
-                case kHAPCharacteristicFormat_Data: {
-                    r += 2 + HAPJSONUtilsGetNumEscapedStringDataBytes(
-                                     HAPNonnull(writeContext->value.stringValue.bytes),
-                                     writeContext->value.stringValue.numBytes);
-                } break;
-            }
-        }
-    }
-    HAPAssert(i == numWriteContexts);
-    return r;
-}
-
 HAP_RESULT_USE_CHECK
 HAPError HAPIPAccessoryProtocolGetCharacteristicWriteResponseBytes(
-        HAPAccessoryServerRef* server,
         HAPIPWriteContextRef* writeContexts,
         size_t numWriteContexts,
         HAPIPByteBuffer* buffer) {
-    HAPPrecondition(server);
     HAPPrecondition(writeContexts);
     HAPPrecondition(buffer);
 
@@ -1768,9 +1772,7 @@ HAPError HAPIPAccessoryProtocolGetCharacteristicWriteResponseBytes(
             goto error;
         }
         if ((writeContext->status == 0) && writeContext->response) {
-            const HAPBaseCharacteristic* chr_ = GetCharacteristic(server, writeContext->aid, writeContext->iid);
-            HAPAssert(chr_);
-            switch (chr_->format) {
+            switch (writeContext->format) {
                 case kHAPCharacteristicFormat_Bool: {
                     err = HAPIPByteBufferAppendStringWithFormat(
                             buffer, ",\"value\":%s", writeContext->value.unsignedIntValue ? "1" : "0");
@@ -1805,6 +1807,13 @@ HAPError HAPIPAccessoryProtocolGetCharacteristicWriteResponseBytes(
                     if (err) {
                         goto error;
                     }
+                    // Escaping may grow the value in place.
+                    HAPIPByteBufferEnsureHeadroom(
+                            buffer,
+                            HAPJSONUtilsGetNumEscapedStringDataBytes(
+                                    HAPNonnull(writeContext->value.stringValue.bytes),
+                                    writeContext->value.stringValue.numBytes) +
+                                    1);
                     size_t bufferMark = buffer->position;
                     err = HAPIPByteBufferAppendStringWithFormat(buffer, "%s", writeContext->value.stringValue.bytes);
                     if (err) {
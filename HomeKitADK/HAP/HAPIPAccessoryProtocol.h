@@ -17,6 +17,51 @@ extern "C" {
 #pragma clang assume_nonnull begin
 #endif
 
+/**
+ * HAP Status Codes.
+ *
+ * @see HomeKit Accessory Protocol Specification R14
+ *      Table 6-11 HAP Status Codes
+ */
+/**@{*/
+/** This specifies a success for the request. */
+#define kHAPIPAccessoryServerStatusCode_Success ((int32_t) 0)
+
+/** Request denied due to insufficient privileges. */
+#define kHAPIPAccessoryServerStatusCode_InsufficientPrivileges ((int32_t) -70401)
+
+/** Unable to perform operation with requested service or characteristic. */
+#define kHAPIPAccessoryServerStatusCode_UnableToPerformOperation ((int32_t) -70402)
+
+/** Resource is busy, try again. */
+#define kHAPIPAccessoryServerStatusCode_ResourceIsBusy ((int32_t) -70403)
+
+/** Cannot write to read only characteristic. */
+#define kHAPIPAccessoryServerStatusCode_WriteToReadOnlyCharacteristic ((int32_t) -70404)
+
+/** Cannot read from a write only characteristic. */
+#define kHAPIPAccessoryServerStatusCode_ReadFromWriteOnlyCharacteristic ((int32_t) -70405)
+
+/** Notification is not supported for characteristic. */
+#define kHAPIPAccessoryServerStatusCode_NotificationNotSupported ((int32_t) -70406)
+
+/** Out of resources to process request. */
+#define kHAPIPAccessoryServerStatusCode_OutOfResources ((int32_t) -70407)
+
+/** Operation timed out. */
+#define kHAPIPAccessoryServerStatusCode_OperationTimedOut ((int32_t) -70408)
+
+/** Resource does not exist. */
+#define kHAPIPAccessoryServerStatusCode_ResourceDoesNotExist ((int32_t) -70409)
+
+/** Accessory received an invalid value in a write request. */
+#define kHAPIPAccessoryServerStatusCode_InvalidValueInWrite ((int32_t) -70410)
+
+/** Insufficient Authorization. */
+#define kHAPIPAccessoryServerStatusCode_InsufficientAuthorization ((int32_t) -70411)
+
+/**@}*/
+
 #define kHAPIPAccessoryProtocolAID_PrimaryAccessory ((uint64_t) 1)
 
 #define kHAPIPAccessoryProtocolIID_AccessoryInformation ((uint64_t) 1)
@@ -101,16 +146,21 @@ typedef struct {
     bool remote;
     HAPIPEventNotificationState ev;
     bool response;
+    bool deferred;
+    HAPCharacteristicFormat format; /**< Format of the characteristic. Set once the write has been handled. */
 } HAPIPWriteContext;
 HAP_STATIC_ASSERT(sizeof(HAPIPWriteContextRef) >= sizeof(HAPIPWriteContext), HAPIPWriteContext);
 
 /**
  * Parses a PUT /characteristic request.
  *
+ * - String values and authorization data point into @p bytes. Escape sequences are resolved in place,
+ *   strings without escape sequences are left untouched.
+ *
  * @param      bytes                Bytes
  * @param      numBytes             Length of @p bytes.
- * @param[out] writeContexts        Contexts to store data about the received write requests.
- * @param      maxWriteContexts     Capacity of @p writeContexts.
+ * @param[out] writeContexts        Contexts to store data about the received write requests. Allocated by this
+ *                                  function and must be freed by the caller.
  * @param[out] numWriteContexts     Number of valid contexts.
  * @param[out] hasPID               True if a PID was specified. False otherwise.
  * @param[out] pid                  PID, if a PID was specified.
@@ -128,15 +178,21 @@ HAPError HAPIPAccessoryProtocolGetCharacteristicWriteRequests(
         bool* hasPID,
         uint64_t* pid);
 
-HAP_RESULT_USE_CHECK
-size_t HAPIPAccessoryProtocolGetNumCharacteristicWriteResponseBytes(
-        HAPAccessoryServerRef* server,
-        HAPIPWriteContextRef* writeContexts,
-        size_t numWriteContexts);
-
+/**
+ * Serializes the body of a PUT /characteristics Multi-Status response.
+ *
+ * - Values of writes with write response are serialized according to the format that has been recorded in the
+ *   write context while the write was handled.
+ *
+ * @param      writeContexts        Contexts of the handled write requests.
+ * @param      numWriteContexts     Length of @p writeContexts.
+ * @param      buffer               Buffer to append the response body to.
+ *
+ * @return kHAPError_None           If successful.
+ * @return kHAPError_OutOfResources If @p buffer is not large enough.
+ */
 HAP_RESULT_USE_CHECK
 HAPError HAPIPAccessoryProtocolGetCharacteristicWriteResponseBytes(
-        HAPAccessoryServerRef* server,
         HAPIPWriteContextRef* writeContexts,
         size_t numWriteContexts,
         HAPIPByteBuffer* buffer);
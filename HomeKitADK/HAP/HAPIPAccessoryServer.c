@@ -22,46 +22,20 @@ static const HAPLogObject logObject = { .subsystem = kHAP_LogSubsystem, .categor
 #define kHAPIPAccessoryServerCharacter_Space ((char) 32)
 
 /**
- * HAP Status Codes.
+ * Maximum number of bytes per chunk of a GET /accessories response, including its framing.
  *
- * @see HomeKit Accessory Protocol Specification R14
- *      Table 6-11 HAP Status Codes
+ * - Bounds the outbound buffer of a session during GET /accessories, independent of the attribute database size.
+ *
+ * - Individual attributes must fit into a single chunk. Characteristic values that do not fit are sent as null,
+ *   or as an empty string for TLV8 values. With the default of one full security frame this applies to string,
+ *   data and TLV8 values longer than roughly 1000 bytes after encoding and escaping.
  */
-/**@{*/
-/** This specifies a success for the request. */
-#define kHAPIPAccessoryServerStatusCode_Success ((int32_t) 0)
-
-/** Request denied due to insufficient privileges. */
-#define kHAPIPAccessoryServerStatusCode_InsufficientPrivileges ((int32_t) -70401)
-
-/** Unable to perform operation with requested service or characteristic. */
-#define kHAPIPAccessoryServerStatusCode_UnableToPerformOperation ((int32_t) -70402)
-
-/** Resource is busy, try again. */
-#define kHAPIPAccessoryServerStatusCode_ResourceIsBusy ((int32_t) -70403)
-
-/** Cannot write to read only characteristic. */
-#define kHAPIPAccessoryServerStatusCode_WriteToReadOnlyCharacteristic ((int32_t) -70404)
-
-/** Cannot read from a write only characteristic. */
-#define kHAPIPAccessoryServerStatusCode_ReadFromWriteOnlyCharacteristic ((int32_t) -70405)
-
-/** Notification is not supported for characteristic. */
-#define kHAPIPAccessoryServerStatusCode_NotificationNotSupported ((int32_t) -70406)
-
-/** Out of resources to process request. */
-#define kHAPIPAccessoryServerStatusCode_OutOfResources ((int32_t) -70407)
-
-/** Resource does not exist. */
-#define kHAPIPAccessoryServerStatusCode_ResourceDoesNotExist ((int32_t) -70409)
-
-/** Accessory received an invalid value in a write request. */
-#define kHAPIPAccessoryServerStatusCode_InvalidValueInWrite ((int32_t) -70410)
-
-/** Insufficient Authorization. */
-#define kHAPIPAccessoryServerStatusCode_InsufficientAuthorization ((int32_t) -70411)
-
-/**@}*/
+#ifndef kHAPIPAccessoryServer_MaxAccessorySerializationChunkBytes
+#define kHAPIPAccessoryServer_MaxAccessorySerializationChunkBytes (kHAPIPSecurityProtocol_MaxFrameBytes)
+#endif
+HAP_STATIC_ASSERT(
+        kHAPIPAccessoryServer_MaxAccessorySerializationChunkBytes <= kHAPIPSecurityProtocol_MaxFrameBytes,
+        accessory_serialization_chunk);
 
 /**
  * Predefined HTTP/1.1 response indicating successful request completion with an empty response body.
@@ -145,6 +119,16 @@ static const HAPLogObject logObject = { .subsystem = kHAP_LogSubsystem, .categor
  */
 #define kHAPIPAccessoryServer_MaxEventNotificationDelay ((HAPTime)(1 * HAPSecond))
 
+/**
+ * Maximum time a deferred characteristic request may stay pending.
+ *
+ * - Reads and writes that have not been completed by then are reported as timed out, and the session resumes.
+ *   Later completions of the request are ignored.
+ */
+#ifndef kHAPIPAccessoryServer_MaxDeferredRequestTime
+#define kHAPIPAccessoryServer_MaxDeferredRequestTime ((HAPTime)(10 * HAPSecond))
+#endif
+
 static void log_result(HAPLogType type, char* msg, int result, const char* function, const char* file, int line) {
     HAPAssert(msg);
     HAPAssert(function);
@@ -397,6 +381,11 @@ static void schedule_max_idle_time_timer(HAPAccessoryServerRef* server_) {
         if ((session->state == kHAPIPSessionState_Reading) && (session->inboundBuffer.position == 0) &&
             (server->ip.state == kHAPIPAccessoryServerState_Stopping)) {
             CloseSession(session);
+        } else if (
+                (session->state == kHAPIPSessionState_Processing) && session->deferredRequest &&
+                (server->ip.state == kHAPIPAccessoryServerState_Stopping)) {
+            // Deferred requests are not waited for. Their completions are ignored once the session is closed.
+            CloseSession(session);
         } else if (
                 ((session->state == kHAPIPSessionState_Reading) || (session->state == kHAPIPSessionState_Writing)) &&
                 // We (mos PAL) have our own connection management and eviction logic.
@@ -492,6 +481,12 @@ static void CloseSession(HAPIPSessionDescriptor* session) {
     }
     free(session->eventNotifications);
     session->eventNotifications = NULL;
+    if (session->deferredRequest) {
+        HAPLogDebug(&logObject, "session:%p:dropping deferred request", (const void*) session);
+        free(session->deferredRequest->writeContexts);
+        free(session->deferredRequest);
+        session->deferredRequest = NULL;
+    }
     if (session->securitySession.isOpen) {
         HAPLogDebug(&logObject, "session:%p:closing security context", (const void*) session);
         switch (session->securitySession.type) {
@@ -528,6 +523,28 @@ static void CloseSession(HAPIPSessionDescriptor* session) {
     HAPLogDebug(&logObject, "session:%p:closed", (const void*) session);
 }
 
+/**
+ * Gets the IP session of an IP session descriptor.
+ *
+ * @param      session              IP session descriptor.
+ *
+ * @return IP session.
+ */
+HAP_RESULT_USE_CHECK
+static HAPIPSession* GetIPSession(HAPIPSessionDescriptor* session) {
+    HAPPrecondition(session);
+    HAPPrecondition(session->server);
+    HAPAccessoryServer* server = (HAPAccessoryServer*) session->server;
+
+    for (size_t i = 0; i < server->ip.storage->numSessions; i++) {
+        HAPIPSession* ipSession = &server->ip.storage->sessions[i];
+        if ((HAPIPSessionDescriptor*) &ipSession->descriptor == session) {
+            return ipSession;
+        }
+    }
+    HAPFatalError();
+}
+
 static void OpenSecuritySession(HAPIPSessionDescriptor* session) {
     HAPPrecondition(session);
     HAPPrecondition(session->server);
@@ -550,6 +567,65 @@ static void write_msg(HAPIPByteBuffer* b, const char* msg) {
     }
 }
 
+/**
+ * Offsets of the HTTP tokens parsed so far, relative to the start of the inbound buffer.
+ */
+typedef struct {
+    size_t method;
+    size_t uri;
+    size_t headerFieldName;
+    size_t headerFieldValue;
+} HTTPTokenOffsets;
+
+/**
+ * Offset of a HTTP token that has not been encountered yet.
+ */
+#define kHTTPTokenOffset_None SIZE_MAX
+
+HAP_RESULT_USE_CHECK
+static size_t get_http_token_offset(const HAPIPByteBuffer* b, const char* _Nullable bytes) {
+    HAPPrecondition(b);
+
+    if (!bytes) {
+        return kHTTPTokenOffset_None;
+    }
+    HAPAssert(bytes >= b->data && bytes <= &b->data[b->position]);
+    return (size_t)(bytes - b->data);
+}
+
+HAP_RESULT_USE_CHECK
+static char* _Nullable get_http_token_bytes(const HAPIPByteBuffer* b, size_t offset) {
+    HAPPrecondition(b);
+
+    if (offset == kHTTPTokenOffset_None) {
+        return NULL;
+    }
+    HAPAssert(offset <= b->position);
+    return &b->data[offset];
+}
+
+static void get_http_token_offsets(const HAPIPSessionDescriptor* session, HTTPTokenOffsets* offsets) {
+    HAPPrecondition(session);
+    HAPPrecondition(offsets);
+
+    const HAPIPByteBuffer* b = &session->inboundBuffer;
+    offsets->method = get_http_token_offset(b, session->httpMethod.bytes);
+    offsets->uri = get_http_token_offset(b, session->httpURI.bytes);
+    offsets->headerFieldName = get_http_token_offset(b, session->httpHeaderFieldName.bytes);
+    offsets->headerFieldValue = get_http_token_offset(b, session->httpHeaderFieldValue.bytes);
+}
+
+static void set_http_token_offsets(HAPIPSessionDescriptor* session, const HTTPTokenOffsets* offsets) {
+    HAPPrecondition(session);
+    HAPPrecondition(offsets);
+
+    const HAPIPByteBuffer* b = &session->inboundBuffer;
+    session->httpMethod.bytes = get_http_token_bytes(b, offsets->method);
+    session->httpURI.bytes = get_http_token_bytes(b, offsets->uri);
+    session->httpHeaderFieldName.bytes = get_http_token_bytes(b, offsets->headerFieldName);
+    session->httpHeaderFieldValue.bytes = get_http_token_bytes(b, offsets->headerFieldValue);
+}
+
 static void prepare_reading_request(HAPIPSessionDescriptor* session) {
     HAPPrecondition(session);
     HAPPrecondition(session->server);
@@ -563,6 +639,7 @@ static void prepare_reading_request(HAPIPSessionDescriptor* session) {
     session->httpHeaderFieldValue.bytes = NULL;
     session->httpContentLength.isDefined = false;
     session->httpContentType = kHAPIPAccessoryServerContentType_Unknown;
+    session->httpHasContentType = false;
 }
 
 static void handle_input(HAPIPSessionDescriptor* session);
@@ -633,10 +710,24 @@ static void put_prepare(HAPIPSessionDescriptor* session) {
     }
 }
 
+/**
+ * Writes the response to a PUT /characteristics request.
+ *
+ * - If all writes succeeded without write response, 204 No Content is sent without serializing any statuses.
+ *
+ * - Otherwise, the Multi-Status body is serialized into the outbound buffer,
+ *   and the header is inserted in front of it once the content length is known.
+ *
+ * @param      session              IP session descriptor.
+ * @param      contexts             Contexts of the handled write requests.
+ * @param      contexts_count       Length of @p contexts.
+ * @param      allSucceeded         Whether all writes succeeded without write response.
+ */
 static void write_characteristic_write_response(
         HAPIPSessionDescriptor* session,
         HAPIPWriteContextRef* contexts,
-        size_t contexts_count) {
+        size_t contexts_count,
+        bool allSucceeded) {
     HAPPrecondition(session);
     HAPPrecondition(session->server);
     HAPPrecondition(session->securitySession.type == kHAPIPSecuritySessionType_HAP);
@@ -645,40 +736,48 @@ static void write_characteristic_write_response(
     HAPPrecondition(!HAPSessionIsTransient(&session->securitySession._.hap));
 
     HAPError err;
-    size_t content_length, mark;
+    size_t content_length, header_length, mark;
+    char header[128];
+
+    if (allSucceeded) {
+        write_msg(&session->outboundBuffer, kHAPIPAccessoryServerResponse_NoContent);
+        return;
+    }
 
     HAPAssert(contexts);
     HAPAssert(session->outboundBuffer.data || session->outboundBuffer.isDynamic);
     HAPAssert(session->outboundBuffer.position <= session->outboundBuffer.limit);
     HAPAssert(session->outboundBuffer.limit <= session->outboundBuffer.capacity);
-    content_length = HAPIPAccessoryProtocolGetNumCharacteristicWriteResponseBytes(
-            HAPNonnull(session->server), contexts, contexts_count);
-    HAP_DIAGNOSTIC_IGNORED_ICCARM(Pa084)
-    if (content_length <= UINT32_MAX) {
-        mark = session->outboundBuffer.position;
-        err = HAPIPByteBufferAppendStringWithFormat(
-                &session->outboundBuffer,
+    mark = session->outboundBuffer.position;
+    err = HAPIPAccessoryProtocolGetCharacteristicWriteResponseBytes(contexts, contexts_count, &session->outboundBuffer);
+    if (!err) {
+        content_length = session->outboundBuffer.position - mark;
+        HAP_DIAGNOSTIC_IGNORED_ICCARM(Pa084)
+        HAPAssert(content_length <= UINT32_MAX);
+        HAP_DIAGNOSTIC_RESTORE_ICCARM(Pa084)
+        err = HAPStringWithFormat(
+                header,
+                sizeof header,
                 "HTTP/1.1 207 Multi-Status\r\n"
                 "Content-Type: application/hap+json\r\n"
                 "Content-Length: %lu\r\n\r\n",
                 (unsigned long) content_length);
         HAPAssert(!err);
-        HAPIPByteBufferEnsureHeadroom(&session->outboundBuffer, content_length);
-        if (content_length <= session->outboundBuffer.limit - session->outboundBuffer.position) {
-            mark = session->outboundBuffer.position;
-            err = HAPIPAccessoryProtocolGetCharacteristicWriteResponseBytes(
-                    HAPNonnull(session->server), contexts, contexts_count, &session->outboundBuffer);
-            HAPAssert(!err && (session->outboundBuffer.position - mark == content_length));
-        } else {
-            HAPLog(&logObject, "Out of resources (outbound buffer too small).");
-            session->outboundBuffer.position = mark;
-            write_msg(&session->outboundBuffer, kHAPIPAccessoryServerResponse_OutOfResources);
+        header_length = HAPStringGetNumBytes(header);
+        HAPIPByteBufferEnsureHeadroom(&session->outboundBuffer, header_length);
+        if (header_length <= session->outboundBuffer.limit - session->outboundBuffer.position) {
+            HAPRawBufferCopyBytes(
+                    &session->outboundBuffer.data[mark + header_length],
+                    &session->outboundBuffer.data[mark],
+                    content_length);
+            HAPRawBufferCopyBytes(&session->outboundBuffer.data[mark], header, header_length);
+            session->outboundBuffer.position += header_length;
+            return;
         }
-    } else {
-        HAPLog(&logObject, "Content length exceeding UINT32_MAX.");
-        write_msg(&session->outboundBuffer, kHAPIPAccessoryServerResponse_OutOfResources);
     }
-    HAP_DIAGNOSTIC_RESTORE_ICCARM(Pa084)
+    HAPLog(&logObject, "Out of resources (outbound buffer too small).");
+    session->outboundBuffer.position = mark;
+    write_msg(&session->outboundBuffer, kHAPIPAccessoryServerResponse_OutOfResources);
 }
 
 static void schedule_event_notifications(HAPAccessoryServerRef* server_);
@@ -696,6 +795,26 @@ static void handle_event_notification_timer(HAPPlatformTimerRef timer, void* _Nu
 
 static void write_event_notifications(HAPIPSessionDescriptor* session);
 
+/**
+ * Returns whether event notifications may be sent on a session.
+ *
+ * - Event notifications are only sent between requests, i.e., when no request has been partially parsed and
+ *   no response is pending. Pipelined requests that have been received but not yet parsed do not block
+ *   event notifications, so that events are interleaved between their responses instead of being starved.
+ *
+ * @param      session              Session.
+ *
+ * @return true                     If event notifications may be sent.
+ * @return false                    Otherwise.
+ */
+HAP_RESULT_USE_CHECK
+static bool can_write_event_notifications(const HAPIPSessionDescriptor* session) {
+    HAPPrecondition(session);
+
+    return (session->state == kHAPIPSessionState_Reading) && (session->httpReaderPosition == 0) &&
+           (session->numEventNotificationFlags > 0);
+}
+
 static void schedule_event_notifications(HAPAccessoryServerRef* server_) {
     HAPPrecondition(server_);
     HAPAccessoryServer* server = (HAPAccessoryServer*) server_;
@@ -714,8 +833,7 @@ static void schedule_event_notifications(HAPAccessoryServerRef* server_) {
             continue;
         }
 
-        if ((session->state == kHAPIPSessionState_Reading) && (session->inboundBuffer.position == 0) &&
-            (session->numEventNotificationFlags > 0)) {
+        if (can_write_event_notifications(session)) {
             write_event_notifications(session);
         }
     }
@@ -730,8 +848,7 @@ static void schedule_event_notifications(HAPAccessoryServerRef* server_) {
             continue;
         }
 
-        if ((session->state == kHAPIPSessionState_Reading) && (session->inboundBuffer.position == 0) &&
-            (session->numEventNotificationFlags > 0)) {
+        if (can_write_event_notifications(session)) {
             HAPAssert(clock_now_ms >= session->eventNotificationStamp);
             HAPTime dt_ms = clock_now_ms - session->eventNotificationStamp;
             HAP_DIAGNOSTIC_PUSH
@@ -1323,7 +1440,10 @@ static int handle_characteristic_write_requests(
     HAPPrecondition(dataBuffer);
 
     int r = 0;
+    HAPIPSession* ipSession = GetIPSession(session);
 
+    // The characteristic format is recorded with the status so that the response can be serialized without looking
+    // up the characteristics again.
     for (size_t i = 0; i < numContexts; i++) {
         HAPIPWriteContext* writeContext = (HAPIPWriteContext*) &contexts[i];
         const HAPCharacteristic* characteristic;
@@ -1333,20 +1453,12 @@ static int handle_characteristic_write_requests(
         if (characteristic) {
             HAPAssert(service);
             HAPAssert(accessory);
-            server->ip.characteristicWriteRequestContext.ipSession = NULL;
-            for (size_t j = 0; j < server->ip.storage->numSessions; j++) {
-                HAPIPSession* ipSession = &server->ip.storage->sessions[j];
-                HAPIPSessionDescriptor* t = (HAPIPSessionDescriptor*) &ipSession->descriptor;
-                if (t->server && (t == session)) {
-                    HAPAssert(!server->ip.characteristicWriteRequestContext.ipSession);
-                    server->ip.characteristicWriteRequestContext.ipSession = ipSession;
-                }
-            }
-            HAPAssert(server->ip.characteristicWriteRequestContext.ipSession);
+            server->ip.characteristicWriteRequestContext.ipSession = ipSession;
             server->ip.characteristicWriteRequestContext.characteristic = characteristic;
             server->ip.characteristicWriteRequestContext.service = service;
             server->ip.characteristicWriteRequestContext.accessory = accessory;
             const HAPBaseCharacteristic* baseCharacteristic = characteristic;
+            writeContext->format = baseCharacteristic->format;
             if ((writeContext->type != kHAPIPWriteValueType_None) &&
                 baseCharacteristic->properties.requiresTimedWrite && !timedWrite) {
                 // If the accessory receives a standard write request on a characteristic which requires timed write,
@@ -1361,8 +1473,13 @@ static int handle_characteristic_write_requests(
                         "Rejected write: Only timed writes are supported.");
                 writeContext->status = kHAPIPAccessoryServerStatusCode_InvalidValueInWrite;
             } else {
+                server->ip.deferrableRequestContext.ipSession = ipSession;
+                server->ip.deferrableRequestContext.writeContext = &contexts[i];
+                server->ip.deferrableRequestContext.writeIndex = (uint32_t) i;
+                server->ip.deferrableRequestContext.isDeferred = false;
                 handle_characteristic_write_request(
                         session, characteristic, service, accessory, &contexts[i], dataBuffer);
+                HAPRawBufferZero(&server->ip.deferrableRequestContext, sizeof server->ip.deferrableRequestContext);
             }
             server->ip.characteristicWriteRequestContext.ipSession = NULL;
             server->ip.characteristicWriteRequestContext.characteristic = NULL;
@@ -1399,6 +1516,35 @@ static void put_characteristics(HAPIPSessionDescriptor* session) {
     HAPIPByteBuffer data_buffer;
     HAPIPWriteContextRef* writeContexts = NULL;
 
+    if (session->deferredRequest) {
+        // All deferred writes have been completed.
+        HAPIPDeferredRequest* deferredRequest = session->deferredRequest;
+        HAPAssert(!deferredRequest->numPending);
+        HAPAssert(deferredRequest->writeContexts);
+        writeContexts = deferredRequest->writeContexts;
+        contexts_count = deferredRequest->numWriteContexts;
+        pid_valid = deferredRequest->timedWrite;
+        free(deferredRequest);
+        session->deferredRequest = NULL;
+
+        HAPLogDebug(&logObject, "session:%p:completing deferred write request", (const void*) session);
+        r = 0;
+        for (i = 0; i < contexts_count; i++) {
+            const HAPIPWriteContext* writeContext = (const HAPIPWriteContext*) &writeContexts[i];
+            HAPAssert(!writeContext->deferred);
+            if ((writeContext->status != kHAPIPAccessoryServerStatusCode_Success) || writeContext->response) {
+                r = -1;
+            }
+        }
+        write_characteristic_write_response(session, writeContexts, contexts_count, r == 0);
+        if (session->timedWriteExpirationTime && pid_valid) {
+            session->timedWriteExpirationTime = 0;
+            session->timedWritePID = 0;
+        }
+        free(writeContexts);
+        return;
+    }
+
     HAPAssert(session->inboundBuffer.data);
     HAPAssert(session->inboundBuffer.position <= session->inboundBuffer.limit);
     HAPAssert(session->inboundBuffer.limit <= session->inboundBuffer.capacity);
@@ -1427,7 +1573,7 @@ static void put_characteristics(HAPIPSessionDescriptor* session) {
                             kHAPIPAccessoryServerStatusCode_InvalidValueInWrite;
                 }
                 HAPAssert(i == contexts_count);
-                write_characteristic_write_response(session, writeContexts, contexts_count);
+                write_characteristic_write_response(session, writeContexts, contexts_count, false);
             } else if (contexts_count == 0) {
                 write_msg(&session->outboundBuffer, kHAPIPAccessoryServerResponse_NoContent);
             } else {
@@ -1440,11 +1586,16 @@ static void put_characteristics(HAPIPSessionDescriptor* session) {
                 HAPAssert(data_buffer.limit <= data_buffer.capacity);
                 r = handle_characteristic_write_requests(
                         session, writeContexts, contexts_count, &data_buffer, pid_valid);
-                if (r == 0) {
-                    write_msg(&session->outboundBuffer, kHAPIPAccessoryServerResponse_NoContent);
-                } else {
-                    write_characteristic_write_response(session, writeContexts, contexts_count);
+                if (session->deferredRequest) {
+                    // Wait until all deferred writes have been completed. The request is handled again afterwards.
+                    HAPLogDebug(&logObject, "session:%p:write request deferred", (const void*) session);
+                    session->deferredRequest->writeContexts = writeContexts;
+                    session->deferredRequest->numWriteContexts = contexts_count;
+                    session->deferredRequest->timedWrite = pid_valid;
+                    session->state = kHAPIPSessionState_Processing;
+                    return;
                 }
+                write_characteristic_write_response(session, writeContexts, contexts_count, r == 0);
             }
             // Reset timed write transaction.
             if (session->timedWriteExpirationTime && pid_valid) {
@@ -1755,6 +1906,7 @@ static int handle_characteristic_read_requests(
         HAPIPByteBuffer* data_buffer) {
     HAPPrecondition(session);
     HAPPrecondition(session->server);
+    HAPAccessoryServer* server = (HAPAccessoryServer*) session->server;
     HAPPrecondition(session->securitySession.type == kHAPIPSecuritySessionType_HAP);
     HAPPrecondition(session->securitySession.isOpen);
     HAPPrecondition(session->securitySession.isSecured || kHAPIPAccessoryServer_SessionSecurityDisabled);
@@ -1801,6 +1953,7 @@ static int handle_characteristic_read_requests(
                             chr->properties.ip.controlPoint) {
                         readContext->status = kHAPIPAccessoryServerStatusCode_UnableToPerformOperation;
                     } else {
+                        server->ip.deferrableRequestContext.isDeferred = false;
                         handle_characteristic_read_request(session, chr, svc, acc, &contexts[i], data_buffer);
                     }
                 } else {
@@ -1837,6 +1990,18 @@ static void get_characteristics(HAPIPSessionDescriptor* session) {
     HAPIPReadRequestParameters parameters;
     HAPIPByteBuffer data_buffer;
 
+    bool isResumed = session->deferredRequest != NULL;
+    bool isTimedOut = false;
+    if (isResumed) {
+        // All deferred reads have been completed. The request is handled again from scratch.
+        HAPAssert(!session->deferredRequest->numPending);
+        HAPAssert(!session->deferredRequest->writeContexts);
+        isTimedOut = session->deferredRequest->timedOut;
+        free(session->deferredRequest);
+        session->deferredRequest = NULL;
+        HAPLogDebug(&logObject, "session:%p:completing deferred read request", (const void*) session);
+    }
+
     HAPAssert(
             (session->httpURI.numBytes >= 16) &&
             HAPRawBufferAreEqual(HAPNonnull(session->httpURI.bytes), "/characteristics", 16));
@@ -1858,8 +2023,27 @@ static void get_characteristics(HAPIPSessionDescriptor* session) {
                 HAPAssert(data_buffer.data);
                 HAPAssert(data_buffer.position <= data_buffer.limit);
                 HAPAssert(data_buffer.limit <= data_buffer.capacity);
+                // A resumed read is served without allowing its handlers to defer again so that it always completes.
+                server->ip.deferrableRequestContext.ipSession = isResumed ? NULL : GetIPSession(session);
                 r = handle_characteristic_read_requests(
                         session, kHAPIPSessionContext_GetCharacteristics, readContexts, contexts_count, &data_buffer);
+                HAPRawBufferZero(&server->ip.deferrableRequestContext, sizeof server->ip.deferrableRequestContext);
+                if (session->deferredRequest) {
+                    // Wait until all deferred reads have been completed. The request is handled again afterwards.
+                    HAPLogDebug(&logObject, "session:%p:read request deferred", (const void*) session);
+                    session->state = kHAPIPSessionState_Processing;
+                    free(readContexts);
+                    return;
+                }
+                if (isTimedOut) {
+                    // Handlers that still cannot provide their value report busy. Their reads have timed out.
+                    for (size_t i = 0; i < contexts_count; i++) {
+                        HAPIPReadContext* readContext = (HAPIPReadContext*) &readContexts[i];
+                        if (readContext->status == kHAPIPAccessoryServerStatusCode_ResourceIsBusy) {
+                            readContext->status = kHAPIPAccessoryServerStatusCode_OperationTimedOut;
+                        }
+                    }
+                }
                 content_length = HAPIPAccessoryProtocolGetNumCharacteristicReadResponseBytes(
                         HAPNonnull(session->server), readContexts, contexts_count, &parameters);
                 HAPAssert(session->outboundBuffer.data || session->outboundBuffer.isDynamic);
@@ -1914,6 +2098,16 @@ static void get_characteristics(HAPIPSessionDescriptor* session) {
     free(readContexts);
 }
 
+/**
+ * Serializes and sends the next chunk of a GET /accessories response.
+ *
+ * - The attribute database is serialized chunk by chunk. The next chunk is only serialized once the previous one
+ *   has been written completely to the TCP stream, so that the outbound buffer holds at most one chunk.
+ *
+ * - Each chunk, including its chunked transfer coding framing, is encrypted as a single security frame.
+ *
+ * @param      session              IP session descriptor.
+ */
 static void handle_accessory_serialization(HAPIPSessionDescriptor* session) {
     HAPPrecondition(session);
     HAPPrecondition(session->server);
@@ -1927,71 +2121,67 @@ static void handle_accessory_serialization(HAPIPSessionDescriptor* session) {
     HAPAssert(session->outboundBuffer.data || session->outboundBuffer.isDynamic);
 
     if (session->accessorySerializationIsInProgress) {
+        // Previous chunk has been written.
         HAPAssert(session->outboundBuffer.position == session->outboundBuffer.limit);
-        if (session->securitySession.isSecured) {
-            HAPAssert(session->outboundBuffer.limit <= session->outboundBufferMark);
-            HAPAssert(session->outboundBufferMark <= session->outboundBuffer.capacity);
-            HAPRawBufferCopyBytes(
-                    &session->outboundBuffer.data[0],
-                    &session->outboundBuffer.data[session->outboundBuffer.limit],
-                    session->outboundBufferMark - session->outboundBuffer.limit);
-            session->outboundBuffer.position = session->outboundBufferMark - session->outboundBuffer.limit;
-            session->outboundBuffer.limit = session->outboundBuffer.capacity;
-            session->outboundBufferMark = 0;
-        } else {
-            HAPAssert(session->outboundBuffer.limit <= session->outboundBuffer.capacity);
-            session->outboundBuffer.position = 0;
-            session->outboundBuffer.limit = session->outboundBuffer.capacity;
-        }
+        session->outboundBuffer.position = 0;
+        session->outboundBuffer.limit = session->outboundBuffer.capacity;
     }
 
     HAPAssert(session->outboundBuffer.position <= session->outboundBuffer.limit);
     HAPAssert(session->outboundBuffer.limit <= session->outboundBuffer.capacity);
 
-    if ((session->outboundBuffer.position < session->outboundBuffer.limit) &&
-        (session->outboundBuffer.position < kHAPIPSecurityProtocol_MaxFrameBytes) &&
-        !HAPIPAccessorySerializationIsComplete(&session->accessorySerializationContext)) {
-        HAPIPByteBufferEnsureHeadroom(&session->outboundBuffer, kHAPIPAccessoryServerMaxIOSize);
+    if (!HAPIPAccessorySerializationIsComplete(&session->accessorySerializationContext)) {
+        // The first chunk shares its frame with the HTTP header that is already in the outbound buffer.
+        size_t numFrameBytes = kHAPIPAccessoryServer_MaxAccessorySerializationChunkBytes;
+        size_t numEncryptionOverheadBytes =
+                session->securitySession.isSecured ? HAPIPSecurityProtocolGetNumEncryptedBytes(1) - 1 : 0;
+        err = HAPIPByteBufferEnsureCapacity(&session->outboundBuffer, numFrameBytes + numEncryptionOverheadBytes);
+        if (err) {
+            HAPAssert(err == kHAPError_OutOfResources);
+            if (session->outboundBuffer.capacity < numEncryptionOverheadBytes) {
+                HAPLogError(&logObject, "Invalid configuration (outbound buffer too small).");
+                HAPFatalError();
+            }
+            numFrameBytes = session->outboundBuffer.capacity - numEncryptionOverheadBytes;
+        }
+        session->outboundBuffer.limit = session->outboundBuffer.capacity;
+
+        // maxProtocolBytes = max(8, size_t represented in HEX + '\r' + '\n' + '\0')
+        char protocolBytes[HAPMax(8, sizeof(size_t) * 2 + 2 + 1)];
+
+        err = HAPStringWithFormat(protocolBytes, sizeof protocolBytes, "%zX\r\n", numFrameBytes);
+        HAPAssert(!err);
+        size_t numChunkHeaderBytes = HAPStringGetNumBytes(protocolBytes);
+        size_t numChunkTrailerBytes = sizeof "\r\n0\r\n\r\n" - 1;
+        if (numFrameBytes <= session->outboundBuffer.position + numChunkHeaderBytes + numChunkTrailerBytes) {
+            HAPLogError(&logObject, "Invalid configuration (outbound buffer too small).");
+            HAPFatalError();
+        }
+        size_t maxBytes = numFrameBytes - session->outboundBuffer.position - numChunkHeaderBytes - numChunkTrailerBytes;
+
         size_t numBytesSerialized;
-        size_t maxBytes = session->outboundBuffer.limit - session->outboundBuffer.position - 20;
-        size_t minBytes = maxBytes / 2;
-        // kHAPIPSecurityProtocol_MaxFrameBytes < maxBytes ? kHAPIPSecurityProtocol_MaxFrameBytes : maxBytes;
         err = HAPIPAccessorySerializeReadResponse(
                 &session->accessorySerializationContext,
                 HAPNonnull(session->server),
                 (HAPIPSessionDescriptorRef*) session,
                 &session->outboundBuffer.data[session->outboundBuffer.position],
-                minBytes,
                 maxBytes,
                 &numBytesSerialized);
         if (err) {
             HAPAssert(err == kHAPError_OutOfResources);
-            HAPLogError(&logObject, "Invalid configuration (outbound buffer too small). %d", (int) maxBytes);
+            HAPLogError(
+                    &logObject,
+                    "Invalid configuration (attribute exceeds chunk size of %lu bytes).",
+                    (unsigned long) maxBytes);
             HAPFatalError();
         }
         HAPAssert(numBytesSerialized > 0);
         HAPAssert(numBytesSerialized <= maxBytes);
-        HAPAssert(
-                (numBytesSerialized >= minBytes) ||
-                HAPIPAccessorySerializationIsComplete(&session->accessorySerializationContext));
-
-        // maxProtocolBytes = max(8, size_t represented in HEX + '\r' + '\n' + '\0')
-        char protocolBytes[HAPMax(8, sizeof(size_t) * 2 + 2 + 1)];
 
         err = HAPStringWithFormat(protocolBytes, sizeof protocolBytes, "%zX\r\n", numBytesSerialized);
         HAPAssert(!err);
         size_t numProtocolBytes = HAPStringGetNumBytes(protocolBytes);
-
-        HAPIPByteBufferEnsureHeadroom(&session->outboundBuffer, numProtocolBytes + numBytesSerialized);
-
-        if (numProtocolBytes > session->outboundBuffer.limit - session->outboundBuffer.position) {
-            HAPLogError(&logObject, "Invalid configuration (outbound buffer too small).");
-            HAPFatalError();
-        }
-        if (numBytesSerialized > session->outboundBuffer.limit - session->outboundBuffer.position - numProtocolBytes) {
-            HAPLogError(&logObject, "Invalid configuration (outbound buffer too small).");
-            HAPFatalError();
-        }
+        HAPAssert(numProtocolBytes <= numChunkHeaderBytes);
 
         HAPRawBufferCopyBytes(
                 &session->outboundBuffer.data[session->outboundBuffer.position + numProtocolBytes],
@@ -2008,65 +2198,27 @@ static void handle_accessory_serialization(HAPIPSessionDescriptor* session) {
         }
         HAPAssert(!err);
         numProtocolBytes = HAPStringGetNumBytes(protocolBytes);
-
-        HAPIPByteBufferEnsureHeadroom(&session->outboundBuffer, numProtocolBytes);
-
-        if (numProtocolBytes > session->outboundBuffer.limit - session->outboundBuffer.position) {
-            HAPLogError(&logObject, "Invalid configuration (outbound buffer too small).");
-            HAPFatalError();
-        }
+        HAPAssert(numProtocolBytes <= numChunkTrailerBytes);
 
         HAPRawBufferCopyBytes(
                 &session->outboundBuffer.data[session->outboundBuffer.position], protocolBytes, numProtocolBytes);
         session->outboundBuffer.position += numProtocolBytes;
+        HAPAssert(session->outboundBuffer.position <= numFrameBytes);
     }
 
     if (session->outboundBuffer.position > 0) {
         HAPIPByteBufferFlip(&session->outboundBuffer);
+        HAPLogBufferDebug(
+                &logObject,
+                &session->outboundBuffer.data[session->outboundBuffer.position],
+                session->outboundBuffer.limit - session->outboundBuffer.position,
+                "session:%p:<",
+                (const void*) session);
 
         if (session->securitySession.isSecured) {
-            size_t numFrameBytes = kHAPIPSecurityProtocol_MaxFrameBytes <
-                                                   session->outboundBuffer.limit - session->outboundBuffer.position ?
-                                           kHAPIPSecurityProtocol_MaxFrameBytes :
-                                           session->outboundBuffer.limit - session->outboundBuffer.position;
-
-            HAPLogBufferDebug(
-                    &logObject,
-                    &session->outboundBuffer.data[session->outboundBuffer.position],
-                    numFrameBytes,
-                    "session:%p:<",
-                    (const void*) session);
-
-            size_t numUnencryptedBytes =
-                    session->outboundBuffer.limit - session->outboundBuffer.position - numFrameBytes;
-
-            size_t numEncryptedBytes = HAPIPSecurityProtocolGetNumEncryptedBytes(numFrameBytes);
-            HAPIPByteBufferEnsureHeadroom(&session->outboundBuffer, numEncryptedBytes + numUnencryptedBytes);
-            if (numEncryptedBytes >
-                session->outboundBuffer.capacity - session->outboundBuffer.position - numUnencryptedBytes) {
-                HAPLogError(&logObject, "Invalid configuration (outbound buffer too small).");
-                HAPFatalError();
-            }
-
-            HAPRawBufferCopyBytes(
-                    &session->outboundBuffer.data[session->outboundBuffer.position + numEncryptedBytes],
-                    &session->outboundBuffer.data[session->outboundBuffer.position + numFrameBytes],
-                    numUnencryptedBytes);
-
-            session->outboundBuffer.limit = session->outboundBuffer.position + numFrameBytes;
-
+            HAPAssert(session->outboundBuffer.limit <= kHAPIPSecurityProtocol_MaxFrameBytes);
             HAPIPSecurityProtocolEncryptData(
                     HAPNonnull(session->server), &session->securitySession._.hap, &session->outboundBuffer);
-            HAPAssert(numEncryptedBytes == session->outboundBuffer.limit - session->outboundBuffer.position);
-
-            session->outboundBufferMark = session->outboundBuffer.limit + numUnencryptedBytes;
-        } else {
-            HAPLogBufferDebug(
-                    &logObject,
-                    &session->outboundBuffer.data[session->outboundBuffer.position],
-                    session->outboundBuffer.limit - session->outboundBuffer.position,
-                    "session:%p:<",
-                    (const void*) session);
         }
 
         session->state = kHAPIPSessionState_Writing;
@@ -2887,12 +3039,22 @@ static void handle_http_request(HAPIPSessionDescriptor* session) {
     }
 }
 
-static void handle_http(HAPIPSessionDescriptor* session) {
+/**
+ * Handles a completely parsed HTTP request.
+ *
+ * @param      session              IP session descriptor.
+ *
+ * @return Number of bytes of the request that may be discarded from the inbound buffer. 0 if the request has not
+ *         been received completely or is still being processed.
+ */
+HAP_RESULT_USE_CHECK
+static size_t handle_http(HAPIPSessionDescriptor* session) {
     HAPPrecondition(session);
     HAPPrecondition(session->server);
     HAPPrecondition(session->securitySession.isOpen);
 
     size_t content_length, encrypted_length;
+    size_t numHandledBytes = 0;
     HAPAssert(session->inboundBuffer.data);
     HAPAssert(session->inboundBuffer.position <= session->inboundBuffer.limit);
     HAPAssert(session->inboundBuffer.limit <= session->inboundBuffer.capacity);
@@ -2915,8 +3077,14 @@ static void handle_http(HAPIPSessionDescriptor* session) {
                 (const void*) session,
                 (long) requestLen);
         handle_http_request(session);
+        if (session->state != kHAPIPSessionState_Processing && session->deferredRequest) {
+            // The resumed request has been rejected before reaching its handler, e.g. because the pairing was removed.
+            free(session->deferredRequest->writeContexts);
+            free(session->deferredRequest);
+            session->deferredRequest = NULL;
+        }
         if (session->state != kHAPIPSessionState_Processing) {
-            HAPIPByteBufferShiftLeft(&session->inboundBuffer, requestLen);
+            numHandledBytes = requestLen;
         }
         if (session->accessorySerializationIsInProgress) {
             // Session is already prepared for writing
@@ -2959,6 +3127,7 @@ static void handle_http(HAPIPSessionDescriptor* session) {
             session->state = kHAPIPSessionState_Writing;
         }
     }
+    return numHandledBytes;
 }
 
 static void update_token(struct util_http_reader* r, char** token, size_t* length) {
@@ -3122,8 +3291,6 @@ static void read_http(HAPIPSessionDescriptor* session) {
     HAPAssert(session->httpReaderPosition <= session->inboundBuffer.position);
     HAPAssert(!session->httpParserError);
     r = &session->httpReader;
-    bool hasContentLength = false;
-    bool hasContentType = false;
     do {
         session->httpReaderPosition += util_http_reader_read(
                 r,
@@ -3163,11 +3330,10 @@ static void read_http(HAPIPSessionDescriptor* session) {
                     (session->httpHeaderFieldName.bytes[11] == 'G' || session->httpHeaderFieldName.bytes[11] == 'g') &&
                     (session->httpHeaderFieldName.bytes[12] == 'T' || session->httpHeaderFieldName.bytes[12] == 't') &&
                     (session->httpHeaderFieldName.bytes[13] == 'H' || session->httpHeaderFieldName.bytes[13] == 'h')) {
-                    if (hasContentLength) {
+                    if (session->httpContentLength.isDefined) {
                         HAPLog(&logObject, "Request has multiple Content-Length headers.");
                         session->httpParserError = true;
                     } else {
-                        hasContentLength = true;
                         read_http_content_length(session);
                     }
                 } else if (
@@ -3195,11 +3361,11 @@ static void read_http(HAPIPSessionDescriptor* session) {
                          session->httpHeaderFieldName.bytes[10] == 'p') &&
                         (session->httpHeaderFieldName.bytes[11] == 'E' ||
                          session->httpHeaderFieldName.bytes[11] == 'e')) {
-                    if (hasContentType) {
+                    if (session->httpHasContentType) {
                         HAPLog(&logObject, "Request has multiple Content-Type headers.");
                         session->httpParserError = true;
                     } else {
-                        hasContentType = true;
+                        session->httpHasContentType = true;
                         read_http_content_type(session);
                     }
                 }
@@ -3253,12 +3419,19 @@ static void handle_input(HAPIPSessionDescriptor* session) {
                     kHAPLogType_Info, "Unexpected request.", &session->inboundBuffer, __func__, HAP_FILE, __LINE__);
             CloseSession(session);
         } else {
+            size_t numHandledBytes = 0;
             if (session->httpReader.state == util_HTTP_READER_STATE_DONE) {
-                handle_http(session);
+                numHandledBytes = handle_http(session);
             }
             session->inboundBufferMark = session->inboundBuffer.position;
             if (session->state != kHAPIPSessionState_Processing) {
                 session->inboundBuffer.position = session->inboundBuffer.limit;
+                if (numHandledBytes) {
+                    // Discard the handled request. Received data of pipelined requests, decrypted or not, is kept.
+                    HAPIPByteBufferShiftLeft(&session->inboundBuffer, numHandledBytes);
+                    HAPAssert(numHandledBytes <= session->inboundBufferMark);
+                    session->inboundBufferMark -= numHandledBytes;
+                }
                 session->inboundBuffer.limit = session->inboundBuffer.capacity;
             }
 
@@ -3294,9 +3467,7 @@ static void write_event_notifications(HAPIPSessionDescriptor* session) {
     HAPPrecondition(session->securitySession.type == kHAPIPSecuritySessionType_HAP);
     HAPPrecondition(session->securitySession.isOpen);
     HAPPrecondition(!HAPSessionIsTransient(&session->securitySession._.hap));
-    HAPPrecondition(session->state == kHAPIPSessionState_Reading);
-    HAPPrecondition(session->inboundBuffer.position == 0);
-    HAPPrecondition(session->numEventNotificationFlags > 0);
+    HAPPrecondition(can_write_event_notifications(session));
     HAPPrecondition(session->numEventNotificationFlags <= session->numEventNotifications);
 
     HAPError err;
@@ -3463,6 +3634,39 @@ static void write_event_notifications(HAPIPSessionDescriptor* session) {
 
 static void handle_io_progression(HAPIPSessionDescriptor* session);
 
+/**
+ * Completes the reads or writes of a deferred request that are still pending with an error.
+ *
+ * - Pending writes are reported with status kHAPIPAccessoryServerStatusCode_OperationTimedOut.
+ *
+ * - Reads are handled again. Reads whose handlers still report busy are reported as timed out.
+ *
+ * @param      session              IP session with a deferred request whose deadline has passed.
+ */
+static void ExpireDeferredRequest(HAPIPSessionDescriptor* session) {
+    HAPPrecondition(session);
+    HAPPrecondition(session->deferredRequest);
+    HAPIPDeferredRequest* deferredRequest = HAPNonnull(session->deferredRequest);
+    HAPPrecondition(deferredRequest->numPending);
+
+    HAPLog(&logObject,
+           "session:%p:deferred request %lu timed out (%zu pending)",
+           (const void*) session,
+           (unsigned long) deferredRequest->requestID,
+           deferredRequest->numPending);
+    if (deferredRequest->writeContexts) {
+        for (size_t i = 0; i < deferredRequest->numWriteContexts; i++) {
+            HAPIPWriteContext* writeContext = (HAPIPWriteContext*) &HAPNonnull(deferredRequest->writeContexts)[i];
+            if (writeContext->deferred) {
+                writeContext->deferred = false;
+                writeContext->status = kHAPIPAccessoryServerStatusCode_OperationTimedOut;
+            }
+        }
+    }
+    deferredRequest->numPending = 0;
+    deferredRequest->timedOut = true;
+}
+
 static void handle_server_process_timer(HAPPlatformTimerRef timer, void* _Nullable context) {
     HAPPrecondition(context);
     HAPAccessoryServerRef* server_ = context;
@@ -3475,17 +3679,41 @@ static void handle_server_process_timer(HAPPlatformTimerRef timer, void* _Nullab
         return;
     }
 
+    HAPTime now = HAPPlatformClockGetCurrent();
+    HAPTime nextDeadline = 0;
     for (size_t i = 0; i < server->ip.storage->numSessions; i++) {
         HAPIPSession* ipSession = &server->ip.storage->sessions[i];
         HAPIPSessionDescriptor* session = (HAPIPSessionDescriptor*) &ipSession->descriptor;
         if (!session->server || session->state != kHAPIPSessionState_Processing) {
             continue;
         }
+        if (session->deferredRequest) {
+            if (session->deferredRequest->numPending) {
+                if (now < session->deferredRequest->deadline) {
+                    if (!nextDeadline || session->deferredRequest->deadline < nextDeadline) {
+                        nextDeadline = session->deferredRequest->deadline;
+                    }
+                    continue;
+                }
+                ExpireDeferredRequest(session);
+            }
+            // All deferred reads or writes have been completed. Handle the request again.
+            session->state = kHAPIPSessionState_Reading;
+        }
 
         HAPLogDebug(&logObject, "Re-processing session %p...", session);
         handle_input(session);
         handle_io_progression(session);
     }
+
+    if (nextDeadline && !server->ip.processTimer) {
+        HAPError err =
+                HAPPlatformTimerRegister(&server->ip.processTimer, nextDeadline, handle_server_process_timer, server_);
+        if (err) {
+            HAPLog(&logObject, "Not enough resources to schedule processing timer!");
+            HAPFatalError();
+        }
+    }
 }
 
 static void handle_io_progression(HAPIPSessionDescriptor* session) {
@@ -3493,7 +3721,7 @@ static void handle_io_progression(HAPIPSessionDescriptor* session) {
     HAPPrecondition(session->server);
     HAPAccessoryServer* server = (HAPAccessoryServer*) session->server;
 
-    if (session->state == kHAPIPSessionState_Processing) {
+    if (session->state == kHAPIPSessionState_Processing && !session->deferredRequest) {
         if (server->ip.processTimer == 0) {
             HAPError err = HAPPlatformTimerRegister(
                     &server->ip.processTimer, HAPPlatformClockGetCurrent() + 150, handle_server_process_timer, server);
@@ -3554,7 +3782,18 @@ static void handle_output_completion(HAPIPSessionDescriptor* session) {
     session->state = kHAPIPSessionState_Reading;
     prepare_reading_request(session);
     if (session->inboundBuffer.position != 0) {
-        handle_input(session);
+        // Pipelined request. The previous response has been written completely, so the outbound buffer is reset
+        // before anything else is written to it.
+        HAPIPByteBufferClear(&session->outboundBuffer);
+
+        // Send event notifications that became due while the previous response was written before processing the
+        // request, so that a controller keeping its request queue filled does not starve events.
+        if (can_write_event_notifications(session) && server->ip.state == kHAPIPAccessoryServerState_Running) {
+            write_event_notifications(session);
+        }
+        if (session->state == kHAPIPSessionState_Reading) {
+            handle_input(session);
+        }
     }
 }
 
@@ -3649,16 +3888,16 @@ static void ReadInboundData(HAPIPSessionDescriptor* session) {
     HAPAssert(b->limit <= b->capacity);
 
     if (b->limit - b->position <= 1) {
-        char* prevData = b->data;
+        // HTTP tokens parsed so far point into the inbound buffer. Remember their offsets so that parsing
+        // resumes where it left off if the buffer is reallocated, instead of rescanning the request.
+        HTTPTokenOffsets tokenOffsets;
+        get_http_token_offsets(session, &tokenOffsets);
         err = HAPIPByteBufferEnsureHeadroom(b, kHAPIPAccessoryServerMaxIOSize + 1);
         if (err) {
             CloseSession(session);
             return;
         }
-        if (b->data != prevData) {
-            // Buffer has been reallocated, reset HTTP parser context.
-            prepare_reading_request(session);
-        }
+        set_http_token_offsets(session, &tokenOffsets);
     }
 
     size_t numBytes = 0;
@@ -3965,27 +4204,63 @@ static HAPError engine_stop(HAPAccessoryServerRef* server_) {
     return kHAPError_None;
 }
 
+/**
+ * Determines whether a deferred write request of a session writes to a characteristic.
+ *
+ * - Like for writes that are completed synchronously, events raised for the written characteristic are not sent to
+ *   the controller that issued the write until the response to the write request has been sent.
+ *
+ * @param      session              IP session descriptor.
+ * @param      aid                  Accessory instance ID.
+ * @param      iid                  Characteristic instance ID.
+ *
+ * @return true                     If the session has a deferred write request that writes to the characteristic.
+ * @return false                    Otherwise.
+ */
 HAP_RESULT_USE_CHECK
-static HAPError engine_raise_event_on_session_(
+static bool IsDeferredWriteInProgress(const HAPIPSessionDescriptor* session, uint64_t aid, uint64_t iid) {
+    HAPPrecondition(session);
+
+    const HAPIPDeferredRequest* _Nullable deferredRequest = session->deferredRequest;
+    if (!deferredRequest || !deferredRequest->writeContexts) {
+        return false;
+    }
+    for (size_t i = 0; i < deferredRequest->numWriteContexts; i++) {
+        const HAPIPWriteContext* writeContext =
+                (const HAPIPWriteContext*) &HAPNonnull(deferredRequest->writeContexts)[i];
+        if (writeContext->aid == aid && writeContext->iid == iid) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Flags pending event notifications for changed characteristics.
+ *
+ * - All sessions are scanned once, and a single event notification flush is scheduled.
+ *
+ * @param      server_              Accessory server.
+ * @param      events               Changed characteristics.
+ * @param      numEvents            Number of changed characteristics.
+ * @param      securitySession_     Session on which to flag the event notifications. NULL to flag them on all sessions.
+ *
+ * @return kHAPError_None           If successful.
+ */
+HAP_RESULT_USE_CHECK
+static HAPError engine_raise_events_on_session_(
         HAPAccessoryServerRef* server_,
-        const HAPCharacteristic* characteristic_,
-        const HAPService* service_,
-        const HAPAccessory* accessory_,
-        const HAPSessionRef* securitySession_) {
+        const HAPCharacteristicEvent* events,
+        size_t numEvents,
+        const HAPSessionRef* _Nullable securitySession_) {
     HAPPrecondition(server_);
     HAPAccessoryServer* server = (HAPAccessoryServer*) server_;
-
-    HAPPrecondition(characteristic_);
-    HAPPrecondition(service_);
-    HAPPrecondition(accessory_);
+    HAPPrecondition(events);
 
     HAPError err;
 
     size_t events_raised = 0;
 
-    uint64_t aid = accessory_->aid;
-    uint64_t iid = ((const HAPBaseCharacteristic*) characteristic_)->iid;
-
     for (size_t i = 0; i < server->ip.storage->numSessions; i++) {
         HAPIPSession* ipSession = &server->ip.storage->sessions[i];
         HAPIPSessionDescriptor* session = (HAPIPSessionDescriptor*) &ipSession->descriptor;
@@ -4006,10 +4281,24 @@ static HAPError engine_raise_event_on_session_(
             continue;
         }
 
-        if ((ipSession != server->ip.characteristicWriteRequestContext.ipSession) ||
-            (characteristic_ != server->ip.characteristicWriteRequestContext.characteristic) ||
-            (service_ != server->ip.characteristicWriteRequestContext.service) ||
-            (accessory_ != server->ip.characteristicWriteRequestContext.accessory)) {
+        for (size_t k = 0; k < numEvents; k++) {
+            const HAPCharacteristicEvent* event = &events[k];
+            HAPPrecondition(event->characteristic);
+            HAPPrecondition(event->service);
+            HAPPrecondition(event->accessory);
+
+            if ((ipSession == server->ip.characteristicWriteRequestContext.ipSession) &&
+                (event->characteristic == server->ip.characteristicWriteRequestContext.characteristic) &&
+                (event->service == server->ip.characteristicWriteRequestContext.service) &&
+                (event->accessory == server->ip.characteristicWriteRequestContext.accessory)) {
+                continue;
+            }
+
+            uint64_t aid = event->accessory->aid;
+            uint64_t iid = ((const HAPBaseCharacteristic*) event->characteristic)->iid;
+            if (IsDeferredWriteInProgress(session, aid, iid)) {
+                continue;
+            }
             size_t j = 0;
             while ((j < session->numEventNotifications) &&
                    ((((HAPIPEventNotification*) &session->eventNotifications[j])->aid != aid) ||
@@ -4047,17 +4336,14 @@ static HAPError engine_raise_event_on_session_(
 }
 
 HAP_RESULT_USE_CHECK
-static HAPError engine_raise_event(
+static HAPError engine_raise_events(
         HAPAccessoryServerRef* server,
-        const HAPCharacteristic* characteristic,
-        const HAPService* service,
-        const HAPAccessory* accessory) {
+        const HAPCharacteristicEvent* events,
+        size_t numEvents) {
     HAPPrecondition(server);
-    HAPPrecondition(characteristic);
-    HAPPrecondition(service);
-    HAPPrecondition(accessory);
+    HAPPrecondition(events);
 
-    return engine_raise_event_on_session_(server, characteristic, service, accessory, /* session: */ NULL);
+    return engine_raise_events_on_session_(server, events, numEvents, /* session: */ NULL);
 }
 
 HAP_RESULT_USE_CHECK
@@ -4073,7 +4359,162 @@ static HAPError engine_raise_event_on_session(
     HAPPrecondition(accessory);
     HAPPrecondition(session);
 
-    return engine_raise_event_on_session_(server, characteristic, service, accessory, session);
+    const HAPCharacteristicEvent event = { .characteristic = characteristic,
+                                           .service = service,
+                                           .accessory = accessory };
+    return engine_raise_events_on_session_(server, &event, 1, session);
+}
+
+HAP_RESULT_USE_CHECK
+static HAPError engine_defer_request(
+        HAPAccessoryServerRef* server_,
+        HAPSessionRef* securitySession,
+        HAPCharacteristicRequestToken* token) {
+    HAPPrecondition(server_);
+    HAPAccessoryServer* server = (HAPAccessoryServer*) server_;
+    HAPPrecondition(securitySession);
+    HAPPrecondition(token);
+
+    const HAPIPSession* _Nullable ipSession = server->ip.deferrableRequestContext.ipSession;
+    if (!ipSession) {
+        HAPLog(&logObject, "Rejected deferral: No deferrable characteristic request is being handled.");
+        return kHAPError_InvalidState;
+    }
+    HAPIPSessionDescriptor* session = (HAPIPSessionDescriptor*) &HAPNonnull(ipSession)->descriptor;
+    HAPPrecondition(session->server == server_);
+    if (&session->securitySession._.hap != securitySession) {
+        HAPLog(&logObject, "Rejected deferral: Session does not match the request that is being handled.");
+        return kHAPError_InvalidState;
+    }
+    if (server->ip.deferrableRequestContext.isDeferred) {
+        HAPLog(&logObject, "Rejected deferral: Request has already been deferred.");
+        return kHAPError_InvalidState;
+    }
+    HAPIPWriteContext* _Nullable writeContext = (HAPIPWriteContext*) server->ip.deferrableRequestContext.writeContext;
+    if (writeContext) {
+        const HAPBaseCharacteristic* characteristic = server->ip.characteristicWriteRequestContext.characteristic;
+        HAPAssert(characteristic);
+        if (writeContext->response || characteristic->properties.ip.supportsWriteResponse) {
+            HAPLog(&logObject, "Rejected deferral: Writes with write response cannot be deferred.");
+            return kHAPError_InvalidState;
+        }
+    }
+
+    if (!session->deferredRequest) {
+        HAPIPDeferredRequest* deferredRequest = calloc(1, sizeof *deferredRequest);
+        if (!deferredRequest) {
+            HAPLog(&logObject, "Rejected deferral: Out of resources.");
+            return kHAPError_OutOfResources;
+        }
+        server->ip.lastDeferredRequestID++;
+        if (!server->ip.lastDeferredRequestID) {
+            server->ip.lastDeferredRequestID++;
+        }
+        deferredRequest->requestID = server->ip.lastDeferredRequestID;
+        deferredRequest->deadline = HAPPlatformClockGetCurrent() + kHAPIPAccessoryServer_MaxDeferredRequestTime;
+        session->deferredRequest = deferredRequest;
+
+        // A pending processing timer fires no later than this deadline and reschedules itself for it.
+        if (!server->ip.processTimer) {
+            HAPError err = HAPPlatformTimerRegister(
+                    &server->ip.processTimer, deferredRequest->deadline, handle_server_process_timer, server_);
+            if (err) {
+                HAPLog(&logObject, "Rejected deferral: Not enough resources to schedule processing timer.");
+                free(deferredRequest);
+                session->deferredRequest = NULL;
+                return kHAPError_OutOfResources;
+            }
+        }
+    }
+    HAPIPDeferredRequest* deferredRequest = HAPNonnull(session->deferredRequest);
+    deferredRequest->numPending++;
+    server->ip.deferrableRequestContext.isDeferred = true;
+
+    token->session = securitySession;
+    token->requestID = deferredRequest->requestID;
+    if (writeContext) {
+        writeContext->deferred = true;
+        token->writeIndex = server->ip.deferrableRequestContext.writeIndex;
+        token->isWrite = true;
+    }
+    HAPLogDebug(
+            &logObject,
+            "session:%p:deferred %s (request %lu, %zu pending)",
+            (const void*) session,
+            writeContext ? "write" : "read",
+            (unsigned long) deferredRequest->requestID,
+            deferredRequest->numPending);
+    return kHAPError_None;
+}
+
+static void engine_complete_request(
+        HAPAccessoryServerRef* server_,
+        const HAPCharacteristicRequestToken* token,
+        HAPError error) {
+    HAPPrecondition(server_);
+    HAPAccessoryServer* server = (HAPAccessoryServer*) server_;
+    HAPPrecondition(token);
+    HAPPrecondition(token->session);
+
+    HAPIPSessionDescriptor* _Nullable session = NULL;
+    for (size_t i = 0; i < server->ip.storage->numSessions; i++) {
+        HAPIPSessionDescriptor* t = (HAPIPSessionDescriptor*) &server->ip.storage->sessions[i].descriptor;
+        if (t->server && t->deferredRequest && t->deferredRequest->requestID == token->requestID &&
+            t->securitySession.type == kHAPIPSecuritySessionType_HAP && &t->securitySession._.hap == token->session) {
+            session = t;
+            break;
+        }
+    }
+    if (!session) {
+        HAPLog(&logObject,
+               "Ignoring completion of deferred request %lu: Request is no longer pending.",
+               (unsigned long) token->requestID);
+        return;
+    }
+    HAPIPDeferredRequest* deferredRequest = HAPNonnull(session->deferredRequest);
+    if (deferredRequest->timedOut) {
+        HAPLog(&logObject,
+               "Ignoring completion of deferred request %lu: Request has timed out.",
+               (unsigned long) token->requestID);
+        return;
+    }
+
+    if (token->isWrite) {
+        HAPPrecondition(deferredRequest->writeContexts);
+        HAPPrecondition(token->writeIndex < deferredRequest->numWriteContexts);
+        HAPIPWriteContext* writeContext =
+                (HAPIPWriteContext*) &HAPNonnull(deferredRequest->writeContexts)[token->writeIndex];
+        HAPPrecondition(writeContext->deferred);
+        writeContext->deferred = false;
+        writeContext->status = ConvertCharacteristicWriteErrorToStatusCode(error);
+    } else {
+        HAPPrecondition(!deferredRequest->writeContexts);
+    }
+    HAPAssert(deferredRequest->numPending);
+    deferredRequest->numPending--;
+    HAPLogDebug(
+            &logObject,
+            "session:%p:completed deferred %s (request %lu, %zu pending)",
+            (const void*) session,
+            token->isWrite ? "write" : "read",
+            (unsigned long) deferredRequest->requestID,
+            deferredRequest->numPending);
+    if (deferredRequest->numPending) {
+        return;
+    }
+
+    // The request is handled again from the run loop. Completions may be reported from within any callback,
+    // including the handlers of other requests, so the request must not be resumed synchronously.
+    // Reads are handled from scratch, writes pick up the completed write contexts.
+    if (server->ip.processTimer) {
+        HAPPlatformTimerDeregister(server->ip.processTimer);
+        server->ip.processTimer = 0;
+    }
+    HAPError err = HAPPlatformTimerRegister(&server->ip.processTimer, 0, handle_server_process_timer, server_);
+    if (err) {
+        HAPLog(&logObject, "Not enough resources to schedule processing timer!");
+        HAPFatalError();
+    }
 }
 
 static void Create(HAPAccessoryServerRef* server_, const HAPAccessoryServerOptions* options) {
@@ -4166,9 +4607,11 @@ const HAPAccessoryServerServerEngine HAPIPAccessoryServerServerEngine = { .init
                                                                           .get_state = engine_get_state,
                                                                           .start = engine_start,
                                                                           .stop = engine_stop,
-                                                                          .raise_event = engine_raise_event,
+                                                                          .raise_events = engine_raise_events,
                                                                           .raise_event_on_session =
-                                                                                  engine_raise_event_on_session };
+                                                                                  engine_raise_event_on_session,
+                                                                          .defer_request = engine_defer_request,
+                                                                          .complete_request = engine_complete_request };
 
 HAP_RESULT_USE_CHECK
 size_t HAPAccessoryServerGetIPSessionIndex(const HAPAccessoryServerRef* server_, const HAPSessionRef* session) {
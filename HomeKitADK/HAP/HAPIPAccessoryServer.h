@@ -27,11 +27,7 @@ typedef struct {
     HAP_RESULT_USE_CHECK
     HAPError (*stop)(HAPAccessoryServerRef* p_srv);
     HAP_RESULT_USE_CHECK
-    HAPError (*raise_event)(
-            HAPAccessoryServerRef* server,
-            const HAPCharacteristic* characteristic,
-            const HAPService* service,
-            const HAPAccessory* accessory);
+    HAPError (*raise_events)(HAPAccessoryServerRef* server, const HAPCharacteristicEvent* events, size_t numEvents);
     HAP_RESULT_USE_CHECK
     HAPError (*raise_event_on_session)(
             HAPAccessoryServerRef* server,
@@ -39,6 +35,15 @@ typedef struct {
             const HAPService* service,
             const HAPAccessory* accessory,
             const HAPSessionRef* session);
+    HAP_RESULT_USE_CHECK
+    HAPError (*defer_request)(
+            HAPAccessoryServerRef* server,
+            HAPSessionRef* session,
+            HAPCharacteristicRequestToken* token);
+    void (*complete_request)(
+            HAPAccessoryServerRef* server,
+            const HAPCharacteristicRequestToken* token,
+            HAPError error);
 } HAPAccessoryServerServerEngine;
 
 extern const HAPAccessoryServerServerEngine HAPIPAccessoryServerServerEngine;
@@ -160,6 +165,32 @@ typedef struct {
 } HAPIPEventNotification;
 HAP_STATIC_ASSERT(sizeof(HAPIPEventNotificationRef) >= sizeof(HAPIPEventNotification), event_notification);
 
+/**
+ * Deferred characteristic request of an IP session.
+ */
+typedef struct {
+    /** Identifier of the request. */
+    uint32_t requestID;
+
+    /** Number of deferred reads or writes that have not been completed yet. */
+    size_t numPending;
+
+    /** Write contexts of a deferred PUT /characteristics request. NULL for GET /characteristics. */
+    HAPIPWriteContextRef* _Nullable writeContexts;
+
+    /** Length of writeContexts. */
+    size_t numWriteContexts;
+
+    /** Whether the PUT /characteristics request was a valid Execute Write Request. */
+    bool timedWrite;
+
+    /** Time after which reads or writes that are still pending are completed with an error. */
+    HAPTime deadline;
+
+    /** Whether reads or writes have been completed with an error because the deadline has passed. */
+    bool timedOut;
+} HAPIPDeferredRequest;
+
 /**
  * IP specific accessory server session descriptor.
  */
@@ -191,12 +222,6 @@ typedef struct {
     /** Outbound buffer. */
     HAPIPByteBuffer outboundBuffer;
 
-    /**
-     * Marked outbound buffer position indicating the position until which the buffer has not yet been encrypted
-     * (starting from outboundBuffer->limit).
-     */
-    size_t outboundBufferMark;
-
     /** HTTP reader. */
     struct util_http_reader httpReader;
 
@@ -286,6 +311,13 @@ typedef struct {
      */
     HAPIPAccessoryServerContentType httpContentType;
 
+    /**
+     * Flag indicating whether a HTTP/1.1 Content-Type header has been encountered.
+     *
+     * - Header fields are recorded as they are parsed, possibly across multiple reads.
+     */
+    bool httpHasContentType;
+
     /**
      * Array of event notification contexts on this session.
      */
@@ -325,6 +357,14 @@ typedef struct {
      * Flag indicating whether incremental serialization of accessory attribute database is in progress.
      */
     bool accessorySerializationIsInProgress;
+
+    /**
+     * Deferred characteristic request. NULL if none.
+     *
+     * - While set, the session is parked in kHAPIPSessionState_Processing until all deferred reads or writes
+     *   have been completed.
+     */
+    HAPIPDeferredRequest* _Nullable deferredRequest;
 } HAPIPSessionDescriptor;
 HAP_STATIC_ASSERT(sizeof(HAPIPSessionDescriptorRef) >= sizeof(HAPIPSessionDescriptor), HAPIPSessionDescriptor);
 
@@ -38,21 +38,34 @@ void HAPIPSecurityProtocolEncryptData(HAPAccessoryServerRef* server_, HAPSession
     HAPAssert(numEncryptedBytes <= buffer->capacity);
     HAPAssert(buffer->position <= buffer->capacity - numEncryptedBytes);
 
-    size_t position = buffer->position;
-
-    while (position < buffer->limit) {
-        size_t numFrameBytes = buffer->limit - position > kHAPIPSecurityProtocol_MaxFrameBytes ?
+    size_t numPlaintextBytes = buffer->limit - buffer->position;
+    size_t numFrames = (numPlaintextBytes + kHAPIPSecurityProtocol_MaxFrameBytes - 1) /
+                       kHAPIPSecurityProtocol_MaxFrameBytes;
+    size_t numEncryptedFrameBytes =
+            kHAPIPSecurityProtocol_NumAADBytes + kHAPIPSecurityProtocol_MaxFrameBytes + CHACHA20_POLY1305_TAG_BYTES;
+
+    // Move the plaintext of each frame to its final location.
+    // Frames are moved back to front so that each frame only moves over bytes that have already been moved.
+    for (size_t i = numFrames; i > 0; i--) {
+        size_t plaintextOffset = (i - 1) * kHAPIPSecurityProtocol_MaxFrameBytes;
+        size_t numFrameBytes = numPlaintextBytes - plaintextOffset > kHAPIPSecurityProtocol_MaxFrameBytes ?
                                        kHAPIPSecurityProtocol_MaxFrameBytes :
-                                       buffer->limit - position;
-
+                                       numPlaintextBytes - plaintextOffset;
         HAPRawBufferCopyBytes(
-                &buffer
-                         ->data[position + numFrameBytes + kHAPIPSecurityProtocol_NumAADBytes +
-                                CHACHA20_POLY1305_TAG_BYTES],
-                &buffer->data[position + numFrameBytes],
-                buffer->limit - (position + numFrameBytes));
+                &buffer->data[buffer->position + (i - 1) * numEncryptedFrameBytes +
+                              kHAPIPSecurityProtocol_NumAADBytes],
+                &buffer->data[buffer->position + plaintextOffset],
+                numFrameBytes);
+    }
+
+    // Encrypt frames in place. Frames must be encrypted in order as each one consumes a nonce.
+    size_t position = buffer->position;
+    for (size_t i = 0; i < numFrames; i++) {
+        size_t plaintextOffset = i * kHAPIPSecurityProtocol_MaxFrameBytes;
+        size_t numFrameBytes = numPlaintextBytes - plaintextOffset > kHAPIPSecurityProtocol_MaxFrameBytes ?
+                                       kHAPIPSecurityProtocol_MaxFrameBytes :
+                                       numPlaintextBytes - plaintextOffset;
 
-        HAPRawBufferCopyBytes(&buffer->data[position + sizeof(uint16_t)], &buffer->data[position], numFrameBytes);
         HAPWriteLittleUInt16(&buffer->data[position], numFrameBytes);
 
         err = HAPSessionEncryptControlMessageWithAAD(
@@ -71,11 +84,10 @@ void HAPIPSecurityProtocolEncryptData(HAPAccessoryServerRef* server_, HAPSession
         HAPAssert(!err);
 
         position += numFrameBytes + kHAPIPSecurityProtocol_NumAADBytes + CHACHA20_POLY1305_TAG_BYTES;
-        buffer->limit += kHAPIPSecurityProtocol_NumAADBytes + CHACHA20_POLY1305_TAG_BYTES;
-
-        HAPAssert(position <= buffer->limit);
-        HAPAssert(buffer->limit <= buffer->capacity);
     }
+    HAPAssert(position == buffer->position + numEncryptedBytes);
+    buffer->limit = position;
+    HAPAssert(buffer->limit <= buffer->capacity);
 }
 
 HAP_RESULT_USE_CHECK
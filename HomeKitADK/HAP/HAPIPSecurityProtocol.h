@@ -35,6 +35,9 @@ size_t HAPIPSecurityProtocolGetNumEncryptedBytes(size_t numPlaintextBytes);
 /**
  * Encrypts data to be sent over a HomeKit session.
  *
+ * - The data is split into frames of up to kHAPIPSecurityProtocol_MaxFrameBytes bytes.
+ *   The plaintext of each frame is moved to its final location and then encrypted in place.
+ *
  * @param      server               Accessory server.
  * @param      session              The session over which the data will be sent.
  * @param      buffer               Plaintext data to be encrypted.
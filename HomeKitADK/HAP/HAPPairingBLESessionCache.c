@@ -6,20 +6,99 @@
 
 #include "HAP+Internal.h"
 
+static const HAPLogObject logObject = { .subsystem = kHAP_LogSubsystem, .category = "BLESessionCache" };
+
 /**
  * BLE: Pair Resume cache entry.
+ *
+ * - Entries are referenced by their index in the session cache storage + 1. 0 if none.
  */
 typedef struct {
     HAPPairingBLESessionID sessionID;
     uint8_t sharedSecret[X25519_SCALAR_BYTES];
-    int pairingID;
-    uint32_t lastUsed; // 0: invalid, >0: timestamp
+    int16_t pairingID;
+    uint16_t newer;        // Next more recently used entry. Unused entries: 0.
+    uint16_t older;        // Next less recently used entry. Unused entries: 0.
+    uint16_t nextInBucket; // Next entry in the same hash bucket. Unused entries: Next unused entry.
 } HAPPairingBLESessionCacheEntry;
 
 HAP_STATIC_ASSERT(
         sizeof(HAPBLESessionCacheElementRef) >= sizeof(HAPPairingBLESessionCacheEntry),
         HAPPairingBLESessionCacheEntry);
 
+/**
+ * Gets a cache entry.
+ *
+ * @param      server               Accessory server.
+ * @param      entry                Entry (index in the session cache storage + 1).
+ *
+ * @return Cache entry.
+ */
+HAP_RESULT_USE_CHECK
+static HAPPairingBLESessionCacheEntry* GetEntry(HAPAccessoryServer* server, uint16_t entry) {
+    HAPPrecondition(server);
+    HAPPrecondition(entry && entry <= server->ble.storage->numSessionCacheElements);
+
+    return (HAPPairingBLESessionCacheEntry*) &server->ble.storage->sessionCacheElements[entry - 1];
+}
+
+/**
+ * Gets the hash bucket of a session ID.
+ *
+ * - Session IDs are derived from the shared secret and are uniformly distributed.
+ *
+ * @param      server               Accessory server.
+ * @param      sessionID            Session ID.
+ *
+ * @return Hash bucket.
+ */
+HAP_RESULT_USE_CHECK
+static uint16_t* GetBucket(HAPAccessoryServer* server, const HAPPairingBLESessionID* sessionID) {
+    HAPPrecondition(server);
+    HAPPrecondition(sessionID);
+
+    return &server->ble.sessionCache.buckets[sessionID->value[0] % kHAPPairingBLESessionCache_NumBuckets];
+}
+
+/**
+ * Removes a cache entry and marks it as unused.
+ *
+ * @param      server               Accessory server.
+ * @param      entry                Entry (index in the session cache storage + 1).
+ */
+static void RemoveEntry(HAPAccessoryServer* server, uint16_t entry) {
+    HAPPrecondition(server);
+    HAPPairingBLESessionCacheIndex* index = &server->ble.sessionCache;
+    HAPPairingBLESessionCacheEntry* cacheEntry = GetEntry(server, entry);
+
+    // Remove from hash bucket.
+    uint16_t* link = GetBucket(server, &cacheEntry->sessionID);
+    while (*link != entry) {
+        HAPAssert(*link);
+        link = &GetEntry(server, *link)->nextInBucket;
+    }
+    *link = cacheEntry->nextInBucket;
+
+    // Remove from Least Recently Used list.
+    if (cacheEntry->newer) {
+        GetEntry(server, cacheEntry->newer)->older = cacheEntry->older;
+    } else {
+        HAPAssert(index->mostRecentlyUsed == entry);
+        index->mostRecentlyUsed = cacheEntry->older;
+    }
+    if (cacheEntry->older) {
+        GetEntry(server, cacheEntry->older)->newer = cacheEntry->newer;
+    } else {
+        HAPAssert(index->leastRecentlyUsed == entry);
+        index->leastRecentlyUsed = cacheEntry->newer;
+    }
+
+    // Mark as unused.
+    HAPRawBufferZero(cacheEntry, sizeof *cacheEntry);
+    cacheEntry->nextInBucket = index->firstUnused;
+    index->firstUnused = entry;
+}
+
 void HAPPairingBLESessionCacheFetch(
         HAPAccessoryServerRef* server_,
         const HAPPairingBLESessionID* sessionID,
@@ -33,19 +112,21 @@ void HAPPairingBLESessionCacheFetch(
     HAPPrecondition(pairingID);
 
     // Fetch session.
-    for (size_t i = 0; i < server->ble.storage->numSessionCacheElements; i++) {
-        HAPPairingBLESessionCacheEntry* cacheEntry =
-                (HAPPairingBLESessionCacheEntry*) &server->ble.storage->sessionCacheElements[i];
+    for (uint16_t entry = *GetBucket(server, sessionID); entry;) {
+        HAPPairingBLESessionCacheEntry* cacheEntry = GetEntry(server, entry);
 
-        if (cacheEntry->lastUsed && HAPRawBufferAreEqual(&cacheEntry->sessionID, sessionID, sizeof *sessionID)) {
+        if (HAPRawBufferAreEqual(&cacheEntry->sessionID, sessionID, sizeof *sessionID)) {
             HAPRawBufferCopyBytes(sharedSecret, cacheEntry->sharedSecret, sizeof cacheEntry->sharedSecret);
             *pairingID = cacheEntry->pairingID;
-            HAPRawBufferZero(cacheEntry, sizeof *cacheEntry);
+            RemoveEntry(server, entry);
+            HAPLogDebug(&logObject, "Session found (pairing ID %d).", *pairingID);
             return;
         }
+        entry = cacheEntry->nextInBucket;
     }
 
     // Not found.
+    HAPLogDebug(&logObject, "Session not found.");
     *pairingID = -1;
 }
 
@@ -59,46 +140,46 @@ void HAPPairingBLESessionCacheSave(
     HAPPrecondition(server->transports.ble);
     HAPPrecondition(sessionID);
     HAPPrecondition(sharedSecret);
-    HAPPrecondition(pairingID >= 0);
+    HAPPrecondition(pairingID >= 0 && pairingID <= INT16_MAX);
+    HAPPairingBLESessionCacheIndex* index = &server->ble.sessionCache;
 
     // Find free cache entry.
-    size_t index = 0;
-    {
-        // Search least recently used.
-        uint32_t min = UINT32_MAX;
-        for (size_t i = 0; i < server->ble.storage->numSessionCacheElements; i++) {
-            HAPPairingBLESessionCacheEntry* cacheEntry =
-                    (HAPPairingBLESessionCacheEntry*) &server->ble.storage->sessionCacheElements[i];
-
-            if (cacheEntry->lastUsed < min) {
-                min = cacheEntry->lastUsed;
-                index = i;
-            }
-        }
+    uint16_t entry;
+    if (index->firstUnused) {
+        entry = index->firstUnused;
+        index->firstUnused = GetEntry(server, entry)->nextInBucket;
+    } else if (index->numInitializedEntries < server->ble.storage->numSessionCacheElements) {
+        index->numInitializedEntries++;
+        entry = index->numInitializedEntries;
+    } else {
+        // Evict least recently used.
+        entry = index->leastRecentlyUsed;
+        HAPAssert(entry);
+        RemoveEntry(server, entry);
+        HAPAssert(index->firstUnused == entry);
+        index->firstUnused = GetEntry(server, entry)->nextInBucket;
     }
-    HAPPairingBLESessionCacheEntry* cacheEntry =
-            (HAPPairingBLESessionCacheEntry*) &server->ble.storage->sessionCacheElements[index];
+    HAPPairingBLESessionCacheEntry* cacheEntry = GetEntry(server, entry);
 
     // Save session.
     HAPRawBufferCopyBytes(&cacheEntry->sessionID, sessionID, sizeof *sessionID);
     HAPRawBufferCopyBytes(cacheEntry->sharedSecret, sharedSecret, sizeof cacheEntry->sharedSecret);
-    cacheEntry->pairingID = pairingID;
-
-    // Update least recently used.
-    server->ble.sessionCacheTimestamp++;
-    if (server->ble.sessionCacheTimestamp == 0) {
-        // Overflow => reset time stamps.
-        for (size_t i = 0; i < server->ble.storage->numSessionCacheElements; i++) {
-            HAPPairingBLESessionCacheEntry* e =
-                    (HAPPairingBLESessionCacheEntry*) &server->ble.storage->sessionCacheElements[i];
-
-            if (e->lastUsed) {
-                e->lastUsed = 1;
-            }
-        }
-        server->ble.sessionCacheTimestamp = 2;
+    cacheEntry->pairingID = (int16_t) pairingID;
+
+    // Add to hash bucket.
+    uint16_t* bucket = GetBucket(server, sessionID);
+    cacheEntry->nextInBucket = *bucket;
+    *bucket = entry;
+
+    // Add as most recently used.
+    cacheEntry->newer = 0;
+    cacheEntry->older = index->mostRecentlyUsed;
+    if (index->mostRecentlyUsed) {
+        GetEntry(server, index->mostRecentlyUsed)->newer = entry;
+    } else {
+        index->leastRecentlyUsed = entry;
     }
-    cacheEntry->lastUsed = server->ble.sessionCacheTimestamp;
+    index->mostRecentlyUsed = entry;
 }
 
 void HAPPairingBLESessionCacheInvalidateEntriesForPairing(HAPAccessoryServerRef* server_, int pairingID) {
@@ -108,12 +189,24 @@ void HAPPairingBLESessionCacheInvalidateEntriesForPairing(HAPAccessoryServerRef*
     HAPPrecondition(pairingID >= 0);
 
     // Remove sessions for pairing. There may be multiple (e.g. pairing synced to multiple controllers).
-    for (size_t i = 0; i < server->ble.storage->numSessionCacheElements; i++) {
-        HAPPairingBLESessionCacheEntry* cacheEntry =
-                (HAPPairingBLESessionCacheEntry*) &server->ble.storage->sessionCacheElements[i];
+    for (uint16_t entry = server->ble.sessionCache.mostRecentlyUsed; entry;) {
+        HAPPairingBLESessionCacheEntry* cacheEntry = GetEntry(server, entry);
+        uint16_t older = cacheEntry->older;
 
         if (cacheEntry->pairingID == pairingID) {
-            HAPRawBufferZero(cacheEntry, sizeof *cacheEntry);
+            RemoveEntry(server, entry);
         }
+        entry = older;
     }
 }
+
+void HAPPairingBLESessionCacheInvalidateAllEntries(HAPAccessoryServerRef* server_) {
+    HAPPrecondition(server_);
+    HAPAccessoryServer* server = (HAPAccessoryServer*) server_;
+    HAPPrecondition(server->ble.storage);
+
+    HAPRawBufferZero(
+            server->ble.storage->sessionCacheElements,
+            server->ble.storage->numSessionCacheElements * sizeof *server->ble.storage->sessionCacheElements);
+    HAPRawBufferZero(&server->ble.sessionCache, sizeof server->ble.sessionCache);
+}
@@ -25,6 +25,33 @@ typedef struct {
 } HAPPairingBLESessionID;
 HAP_STATIC_ASSERT(sizeof(HAPPairingBLESessionID) == 8, HAPPairingBLESessionID);
 
+/**
+ * BLE: Number of hash buckets in the Pair Resume cache index.
+ */
+#define kHAPPairingBLESessionCache_NumBuckets ((size_t) 16)
+
+/**
+ * BLE: Pair Resume cache index.
+ *
+ * - Cache entries are referenced by their index in the session cache storage + 1. 0 if none.
+ */
+typedef struct {
+    /** Hash buckets by session ID. Entries of a bucket are chained. */
+    uint16_t buckets[kHAPPairingBLESessionCache_NumBuckets];
+
+    /** Most recently used entry. */
+    uint16_t mostRecentlyUsed;
+
+    /** Least recently used entry. Evicted first when the cache is full. */
+    uint16_t leastRecentlyUsed;
+
+    /** First unused entry. Unused entries are chained. */
+    uint16_t firstUnused;
+
+    /** Number of entries that have been used before. Entries beyond are unused and not chained. */
+    uint16_t numInitializedEntries;
+} HAPPairingBLESessionCacheIndex;
+
 /**
  * Retrieves the shared secret and pairing ID for a session ID, if available.
  *
@@ -69,6 +96,13 @@ void HAPPairingBLESessionCacheSave(
  */
 void HAPPairingBLESessionCacheInvalidateEntriesForPairing(HAPAccessoryServerRef* server, int pairingID);
 
+/**
+ * Invalidates all Pair Resume cache entries.
+ *
+ * @param      server               Accessory server.
+ */
+void HAPPairingBLESessionCacheInvalidateAllEntries(HAPAccessoryServerRef* server);
+
 #if __has_feature(nullability)
 #pragma clang assume_nonnull end
 #endif
@@ -188,21 +188,28 @@ static HAPError HAPPairingPairingsAddPairingProcessM1(
         HAPAssert(sizeof pairing.publicKey.value == 32);
         HAPRawBufferCopyBytes(&pairingBytes[37], pairing.publicKey.value, 32);
         pairingBytes[69] = pairing.permissions;
+        HAPPlatformKeyValueStoreBeginBatch(server->platform.keyValueStore);
         err = HAPPlatformKeyValueStoreSet(
                 server->platform.keyValueStore,
                 kHAPKeyValueStoreDomain_Pairings,
                 key,
                 pairingBytes,
                 sizeof pairingBytes);
+        HAPError cleanupErr = kHAPError_None;
+        if (!err) {
+            // If the admin controller pairing is removed, all pairings on the accessory must be removed.
+            cleanupErr = HAPAccessoryServerCleanupPairings(server_);
+        }
+        HAPError commitErr = HAPPlatformKeyValueStoreCommitBatch(server->platform.keyValueStore);
+        if (!err) {
+            err = commitErr;
+        }
         if (err) {
             HAPAssert(err == kHAPError_Unknown);
             return err;
         }
-
-        // If the admin controller pairing is removed, all pairings on the accessory must be removed.
-        err = HAPAccessoryServerCleanupPairings(server_);
-        if (err) {
-            HAPAssert(err == kHAPError_Unknown);
+        if (cleanupErr) {
+            HAPAssert(cleanupErr == kHAPError_Unknown);
             HAPLog(&logObject, "Add Pairing M1: Failed to cleanup pairings.");
             session->state.pairings.error = kHAPPairingError_Unknown;
             return kHAPError_None;
@@ -482,24 +489,33 @@ static HAPError HAPPairingPairingsRemovePairingGetM2(
     // key from persistent storage. If a pairing for RemovedControllerPairingIdentifier does not exist, the
     // accessory must return success.
     if (found) {
+        // The pairing and any pairings that depend on it are removed together.
+        HAPPlatformKeyValueStoreBeginBatch(server->platform.keyValueStore);
+
         // Remove the pairing.
         err = HAPPlatformKeyValueStoreRemove(server->platform.keyValueStore, kHAPKeyValueStoreDomain_Pairings, key);
+        HAPError cleanupErr = kHAPError_None;
+        if (!err) {
+            // BLE: Remove all Pair Resume cache entries related to this pairing.
+            if (server->transports.ble) {
+                HAPNonnull(server->transports.ble)->sessionCache.invalidateEntriesForPairing(server_, (int) key);
+            }
+
+            // If the admin controller pairing is removed, all pairings on the accessory must be removed.
+            cleanupErr = HAPAccessoryServerCleanupPairings(server_);
+        }
+        HAPError commitErr = HAPPlatformKeyValueStoreCommitBatch(server->platform.keyValueStore);
+        if (!err) {
+            err = commitErr;
+        }
         if (err) {
             HAPAssert(err == kHAPError_Unknown);
             HAPLog(&logObject, "Remove Pairing M2: Failed to remove pairing.");
             session->state.pairings.error = kHAPPairingError_Unknown;
             return kHAPError_None;
         }
-
-        // BLE: Remove all Pair Resume cache entries related to this pairing.
-        if (server->transports.ble) {
-            HAPNonnull(server->transports.ble)->sessionCache.invalidateEntriesForPairing(server_, (int) key);
-        }
-
-        // If the admin controller pairing is removed, all pairings on the accessory must be removed.
-        err = HAPAccessoryServerCleanupPairings(server_);
-        if (err) {
-            HAPAssert(err == kHAPError_Unknown);
+        if (cleanupErr) {
+            HAPAssert(cleanupErr == kHAPError_Unknown);
             HAPLog(&logObject, "Remove Pairing M2: Failed to cleanup pairings.");
             session->state.pairings.error = kHAPPairingError_Unknown;
             return kHAPError_None;
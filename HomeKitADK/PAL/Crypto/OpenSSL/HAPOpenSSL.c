@@ -10,11 +10,108 @@
 #include <openssl/evp.h>
 #include <openssl/hmac.h>
 #include <openssl/kdf.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#endif
 #include <openssl/srp.h>
 #include <openssl/rand.h>
 
+#include <pthread.h>
+#include <stdlib.h>
+
+// Spare contexts are freed when their thread exits, or at process exit for the thread calling exit().
+static pthread_once_t ctx_cache_once = PTHREAD_ONCE_INIT;
+static pthread_key_t ctx_cache_key;
+
+static void ctx_cache_free(void* _Nullable unused);
+
+static void ctx_cache_free_at_exit(void) {
+    ctx_cache_free(NULL);
+}
+
+static void ctx_cache_init(void) {
+    int ret = pthread_key_create(&ctx_cache_key, ctx_cache_free);
+    HAPAssert(ret == 0);
+    ret = atexit(ctx_cache_free_at_exit);
+    HAPAssert(ret == 0);
+}
+
+static void ctx_cache_register(void) {
+    int ret = pthread_once(&ctx_cache_once, ctx_cache_init);
+    HAPAssert(ret == 0);
+    if (!pthread_getspecific(ctx_cache_key)) {
+        ret = pthread_setspecific(ctx_cache_key, &ctx_cache_key);
+        HAPAssert(ret == 0);
+    }
+}
+
+// Contexts are expensive to create. One spare context of each type is kept per thread and reset for reuse.
+// init creates a new context, reset(ctx) prepares a released context for reuse and returns 1 on success.
+#define DEFINE_CTX_CACHE(type, init, reset) \
+    static _Thread_local type* spare_##type; \
+\
+    static void type##_cache_free(void) { \
+        type##_free(spare_##type); \
+        spare_##type = NULL; \
+    } \
+\
+    static type* type##_acquire(void) { \
+        type* ctx = spare_##type; \
+        spare_##type = NULL; \
+        if (!ctx) { \
+            ctx = init; \
+            HAPAssert(ctx); \
+        } \
+        return ctx; \
+    } \
+\
+    static void type##_release(type* ctx) { \
+        if (!spare_##type) { \
+            int ret = reset(ctx); \
+            HAPAssert(ret == 1); \
+            ctx_cache_register(); \
+            spare_##type = ctx; \
+        } else { \
+            type##_free(ctx); \
+        } \
+    }
+
+DEFINE_CTX_CACHE(EVP_MD_CTX, EVP_MD_CTX_new(), EVP_MD_CTX_reset)
+DEFINE_CTX_CACHE(EVP_CIPHER_CTX, EVP_CIPHER_CTX_new(), EVP_CIPHER_CTX_reset)
+
+// The HKDF context is reinitialized by EVP_PKEY_derive_init, which also clears the key, salt and info.
+DEFINE_CTX_CACHE(EVP_PKEY_CTX, EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, NULL), EVP_PKEY_derive_init)
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+static EVP_MAC_CTX* EVP_MAC_CTX_new_hmac(void) {
+    EVP_MAC* mac = EVP_MAC_fetch(NULL, OSSL_MAC_NAME_HMAC, NULL);
+    HAPAssert(mac);
+    EVP_MAC_CTX* ctx = EVP_MAC_CTX_new(mac);
+    EVP_MAC_free(mac);
+    return ctx;
+}
+
+// The HMAC context is rekeyed by EVP_MAC_init on every use.
+#define EVP_MAC_CTX_reset(ctx) 1
+
+DEFINE_CTX_CACHE(EVP_MAC_CTX, EVP_MAC_CTX_new_hmac(), EVP_MAC_CTX_reset)
+#else
+DEFINE_CTX_CACHE(HMAC_CTX, HMAC_CTX_new(), HMAC_CTX_reset)
+#endif
+
+static void ctx_cache_free(void* _Nullable unused HAP_UNUSED) {
+    EVP_MD_CTX_cache_free();
+    EVP_CIPHER_CTX_cache_free();
+    EVP_PKEY_CTX_cache_free();
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    EVP_MAC_CTX_cache_free();
+#else
+    HMAC_CTX_cache_free();
+#endif
+}
+
 static void hash_init(EVP_MD_CTX** ctx, const EVP_MD* type) {
-    *ctx = EVP_MD_CTX_create();
+    *ctx = EVP_MD_CTX_acquire();
     int ret = EVP_DigestInit_ex(*ctx, type, NULL);
     HAPAssert(ret == 1);
 }
@@ -27,7 +124,7 @@ static void hash_update(EVP_MD_CTX** ctx, const uint8_t* data, size_t size) {
 static void hash_final(EVP_MD_CTX** ctx, uint8_t* md) {
     int ret = EVP_DigestFinal_ex(*ctx, md, NULL);
     HAPAssert(ret == 1);
-    EVP_MD_CTX_destroy(*ctx);
+    EVP_MD_CTX_release(*ctx);
     *ctx = NULL;
 }
 
@@ -57,7 +154,7 @@ void HAP_ed25519_sign(
         const uint8_t sk[ED25519_SECRET_KEY_BYTES],
         const uint8_t pk[ED25519_PUBLIC_KEY_BYTES] HAP_UNUSED) {
     WITH_PKEY(key, EVP_PKEY_new_raw_private_key(EVP_PKEY_ED25519, NULL, sk, ED25519_SECRET_KEY_BYTES), {
-        WITH_CTX(EVP_MD_CTX, EVP_MD_CTX_new(), {
+        WITH(EVP_MD_CTX, ctx, EVP_MD_CTX_acquire(), EVP_MD_CTX_release, {
             int ret = EVP_DigestSignInit(ctx, NULL, NULL, NULL, key);
             HAPAssert(ret == 1);
             size_t len = ED25519_BYTES;
@@ -74,7 +171,7 @@ int HAP_ed25519_verify(
         const uint8_t pk[ED25519_PUBLIC_KEY_BYTES]) {
     int ret;
     WITH_PKEY(key, EVP_PKEY_new_raw_public_key(EVP_PKEY_ED25519, NULL, pk, ED25519_PUBLIC_KEY_BYTES), {
-        WITH_CTX(EVP_MD_CTX, EVP_MD_CTX_new(), {
+        WITH(EVP_MD_CTX, ctx, EVP_MD_CTX_acquire(), EVP_MD_CTX_release, {
             ret = EVP_DigestVerifyInit(ctx, NULL, NULL, NULL, key);
             HAPAssert(ret == 1);
             ret = EVP_DigestVerify(ctx, sig, ED25519_BYTES, m, m_len);
@@ -261,6 +358,32 @@ int HAP_srp_premaster_secret(
     return (isAValid) ? 0 : 1;
 }
 
+int HAP_srp_premaster_secret_stage(
+        uint8_t s[SRP_PREMASTER_SECRET_BYTES],
+        const uint8_t pub_a[SRP_PUBLIC_KEY_BYTES],
+        const uint8_t priv_b[SRP_SECRET_KEY_BYTES],
+        const uint8_t u[SRP_SCRAMBLING_PARAMETER_BYTES],
+        const uint8_t v[SRP_VERIFIER_BYTES],
+        uint8_t* stage) {
+    // OpenSSL is fast enough to compute the premaster secret in a single stage.
+    switch (*stage) {
+        case 0: {
+            int ret = HAP_srp_premaster_secret(s, pub_a, priv_b, u, v);
+            if (ret) {
+                return ret;
+            }
+            *stage = HAP_SRP_PREMASTER_SECRET_STAGE_DONE;
+            return 0;
+        }
+        case HAP_SRP_PREMASTER_SECRET_STAGE_DONE: {
+            return 0;
+        }
+        default: {
+            return 2;
+        }
+    }
+}
+
 static size_t Count_Leading_Zeroes(const uint8_t* start, size_t n) {
     const uint8_t* p = start;
     const uint8_t* stop = start + n;
@@ -357,7 +480,23 @@ void HAP_hmac_sha1_aad(
         size_t in_len,
         const uint8_t* aad,
         size_t aad_len) {
-    WITH_CTX(HMAC_CTX, HMAC_CTX_new(), {
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    OSSL_PARAM params[2];
+    params[0] = OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, (char*) OSSL_DIGEST_NAME_SHA1, 0);
+    params[1] = OSSL_PARAM_construct_end();
+    WITH(EVP_MAC_CTX, ctx, EVP_MAC_CTX_acquire(), EVP_MAC_CTX_release, {
+        int ret = EVP_MAC_init(ctx, key, key_len, params);
+        HAPAssert(ret == 1);
+        ret = EVP_MAC_update(ctx, in, in_len);
+        HAPAssert(ret == 1);
+        ret = EVP_MAC_update(ctx, aad, aad_len);
+        HAPAssert(ret == 1);
+        size_t r_len = HMAC_SHA1_BYTES;
+        ret = EVP_MAC_final(ctx, r, &r_len, HMAC_SHA1_BYTES);
+        HAPAssert(ret == 1 && r_len == HMAC_SHA1_BYTES);
+    });
+#else
+    WITH(HMAC_CTX, ctx, HMAC_CTX_acquire(), HMAC_CTX_release, {
         int ret = HMAC_Init_ex(ctx, key, key_len, EVP_sha1(), NULL);
         HAPAssert(ret == 1);
         ret = HMAC_Update(ctx, in, in_len);
@@ -368,6 +507,7 @@ void HAP_hmac_sha1_aad(
         ret = HMAC_Final(ctx, r, &r_len);
         HAPAssert(ret == 1 && r_len == HMAC_SHA1_BYTES);
     });
+#endif
 }
 
 void HAP_hkdf_sha512(
@@ -379,7 +519,7 @@ void HAP_hkdf_sha512(
         size_t salt_len,
         const uint8_t* info,
         size_t info_len) {
-    WITH_CTX(EVP_PKEY_CTX, EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, NULL), {
+    WITH(EVP_PKEY_CTX, ctx, EVP_PKEY_CTX_acquire(), EVP_PKEY_CTX_release, {
         int ret = EVP_PKEY_derive_init(ctx);
         HAPAssert(ret == 1);
         ret = EVP_PKEY_CTX_set_hkdf_md(ctx, EVP_sha512());
@@ -413,25 +553,66 @@ typedef struct {
 
 HAP_STATIC_ASSERT(sizeof(HAP_chacha20_poly1305_ctx) >= sizeof(EVP_CIPHER_CTX_Handle), HAP_chacha20_poly1305_ctx);
 
-// OpenSSL doesn't like overlapping in/out buffers in EVP_EncryptUpdate/EVP_DecryptUpdate
+// OpenSSL supports exact in-place operation in EVP_EncryptUpdate/EVP_DecryptUpdate
+// but not partially overlapping in/out buffers.
 static bool is_overlapping(const uint8_t* a, const uint8_t* b, size_t n) {
     return (a < b && a + n > b) || (b < a && b + n > a);
 }
 
-static uint8_t* use_temporary_if_overlapping(uint8_t** tmp, const uint8_t* in, uint8_t* out, size_t n) {
-    *tmp = NULL;
-    if (is_overlapping(in, out, n)) {
-        return *tmp = malloc(n);
+static void chacha20_poly1305_update(
+        HAP_chacha20_poly1305_ctx* ctx,
+        int enc,
+        uint8_t* output,
+        const uint8_t* input,
+        size_t input_len,
+        const uint8_t* n,
+        size_t n_len,
+        const uint8_t k[CHACHA20_POLY1305_KEY_BYTES]) {
+    EVP_CIPHER_CTX_Handle* handle = (EVP_CIPHER_CTX_Handle*) ctx;
+    int ret;
+    if (!handle->ctx) {
+        handle->ctx = EVP_CIPHER_CTX_acquire();
+        ret = EVP_CipherInit_ex(handle->ctx, EVP_chacha20_poly1305(), NULL, NULL, NULL, enc);
+        HAPAssert(ret == 1);
+        if (enc) {
+            ret = EVP_CIPHER_CTX_ctrl(handle->ctx, EVP_CTRL_AEAD_SET_TAG, CHACHA20_POLY1305_TAG_BYTES, NULL);
+            HAPAssert(ret == 1);
+        }
+        if (n_len >= CHACHA20_POLY1305_NONCE_BYTES_MAX) {
+            n_len = CHACHA20_POLY1305_NONCE_BYTES_MAX;
+        }
+        // pad nonce
+        uint8_t nonce[CHACHA20_POLY1305_NONCE_BYTES_MAX];
+        memset(nonce, 0, sizeof nonce);
+        memcpy(nonce + sizeof nonce - n_len, n, n_len);
+        ret = EVP_CipherInit_ex(handle->ctx, NULL, NULL, k, nonce, enc);
+        HAPAssert(ret == 1);
+    }
+    if (input_len > 0) {
+        if (is_overlapping(input, output, input_len)) {
+            // Move the input into place and process it in place.
+            memmove(output, input, input_len);
+            input = output;
+        }
+        int output_len;
+        ret = EVP_CipherUpdate(handle->ctx, output, &output_len, input, input_len);
+        HAPAssert(ret == 1 && (size_t) output_len == input_len);
     }
-    return out;
 }
 
-static void copy_and_free_if_overlapping(uint8_t** tmp, uint8_t** out, size_t n) {
-    if (*tmp) {
-        memcpy(*out, *tmp, n);
-        free(*tmp);
-        *tmp = NULL;
-    }
+static void chacha20_poly1305_update_aad(
+        HAP_chacha20_poly1305_ctx* ctx,
+        int enc,
+        const uint8_t* a,
+        size_t a_len,
+        const uint8_t* n,
+        size_t n_len,
+        const uint8_t k[CHACHA20_POLY1305_KEY_BYTES]) {
+    chacha20_poly1305_update(ctx, enc, NULL, NULL, 0, n, n_len, k);
+    EVP_CIPHER_CTX_Handle* handle = (EVP_CIPHER_CTX_Handle*) ctx;
+    int a_out;
+    int ret = EVP_CipherUpdate(handle->ctx, NULL, &a_out, a, a_len);
+    HAPAssert(ret == 1 && (size_t) a_out == a_len);
 }
 
 void HAP_chacha20_poly1305_init(
@@ -451,26 +632,7 @@ void HAP_chacha20_poly1305_update_enc(
         const uint8_t* n,
         size_t n_len,
         const uint8_t k[CHACHA20_POLY1305_KEY_BYTES]) {
-    EVP_CIPHER_CTX_Handle* handle = (EVP_CIPHER_CTX_Handle*) ctx;
-    int ret;
-    if (!handle->ctx) {
-        handle->ctx = EVP_CIPHER_CTX_new();
-        ret = EVP_EncryptInit_ex(handle->ctx, EVP_chacha20_poly1305(), 0, 0, 0);
-        HAPAssert(ret == 1);
-        ret = EVP_CIPHER_CTX_ctrl(handle->ctx, EVP_CTRL_AEAD_SET_TAG, CHACHA20_POLY1305_TAG_BYTES, NULL);
-        HAPAssert(ret == 1);
-        ret = EVP_CIPHER_CTX_ctrl(handle->ctx, EVP_CTRL_AEAD_SET_IVLEN, n_len, NULL);
-        HAPAssert(ret == 1);
-        ret = EVP_EncryptInit_ex(handle->ctx, NULL, NULL, k, n);
-        HAPAssert(ret == 1);
-    }
-    if (m_len > 0) {
-        uint8_t* tmp;
-        int c_len;
-        ret = EVP_EncryptUpdate(handle->ctx, use_temporary_if_overlapping(&tmp, m, c, m_len), &c_len, m, m_len);
-        copy_and_free_if_overlapping(&tmp, &c, m_len);
-        HAPAssert(ret == 1 && (size_t) c_len == m_len);
-    }
+    chacha20_poly1305_update(ctx, 1, c, m, m_len, n, n_len, k);
 }
 
 void HAP_chacha20_poly1305_update_enc_aad(
@@ -480,11 +642,7 @@ void HAP_chacha20_poly1305_update_enc_aad(
         const uint8_t* n,
         size_t n_len,
         const uint8_t k[CHACHA20_POLY1305_KEY_BYTES]) {
-    HAP_chacha20_poly1305_update_enc(ctx, NULL, NULL, 0, n, n_len, k);
-    EVP_CIPHER_CTX_Handle* handle = (EVP_CIPHER_CTX_Handle*) ctx;
-    int a_out;
-    int ret = EVP_EncryptUpdate(handle->ctx, NULL, &a_out, a, a_len);
-    HAPAssert(ret == 1 && (size_t) a_out == a_len);
+    chacha20_poly1305_update_aad(ctx, 1, a, a_len, n, n_len, k);
 }
 
 void HAP_chacha20_poly1305_final_enc(HAP_chacha20_poly1305_ctx* ctx, uint8_t tag[CHACHA20_POLY1305_TAG_BYTES]) {
@@ -494,7 +652,7 @@ void HAP_chacha20_poly1305_final_enc(HAP_chacha20_poly1305_ctx* ctx, uint8_t tag
     HAPAssert(ret == 1 && !c_len);
     ret = EVP_CIPHER_CTX_ctrl(handle->ctx, EVP_CTRL_AEAD_GET_TAG, CHACHA20_POLY1305_TAG_BYTES, tag);
     HAPAssert(ret == 1);
-    EVP_CIPHER_CTX_free(handle->ctx);
+    EVP_CIPHER_CTX_release(handle->ctx);
     handle->ctx = NULL;
 }
 
@@ -506,24 +664,7 @@ void HAP_chacha20_poly1305_update_dec(
         const uint8_t* n,
         size_t n_len,
         const uint8_t k[CHACHA20_POLY1305_KEY_BYTES]) {
-    EVP_CIPHER_CTX_Handle* handle = (EVP_CIPHER_CTX_Handle*) ctx;
-    int ret;
-    if (!handle->ctx) {
-        handle->ctx = EVP_CIPHER_CTX_new();
-        int ret = EVP_DecryptInit_ex(handle->ctx, EVP_chacha20_poly1305(), 0, 0, 0);
-        HAPAssert(ret == 1);
-        ret = EVP_CIPHER_CTX_ctrl(handle->ctx, EVP_CTRL_AEAD_SET_IVLEN, n_len, NULL);
-        HAPAssert(ret == 1);
-        ret = EVP_DecryptInit_ex(handle->ctx, NULL, NULL, k, n);
-        HAPAssert(ret == 1);
-    }
-    if (c_len > 0) {
-        uint8_t* tmp;
-        int m_len;
-        ret = EVP_DecryptUpdate(handle->ctx, use_temporary_if_overlapping(&tmp, c, m, c_len), &m_len, c, c_len);
-        copy_and_free_if_overlapping(&tmp, &m, c_len);
-        HAPAssert(ret == 1);
-    }
+    chacha20_poly1305_update(ctx, 0, m, c, c_len, n, n_len, k);
 }
 
 void HAP_chacha20_poly1305_update_dec_aad(
@@ -533,11 +674,7 @@ void HAP_chacha20_poly1305_update_dec_aad(
         const uint8_t* n,
         size_t n_len,
         const uint8_t k[CHACHA20_POLY1305_KEY_BYTES]) {
-    HAP_chacha20_poly1305_update_dec(ctx, NULL, NULL, 0, n, n_len, k);
-    EVP_CIPHER_CTX_Handle* handle = (EVP_CIPHER_CTX_Handle*) ctx;
-    int a_out;
-    int ret = EVP_DecryptUpdate(handle->ctx, NULL, &a_out, a, a_len);
-    HAPAssert(ret == 1 && (size_t) a_out == a_len);
+    chacha20_poly1305_update_aad(ctx, 0, a, a_len, n, n_len, k);
 }
 
 int HAP_chacha20_poly1305_final_dec(HAP_chacha20_poly1305_ctx* ctx, const uint8_t tag[CHACHA20_POLY1305_TAG_BYTES]) {
@@ -547,7 +684,7 @@ int HAP_chacha20_poly1305_final_dec(HAP_chacha20_poly1305_ctx* ctx, const uint8_
     int m_len;
     ret = EVP_DecryptFinal_ex(handle->ctx, NULL, &m_len);
     HAPAssert(m_len == 0);
-    EVP_CIPHER_CTX_free(handle->ctx);
+    EVP_CIPHER_CTX_release(handle->ctx);
     handle->ctx = NULL;
     return (ret == 1) ? 0 : -1;
 }
@@ -557,7 +694,7 @@ HAP_STATIC_ASSERT(sizeof(HAP_aes_ctr_ctx) >= sizeof(EVP_CIPHER_CTX_Handle), HAP_
 void HAP_aes_ctr_init(HAP_aes_ctr_ctx* ctx, const uint8_t* key, int size, const uint8_t iv[16]) {
     EVP_CIPHER_CTX_Handle* handle = (EVP_CIPHER_CTX_Handle*) ctx;
     HAPAssert(size == 16 || size == 32);
-    handle->ctx = EVP_CIPHER_CTX_new();
+    handle->ctx = EVP_CIPHER_CTX_acquire();
     int ret = EVP_EncryptInit_ex(handle->ctx, (size == 16) ? EVP_aes_128_ctr() : EVP_aes_256_ctr(), NULL, key, iv);
     HAPAssert(ret == 1);
     EVP_CIPHER_CTX_set_padding(handle->ctx, 0);
@@ -576,6 +713,6 @@ void HAP_aes_ctr_decrypt(HAP_aes_ctr_ctx* ctx, uint8_t* pt, const uint8_t* ct, s
 
 void HAP_aes_ctr_done(HAP_aes_ctr_ctx* ctx) {
     EVP_CIPHER_CTX_Handle* handle = (EVP_CIPHER_CTX_Handle*) ctx;
-    EVP_CIPHER_CTX_free(handle->ctx);
+    EVP_CIPHER_CTX_release(handle->ctx);
     handle->ctx = NULL;
 }
@@ -56,6 +56,8 @@ struct HAPPlatformKeyValueStore {
     // Opaque type. Do not access the instance fields directly.
     /**@cond */
     const char* rootDirectory;
+    size_t numBatches;
+    bool isDirty;
     /**@endcond */
 };
 
@@ -21,6 +21,8 @@ void HAPPlatformKeyValueStoreCreate(
     HAPPrecondition(keyValueStore);
 
     keyValueStore->rootDirectory = options->rootDirectory;
+    keyValueStore->numBatches = 0;
+    keyValueStore->isDirty = false;
     HAPLog(&kvs_log, "Storage location: %s", keyValueStore->rootDirectory);
 
     NSError* error;
@@ -67,14 +69,21 @@ HAPError HAPPlatformKeyValueStoreGet(
     return kHAPError_None;
 }
 
-static HAPError Sync(const char* rootDirectory) {
+static HAPError Sync(HAPPlatformKeyValueStoreRef keyValueStore) {
+    if (keyValueStore->numBatches) {
+        // Written when the outermost batch is committed.
+        keyValueStore->isDirty = true;
+        return kHAPError_None;
+    }
+    keyValueStore->isDirty = false;
+
     NSError* error;
     NSData* data = [NSKeyedArchiver archivedDataWithRootObject:KeyValueStore requiringSecureCoding:YES error:&error];
     if (!data) {
         HAPLogError(&kvs_log, "Serializing data with NSKeyedArchiver failed");
         return kHAPError_Unknown;
     }
-    [data writeToFile:@(rootDirectory) atomically:YES];
+    [data writeToFile:@(keyValueStore->rootDirectory) atomically:YES];
 
     return kHAPError_None;
 }
@@ -91,7 +100,7 @@ HAPError HAPPlatformKeyValueStoreSet(
 
     KeyValueStore[AsDictionaryKey(domain, key)] = [NSData dataWithBytes:bytes length:numBytes];
 
-    return Sync(keyValueStore->rootDirectory);
+    return Sync(keyValueStore);
 }
 
 HAP_RESULT_USE_CHECK
@@ -103,7 +112,7 @@ HAPError HAPPlatformKeyValueStoreRemove(
 
     [KeyValueStore removeObjectForKey:AsDictionaryKey(domain, key)];
 
-    return Sync(keyValueStore->rootDirectory);
+    return Sync(keyValueStore);
 }
 
 HAP_RESULT_USE_CHECK
@@ -148,5 +157,23 @@ HAPError HAPPlatformKeyValueStorePurgeDomain(
     }
     KeyValueStore = newDict;
 
-    return Sync(keyValueStore->rootDirectory);
+    return Sync(keyValueStore);
+}
+
+void HAPPlatformKeyValueStoreBeginBatch(HAPPlatformKeyValueStoreRef keyValueStore) {
+    HAPPrecondition(keyValueStore);
+
+    keyValueStore->numBatches++;
+}
+
+HAP_RESULT_USE_CHECK
+HAPError HAPPlatformKeyValueStoreCommitBatch(HAPPlatformKeyValueStoreRef keyValueStore) {
+    HAPPrecondition(keyValueStore);
+    HAPPrecondition(keyValueStore->numBatches);
+
+    keyValueStore->numBatches--;
+    if (keyValueStore->numBatches || !keyValueStore->isDirty) {
+        return kHAPError_None;
+    }
+    return Sync(keyValueStore);
 }
@@ -7,6 +7,7 @@
 #include "HAPBase.h"
 #include "HAPCrypto.h"
 
+#include <limits.h>
 #include <string.h>
 
 uint32_t HAP_load_bigendian(const uint8_t* x) {
@@ -24,27 +25,48 @@ void HAP_store_bigendian(uint8_t x[4], uint32_t u) {
     x[3] = (uint8_t) u;
 }
 
+// The constant time functions process a machine word at a time. Words are loaded with memcpy so that buffers
+// do not need to be aligned. Only the length determines the sequence of operations, never the contents.
+
+static int constant_time_word_is_zero(uintptr_t a) {
+    return (int) (((a | (0 - a)) >> (sizeof a * CHAR_BIT - 1)) ^ 1);
+}
+
 int HAP_constant_time_equal(const void* x, const void* y, size_t length) {
     const uint8_t* px = (const uint8_t*) x;
     const uint8_t* py = (const uint8_t*) y;
-    uint32_t a = 0;
+    uintptr_t a = 0;
+    for (; length >= sizeof a; px += sizeof a, py += sizeof a, length -= sizeof a) {
+        uintptr_t wx, wy;
+        memcpy(&wx, px, sizeof wx);
+        memcpy(&wy, py, sizeof wy);
+        a |= wx ^ wy;
+    }
     while (length--) {
-        a |= (*px++) ^ (*py++);
+        a |= (uintptr_t)((*px++) ^ (*py++));
     }
-    return !a;
+    return constant_time_word_is_zero(a);
 }
 
 int HAP_constant_time_is_zero(const void* x, size_t length) {
     const uint8_t* p = (const uint8_t*) x;
-    uint32_t a = 0;
+    uintptr_t a = 0;
+    for (; length >= sizeof a; p += sizeof a, length -= sizeof a) {
+        uintptr_t w;
+        memcpy(&w, p, sizeof w);
+        a |= w;
+    }
     while (length--) {
         a |= *p++;
     }
-    return !a;
+    return constant_time_word_is_zero(a);
 }
 
+// Called through a volatile pointer so that clearing secrets is not optimized away.
+static void* (*const volatile memset_function)(void*, int, size_t) = memset;
+
 void HAP_constant_time_fill_zero(void* x, size_t length) {
-    memset(x, 0, length);
+    memset_function(x, 0, length);
 }
 
 void HAP_constant_time_copy(void* x, const void* y, size_t length) {
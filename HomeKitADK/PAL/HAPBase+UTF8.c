@@ -6,8 +6,35 @@
 
 #include "HAPPlatform.h"
 
+// The vectorized validator is selected at compile time based on the target instruction set.
+// Define HAP_UTF8_DISABLE_SIMD to always use the portable implementation.
+#if !defined(HAP_UTF8_DISABLE_SIMD) && defined(__SSE4_1__)
+#define HAP_UTF8_SSE4 1
+#include <smmintrin.h>
+#elif !defined(HAP_UTF8_DISABLE_SIMD) && defined(__ARM_NEON) && defined(__aarch64__)
+#define HAP_UTF8_NEON 1
+#include <arm_neon.h>
+#endif
+
+/**
+ * Machine word used by the ASCII fast path of the portable validator.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+typedef size_t __attribute__((__may_alias__)) UTF8Word;
+#else
+typedef size_t UTF8Word;
+#endif
+
+/**
+ * Mask of the high bit of every byte in a UTF8Word.
+ */
+#define kUTF8Word_HighBits ((UTF8Word)(((UTF8Word) -1 / 0xFF) * 0x80))
+
+/**
+ * Portable validator. Consumes aligned machine words at a time while in a run of ASCII characters.
+ */
 HAP_RESULT_USE_CHECK
-bool HAPUTF8IsValidData(const void* bytes, size_t numBytes) {
+static bool IsValidDataScalar(const uint8_t* bytes, size_t numBytes) {
     HAPPrecondition(bytes);
 
     // See http://www.unicode.org/versions/Unicode6.0.0/ch03.pdf - Table 3-7, page 94.
@@ -24,8 +51,20 @@ bool HAPUTF8IsValidData(const void* bytes, size_t numBytes) {
     // 110xxxx0  10xxxxxx     1      1      0        0    10xxxxxx  00000000
     // 110xxxx0  110xxxxx     1      1      1        1
 
-    for (size_t i = 0; i < numBytes; i++) {
-        int value = ((const uint8_t*) bytes)[i];
+    size_t i = 0;
+    while (i < numBytes) {
+        // ASCII fast path. Only taken on a character boundary where no continuation bytes are outstanding.
+        if (!(state >> 7) && !((uintptr_t) &bytes[i] % sizeof(UTF8Word))) {
+            while (numBytes - i >= sizeof(UTF8Word) && !(*(const UTF8Word*) &bytes[i] & kUTF8Word_HighBits)) {
+                i += sizeof(UTF8Word);
+                state = 0;
+            }
+            if (i == numBytes) {
+                break;
+            }
+        }
+
+        int value = bytes[i];
         int more = state >> 7;         // More continuation bytes expected.
         int first = value >> 7;        // First bit.
         int second = (value >> 6) & 1; // Second bit.
@@ -48,6 +87,7 @@ bool HAPUTF8IsValidData(const void* bytes, size_t numBytes) {
         // New state.
         prefix = -(first & second) & value;
         state = (uint8_t)((prefix | (-more & state)) << 1);
+        i++;
     }
 
     // Missing continuations.
@@ -55,3 +95,211 @@ bool HAPUTF8IsValidData(const void* bytes, size_t numBytes) {
 
     return (bool) (1 & ~error);
 }
+
+#if HAP_UTF8_SSE4 || HAP_UTF8_NEON
+
+// Vectorized validator based on the lookup algorithm described in
+// John Keiser, Daniel Lemire: Validating UTF-8 In Less Than One Instruction Per Byte (2020).
+//
+// Every byte is classified together with its predecessor using three 16-entry lookup tables
+// (high nibble of the previous byte, low nibble of the previous byte, high nibble of the current byte).
+// A byte pair is invalid if all three lookups have an error bit in common.
+// The expected 3rd and 4th bytes of multi-byte sequences are verified separately.
+
+// Error classes of a byte pair. Byte 1 is the previous byte, byte 2 the current byte.
+#define kTooShort     (1 << 0) // 11______ 0_______ or 11______ 11______
+#define kTooLong      (1 << 1) // 0_______ 10______
+#define kOverlong3    (1 << 2) // 11100000 100_____
+#define kTooLarge     (1 << 3) // 11110100 1001____, 11110100 101_____, 11110101+ 1001____, 11110101+ 101_____
+#define kSurrogate    (1 << 4) // 11101101 101_____
+#define kOverlong2    (1 << 5) // 1100000_ 10______
+#define kTooLarge1000 (1 << 6) // 11110101+ 1000____
+#define kOverlong4    (1 << 6) // 11110000 1000____
+#define kTwoConts     (1 << 7) // 10______ 10______
+#define kCarry        (kTooShort | kTooLong | kTwoConts)
+
+static const uint8_t kByte1High[16] = {
+    // 0_______ ________ <ASCII in byte 1>
+    kTooLong,
+    kTooLong,
+    kTooLong,
+    kTooLong,
+    kTooLong,
+    kTooLong,
+    kTooLong,
+    kTooLong,
+    // 10______ ________ <continuation in byte 1>
+    kTwoConts,
+    kTwoConts,
+    kTwoConts,
+    kTwoConts,
+    // 1100____ ________ <two byte lead in byte 1>
+    kTooShort | kOverlong2,
+    // 1101____ ________ <two byte lead in byte 1>
+    kTooShort,
+    // 1110____ ________ <three byte lead in byte 1>
+    kTooShort | kOverlong3 | kSurrogate,
+    // 1111____ ________ <four+ byte lead in byte 1>
+    kTooShort | kTooLarge | kTooLarge1000 | kOverlong4,
+};
+
+static const uint8_t kByte1Low[16] = {
+    // ____0000 ________
+    kCarry | kOverlong3 | kOverlong2 | kOverlong4,
+    // ____0001 ________
+    kCarry | kOverlong2,
+    // ____001_ ________
+    kCarry,
+    kCarry,
+    // ____0100 ________
+    kCarry | kTooLarge,
+    // ____0101 ________
+    kCarry | kTooLarge | kTooLarge1000,
+    // ____011_ ________
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    // ____1___ ________
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+    // ____1101 ________
+    kCarry | kTooLarge | kTooLarge1000 | kSurrogate,
+    kCarry | kTooLarge | kTooLarge1000,
+    kCarry | kTooLarge | kTooLarge1000,
+};
+
+static const uint8_t kByte2High[16] = {
+    // ________ 0_______ <ASCII in byte 2>
+    kTooShort,
+    kTooShort,
+    kTooShort,
+    kTooShort,
+    kTooShort,
+    kTooShort,
+    kTooShort,
+    kTooShort,
+    // ________ 1000____
+    kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge1000 | kOverlong4,
+    // ________ 1001____
+    kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge,
+    // ________ 101_____
+    kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+    kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+    // ________ 11______
+    kTooShort,
+    kTooShort,
+    kTooShort,
+    kTooShort,
+};
+
+// Largest byte values that do not start a sequence running past the end of a block, by block position.
+static const uint8_t kMaxCompleteValue[16] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                                               0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xEF, 0xDF, 0xBF };
+
+#if HAP_UTF8_SSE4
+typedef __m128i UTF8Vector;
+#define UTF8VectorLoad(bytes)             _mm_loadu_si128((const __m128i*) (const void*) (bytes))
+#define UTF8VectorZero()                  _mm_setzero_si128()
+#define UTF8VectorSplat(value)            _mm_set1_epi8((char) (value))
+#define UTF8VectorAnd(a, b)               _mm_and_si128((a), (b))
+#define UTF8VectorOr(a, b)                _mm_or_si128((a), (b))
+#define UTF8VectorXor(a, b)               _mm_xor_si128((a), (b))
+#define UTF8VectorSubtractSaturating(a, b) _mm_subs_epu8((a), (b))
+#define UTF8VectorShiftRight4(a)          _mm_and_si128(_mm_srli_epi16((a), 4), _mm_set1_epi8(0x0F))
+#define UTF8VectorLookup(table, indices)  _mm_shuffle_epi8((table), (indices))
+#define UTF8VectorPrevious(input, previousInput, n) \
+    _mm_alignr_epi8((input), (previousInput), 16 - (n))
+#define UTF8VectorIsASCII(a)   (_mm_movemask_epi8(a) == 0)
+#define UTF8VectorIsZero(a)    (_mm_testz_si128((a), (a)) != 0)
+#elif HAP_UTF8_NEON
+typedef uint8x16_t UTF8Vector;
+#define UTF8VectorLoad(bytes)             vld1q_u8(bytes)
+#define UTF8VectorZero()                  vdupq_n_u8(0)
+#define UTF8VectorSplat(value)            vdupq_n_u8(value)
+#define UTF8VectorAnd(a, b)               vandq_u8((a), (b))
+#define UTF8VectorOr(a, b)                vorrq_u8((a), (b))
+#define UTF8VectorXor(a, b)               veorq_u8((a), (b))
+#define UTF8VectorSubtractSaturating(a, b) vqsubq_u8((a), (b))
+#define UTF8VectorShiftRight4(a)          vshrq_n_u8((a), 4)
+#define UTF8VectorLookup(table, indices)  vqtbl1q_u8((table), (indices))
+#define UTF8VectorPrevious(input, previousInput, n) vextq_u8((previousInput), (input), 16 - (n))
+#define UTF8VectorIsASCII(a)   (vmaxvq_u8(a) < 0x80)
+#define UTF8VectorIsZero(a)    (vmaxvq_u8(a) == 0)
+#endif
+
+/**
+ * Vectorized validator. Processes 16 bytes at a time.
+ */
+HAP_RESULT_USE_CHECK
+static bool IsValidDataSIMD(const uint8_t* bytes, size_t numBytes) {
+    HAPPrecondition(bytes);
+
+    const UTF8Vector byte1High = UTF8VectorLoad(kByte1High);
+    const UTF8Vector byte1Low = UTF8VectorLoad(kByte1Low);
+    const UTF8Vector byte2High = UTF8VectorLoad(kByte2High);
+    const UTF8Vector maxCompleteValue = UTF8VectorLoad(kMaxCompleteValue);
+    const UTF8Vector lowNibbleMask = UTF8VectorSplat(0x0F);
+    const UTF8Vector highBit = UTF8VectorSplat(0x80);
+
+    UTF8Vector error = UTF8VectorZero();
+    UTF8Vector previousInput = UTF8VectorZero();
+    UTF8Vector previousIncomplete = UTF8VectorZero();
+
+    for (size_t i = 0; i < numBytes; i += 16) {
+        UTF8Vector input;
+        if (numBytes - i >= 16) {
+            input = UTF8VectorLoad(&bytes[i]);
+        } else {
+            // Pad the final block with ASCII. Truncated sequences are then reported as too short.
+            uint8_t tail[16];
+            HAPRawBufferZero(tail, sizeof tail);
+            HAPRawBufferCopyBytes(tail, &bytes[i], numBytes - i);
+            input = UTF8VectorLoad(tail);
+        }
+
+        if (UTF8VectorIsASCII(input)) {
+            // A block of ASCII is only valid if the previous block did not end in the middle of a sequence.
+            error = UTF8VectorOr(error, previousIncomplete);
+        } else {
+            UTF8Vector previous1 = UTF8VectorPrevious(input, previousInput, 1);
+            UTF8Vector specialCases = UTF8VectorAnd(
+                    UTF8VectorAnd(
+                            UTF8VectorLookup(byte1High, UTF8VectorShiftRight4(previous1)),
+                            UTF8VectorLookup(byte1Low, UTF8VectorAnd(previous1, lowNibbleMask))),
+                    UTF8VectorLookup(byte2High, UTF8VectorShiftRight4(input)));
+
+            // Only 111_____ leads need a continuation as 3rd byte, only 1111____ leads as 4th byte.
+            UTF8Vector previous2 = UTF8VectorPrevious(input, previousInput, 2);
+            UTF8Vector previous3 = UTF8VectorPrevious(input, previousInput, 3);
+            UTF8Vector isThirdByte = UTF8VectorSubtractSaturating(previous2, UTF8VectorSplat(0xE0 - 0x80));
+            UTF8Vector isFourthByte = UTF8VectorSubtractSaturating(previous3, UTF8VectorSplat(0xF0 - 0x80));
+            UTF8Vector mustBe23Continuation = UTF8VectorAnd(UTF8VectorOr(isThirdByte, isFourthByte), highBit);
+
+            error = UTF8VectorOr(error, UTF8VectorXor(mustBe23Continuation, specialCases));
+            previousIncomplete = UTF8VectorSubtractSaturating(input, maxCompleteValue);
+        }
+        previousInput = input;
+    }
+
+    // Missing continuations.
+    error = UTF8VectorOr(error, previousIncomplete);
+
+    return UTF8VectorIsZero(error);
+}
+
+#endif
+
+HAP_RESULT_USE_CHECK
+bool HAPUTF8IsValidData(const void* bytes, size_t numBytes) {
+    HAPPrecondition(bytes);
+
+#if HAP_UTF8_SSE4 || HAP_UTF8_NEON
+    // Short strings are not worth the setup cost of the vectorized validator.
+    if (numBytes >= 16) {
+        return IsValidDataSIMD(bytes, numBytes);
+    }
+#endif
+    return IsValidDataScalar(bytes, numBytes);
+}
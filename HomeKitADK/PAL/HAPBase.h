@@ -1418,6 +1418,9 @@ bool HAPStringAreEqual(const char* string, const char* otherString);
  * Determines whether the supplied data is a valid UTF-8 byte sequence according to
  * http://www.unicode.org/versions/Unicode6.0.0/ch03.pdf - Table 3-7, page 94.
  *
+ * - On targets with SSE4.1 or AArch64 NEON a vectorized implementation is used for inputs of 16 bytes or more.
+ *   Define HAP_UTF8_DISABLE_SIMD to always use the portable implementation.
+ *
  * @param      bytes                Input data.
  * @param      numBytes             Length of input data.
  *
@@ -0,0 +1,229 @@
+// Copyright (c) 2015-2019 The HomeKit ADK Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the “License”);
+// you may not use this file except in compliance with the License.
+// See [CONTRIBUTORS.md] for the list of HomeKit ADK project authors.
+
+#undef HAP_DISALLOW_USE_IGNORED
+#define HAP_DISALLOW_USE_IGNORED 1
+
+#include "HAPPlatform.h"
+
+#include "HAPLog+Binary.h"
+
+#if HAP_LOG_BINARY
+
+HAP_STATIC_ASSERT(HAP_LOG_BINARY_BUFFER_BYTES >= kHAPLogBinary_MaxMessageBytes, HAP_LOG_BINARY_BUFFER_BYTES);
+
+/**
+ * Ring buffer of recorded messages.
+ */
+static struct {
+    uint8_t bytes[HAP_LOG_BINARY_BUFFER_BYTES];
+    size_t start;    /**< Offset of the oldest message. */
+    size_t numBytes; /**< Number of used bytes. */
+} logBuffer;
+
+/**
+ * Appends a message to the ring buffer, discarding the oldest messages as necessary.
+ *
+ * @param      bytes                Message.
+ * @param      numBytes             Length of message.
+ */
+static void AppendMessage(const uint8_t* bytes, size_t numBytes) {
+    HAPPrecondition(bytes);
+    HAPPrecondition(numBytes <= sizeof logBuffer.bytes);
+
+    while (sizeof logBuffer.bytes - logBuffer.numBytes < numBytes) {
+        size_t numMessageBytes = (size_t) logBuffer.bytes[logBuffer.start] |
+                                 (size_t) logBuffer.bytes[(logBuffer.start + 1) % sizeof logBuffer.bytes] << 8;
+        HAPAssert(numMessageBytes && numMessageBytes <= logBuffer.numBytes);
+        logBuffer.start = (logBuffer.start + numMessageBytes) % sizeof logBuffer.bytes;
+        logBuffer.numBytes -= numMessageBytes;
+    }
+
+    size_t offset = (logBuffer.start + logBuffer.numBytes) % sizeof logBuffer.bytes;
+    size_t numTailBytes = HAPMin(numBytes, sizeof logBuffer.bytes - offset);
+    HAPRawBufferCopyBytes(&logBuffer.bytes[offset], bytes, numTailBytes);
+    HAPRawBufferCopyBytes(&logBuffer.bytes[0], &bytes[numTailBytes], numBytes - numTailBytes);
+    logBuffer.numBytes += numBytes;
+}
+
+HAP_PRINTFLIKE(5, 0)
+void HAPLogBinaryCaptureInternal(
+        const HAPLogObject* log,
+        const void* _Nullable bufferBytes,
+        size_t numBufferBytes,
+        HAPLogType type,
+        const char* format,
+        va_list args) {
+    HAPPrecondition(log);
+    HAPPrecondition(!numBufferBytes || bufferBytes);
+    HAPPrecondition(format);
+
+    uint8_t message[kHAPLogBinary_MaxMessageBytes];
+    size_t numMessageBytes = kHAPLogBinary_NumMessageHeaderBytes;
+    uint8_t numArgs = 0;
+
+    // Record arguments. The format string is parsed like in HAPStringWithFormatAndArguments.
+    // Recording stops at the first argument that does not fit. Space for the buffer length is reserved.
+    for (const char* c = format; *c; c++) {
+        if (*c != '%') {
+            continue;
+        }
+        c++;
+
+        // Flags and width.
+        while (*c == '+' || *c == ' ' || (*c >= '0' && *c <= '9')) {
+            c++;
+        }
+
+        // Length.
+        int length = 0;
+        if (*c == 'l') {
+            length = 1;
+            c++;
+            if (*c == 'l') {
+                length = 2;
+                c++;
+            }
+        } else if (*c == 'z') {
+            length = 3;
+            c++;
+        }
+
+        HAPLogBinaryArgumentType argumentType;
+        uint64_t value = 0;
+        const char* _Nullable string = NULL;
+        switch (*c) {
+            case '%': {
+                continue;
+            }
+            case 'd':
+            case 'i': {
+                argumentType = kHAPLogBinaryArgumentType_Int;
+                if (length == 0) {
+                    value = (uint64_t)(int64_t) va_arg(args, int);
+                } else if (length == 1) {
+                    value = (uint64_t)(int64_t) va_arg(args, long);
+                } else if (length == 2) {
+                    value = (uint64_t)(int64_t) va_arg(args, long long);
+                } else {
+                    value = (uint64_t) va_arg(args, size_t);
+                }
+            } break;
+            case 'u':
+            case 'x':
+            case 'X': {
+                argumentType = kHAPLogBinaryArgumentType_UInt;
+                if (length == 0) {
+                    value = (uint64_t) va_arg(args, unsigned int);
+                } else if (length == 1) {
+                    value = (uint64_t) va_arg(args, unsigned long);
+                } else if (length == 2) {
+                    value = (uint64_t) va_arg(args, unsigned long long);
+                } else {
+                    value = (uint64_t) va_arg(args, size_t);
+                }
+            } break;
+            case 'p': {
+                argumentType = kHAPLogBinaryArgumentType_Pointer;
+                value = (uint64_t)(uintptr_t) va_arg(args, void*);
+            } break;
+            case 'c': {
+                argumentType = kHAPLogBinaryArgumentType_Char;
+                value = (uint64_t)(uint8_t) va_arg(args, int);
+            } break;
+            case 'g': {
+                argumentType = kHAPLogBinaryArgumentType_Double;
+                double doubleValue = va_arg(args, double);
+                HAPRawBufferCopyBytes(&value, &doubleValue, sizeof value);
+            } break;
+            case 's': {
+                argumentType = kHAPLogBinaryArgumentType_String;
+                string = va_arg(args, const char*);
+                if (!string) {
+                    string = "(null)";
+                }
+            } break;
+            default: {
+                // Unsupported type specifier or end of format string. Remaining arguments cannot be located.
+                goto done;
+            }
+        }
+
+        if (string) {
+            size_t numStringBytes = 0;
+            while (numStringBytes < kHAPLogBinary_MaxStringBytes && string[numStringBytes]) {
+                numStringBytes++;
+            }
+            if (numMessageBytes + 2 + numStringBytes > sizeof message - sizeof(uint16_t)) {
+                break;
+            }
+            message[numMessageBytes++] = argumentType;
+            message[numMessageBytes++] = (uint8_t) numStringBytes;
+            HAPRawBufferCopyBytes(&message[numMessageBytes], string, numStringBytes);
+            numMessageBytes += numStringBytes;
+        } else {
+            if (numMessageBytes + 1 + sizeof value > sizeof message - sizeof(uint16_t)) {
+                break;
+            }
+            message[numMessageBytes++] = argumentType;
+            HAPWriteLittleUInt64(&message[numMessageBytes], value);
+            numMessageBytes += sizeof value;
+        }
+        numArgs++;
+    }
+done:
+
+    // Record buffer.
+    size_t numRecordedBufferBytes = HAPMin(
+            HAPMin(numBufferBytes, kHAPLogBinary_MaxBufferBytes), sizeof message - sizeof(uint16_t) - numMessageBytes);
+    HAPWriteLittleUInt16(&message[numMessageBytes], numRecordedBufferBytes);
+    numMessageBytes += sizeof(uint16_t);
+    if (numRecordedBufferBytes) {
+        HAPRawBufferCopyBytes(&message[numMessageBytes], HAPNonnull(bufferBytes), numRecordedBufferBytes);
+        numMessageBytes += numRecordedBufferBytes;
+    }
+
+    // Fill in message header.
+    HAPWriteLittleUInt16(&message[0], numMessageBytes);
+    message[2] = type;
+    message[3] = numArgs;
+    HAPWriteLittleUInt64(&message[4], (uint64_t) HAPPlatformClockGetCurrent());
+    HAPWriteLittleUInt64(&message[12], (uint64_t)(uintptr_t) format);
+    HAPWriteLittleUInt64(&message[20], (uint64_t)(uintptr_t) log->category);
+
+    AppendMessage(message, numMessageBytes);
+}
+
+HAP_RESULT_USE_CHECK
+HAPError HAPLogBinaryGetContents(void* bytes_, size_t maxBytes, size_t* numBytes) {
+    HAPPrecondition(bytes_);
+    uint8_t* bytes = bytes_;
+    HAPPrecondition(numBytes);
+
+    if (maxBytes < kHAPLogBinary_NumHeaderBytes + logBuffer.numBytes) {
+        return kHAPError_OutOfResources;
+    }
+
+    HAPRawBufferZero(bytes, kHAPLogBinary_NumHeaderBytes);
+    HAPRawBufferCopyBytes(bytes, kHAPLogBinary_Magic, sizeof kHAPLogBinary_Magic - 1);
+    bytes[4] = kHAPLogBinary_Version;
+    *numBytes = kHAPLogBinary_NumHeaderBytes;
+
+    size_t numTailBytes = HAPMin(logBuffer.numBytes, sizeof logBuffer.bytes - logBuffer.start);
+    HAPRawBufferCopyBytes(&bytes[*numBytes], &logBuffer.bytes[logBuffer.start], numTailBytes);
+    *numBytes += numTailBytes;
+    HAPRawBufferCopyBytes(&bytes[*numBytes], &logBuffer.bytes[0], logBuffer.numBytes - numTailBytes);
+    *numBytes += logBuffer.numBytes - numTailBytes;
+
+    return kHAPError_None;
+}
+
+void HAPLogBinaryClear(void) {
+    logBuffer.start = 0;
+    logBuffer.numBytes = 0;
+}
+
+#endif
@@ -0,0 +1,98 @@
+// Copyright (c) 2015-2019 The HomeKit ADK Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the “License”);
+// you may not use this file except in compliance with the License.
+// See [CONTRIBUTORS.md] for the list of HomeKit ADK project authors.
+
+#ifndef HAP_LOG_BINARY_H
+#define HAP_LOG_BINARY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "HAPBase.h"
+
+/**
+ * Binary log format.
+ *
+ * The binary log starts with a header followed by the recorded messages, oldest first.
+ * All integers are little endian.
+ *
+ * Header:
+ * - 4 bytes: kHAPLogBinary_Magic.
+ * - 1 byte:  kHAPLogBinary_Version.
+ * - 3 bytes: Reserved.
+ *
+ * Message:
+ * - 2 bytes: Length of the message, including this field.
+ * - 1 byte:  HAPLogType.
+ * - 1 byte:  Number of arguments.
+ * - 8 bytes: Time in milliseconds (HAPPlatformClockGetCurrent).
+ * - 8 bytes: Address of the format string.
+ * - 8 bytes: Address of the log category, 0 if none.
+ * - Arguments, in the order of the format string. Each starts with a 1-byte HAPLogBinaryArgumentType.
+ *   - Integers, pointers and floating point values: 8 bytes (double for floating point values).
+ *   - Strings: 1 byte length followed by the string, truncated to kHAPLogBinary_MaxStringBytes bytes.
+ * - 2 bytes: Number of recorded buffer bytes, followed by the buffer truncated to kHAPLogBinary_MaxBufferBytes bytes.
+ */
+#define kHAPLogBinary_Magic "HAPB"
+
+/**
+ * Binary log format version.
+ */
+#define kHAPLogBinary_Version ((uint8_t) 1)
+
+/**
+ * Length of the binary log header.
+ */
+#define kHAPLogBinary_NumHeaderBytes ((size_t) 8)
+
+/**
+ * Length of the fixed part of a message.
+ */
+#define kHAPLogBinary_NumMessageHeaderBytes ((size_t) 28)
+
+/**
+ * Maximum length of a recorded message.
+ */
+#define kHAPLogBinary_MaxMessageBytes ((size_t) 512)
+
+/**
+ * Maximum number of bytes recorded for a string argument.
+ */
+#define kHAPLogBinary_MaxStringBytes ((size_t) 64)
+
+/**
+ * Maximum number of bytes recorded for a logged buffer.
+ */
+#define kHAPLogBinary_MaxBufferBytes ((size_t) 64)
+
+/**
+ * Binary log argument type.
+ */
+HAP_ENUM_BEGIN(uint8_t, HAPLogBinaryArgumentType) {
+    /** Signed integer (%d, %i). */
+    kHAPLogBinaryArgumentType_Int = 1,
+
+    /** Unsigned integer (%u, %x, %X). */
+    kHAPLogBinaryArgumentType_UInt,
+
+    /** Pointer (%p). */
+    kHAPLogBinaryArgumentType_Pointer,
+
+    /** Character (%c). */
+    kHAPLogBinaryArgumentType_Char,
+
+    /** Floating point value (%g). */
+    kHAPLogBinaryArgumentType_Double,
+
+    /** String (%s). */
+    kHAPLogBinaryArgumentType_String
+} HAP_ENUM_END(uint8_t, HAPLogBinaryArgumentType);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
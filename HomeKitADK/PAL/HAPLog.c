@@ -24,8 +24,6 @@ static void
                 HAPLogType type,
                 const char* format,
                 va_list args) {
-    HAPError err;
-
     if (!log) {
         return;
     }
@@ -50,11 +48,15 @@ static void
         } break;
     }
 
+#if HAP_LOG_BINARY
+    // Record log message without formatting it.
+    HAPLogBinaryCaptureInternal(log, bytes, numBytes, type, format, args);
+#else
     // Format log message.
     char message[kHAPLogMessage_MaxBytes];
     HAPRawBufferZero(message, sizeof message);
 
-    err = HAPStringWithFormatAndArguments(message, sizeof message, format, args);
+    HAPError err = HAPStringWithFormatAndArguments(message, sizeof message, format, args);
     if (err) {
         HAPPlatformLogCapture(log, kHAPLogType_Error, "<Log message too long>", NULL, 0);
         return;
@@ -62,6 +64,7 @@ static void
 
     // Capture log.
     HAPPlatformLogCapture(log, type, message, bytes, numBytes);
+#endif
 }
 
 HAP_PRINTFLIKE(4, 5)
@@ -39,6 +39,20 @@ int HAPPlatformLogLevel(void);
 #error "Invalid HAP_LOG_SENSITIVE."
 #endif
 
+// Validate flag for deferred binary logging.
+// 0 - Log messages are formatted and passed to HAPPlatformLogCapture. Default.
+// 1 - Log messages are recorded unformatted into a RAM ring buffer of HAP_LOG_BINARY_BUFFER_BYTES bytes.
+//     The contents are retrieved with HAPLogBinaryGetContents and decoded offline with the LogDecoder tool.
+#ifndef HAP_LOG_BINARY
+#define HAP_LOG_BINARY (0)
+#endif
+#if HAP_LOG_BINARY < 0 || HAP_LOG_BINARY > 1
+#error "Invalid HAP_LOG_BINARY."
+#endif
+#ifndef HAP_LOG_BINARY_BUFFER_BYTES
+#define HAP_LOG_BINARY_BUFFER_BYTES (4096)
+#endif
+
 /**
  * Log object.
  */
@@ -536,6 +550,34 @@ HAP_ENUM_BEGIN(uint8_t, HAPLogType) {
         } \
     } while (0)
 
+#if HAP_LOG_BINARY
+/**
+ * Maximum number of bytes of the binary log contents, including the header.
+ */
+#define kHAPLogBinary_MaxBytes ((size_t)(8 + HAP_LOG_BINARY_BUFFER_BYTES))
+
+/**
+ * Copies the contents of the binary log, oldest message first.
+ *
+ * - Format strings and log categories are recorded as pointers.
+ *   They are resolved by the LogDecoder tool from the firmware image.
+ *
+ * @param[out] bytes                Buffer to copy the binary log to.
+ * @param      maxBytes             Capacity of buffer.
+ * @param[out] numBytes             Number of bytes copied.
+ *
+ * @return kHAPError_None           If successful.
+ * @return kHAPError_OutOfResources If the buffer is not large enough.
+ */
+HAP_RESULT_USE_CHECK
+HAPError HAPLogBinaryGetContents(void* bytes, size_t maxBytes, size_t* numBytes);
+
+/**
+ * Discards all messages recorded in the binary log.
+ */
+void HAPLogBinaryClear(void);
+#endif
+
 //----------------------------------------------------------------------------------------------------------------------
 // Internal functions. Do not use directly.
 
@@ -604,6 +646,18 @@ HAP_DISALLOW_USE(HAPLogErrorInternal)
 HAP_PRINTFLIKE(2, 3)
 void HAPLogFaultInternal(const HAPLogObject* _Nullable log, const char* format, ...);
 HAP_DISALLOW_USE(HAPLogFaultInternal)
+
+#if HAP_LOG_BINARY
+HAP_PRINTFLIKE(5, 0)
+void HAPLogBinaryCaptureInternal(
+        const HAPLogObject* log,
+        const void* _Nullable bufferBytes,
+        size_t numBufferBytes,
+        HAPLogType type,
+        const char* format,
+        va_list args);
+HAP_DISALLOW_USE(HAPLogBinaryCaptureInternal)
+#endif
 /**@endcond */
 
 #if __has_feature(nullability)
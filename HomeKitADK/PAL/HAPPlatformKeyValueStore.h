@@ -151,6 +151,33 @@ HAPError HAPPlatformKeyValueStorePurgeDomain(
         HAPPlatformKeyValueStoreRef keyValueStore,
         HAPPlatformKeyValueStoreDomain domain);
 
+/**
+ * Begins a batch of related modifications.
+ *
+ * - Modifications until the matching HAPPlatformKeyValueStoreCommitBatch call may be kept in memory and written
+ *   to persistent storage at once when the batch is committed. They are visible to subsequent reads immediately.
+ *
+ * - Batches may be nested. Only committing the outermost batch writes to persistent storage.
+ *
+ * - Implementations that write each key separately may treat batches as no-ops.
+ *
+ * @param      keyValueStore        Key-value store.
+ */
+void HAPPlatformKeyValueStoreBeginBatch(HAPPlatformKeyValueStoreRef keyValueStore);
+
+/**
+ * Commits a batch of modifications that has been started with HAPPlatformKeyValueStoreBeginBatch.
+ *
+ * - The batch is ended even if writing to persistent storage fails.
+ *
+ * @param      keyValueStore        Key-value store.
+ *
+ * @return kHAPError_None           If successful.
+ * @return kHAPError_Unknown        If persistent store access failed.
+ */
+HAP_RESULT_USE_CHECK
+HAPError HAPPlatformKeyValueStoreCommitBatch(HAPPlatformKeyValueStoreRef keyValueStore);
+
 #if __has_feature(nullability)
 #pragma clang assume_nonnull end
 #endif
@@ -4,11 +4,14 @@
 // you may not use this file except in compliance with the License.
 // See [CONTRIBUTORS.md] for the list of HomeKit ADK project authors.
 
+#include <stdlib.h>
+
 #include "HAP+Internal.h"
 #include "HAPPlatform+Init.h"
 #include "HAPPlatformAccessorySetup+Init.h"
 #include "HAPPlatformBLEPeripheralManager+Init.h"
 #include "HAPPlatformKeyValueStore+Init.h"
+#include "HAPPlatformKeyValueStore+Test.h"
 #include "HAPPlatformMFiHWAuth+Init.h"
 #include "HAPPlatformServiceDiscovery+Init.h"
 #include "HAPPlatformTCPStreamManager+Init.h"
@@ -64,6 +67,13 @@ HAPPlatform platform = {
     }
 };
 
+/**
+ * Checks on exit that all key-value store batches have been committed.
+ */
+static void CheckKeyValueStore(void) {
+    HAPAssert(!HAPPlatformKeyValueStoreGetNumBatches(platform.keyValueStore));
+}
+
 void HAPPlatformCreate(void) {
     static bool initialized = false;
     HAPPrecondition(!initialized);
@@ -75,6 +85,8 @@ void HAPPlatformCreate(void) {
             platform.keyValueStore,
             &(const HAPPlatformKeyValueStoreOptions) { .items = keyValueStoreItems,
                                                        .numItems = HAPArrayCount(keyValueStoreItems) });
+    int e = atexit(CheckKeyValueStore);
+    HAPAssert(!e);
 
     // Accessory setup manager. Does not require initialization.
 
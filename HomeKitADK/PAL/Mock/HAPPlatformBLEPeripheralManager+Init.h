@@ -80,6 +80,8 @@ struct HAPPlatformBLEPeripheralManager {
     uint8_t numScanResponseBytes;
     HAPBLEAdvertisingInterval advertisingInterval;
 
+    HAPPlatformBLEPeripheralManagerConnectionHandle connectionHandle;
+    HAPPlatformBLEPeripheralManagerAttributeHandle indicationValueHandle;
     bool isDeviceAddressSet : 1;
     bool didPublishAttributes : 1;
     bool isConnected : 1;
@@ -66,6 +66,80 @@ HAPError HAPPlatformBLEPeripheralManagerGetAdvertisingData(
         size_t maxScanResponseBytes,
         size_t* numScanResponseBytes);
 
+/**
+ * Looks up the attribute handles of the first characteristic of a given type.
+ *
+ * - This can only be called after the GATT database has been published.
+ *
+ * @param      blePeripheralManager BLE peripheral manager.
+ * @param      type                 Characteristic type.
+ * @param[out] valueHandle          Attribute handle of the Characteristic Value declaration.
+ * @param[out] cccDescriptorHandle  Attribute handle of the Client Characteristic Configuration descriptor, if any.
+ *
+ * @return true                     If a characteristic with the given type was found.
+ * @return false                    Otherwise.
+ */
+HAP_RESULT_USE_CHECK
+bool HAPPlatformBLEPeripheralManagerFindCharacteristic(
+        HAPPlatformBLEPeripheralManagerRef blePeripheralManager,
+        const HAPPlatformBLEPeripheralManagerUUID* type,
+        HAPPlatformBLEPeripheralManagerAttributeHandle* valueHandle,
+        HAPPlatformBLEPeripheralManagerAttributeHandle* cccDescriptorHandle);
+
+/**
+ * Simulates a central connecting to the BLE peripheral manager.
+ *
+ * @param      blePeripheralManager BLE peripheral manager.
+ * @param      connectionHandle     Connection handle of the connected central.
+ */
+void HAPPlatformBLEPeripheralManagerConnectCentral(
+        HAPPlatformBLEPeripheralManagerRef blePeripheralManager,
+        HAPPlatformBLEPeripheralManagerConnectionHandle connectionHandle);
+
+/**
+ * Simulates the connected central disconnecting from the BLE peripheral manager.
+ *
+ * @param      blePeripheralManager BLE peripheral manager.
+ */
+void HAPPlatformBLEPeripheralManagerDisconnectCentral(HAPPlatformBLEPeripheralManagerRef blePeripheralManager);
+
+/**
+ * Simulates the connected central writing to an attribute.
+ *
+ * @param      blePeripheralManager BLE peripheral manager.
+ * @param      attributeHandle      Attribute handle that is being written.
+ * @param      bytes                Value to write.
+ * @param      numBytes             Length of value.
+ *
+ * @return kHAPError_None           If successful.
+ * @return Error reported by the BLE peripheral manager delegate otherwise.
+ */
+HAP_RESULT_USE_CHECK
+HAPError HAPPlatformBLEPeripheralManagerWriteAttribute(
+        HAPPlatformBLEPeripheralManagerRef blePeripheralManager,
+        HAPPlatformBLEPeripheralManagerAttributeHandle attributeHandle,
+        void* bytes,
+        size_t numBytes);
+
+/**
+ * Simulates the connected central confirming the outstanding Handle Value Indication.
+ *
+ * - Only one Handle Value Indication may be outstanding. Further indications are rejected with
+ *   kHAPError_InvalidState until the outstanding one is confirmed.
+ *
+ * - After confirming, the BLE peripheral manager delegate is informed that it may update subscribers again.
+ *
+ * @param      blePeripheralManager BLE peripheral manager.
+ * @param[out] valueHandle          Attribute handle of the Characteristic Value of the confirmed indication.
+ *
+ * @return true                     If a Handle Value Indication was outstanding.
+ * @return false                    Otherwise.
+ */
+HAP_RESULT_USE_CHECK
+bool HAPPlatformBLEPeripheralManagerConfirmHandleValueIndication(
+        HAPPlatformBLEPeripheralManagerRef blePeripheralManager,
+        HAPPlatformBLEPeripheralManagerAttributeHandle* valueHandle);
+
 #if __has_feature(nullability)
 #pragma clang assume_nonnull end
 #endif
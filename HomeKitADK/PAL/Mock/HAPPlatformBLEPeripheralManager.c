@@ -419,6 +419,7 @@ void HAPPlatformBLEPeripheralManagerCancelCentralConnection(
     HAPFatalError();
 }
 
+HAP_RESULT_USE_CHECK
 HAPError HAPPlatformBLEPeripheralManagerSendHandleValueIndication(
         HAPPlatformBLEPeripheralManagerRef _Nonnull blePeripheralManager,
         HAPPlatformBLEPeripheralManagerConnectionHandle connectionHandle,
@@ -428,8 +429,107 @@ HAPError HAPPlatformBLEPeripheralManagerSendHandleValueIndication(
     HAPPrecondition(blePeripheralManager);
     HAPPrecondition(valueHandle);
     HAPPrecondition(!numBytes || bytes);
+    HAPPrecondition(blePeripheralManager->isConnected);
+    HAPPrecondition(connectionHandle == blePeripheralManager->connectionHandle);
 
-    (void) connectionHandle;
-    HAPLogError(&logObject, "[NYI] %s.", __func__);
-    HAPFatalError();
+    // Only one indication may be outstanding until it is confirmed by the central.
+    if (blePeripheralManager->indicationValueHandle) {
+        return kHAPError_InvalidState;
+    }
+    blePeripheralManager->indicationValueHandle = valueHandle;
+    return kHAPError_None;
+}
+
+HAP_RESULT_USE_CHECK
+bool HAPPlatformBLEPeripheralManagerFindCharacteristic(
+        HAPPlatformBLEPeripheralManagerRef blePeripheralManager,
+        const HAPPlatformBLEPeripheralManagerUUID* type,
+        HAPPlatformBLEPeripheralManagerAttributeHandle* valueHandle,
+        HAPPlatformBLEPeripheralManagerAttributeHandle* cccDescriptorHandle) {
+    HAPPrecondition(blePeripheralManager);
+    HAPPrecondition(blePeripheralManager->didPublishAttributes);
+    HAPPrecondition(type);
+    HAPPrecondition(valueHandle);
+    HAPPrecondition(cccDescriptorHandle);
+
+    for (size_t i = 0; i < blePeripheralManager->numAttributes; i++) {
+        const HAPPlatformBLEPeripheralManagerAttribute* attribute = &blePeripheralManager->attributes[i];
+        if (attribute->type == kHAPPlatformBLEPeripheralManagerAttributeType_Characteristic &&
+            HAPRawBufferAreEqual(attribute->_.characteristic.type.bytes, type->bytes, sizeof type->bytes)) {
+            *valueHandle = attribute->_.characteristic.valueHandle;
+            *cccDescriptorHandle = attribute->_.characteristic.cccDescriptorHandle;
+            return true;
+        }
+    }
+    return false;
+}
+
+void HAPPlatformBLEPeripheralManagerConnectCentral(
+        HAPPlatformBLEPeripheralManagerRef blePeripheralManager,
+        HAPPlatformBLEPeripheralManagerConnectionHandle connectionHandle) {
+    HAPPrecondition(blePeripheralManager);
+    HAPPrecondition(blePeripheralManager->didPublishAttributes);
+    HAPPrecondition(!blePeripheralManager->isConnected);
+
+    blePeripheralManager->isConnected = true;
+    blePeripheralManager->connectionHandle = connectionHandle;
+    blePeripheralManager->indicationValueHandle = 0;
+    if (blePeripheralManager->delegate.handleConnectedCentral) {
+        blePeripheralManager->delegate.handleConnectedCentral(
+                blePeripheralManager, connectionHandle, blePeripheralManager->delegate.context);
+    }
+}
+
+void HAPPlatformBLEPeripheralManagerDisconnectCentral(HAPPlatformBLEPeripheralManagerRef blePeripheralManager) {
+    HAPPrecondition(blePeripheralManager);
+    HAPPrecondition(blePeripheralManager->isConnected);
+
+    blePeripheralManager->isConnected = false;
+    blePeripheralManager->indicationValueHandle = 0;
+    if (blePeripheralManager->delegate.handleDisconnectedCentral) {
+        blePeripheralManager->delegate.handleDisconnectedCentral(
+                blePeripheralManager, blePeripheralManager->connectionHandle, blePeripheralManager->delegate.context);
+    }
+}
+
+HAP_RESULT_USE_CHECK
+HAPError HAPPlatformBLEPeripheralManagerWriteAttribute(
+        HAPPlatformBLEPeripheralManagerRef blePeripheralManager,
+        HAPPlatformBLEPeripheralManagerAttributeHandle attributeHandle,
+        void* bytes,
+        size_t numBytes) {
+    HAPPrecondition(blePeripheralManager);
+    HAPPrecondition(blePeripheralManager->isConnected);
+    HAPPrecondition(blePeripheralManager->delegate.handleWriteRequest);
+    HAPPrecondition(attributeHandle);
+    HAPPrecondition(bytes);
+    HAPPrecondition(numBytes);
+
+    return blePeripheralManager->delegate.handleWriteRequest(
+            blePeripheralManager,
+            blePeripheralManager->connectionHandle,
+            attributeHandle,
+            bytes,
+            numBytes,
+            blePeripheralManager->delegate.context);
+}
+
+HAP_RESULT_USE_CHECK
+bool HAPPlatformBLEPeripheralManagerConfirmHandleValueIndication(
+        HAPPlatformBLEPeripheralManagerRef blePeripheralManager,
+        HAPPlatformBLEPeripheralManagerAttributeHandle* valueHandle) {
+    HAPPrecondition(blePeripheralManager);
+    HAPPrecondition(blePeripheralManager->isConnected);
+    HAPPrecondition(valueHandle);
+
+    if (!blePeripheralManager->indicationValueHandle) {
+        return false;
+    }
+    *valueHandle = blePeripheralManager->indicationValueHandle;
+    blePeripheralManager->indicationValueHandle = 0;
+    if (blePeripheralManager->delegate.handleReadyToUpdateSubscribers) {
+        blePeripheralManager->delegate.handleReadyToUpdateSubscribers(
+                blePeripheralManager, blePeripheralManager->connectionHandle, blePeripheralManager->delegate.context);
+    }
+    return true;
 }
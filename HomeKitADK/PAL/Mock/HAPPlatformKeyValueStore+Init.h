@@ -80,6 +80,10 @@ struct HAPPlatformKeyValueStore {
     /**@cond */
     HAPPlatformKeyValueStoreItem* bytes;
     size_t maxBytes;
+    size_t numBatches;
+    bool isDirty;
+    size_t numWrites;
+    bool failWrites;
     /**@endcond */
 };
 
@@ -0,0 +1,61 @@
+// Copyright (c) 2015-2019 The HomeKit ADK Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the “License”);
+// you may not use this file except in compliance with the License.
+// See [CONTRIBUTORS.md] for the list of HomeKit ADK project authors.
+
+#ifndef HAP_PLATFORM_KEY_VALUE_STORE_TEST_H
+#define HAP_PLATFORM_KEY_VALUE_STORE_TEST_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "HAPPlatform.h"
+
+#if __has_feature(nullability)
+#pragma clang assume_nonnull begin
+#endif
+
+/**
+ * Returns the nesting depth of the currently open batches.
+ *
+ * @param      keyValueStore        Key-value store.
+ *
+ * @return Number of batches that have been begun but not yet committed.
+ */
+HAP_RESULT_USE_CHECK
+size_t HAPPlatformKeyValueStoreGetNumBatches(HAPPlatformKeyValueStoreRef keyValueStore);
+
+/**
+ * Returns the number of simulated writes to persistent storage.
+ *
+ * - Modifications outside of a batch are written immediately.
+ *   Modifications within a batch are written once, when the outermost batch is committed.
+ *
+ * @param      keyValueStore        Key-value store.
+ *
+ * @return Number of successful writes.
+ */
+HAP_RESULT_USE_CHECK
+size_t HAPPlatformKeyValueStoreGetNumWrites(HAPPlatformKeyValueStoreRef keyValueStore);
+
+/**
+ * Configures whether writes to persistent storage fail.
+ *
+ * - Failing writes report kHAPError_Unknown. Modifications are still visible to subsequent reads.
+ *
+ * @param      keyValueStore        Key-value store.
+ * @param      failWrites           Whether writes fail.
+ */
+void HAPPlatformKeyValueStoreSetFailWrites(HAPPlatformKeyValueStoreRef keyValueStore, bool failWrites);
+
+#if __has_feature(nullability)
+#pragma clang assume_nonnull end
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
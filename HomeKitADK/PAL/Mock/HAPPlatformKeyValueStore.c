@@ -5,9 +5,37 @@
 // See [CONTRIBUTORS.md] for the list of HomeKit ADK project authors.
 
 #include "HAPPlatformKeyValueStore+Init.h"
+#include "HAPPlatformKeyValueStore+Test.h"
 
 static const HAPLogObject logObject = { .subsystem = kHAPPlatform_LogSubsystem, .category = "KeyValueStore" };
 
+/**
+ * Simulates writing modifications to persistent storage.
+ *
+ * - Within a batch, the write is deferred until the outermost batch is committed.
+ *
+ * @param      keyValueStore        Key-value store.
+ *
+ * @return kHAPError_None           If successful.
+ * @return kHAPError_Unknown        If write failures are simulated.
+ */
+HAP_RESULT_USE_CHECK
+static HAPError Write(HAPPlatformKeyValueStoreRef keyValueStore) {
+    HAPPrecondition(keyValueStore);
+
+    if (keyValueStore->numBatches) {
+        keyValueStore->isDirty = true;
+        return kHAPError_None;
+    }
+    keyValueStore->isDirty = false;
+    if (keyValueStore->failWrites) {
+        HAPLog(&logObject, "Simulated write failure.");
+        return kHAPError_Unknown;
+    }
+    keyValueStore->numWrites++;
+    return kHAPError_None;
+}
+
 void HAPPlatformKeyValueStoreCreate(
         HAPPlatformKeyValueStoreRef keyValueStore,
         const HAPPlatformKeyValueStoreOptions* options) {
@@ -17,6 +45,10 @@ void HAPPlatformKeyValueStoreCreate(
 
     keyValueStore->bytes = options->items;
     keyValueStore->maxBytes = options->numItems;
+    keyValueStore->numBatches = 0;
+    keyValueStore->isDirty = false;
+    keyValueStore->numWrites = 0;
+    keyValueStore->failWrites = false;
     HAPRawBufferZero(keyValueStore->bytes, sizeof keyValueStore->bytes[0] * keyValueStore->maxBytes);
 }
 
@@ -113,7 +145,7 @@ HAPError HAPPlatformKeyValueStoreSet(
     if (numBytes) {
         HAPRawBufferCopyBytes(keyValueStore->bytes[index].bytes, bytes, numBytes);
     }
-    return kHAPError_None;
+    return Write(keyValueStore);
 }
 
 HAP_RESULT_USE_CHECK
@@ -129,7 +161,7 @@ HAPError HAPPlatformKeyValueStoreRemove(
         }
         if (keyValueStore->bytes[i].domain == domain && keyValueStore->bytes[i].key == key) {
             keyValueStore->bytes[i].active = false;
-            return kHAPError_None;
+            return Write(keyValueStore);
         }
     }
 
@@ -181,5 +213,43 @@ HAPError HAPPlatformKeyValueStorePurgeDomain(
         }
         keyValueStore->bytes[i].active = false;
     }
+    return Write(keyValueStore);
+}
+
+void HAPPlatformKeyValueStoreBeginBatch(HAPPlatformKeyValueStoreRef keyValueStore) {
+    HAPPrecondition(keyValueStore);
+
+    keyValueStore->numBatches++;
+}
+
+HAP_RESULT_USE_CHECK
+HAPError HAPPlatformKeyValueStoreCommitBatch(HAPPlatformKeyValueStoreRef keyValueStore) {
+    HAPPrecondition(keyValueStore);
+    HAPPrecondition(keyValueStore->numBatches);
+
+    keyValueStore->numBatches--;
+    if (!keyValueStore->numBatches && keyValueStore->isDirty) {
+        return Write(keyValueStore);
+    }
     return kHAPError_None;
 }
+
+HAP_RESULT_USE_CHECK
+size_t HAPPlatformKeyValueStoreGetNumBatches(HAPPlatformKeyValueStoreRef keyValueStore) {
+    HAPPrecondition(keyValueStore);
+
+    return keyValueStore->numBatches;
+}
+
+HAP_RESULT_USE_CHECK
+size_t HAPPlatformKeyValueStoreGetNumWrites(HAPPlatformKeyValueStoreRef keyValueStore) {
+    HAPPrecondition(keyValueStore);
+
+    return keyValueStore->numWrites;
+}
+
+void HAPPlatformKeyValueStoreSetFailWrites(HAPPlatformKeyValueStoreRef keyValueStore, bool failWrites) {
+    HAPPrecondition(keyValueStore);
+
+    keyValueStore->failWrites = failWrites;
+}
@@ -436,3 +436,16 @@ HAPError HAPPlatformKeyValueStorePurgeDomain(
 
     return kHAPError_None;
 }
+
+void HAPPlatformKeyValueStoreBeginBatch(HAPPlatformKeyValueStoreRef keyValueStore) {
+    HAPPrecondition(keyValueStore);
+
+    // Each key is stored in its own file. There is nothing to coalesce.
+}
+
+HAP_RESULT_USE_CHECK
+HAPError HAPPlatformKeyValueStoreCommitBatch(HAPPlatformKeyValueStoreRef keyValueStore) {
+    HAPPrecondition(keyValueStore);
+
+    return kHAPError_None;
+}
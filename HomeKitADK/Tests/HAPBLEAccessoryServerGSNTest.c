@@ -0,0 +1,261 @@
+// Copyright (c) 2015-2019 The HomeKit ADK Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the “License”);
+// you may not use this file except in compliance with the License.
+// See [CONTRIBUTORS.md] for the list of HomeKit ADK project authors.
+
+#include "HAP+Internal.h"
+#include "HAPPlatform+Init.h"
+
+#include "Harness/HAPTestController.c"
+#include "Harness/TemplateDB.c"
+
+static HAPAccessoryServerRef accessoryServer;
+
+HAP_RESULT_USE_CHECK
+static HAPError HandleRead(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        const HAPBoolCharacteristicReadRequest* request HAP_UNUSED,
+        bool* value,
+        void* _Nullable context HAP_UNUSED) {
+    *value = true;
+    return kHAPError_None;
+}
+
+static const HAPBoolCharacteristic onCharacteristic = {
+    .format = kHAPCharacteristicFormat_Bool,
+    .iid = 0x30,
+    .characteristicType = &kHAPCharacteristicType_On,
+    .debugDescription = kHAPCharacteristicDebugDescription_On,
+    .properties = { .readable = true,
+                    .supportsEventNotification = true,
+                    .ble = { .supportsBroadcastNotification = true, .supportsDisconnectedNotification = true } },
+    .callbacks = { .handleRead = HandleRead }
+};
+
+static const HAPService lightBulbService = {
+    .iid = 0x2F,
+    .serviceType = &kHAPServiceType_LightBulb,
+    .debugDescription = kHAPServiceDebugDescription_LightBulb,
+    .characteristics = (const HAPCharacteristic* const[]) { &onCharacteristic, NULL }
+};
+
+HAP_RESULT_USE_CHECK
+static HAPError IdentifyAccessory(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        const HAPAccessoryIdentifyRequest* request HAP_UNUSED,
+        void* _Nullable context HAP_UNUSED) {
+    return kHAPError_None;
+}
+
+static const HAPAccessory accessory = { .aid = 1,
+                                        .category = kHAPAccessoryCategory_Lighting,
+                                        .name = "Acme Test",
+                                        .manufacturer = "Acme",
+                                        .model = "Test1,1",
+                                        .serialNumber = "099DB48E9E28",
+                                        .firmwareVersion = "1",
+                                        .hardwareVersion = "1",
+                                        .services = (const HAPService* const[]) { &accessoryInformationService,
+                                                                                  &hapProtocolInformationService,
+                                                                                  &pairingService,
+                                                                                  &lightBulbService,
+                                                                                  NULL },
+                                        .callbacks = { .identify = IdentifyAccessory } };
+
+static void HandleUpdatedAccessoryServerState(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        void* _Nullable context HAP_UNUSED) {
+}
+
+/**
+ * Creates and starts the accessory server, as on boot.
+ */
+static void StartAccessoryServer(void) {
+    static HAPBLEGATTTableElementRef gattTableElements[kAttributeCount + 2];
+    static HAPBLESessionCacheElementRef sessionCacheElements[kHAPBLESessionCache_MinElements];
+    static HAPSessionRef session;
+    static uint8_t procedureBytes[2048];
+    static HAPBLEProcedureRef procedures[1];
+    static HAPBLEAccessoryServerStorage bleAccessoryServerStorage = {
+        .gattTableElements = gattTableElements,
+        .numGATTTableElements = HAPArrayCount(gattTableElements),
+        .sessionCacheElements = sessionCacheElements,
+        .numSessionCacheElements = HAPArrayCount(sessionCacheElements),
+        .session = &session,
+        .procedures = procedures,
+        .numProcedures = HAPArrayCount(procedures),
+        .procedureBuffer = { .bytes = procedureBytes, .numBytes = sizeof procedureBytes },
+    };
+
+    HAPAccessoryServerCreate(
+            &accessoryServer,
+            &(const HAPAccessoryServerOptions) {
+                    .maxPairings = kHAPPairingStorage_MinElements,
+                    .ble = { .transport = &kHAPAccessoryServerTransport_BLE,
+                             .accessoryServerStorage = &bleAccessoryServerStorage,
+                             .preferredAdvertisingInterval = kHAPBLEAdvertisingInterval_Minimum,
+                             .preferredNotificationDuration = kHAPBLENotification_MinDuration } },
+            &platform,
+            &(const HAPAccessoryServerCallbacks) { .handleUpdatedState = HandleUpdatedAccessoryServerState },
+            /* context: */ NULL);
+    HAPAccessoryServerStart(&accessoryServer, &accessory);
+    HAPPlatformClockAdvance(0);
+    HAPAssert(HAPAccessoryServerGetState(&accessoryServer) == kHAPAccessoryServerState_Running);
+}
+
+/**
+ * Stops and releases the accessory server, as on power loss.
+ */
+static void StopAccessoryServer(void) {
+    HAPAccessoryServerStop(&accessoryServer);
+    HAPPlatformClockAdvance(0);
+    HAPAssert(HAPAccessoryServerGetState(&accessoryServer) == kHAPAccessoryServerState_Idle);
+    HAPAccessoryServerRelease(&accessoryServer);
+}
+
+/**
+ * Returns the current GSN.
+ */
+static uint16_t GetGSN(void) {
+    HAPBLEAccessoryServerGSN gsn;
+    HAPError err = HAPBLEAccessoryServerGetGSN(&accessoryServer, &gsn);
+    HAPAssert(!err);
+    return gsn.gsn;
+}
+
+/**
+ * Returns the GSN reservation stored in the key-value store.
+ */
+static uint16_t GetStoredGSN(void) {
+    uint8_t gsnBytes[3];
+    size_t numBytes;
+    bool found;
+    HAPError err = HAPPlatformKeyValueStoreGet(
+            platform.keyValueStore,
+            kHAPKeyValueStoreDomain_Configuration,
+            kHAPKeyValueStoreKey_Configuration_BLEGSN,
+            gsnBytes,
+            sizeof gsnBytes,
+            &numBytes,
+            &found);
+    HAPAssert(!err);
+    HAPAssert(found && numBytes == sizeof gsnBytes);
+    return HAPReadLittleUInt16(&gsnBytes[0]);
+}
+
+/**
+ * Stores broadcast encryption key parameters with a given key expiration GSN.
+ */
+static void StoreBroadcastParameters(uint16_t keyExpirationGSN) {
+    uint8_t parametersBytes[2 + 32 + 1 + 6];
+    HAPRawBufferZero(parametersBytes, sizeof parametersBytes);
+    HAPWriteLittleUInt16(&parametersBytes[0], keyExpirationGSN);
+    parametersBytes[2] = 0xAA;
+    HAPError err = HAPPlatformKeyValueStoreSet(
+            platform.keyValueStore,
+            kHAPKeyValueStoreDomain_Configuration,
+            kHAPKeyValueStoreKey_Configuration_BLEBroadcastParameters,
+            parametersBytes,
+            sizeof parametersBytes);
+    HAPAssert(!err);
+}
+
+/**
+ * Returns the broadcast encryption key expiration GSN.
+ */
+static uint16_t GetKeyExpirationGSN(void) {
+    uint16_t keyExpirationGSN;
+    HAPError err = HAPBLEAccessoryServerBroadcastGetParameters(&accessoryServer, &keyExpirationGSN, NULL, NULL);
+    HAPAssert(!err);
+    return keyExpirationGSN;
+}
+
+/**
+ * Raises a disconnected event, which increments the GSN once per disconnected period.
+ */
+static void IncrementGSN(void) {
+    // Start a new disconnected period and let the previous disconnected event advertisement complete.
+    ((HAPAccessoryServer*) &accessoryServer)->ble.gsn.state.didIncrement = false;
+    HAPPlatformClockAdvance(5 * HAPSecond);
+    HAPAccessoryServerRaiseEvent(&accessoryServer, &onCharacteristic, &lightBulbService, &accessory);
+}
+
+int main() {
+    HAPError err;
+    HAPPlatformCreate();
+
+    // First boot: GSN starts at 1 and a range of GSNs is reserved.
+    StartAccessoryServer();
+
+    // Pair controller, so that pairings are not cleaned up on the following boots.
+    static HAPTestControllerPairing pairing;
+    HAPTestControllerCreatePairing(platform.keyValueStore, &pairing);
+    HAPAssert(GetGSN() == 1);
+    HAPAssert(GetStoredGSN() == 1 + kHAPBLEAccessoryServer_NumReservedGSNs);
+
+    // Increments within the reservation are not persisted.
+    IncrementGSN();
+    HAPAssert(GetGSN() == 2);
+    HAPAssert(GetStoredGSN() == 1 + kHAPBLEAccessoryServer_NumReservedGSNs);
+
+    // Multiple events in the same disconnected period increment the GSN only once.
+    HAPAccessoryServerRaiseEvent(&accessoryServer, &onCharacteristic, &lightBulbService, &accessory);
+    HAPAssert(GetGSN() == 2);
+
+    // The reservation is extended when the GSN reaches its end.
+    while (GetGSN() < 1 + kHAPBLEAccessoryServer_NumReservedGSNs) {
+        IncrementGSN();
+        HAPAssert(GetStoredGSN() == 1 + kHAPBLEAccessoryServer_NumReservedGSNs);
+    }
+    IncrementGSN();
+    HAPAssert(GetGSN() == 2 + kHAPBLEAccessoryServer_NumReservedGSNs);
+    HAPAssert(GetStoredGSN() == 1 + 2 * kHAPBLEAccessoryServer_NumReservedGSNs);
+
+    // Reboot: the GSN continues after the reservation, as any GSN up to it may have been used.
+    // A broadcast encryption key that expires within the skipped range is expired.
+    StoreBroadcastParameters(/* keyExpirationGSN: */ 100);
+    StopAccessoryServer();
+    StartAccessoryServer();
+    HAPAssert(GetGSN() == 2 + 2 * kHAPBLEAccessoryServer_NumReservedGSNs);
+    HAPAssert(GetStoredGSN() == 2 + 3 * kHAPBLEAccessoryServer_NumReservedGSNs);
+    HAPAssert(GetKeyExpirationGSN() == 0);
+
+    // Reboot: a broadcast encryption key that expires after the skipped range is kept.
+    StoreBroadcastParameters(/* keyExpirationGSN: */ 1000);
+    StopAccessoryServer();
+    StartAccessoryServer();
+    HAPAssert(GetGSN() == 3 + 3 * kHAPBLEAccessoryServer_NumReservedGSNs);
+    HAPAssert(GetKeyExpirationGSN() == 1000);
+
+    // Wrap-around: the GSN wraps from 65535 to 1.
+    {
+        uint8_t gsnBytes[] = { HAPExpandLittleUInt16(UINT16_MAX - 1), 0x00 };
+        err = HAPPlatformKeyValueStoreSet(
+                platform.keyValueStore,
+                kHAPKeyValueStoreDomain_Configuration,
+                kHAPKeyValueStoreKey_Configuration_BLEGSN,
+                gsnBytes,
+                sizeof gsnBytes);
+        HAPAssert(!err);
+    }
+    StopAccessoryServer();
+    StartAccessoryServer();
+    HAPAssert(GetGSN() == UINT16_MAX);
+    HAPAssert(GetStoredGSN() == kHAPBLEAccessoryServer_NumReservedGSNs);
+    IncrementGSN();
+    HAPAssert(GetGSN() == 1);
+
+    // Removing the admin pairing and cleaning up pairings purges the broadcast encryption key but keeps the GSN state.
+    HAPAssert(GetKeyExpirationGSN() == 1000);
+    err = HAPPlatformKeyValueStorePurgeDomain(platform.keyValueStore, kHAPKeyValueStoreDomain_Pairings);
+    HAPAssert(!err);
+    err = HAPAccessoryServerCleanupPairings(&accessoryServer);
+    HAPAssert(!err);
+    HAPAssert(GetKeyExpirationGSN() == 0);
+    HAPAssert(GetGSN() == 1);
+    HAPAssert(GetStoredGSN() == kHAPBLEAccessoryServer_NumReservedGSNs);
+
+    StopAccessoryServer();
+    return 0;
+}
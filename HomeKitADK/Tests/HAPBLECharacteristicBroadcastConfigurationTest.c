@@ -0,0 +1,329 @@
+// Copyright (c) 2015-2019 The HomeKit ADK Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the “License”);
+// you may not use this file except in compliance with the License.
+// See [CONTRIBUTORS.md] for the list of HomeKit ADK project authors.
+
+#include "HAP+Internal.h"
+#include "HAPPlatform+Init.h"
+#include "HAPPlatformKeyValueStore+Test.h"
+
+#include "Harness/TemplateDB.c"
+
+static HAPAccessoryServerRef accessoryServer;
+
+HAP_RESULT_USE_CHECK
+static HAPError HandleRead(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        const HAPBoolCharacteristicReadRequest* request HAP_UNUSED,
+        bool* value,
+        void* _Nullable context HAP_UNUSED) {
+    *value = true;
+    return kHAPError_None;
+}
+
+static const HAPBoolCharacteristic onCharacteristic = {
+    .format = kHAPCharacteristicFormat_Bool,
+    .iid = 0x31,
+    .characteristicType = &kHAPCharacteristicType_On,
+    .debugDescription = kHAPCharacteristicDebugDescription_On,
+    .properties = { .readable = true,
+                    .supportsEventNotification = true,
+                    .ble = { .supportsBroadcastNotification = true } },
+    .callbacks = { .handleRead = HandleRead }
+};
+
+static const HAPBoolCharacteristic statusActiveCharacteristic = {
+    .format = kHAPCharacteristicFormat_Bool,
+    .iid = 0x30,
+    .characteristicType = &kHAPCharacteristicType_StatusActive,
+    .debugDescription = kHAPCharacteristicDebugDescription_StatusActive,
+    .properties = { .readable = true,
+                    .supportsEventNotification = true,
+                    .ble = { .supportsBroadcastNotification = true } },
+    .callbacks = { .handleRead = HandleRead }
+};
+
+static const HAPService lightBulbService = {
+    .iid = 0x2F,
+    .serviceType = &kHAPServiceType_LightBulb,
+    .debugDescription = kHAPServiceDebugDescription_LightBulb,
+    .characteristics = (const HAPCharacteristic* const[]) { &statusActiveCharacteristic, &onCharacteristic, NULL }
+};
+
+HAP_RESULT_USE_CHECK
+static HAPError IdentifyAccessory(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        const HAPAccessoryIdentifyRequest* request HAP_UNUSED,
+        void* _Nullable context HAP_UNUSED) {
+    return kHAPError_None;
+}
+
+static const HAPAccessory accessory = { .aid = 1,
+                                        .category = kHAPAccessoryCategory_Lighting,
+                                        .name = "Acme Test",
+                                        .manufacturer = "Acme",
+                                        .model = "Test1,1",
+                                        .serialNumber = "099DB48E9E28",
+                                        .firmwareVersion = "1",
+                                        .hardwareVersion = "1",
+                                        .services = (const HAPService* const[]) { &accessoryInformationService,
+                                                                                  &hapProtocolInformationService,
+                                                                                  &pairingService,
+                                                                                  &lightBulbService,
+                                                                                  NULL },
+                                        .callbacks = { .identify = IdentifyAccessory } };
+
+static void HandleUpdatedAccessoryServerState(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        void* _Nullable context HAP_UNUSED) {
+}
+
+/**
+ * Creates and starts the accessory server.
+ */
+static void StartAccessoryServer(void) {
+    static HAPBLEGATTTableElementRef gattTableElements[kAttributeCount + 4];
+    static HAPBLESessionCacheElementRef sessionCacheElements[kHAPBLESessionCache_MinElements];
+    static HAPSessionRef session;
+    static uint8_t procedureBytes[2048];
+    static HAPBLEProcedureRef procedures[1];
+    static HAPBLEAccessoryServerStorage bleAccessoryServerStorage = {
+        .gattTableElements = gattTableElements,
+        .numGATTTableElements = HAPArrayCount(gattTableElements),
+        .sessionCacheElements = sessionCacheElements,
+        .numSessionCacheElements = HAPArrayCount(sessionCacheElements),
+        .session = &session,
+        .procedures = procedures,
+        .numProcedures = HAPArrayCount(procedures),
+        .procedureBuffer = { .bytes = procedureBytes, .numBytes = sizeof procedureBytes },
+    };
+
+    HAPAccessoryServerCreate(
+            &accessoryServer,
+            &(const HAPAccessoryServerOptions) {
+                    .maxPairings = kHAPPairingStorage_MinElements,
+                    .ble = { .transport = &kHAPAccessoryServerTransport_BLE,
+                             .accessoryServerStorage = &bleAccessoryServerStorage,
+                             .preferredAdvertisingInterval = kHAPBLEAdvertisingInterval_Minimum,
+                             .preferredNotificationDuration = kHAPBLENotification_MinDuration } },
+            &platform,
+            &(const HAPAccessoryServerCallbacks) { .handleUpdatedState = HandleUpdatedAccessoryServerState },
+            /* context: */ NULL);
+    HAPAccessoryServerStart(&accessoryServer, &accessory);
+    HAPPlatformClockAdvance(0);
+    HAPAssert(HAPAccessoryServerGetState(&accessoryServer) == kHAPAccessoryServerState_Running);
+}
+
+/**
+ * Stops and releases the accessory server.
+ */
+static void StopAccessoryServer(void) {
+    HAPAccessoryServerStop(&accessoryServer);
+    HAPPlatformClockAdvance(0);
+    HAPAssert(HAPAccessoryServerGetState(&accessoryServer) == kHAPAccessoryServerState_Idle);
+    HAPAccessoryServerRelease(&accessoryServer);
+}
+
+/**
+ * Checks the broadcast configuration of a characteristic, as seen by the accessory server.
+ *
+ * @param      characteristic       Characteristic.
+ * @param      broadcastInterval    Expected broadcast interval. 0 if broadcasts are expected to be disabled.
+ */
+static void ExpectBroadcastConfiguration(const HAPBoolCharacteristic* characteristic, uint8_t broadcastInterval) {
+    bool broadcastsEnabled;
+    HAPBLECharacteristicBroadcastInterval interval;
+    HAPError err = HAPBLECharacteristicGetBroadcastConfiguration(
+            characteristic, &lightBulbService, &accessory, &broadcastsEnabled, &interval, &accessoryServer);
+    HAPAssert(!err);
+    HAPAssert(broadcastsEnabled == (broadcastInterval != 0));
+    if (broadcastsEnabled) {
+        HAPAssert(interval == broadcastInterval);
+    }
+}
+
+/**
+ * Checks the characteristic configuration stored in the key-value store.
+ *
+ * @param      bytes                Expected serialized configuration. NULL if no configuration is expected.
+ * @param      numBytes             Length of expected serialized configuration.
+ */
+static void ExpectStoredConfiguration(const uint8_t* _Nullable bytes, size_t numBytes) {
+    uint8_t storedBytes[256];
+    size_t numStoredBytes;
+    bool found;
+    HAPError err = HAPPlatformKeyValueStoreGet(
+            platform.keyValueStore,
+            kHAPKeyValueStoreDomain_CharacteristicConfiguration,
+            0,
+            storedBytes,
+            sizeof storedBytes,
+            &numStoredBytes,
+            &found);
+    HAPAssert(!err);
+    HAPAssert(found == (bytes != NULL));
+    if (found) {
+        HAPAssert(numStoredBytes == numBytes);
+        HAPAssert(HAPRawBufferAreEqual(storedBytes, HAPNonnull(bytes), numBytes));
+    }
+}
+
+/**
+ * Stores a characteristic configuration in the key-value store, bypassing the accessory server.
+ */
+static void StoreConfiguration(const uint8_t* bytes, size_t numBytes) {
+    HAPError err = HAPPlatformKeyValueStoreSet(
+            platform.keyValueStore, kHAPKeyValueStoreDomain_CharacteristicConfiguration, 0, bytes, numBytes);
+    HAPAssert(!err);
+}
+
+/**
+ * Stores broadcast encryption key parameters in the key-value store, bypassing the accessory server.
+ */
+static void StoreBroadcastParameters(uint16_t keyExpirationGSN) {
+    uint8_t parametersBytes[2 + 32 + 1 + 6];
+    HAPRawBufferZero(parametersBytes, sizeof parametersBytes);
+    HAPWriteLittleUInt16(&parametersBytes[0], keyExpirationGSN);
+    parametersBytes[2] = 0xAA;
+    HAPError err = HAPPlatformKeyValueStoreSet(
+            platform.keyValueStore,
+            kHAPKeyValueStoreDomain_Configuration,
+            kHAPKeyValueStoreKey_Configuration_BLEBroadcastParameters,
+            parametersBytes,
+            sizeof parametersBytes);
+    HAPAssert(!err);
+}
+
+/**
+ * Returns the broadcast encryption key expiration GSN, as seen by the accessory server.
+ */
+static uint16_t GetKeyExpirationGSN(void) {
+    uint16_t keyExpirationGSN;
+    HAPError err = HAPBLEAccessoryServerBroadcastGetParameters(&accessoryServer, &keyExpirationGSN, NULL, NULL);
+    HAPAssert(!err);
+    return keyExpirationGSN;
+}
+
+int main() {
+    HAPError err;
+    HAPPlatformCreate();
+    HAPPlatformKeyValueStoreRef keyValueStore = platform.keyValueStore;
+
+    StartAccessoryServer();
+
+    // Broadcasts are initially disabled. Looking up the configuration does not write.
+    size_t numWrites = HAPPlatformKeyValueStoreGetNumWrites(keyValueStore);
+    ExpectBroadcastConfiguration(&onCharacteristic, 0);
+    ExpectBroadcastConfiguration(&statusActiveCharacteristic, 0);
+    HAPAssert(HAPPlatformKeyValueStoreGetNumWrites(keyValueStore) == numWrites);
+    ExpectStoredConfiguration(NULL, 0);
+
+    // Enabling broadcasts updates the cache and the key-value store.
+    err = HAPBLECharacteristicEnableBroadcastNotifications(
+            &onCharacteristic,
+            &lightBulbService,
+            &accessory,
+            kHAPBLECharacteristicBroadcastInterval_20Ms,
+            &accessoryServer);
+    HAPAssert(!err);
+    HAPAssert(HAPPlatformKeyValueStoreGetNumWrites(keyValueStore) == numWrites + 1);
+    ExpectBroadcastConfiguration(&onCharacteristic, kHAPBLECharacteristicBroadcastInterval_20Ms);
+    ExpectBroadcastConfiguration(&statusActiveCharacteristic, 0);
+    ExpectStoredConfiguration((const uint8_t[]) { 0x01, 0x00, 0x31, 0x00, 0x01 }, 5);
+
+    // Enabling broadcasts with an unchanged interval does not write.
+    numWrites = HAPPlatformKeyValueStoreGetNumWrites(keyValueStore);
+    err = HAPBLECharacteristicEnableBroadcastNotifications(
+            &onCharacteristic,
+            &lightBulbService,
+            &accessory,
+            kHAPBLECharacteristicBroadcastInterval_20Ms,
+            &accessoryServer);
+    HAPAssert(!err);
+    HAPAssert(HAPPlatformKeyValueStoreGetNumWrites(keyValueStore) == numWrites);
+
+    // Changing the interval and enabling broadcasts for another characteristic keep entries sorted by instance ID.
+    err = HAPBLECharacteristicEnableBroadcastNotifications(
+            &onCharacteristic,
+            &lightBulbService,
+            &accessory,
+            kHAPBLECharacteristicBroadcastInterval_2560Ms,
+            &accessoryServer);
+    HAPAssert(!err);
+    err = HAPBLECharacteristicEnableBroadcastNotifications(
+            &statusActiveCharacteristic,
+            &lightBulbService,
+            &accessory,
+            kHAPBLECharacteristicBroadcastInterval_1280Ms,
+            &accessoryServer);
+    HAPAssert(!err);
+    HAPAssert(HAPPlatformKeyValueStoreGetNumWrites(keyValueStore) == numWrites + 2);
+    ExpectBroadcastConfiguration(&onCharacteristic, kHAPBLECharacteristicBroadcastInterval_2560Ms);
+    ExpectBroadcastConfiguration(&statusActiveCharacteristic, kHAPBLECharacteristicBroadcastInterval_1280Ms);
+    ExpectStoredConfiguration((const uint8_t[]) { 0x01, 0x00, 0x30, 0x00, 0x02, 0x31, 0x00, 0x03 }, 8);
+
+    // A configuration change in the key-value store is picked up once the cached state is invalidated.
+    StoreConfiguration((const uint8_t[]) { 0x01, 0x00, 0x31, 0x00, 0x01 }, 5);
+    ExpectBroadcastConfiguration(&onCharacteristic, kHAPBLECharacteristicBroadcastInterval_2560Ms);
+    HAPBLEAccessoryServerInvalidateCachedState(&accessoryServer);
+    ExpectBroadcastConfiguration(&onCharacteristic, kHAPBLECharacteristicBroadcastInterval_20Ms);
+    ExpectBroadcastConfiguration(&statusActiveCharacteristic, 0);
+
+    // The cached state is invalidated when the accessory server is restarted.
+    StoreConfiguration((const uint8_t[]) { 0x01, 0x00, 0x30, 0x00, 0x03 }, 5);
+    StopAccessoryServer();
+    StartAccessoryServer();
+    ExpectBroadcastConfiguration(&onCharacteristic, 0);
+    ExpectBroadcastConfiguration(&statusActiveCharacteristic, kHAPBLECharacteristicBroadcastInterval_2560Ms);
+
+    // Disabling the last broadcast removes the configuration from the key-value store.
+    err = HAPBLECharacteristicDisableBroadcastNotifications(
+            &statusActiveCharacteristic, &lightBulbService, &accessory, &accessoryServer);
+    HAPAssert(!err);
+    ExpectBroadcastConfiguration(&statusActiveCharacteristic, 0);
+    ExpectStoredConfiguration(NULL, 0);
+
+    // If a write fails, the stored state is unknown. The cache is reloaded from the key-value store on next access.
+    HAPPlatformKeyValueStoreSetFailWrites(keyValueStore, true);
+    err = HAPBLECharacteristicEnableBroadcastNotifications(
+            &onCharacteristic,
+            &lightBulbService,
+            &accessory,
+            kHAPBLECharacteristicBroadcastInterval_20Ms,
+            &accessoryServer);
+    HAPAssert(err == kHAPError_Unknown);
+    HAPPlatformKeyValueStoreSetFailWrites(keyValueStore, false);
+    StoreConfiguration((const uint8_t[]) { 0x01, 0x00, 0x31, 0x00, 0x03 }, 5);
+    ExpectBroadcastConfiguration(&onCharacteristic, kHAPBLECharacteristicBroadcastInterval_2560Ms);
+
+    // A broadcast encryption key change in the key-value store is picked up once the cached parameters are
+    // invalidated.
+    StoreBroadcastParameters(/* keyExpirationGSN: */ 1000);
+    HAPBLEAccessoryServerBroadcastInvalidateCachedParameters(&accessoryServer);
+    HAPAssert(GetKeyExpirationGSN() == 1000);
+    StoreBroadcastParameters(/* keyExpirationGSN: */ 2000);
+    HAPAssert(GetKeyExpirationGSN() == 1000);
+    HAPBLEAccessoryServerBroadcastInvalidateCachedParameters(&accessoryServer);
+    HAPAssert(GetKeyExpirationGSN() == 2000);
+
+    // Expiring the broadcast encryption key updates the cache and the key-value store.
+    err = HAPBLEAccessoryServerBroadcastExpireKey(&accessoryServer);
+    HAPAssert(!err);
+    HAPAssert(GetKeyExpirationGSN() == 0);
+    HAPBLEAccessoryServerBroadcastInvalidateCachedParameters(&accessoryServer);
+    HAPAssert(GetKeyExpirationGSN() == 0);
+
+    // A firmware update expires the broadcast encryption key and invalidates all cached state.
+    StoreBroadcastParameters(/* keyExpirationGSN: */ 1000);
+    HAPBLEAccessoryServerBroadcastInvalidateCachedParameters(&accessoryServer);
+    HAPAssert(GetKeyExpirationGSN() == 1000);
+    StoreConfiguration((const uint8_t[]) { 0x01, 0x00, 0x31, 0x00, 0x02 }, 5);
+    err = HAPHandleFirmwareUpdate(&accessoryServer);
+    HAPAssert(!err);
+    HAPAssert(GetKeyExpirationGSN() == 0);
+    ExpectBroadcastConfiguration(&onCharacteristic, kHAPBLECharacteristicBroadcastInterval_1280Ms);
+
+    StopAccessoryServer();
+    return 0;
+}
@@ -0,0 +1,269 @@
+// Copyright (c) 2015-2019 The HomeKit ADK Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the “License”);
+// you may not use this file except in compliance with the License.
+// See [CONTRIBUTORS.md] for the list of HomeKit ADK project authors.
+
+#include "HAP+Internal.h"
+#include "HAPPlatform+Init.h"
+#include "HAPPlatformBLEPeripheralManager+Test.h"
+
+#include "Harness/HAPTestController.c"
+#include "Harness/TemplateDB.c"
+
+static HAPAccessoryServerRef accessoryServer;
+
+HAP_RESULT_USE_CHECK
+static HAPError HandleRead(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        const HAPUInt8CharacteristicReadRequest* request HAP_UNUSED,
+        uint8_t* value,
+        void* _Nullable context HAP_UNUSED) {
+    *value = 0;
+    return kHAPError_None;
+}
+
+static const HAPUInt8Characteristic brightnessCharacteristic = {
+    .format = kHAPCharacteristicFormat_UInt8,
+    .iid = 0x30,
+    .characteristicType = &kHAPCharacteristicType_Brightness,
+    .debugDescription = kHAPCharacteristicDebugDescription_Brightness,
+    .properties = { .readable = true, .supportsEventNotification = true },
+    .constraints = { .maximumValue = 100, .stepValue = 1 },
+    .callbacks = { .handleRead = HandleRead }
+};
+
+static const HAPUInt8Characteristic hueCharacteristic = {
+    .format = kHAPCharacteristicFormat_UInt8,
+    .iid = 0x31,
+    .characteristicType = &kHAPCharacteristicType_Hue,
+    .debugDescription = kHAPCharacteristicDebugDescription_Hue,
+    .properties = { .readable = true, .supportsEventNotification = true },
+    .constraints = { .maximumValue = 100, .stepValue = 1 },
+    .callbacks = { .handleRead = HandleRead }
+};
+
+static const HAPUInt8Characteristic saturationCharacteristic = {
+    .format = kHAPCharacteristicFormat_UInt8,
+    .iid = 0x32,
+    .characteristicType = &kHAPCharacteristicType_Saturation,
+    .debugDescription = kHAPCharacteristicDebugDescription_Saturation,
+    .properties = { .readable = true, .supportsEventNotification = true },
+    .constraints = { .maximumValue = 100, .stepValue = 1 },
+    .callbacks = { .handleRead = HandleRead }
+};
+
+static const HAPService lightBulbService = {
+    .iid = 0x2F,
+    .serviceType = &kHAPServiceType_LightBulb,
+    .debugDescription = kHAPServiceDebugDescription_LightBulb,
+    .characteristics = (const HAPCharacteristic* const[]) { &brightnessCharacteristic,
+                                                            &hueCharacteristic,
+                                                            &saturationCharacteristic,
+                                                            NULL }
+};
+
+HAP_RESULT_USE_CHECK
+static HAPError IdentifyAccessory(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        const HAPAccessoryIdentifyRequest* request HAP_UNUSED,
+        void* _Nullable context HAP_UNUSED) {
+    return kHAPError_None;
+}
+
+static const HAPAccessory accessory = { .aid = 1,
+                                        .category = kHAPAccessoryCategory_Lighting,
+                                        .name = "Acme Test",
+                                        .manufacturer = "Acme",
+                                        .model = "Test1,1",
+                                        .serialNumber = "099DB48E9E28",
+                                        .firmwareVersion = "1",
+                                        .hardwareVersion = "1",
+                                        .services = (const HAPService* const[]) { &accessoryInformationService,
+                                                                                  &hapProtocolInformationService,
+                                                                                  &pairingService,
+                                                                                  &lightBulbService,
+                                                                                  NULL },
+                                        .callbacks = { .identify = IdentifyAccessory } };
+
+static void HandleUpdatedAccessoryServerState(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        void* _Nullable context HAP_UNUSED) {
+}
+
+/**
+ * Attribute handles of a characteristic.
+ */
+typedef struct {
+    HAPPlatformBLEPeripheralManagerAttributeHandle valueHandle;
+    HAPPlatformBLEPeripheralManagerAttributeHandle cccDescriptorHandle;
+} CharacteristicHandles;
+
+/**
+ * Looks up the attribute handles of a characteristic.
+ */
+static void FindCharacteristic(const HAPUInt8Characteristic* characteristic, CharacteristicHandles* handles) {
+    bool found = HAPPlatformBLEPeripheralManagerFindCharacteristic(
+            HAPNonnull(platform.ble.blePeripheralManager),
+            (const HAPPlatformBLEPeripheralManagerUUID*) characteristic->characteristicType,
+            &handles->valueHandle,
+            &handles->cccDescriptorHandle);
+    HAPAssert(found);
+    HAPAssert(handles->valueHandle);
+    HAPAssert(handles->cccDescriptorHandle);
+}
+
+/**
+ * Enables or disables indications for a characteristic by writing its Client Characteristic Configuration descriptor.
+ */
+static void SetIndicationsEnabled(const CharacteristicHandles* handles, bool enable) {
+    uint8_t bytes[] = { HAPExpandLittleUInt16(enable ? 0x0002u : 0x0000u) };
+    HAPError err = HAPPlatformBLEPeripheralManagerWriteAttribute(
+            HAPNonnull(platform.ble.blePeripheralManager), handles->cccDescriptorHandle, bytes, sizeof bytes);
+    HAPAssert(!err);
+}
+
+/**
+ * Raises a connected event for a characteristic.
+ */
+static void RaiseEvent(const HAPUInt8Characteristic* characteristic) {
+    HAPAccessoryServerRaiseEvent(&accessoryServer, characteristic, &lightBulbService, &accessory);
+}
+
+/**
+ * Confirms the outstanding Handle Value Indication and checks that it was sent for the expected characteristic.
+ */
+static void ExpectIndication(const CharacteristicHandles* handles) {
+    HAPPlatformBLEPeripheralManagerAttributeHandle valueHandle;
+    bool confirmed = HAPPlatformBLEPeripheralManagerConfirmHandleValueIndication(
+            HAPNonnull(platform.ble.blePeripheralManager), &valueHandle);
+    HAPAssert(confirmed);
+    HAPAssert(valueHandle == handles->valueHandle);
+}
+
+/**
+ * Checks that no Handle Value Indication is outstanding.
+ */
+static void ExpectNoIndication(void) {
+    HAPPlatformBLEPeripheralManagerAttributeHandle valueHandle;
+    bool confirmed = HAPPlatformBLEPeripheralManagerConfirmHandleValueIndication(
+            HAPNonnull(platform.ble.blePeripheralManager), &valueHandle);
+    HAPAssert(!confirmed);
+}
+
+int main() {
+    HAPPlatformCreate();
+
+    // Prepare accessory server storage.
+    static HAPBLEGATTTableElementRef gattTableElements[kAttributeCount + 4];
+    static HAPBLESessionCacheElementRef sessionCacheElements[kHAPBLESessionCache_MinElements];
+    static HAPSessionRef session;
+    static uint8_t procedureBytes[2048];
+    static HAPBLEProcedureRef procedures[1];
+    static HAPBLEAccessoryServerStorage bleAccessoryServerStorage = {
+        .gattTableElements = gattTableElements,
+        .numGATTTableElements = HAPArrayCount(gattTableElements),
+        .sessionCacheElements = sessionCacheElements,
+        .numSessionCacheElements = HAPArrayCount(sessionCacheElements),
+        .session = &session,
+        .procedures = procedures,
+        .numProcedures = HAPArrayCount(procedures),
+        .procedureBuffer = { .bytes = procedureBytes, .numBytes = sizeof procedureBytes },
+    };
+
+    // Initialize accessory server.
+    HAPAccessoryServerCreate(
+            &accessoryServer,
+            &(const HAPAccessoryServerOptions) {
+                    .maxPairings = kHAPPairingStorage_MinElements,
+                    .ble = { .transport = &kHAPAccessoryServerTransport_BLE,
+                             .accessoryServerStorage = &bleAccessoryServerStorage,
+                             .preferredAdvertisingInterval = kHAPBLEAdvertisingInterval_Minimum,
+                             .preferredNotificationDuration = kHAPBLENotification_MinDuration } },
+            &platform,
+            &(const HAPAccessoryServerCallbacks) { .handleUpdatedState = HandleUpdatedAccessoryServerState },
+            /* context: */ NULL);
+
+    // Start accessory server.
+    HAPAccessoryServerStart(&accessoryServer, &accessory);
+    HAPPlatformClockAdvance(0);
+    HAPAssert(HAPAccessoryServerGetState(&accessoryServer) == kHAPAccessoryServerState_Running);
+
+    // Pair controller.
+    static HAPTestControllerPairing pairing;
+    HAPTestControllerCreatePairing(platform.keyValueStore, &pairing);
+
+    // Connect controller. Pair Verify is not simulated: the session is marked as secured with the admin pairing.
+    HAPPlatformBLEPeripheralManagerConnectCentral(HAPNonnull(platform.ble.blePeripheralManager), 0x0001);
+    ((HAPSession*) &session)->hap.active = true;
+    ((HAPSession*) &session)->hap.pairingID = 0;
+    HAPAssert(HAPSessionIsSecured(&session));
+    HAPAssert(HAPSessionControllerIsAdmin(&session));
+
+    // Subscribe to all characteristics.
+    CharacteristicHandles brightness, hue, saturation;
+    FindCharacteristic(&brightnessCharacteristic, &brightness);
+    FindCharacteristic(&hueCharacteristic, &hue);
+    FindCharacteristic(&saturationCharacteristic, &saturation);
+    SetIndicationsEnabled(&brightness, true);
+    SetIndicationsEnabled(&hue, true);
+    SetIndicationsEnabled(&saturation, true);
+    ExpectNoIndication();
+
+    // Events are indicated in the order in which they were raised, not in GATT table order.
+    // Events raised again while pending are not queued twice.
+    RaiseEvent(&saturationCharacteristic);
+    RaiseEvent(&hueCharacteristic);
+    RaiseEvent(&brightnessCharacteristic);
+    RaiseEvent(&hueCharacteristic);
+    RaiseEvent(&brightnessCharacteristic);
+    ExpectIndication(&saturation);
+    ExpectIndication(&hue);
+    ExpectIndication(&brightness);
+    ExpectNoIndication();
+
+    // An event that has been indicated is queued again at the end when raised again.
+    RaiseEvent(&hueCharacteristic);
+    RaiseEvent(&brightnessCharacteristic);
+    RaiseEvent(&hueCharacteristic);
+    ExpectIndication(&hue);
+    RaiseEvent(&hueCharacteristic);
+    ExpectIndication(&brightness);
+    ExpectIndication(&hue);
+    ExpectNoIndication();
+
+    // Events for characteristics without subscription remain queued in their position.
+    SetIndicationsEnabled(&hue, false);
+    RaiseEvent(&brightnessCharacteristic);
+    RaiseEvent(&hueCharacteristic);
+    RaiseEvent(&saturationCharacteristic);
+    ExpectIndication(&brightness);
+    RaiseEvent(&brightnessCharacteristic);
+    ExpectIndication(&saturation);
+    ExpectIndication(&brightness);
+    ExpectNoIndication();
+    SetIndicationsEnabled(&hue, true);
+    ExpectIndication(&hue);
+    ExpectNoIndication();
+
+    // Pending events are dropped on disconnect.
+    RaiseEvent(&brightnessCharacteristic);
+    RaiseEvent(&hueCharacteristic);
+    HAPPlatformBLEPeripheralManagerDisconnectCentral(HAPNonnull(platform.ble.blePeripheralManager));
+    HAPPlatformBLEPeripheralManagerConnectCentral(HAPNonnull(platform.ble.blePeripheralManager), 0x0002);
+    ((HAPSession*) &session)->hap.active = true;
+    ((HAPSession*) &session)->hap.pairingID = 0;
+    SetIndicationsEnabled(&hue, true);
+    ExpectNoIndication();
+    RaiseEvent(&hueCharacteristic);
+    ExpectIndication(&hue);
+    ExpectNoIndication();
+
+    HAPPlatformBLEPeripheralManagerDisconnectCentral(HAPNonnull(platform.ble.blePeripheralManager));
+    HAPAccessoryServerStop(&accessoryServer);
+    HAPPlatformClockAdvance(0);
+    HAPAssert(HAPAccessoryServerGetState(&accessoryServer) == kHAPAccessoryServerState_Idle);
+    HAPAccessoryServerRelease(&accessoryServer);
+
+    return 0;
+}
@@ -162,6 +162,46 @@ static const uint8_t chacha20_poly1305_ct[] = {
     HAPAssert(!memcmp(t, tag, sizeof tag)); \
     }
 
+#define test_chacha20_poly1305_overlapping(key, nonce, pt, aad, tag, ct) \
+    { \
+        uint8_t t[CHACHA20_POLY1305_TAG_BYTES]; \
+        uint8_t b[300]; \
+        size_t pt_len = sizeof pt - 1; \
+        memcpy(b, pt, pt_len); \
+        HAP_chacha20_poly1305_encrypt_aad(t, b, b, pt_len, aad, sizeof aad, nonce, sizeof nonce, key); \
+        HAPAssert(!memcmp(b, ct, sizeof ct)); \
+        HAPAssert(!memcmp(t, tag, sizeof tag)); \
+        int ret = HAP_chacha20_poly1305_decrypt_aad(tag, b, b, sizeof ct, aad, sizeof aad, nonce, sizeof nonce, key); \
+        HAPAssert(!ret); \
+        HAPAssert(!memcmp(b, pt, pt_len)); \
+        memcpy(b, pt, pt_len); \
+        HAP_chacha20_poly1305_encrypt_aad(t, &b[2], b, pt_len, aad, sizeof aad, nonce, sizeof nonce, key); \
+        HAPAssert(!memcmp(&b[2], ct, sizeof ct)); \
+        HAPAssert(!memcmp(t, tag, sizeof tag)); \
+        ret = HAP_chacha20_poly1305_decrypt_aad(tag, b, &b[2], sizeof ct, aad, sizeof aad, nonce, sizeof nonce, key); \
+        HAPAssert(!ret); \
+        HAPAssert(!memcmp(b, pt, pt_len)); \
+    }
+
+#define test_chacha20_poly1305_short_nonce(key, pt) \
+    { \
+        static const uint8_t n8[] = { 1, 2, 3, 4, 5, 6, 7, 8 }; \
+        static const uint8_t n12[] = { 0, 0, 0, 0, 1, 2, 3, 4, 5, 6, 7, 8 }; \
+        uint8_t t8[CHACHA20_POLY1305_TAG_BYTES]; \
+        uint8_t t12[CHACHA20_POLY1305_TAG_BYTES]; \
+        uint8_t c8[300]; \
+        uint8_t c12[300]; \
+        size_t pt_len = sizeof pt - 1; \
+        HAP_chacha20_poly1305_encrypt(t8, c8, pt, pt_len, n8, sizeof n8, key); \
+        HAP_chacha20_poly1305_encrypt(t12, c12, pt, pt_len, n12, sizeof n12, key); \
+        HAPAssert(!memcmp(c8, c12, pt_len)); \
+        HAPAssert(!memcmp(t8, t12, sizeof t12)); \
+        uint8_t m[300]; \
+        int ret = HAP_chacha20_poly1305_decrypt(t8, m, c8, pt_len, n8, sizeof n8, key); \
+        HAPAssert(!ret); \
+        HAPAssert(!memcmp(m, pt, pt_len)); \
+    }
+
 // https://github.com/wolfSSL/wolfssl/issues/18#issuecomment-83941582
 
 static const uint8_t srp_salt[] = { 0xBE, 0xB2, 0x53, 0x79, 0xD1, 0xA8, 0x58, 0x1E,
@@ -358,6 +398,38 @@ static const uint8_t hkdf_OKM[] = {
     0x14, 0x81, 0x57, 0x93, 0x38, 0xda, 0x36, 0x2c, 0xb8, 0xd9, 0xf9, 0x25, 0xd7, 0xcb,
 };
 
+// Longer inputs and outputs spanning multiple blocks.
+
+static const uint8_t hkdf_IKM_2[] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+    0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f,
+    0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f,
+    0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0x3e, 0x3f,
+    0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x4b, 0x4c, 0x4d, 0x4e, 0x4f,
+};
+static const uint8_t hkdf_info_2[] = {
+    0xb0, 0xb1, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xbb, 0xbc, 0xbd, 0xbe, 0xbf,
+    0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf,
+    0xd0, 0xd1, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xdb, 0xdc, 0xdd, 0xde, 0xdf,
+    0xe0, 0xe1, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xeb, 0xec, 0xed, 0xee, 0xef,
+    0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff,
+};
+static const uint8_t hkdf_salt_2[] = {
+    0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x6b, 0x6c, 0x6d, 0x6e, 0x6f,
+    0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x7b, 0x7c, 0x7d, 0x7e, 0x7f,
+    0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x8b, 0x8c, 0x8d, 0x8e, 0x8f,
+    0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0x9b, 0x9c, 0x9d, 0x9e, 0x9f,
+    0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xab, 0xac, 0xad, 0xae, 0xaf,
+};
+static const uint8_t hkdf_OKM_2[] = {
+    0xce, 0x6c, 0x97, 0x19, 0x28, 0x05, 0xb3, 0x46, 0xe6, 0x16, 0x1e, 0x82, 0x1e, 0xd1,
+    0x65, 0x67, 0x3b, 0x84, 0xf4, 0x00, 0xa2, 0xb5, 0x14, 0xb2, 0xfe, 0x23, 0xd8, 0x4c,
+    0xd1, 0x89, 0xdd, 0xf1, 0xb6, 0x95, 0xb4, 0x8c, 0xbd, 0x1c, 0x83, 0x88, 0x44, 0x11,
+    0x37, 0xb3, 0xce, 0x28, 0xf1, 0x6a, 0xa6, 0x4b, 0xa3, 0x3b, 0xa4, 0x66, 0xb2, 0x4d,
+    0xf6, 0xcf, 0xcb, 0x02, 0x1e, 0xcf, 0xf2, 0x35, 0xf6, 0xa2, 0x05, 0x6c, 0xe3, 0xaf,
+    0x1d, 0xe4, 0x4d, 0x57, 0x20, 0x97, 0xa8, 0x50, 0x5d, 0x9e, 0x7a, 0x93,
+};
+
 #define test_hkdf_sha512(key, salt, info, r) \
     { \
         uint8_t r_[sizeof(r)]; \
@@ -476,6 +548,31 @@ static void test_bn_pad() {
     HAP_srp_verifier(v, salt, (const uint8_t*) "", 0, (const uint8_t*) "", 0);
 }
 
+// Every length and alignment around the word size, with a single differing or non-zero byte at every position.
+static void test_constant_time() {
+    uint8_t x[3 * sizeof(uintptr_t) + 1];
+    uint8_t y[3 * sizeof(uintptr_t) + 1];
+    for (size_t offset = 0; offset < sizeof(uintptr_t); offset++) {
+        for (size_t length = 0; offset + length <= sizeof x; length++) {
+            memset(x, 0, sizeof x);
+            memset(y, 0, sizeof y);
+            HAPAssert(HAP_constant_time_equal(&x[offset], &y[offset], length) == 1);
+            HAPAssert(HAP_constant_time_is_zero(&x[offset], length) == 1);
+            for (size_t i = 0; i < length; i++) {
+                for (unsigned int bit = 0; bit < 8; bit++) {
+                    x[offset + i] = (uint8_t)(1 << bit);
+                    HAPAssert(HAP_constant_time_equal(&x[offset], &y[offset], length) == 0);
+                    HAPAssert(HAP_constant_time_is_zero(&x[offset], length) == 0);
+                    HAP_constant_time_copy(&y[offset], &x[offset], length);
+                    HAPAssert(HAP_constant_time_equal(&x[offset], &y[offset], length) == 1);
+                    HAP_constant_time_fill_zero(&x[offset], length);
+                    HAP_constant_time_fill_zero(&y[offset], length);
+                }
+            }
+        }
+    }
+}
+
 int main() {
     test_ed25519(ed25519_sk, ed25519_pk, ed25519_m, ed25519_sig);
     test_X25519_1(rfc7748_alice_skey, rfc7748_alice_pkey);
@@ -487,6 +584,14 @@ int main() {
             chacha20_poly1305_aad,
             chacha20_poly1305_tag,
             chacha20_poly1305_ct);
+    test_chacha20_poly1305_overlapping(
+            chacha20_poly1305_key,
+            chacha20_poly1305_nonce,
+            chacha20_poly1305_pt,
+            chacha20_poly1305_aad,
+            chacha20_poly1305_tag,
+            chacha20_poly1305_ct);
+    test_chacha20_poly1305_short_nonce(chacha20_poly1305_key, chacha20_poly1305_pt);
 #if HAP_IP
     test_chacha20_poly1305_inc(
             chacha20_poly1305_key,
@@ -501,6 +606,7 @@ int main() {
     test_hash(HAP_sha256, sha_text, sha256_hash);
     test_hash(HAP_sha512, sha_text, sha512_hash);
     test_hkdf_sha512(hkdf_IKM, hkdf_salt, hkdf_info, hkdf_OKM);
+    test_hkdf_sha512(hkdf_IKM_2, hkdf_salt_2, hkdf_info_2, hkdf_OKM_2);
 #if HAP_IP
     test_hmac_sha1(rfc2202_key1, rfc2202_in1, rfc2202_hmac1);
     test_aes_ctr(NIST_800_38A_key, NIST_800_38A_IV, NIST_800_38A_plaintext, NIST_800_38A_ciphertext);
@@ -508,5 +614,6 @@ int main() {
 #endif
     test_store_big_endian(0x12345678);
     test_bn_pad();
+    test_constant_time();
     return 0;
 }
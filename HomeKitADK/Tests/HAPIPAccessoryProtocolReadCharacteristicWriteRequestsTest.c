@@ -167,6 +167,55 @@ int main() {
         HAPAssert(writeContext->type == kHAPIPWriteValueType_UInt);
         HAPAssert(writeContext->value.unsignedIntValue == 18446744073709551615ULL);
     }
+    {
+        // Batch of 100 writes, as sent when a scene is activated.
+        static char request[100 * 64];
+        HAPStringBuilderRef stringBuilder;
+        HAPStringBuilderCreate(&stringBuilder, request, sizeof request);
+        HAPStringBuilderAppend(&stringBuilder, "{\"characteristics\":[");
+        for (int i = 0; i < 100; i++) {
+            if (i % 2) {
+                HAPStringBuilderAppend(&stringBuilder, "{\"aid\":%d,\"iid\":%d,\"value\":%d}", i + 1, 10, i);
+            } else {
+                HAPStringBuilderAppend(&stringBuilder, "{\"aid\":%d,\"iid\":%d,\"value\":\"Scene %d\"}", i + 1, 11, i);
+            }
+            HAPStringBuilderAppend(&stringBuilder, i == 99 ? "]}" : ",");
+        }
+        HAPAssert(!HAPStringBuilderDidOverflow(&stringBuilder));
+        size_t numRequestBytes = HAPStringBuilderGetNumBytes(&stringBuilder);
+
+        uint64_t pid;
+        bool pid_valid;
+        size_t contexts_count;
+        err = HAPIPAccessoryProtocolGetCharacteristicWriteRequests(
+                request, numRequestBytes, &writeContexts, &contexts_count, &pid_valid, &pid);
+        HAPAssert(!err);
+        HAPAssert(contexts_count == 100);
+        HAPAssert(!pid_valid);
+        for (size_t i = 0; i < contexts_count; i++) {
+            HAPIPWriteContext* writeContext = (HAPIPWriteContext*) &writeContexts[i];
+            HAPAssert(writeContext->aid == i + 1);
+            if (i % 2) {
+                HAPAssert(writeContext->iid == 10);
+                HAPAssert(writeContext->type == kHAPIPWriteValueType_UInt);
+                HAPAssert(writeContext->value.unsignedIntValue == i);
+            } else {
+                char expected[16];
+                err = HAPStringWithFormat(expected, sizeof expected, "Scene %zu", i);
+                HAPAssert(!err);
+                HAPAssert(writeContext->iid == 11);
+                HAPAssert(writeContext->type == kHAPIPWriteValueType_String);
+                HAPAssert(writeContext->value.stringValue.numBytes == HAPStringGetNumBytes(expected));
+                HAPAssert(HAPRawBufferAreEqual(
+                        HAPNonnull(writeContext->value.stringValue.bytes),
+                        expected,
+                        writeContext->value.stringValue.numBytes));
+                // String values are not copied out of the request.
+                HAPAssert(writeContext->value.stringValue.bytes > request);
+                HAPAssert(writeContext->value.stringValue.bytes < &request[numRequestBytes]);
+            }
+        }
+    }
 
     free(writeContexts);
 
@@ -0,0 +1,436 @@
+// Copyright (c) 2015-2019 The HomeKit ADK Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the “License”);
+// you may not use this file except in compliance with the License.
+// See [CONTRIBUTORS.md] for the list of HomeKit ADK project authors.
+
+#include <string.h>
+
+#include "HAP+Internal.h"
+#include "HAPPlatform+Init.h"
+
+#include "Harness/HAPTestController.c"
+#include "Harness/TemplateDB.c"
+
+static HAPAccessoryServerRef accessoryServer;
+
+/** State of the characteristic whose requests are deferred. */
+static struct {
+    /** Current value. */
+    uint8_t value;
+
+    /** Value of the write that is in progress. */
+    uint8_t pendingValue;
+
+    /** Whether the value has been fetched and the next read may complete synchronously. */
+    bool isFetched;
+
+    /** Whether the next read completion should not mark the value as fetched. */
+    bool skipFetch;
+
+    /** Whether reads of the synchronous characteristic complete the pending read. */
+    bool completeFromOtherHandler;
+
+    /** Whether deferred requests are never completed and reads that cannot be deferred report busy. */
+    bool isStuck;
+
+    /** Token of the pending read, if any. */
+    HAPCharacteristicRequestToken readToken;
+    bool isReadPending;
+
+    /** Token of the pending write, if any. */
+    HAPCharacteristicRequestToken writeToken;
+    bool isWritePending;
+
+    /** Timer that completes the pending request. */
+    HAPPlatformTimerRef completionTimer;
+
+    /** Statistics. */
+    size_t numReads;
+    size_t numWrites;
+    size_t numRejectedDeferrals;
+} test;
+
+static const HAPUInt8Characteristic deferredCharacteristic;
+static const HAPService lightBulbService;
+static const HAPAccessory accessory;
+
+static void CompleteRead(void) {
+    HAPAssert(test.isReadPending);
+    test.isReadPending = false;
+    test.isFetched = !test.skipFetch;
+    HAPAccessoryServerCompleteCharacteristicRequest(&accessoryServer, &test.readToken, kHAPError_None);
+}
+
+static void CompleteWrite(void) {
+    HAPAssert(test.isWritePending);
+    test.isWritePending = false;
+    test.value = test.pendingValue;
+    HAPAccessoryServerRaiseEvent(&accessoryServer, &deferredCharacteristic, &lightBulbService, &accessory);
+    HAPAccessoryServerCompleteCharacteristicRequest(&accessoryServer, &test.writeToken, kHAPError_None);
+}
+
+static void HandleCompletionTimerExpired(HAPPlatformTimerRef timer, void* _Nullable context HAP_UNUSED) {
+    HAPAssert(timer == test.completionTimer);
+    test.completionTimer = 0;
+    if (test.isReadPending) {
+        CompleteRead();
+    }
+    if (test.isWritePending) {
+        CompleteWrite();
+    }
+}
+
+static void ScheduleCompletion(HAPTime delay) {
+    HAPAssert(!test.completionTimer);
+    HAPError err = HAPPlatformTimerRegister(
+            &test.completionTimer, HAPPlatformClockGetCurrent() + delay, HandleCompletionTimerExpired, NULL);
+    HAPAssert(!err);
+}
+
+HAP_RESULT_USE_CHECK
+static HAPError HandleDeferredRead(
+        HAPAccessoryServerRef* server,
+        const HAPUInt8CharacteristicReadRequest* request,
+        uint8_t* value,
+        void* _Nullable context HAP_UNUSED) {
+    test.numReads++;
+    if (test.isFetched) {
+        test.isFetched = false;
+        *value = test.value;
+        return kHAPError_None;
+    }
+    HAPCharacteristicRequestToken token;
+    HAPError err = HAPAccessoryServerDeferCharacteristicRequest(server, request->session, &token);
+    if (err) {
+        // Reads that cannot be deferred are served with the cached value.
+        HAPAssert(err == kHAPError_InvalidState);
+        test.numRejectedDeferrals++;
+        if (test.isStuck) {
+            return kHAPError_Busy;
+        }
+        *value = test.value;
+        return kHAPError_None;
+    }
+    HAPAssert(!test.isReadPending);
+    test.readToken = token;
+    test.isReadPending = true;
+
+    // A request may only be deferred once.
+    err = HAPAccessoryServerDeferCharacteristicRequest(server, request->session, &token);
+    HAPAssert(err == kHAPError_InvalidState);
+
+    if (!test.completeFromOtherHandler && !test.isStuck) {
+        ScheduleCompletion(500 * HAPMillisecond);
+    }
+    return kHAPError_Busy;
+}
+
+HAP_RESULT_USE_CHECK
+static HAPError HandleDeferredWrite(
+        HAPAccessoryServerRef* server,
+        const HAPUInt8CharacteristicWriteRequest* request,
+        uint8_t value,
+        void* _Nullable context HAP_UNUSED) {
+    test.numWrites++;
+    test.pendingValue = value;
+    HAPError err = HAPAccessoryServerDeferCharacteristicRequest(server, request->session, &test.writeToken);
+    HAPAssert(!err);
+    test.isWritePending = true;
+    if (!test.isStuck) {
+        ScheduleCompletion(300 * HAPMillisecond);
+    }
+    return kHAPError_Busy;
+}
+
+HAP_RESULT_USE_CHECK
+static HAPError HandleRead(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        const HAPUInt8CharacteristicReadRequest* request HAP_UNUSED,
+        uint8_t* value,
+        void* _Nullable context HAP_UNUSED) {
+    if (test.completeFromOtherHandler && test.isReadPending) {
+        CompleteRead();
+    }
+    *value = 99;
+    return kHAPError_None;
+}
+
+static const HAPUInt8Characteristic deferredCharacteristic = {
+    .format = kHAPCharacteristicFormat_UInt8,
+    .iid = 0x100,
+    .characteristicType = &kHAPCharacteristicType_Brightness,
+    .debugDescription = kHAPCharacteristicDebugDescription_Brightness,
+    .properties = { .readable = true, .writable = true, .supportsEventNotification = true },
+    .constraints = { .maximumValue = 100, .stepValue = 1 },
+    .callbacks = { .handleRead = HandleDeferredRead, .handleWrite = HandleDeferredWrite }
+};
+
+static const HAPUInt8Characteristic synchronousCharacteristic = {
+    .format = kHAPCharacteristicFormat_UInt8,
+    .iid = 0x101,
+    .characteristicType = &kHAPCharacteristicType_Brightness,
+    .debugDescription = kHAPCharacteristicDebugDescription_Brightness,
+    .properties = { .readable = true },
+    .constraints = { .maximumValue = 100, .stepValue = 1 },
+    .callbacks = { .handleRead = HandleRead }
+};
+
+static const HAPService lightBulbService = {
+    .iid = 0xF0,
+    .serviceType = &kHAPServiceType_LightBulb,
+    .debugDescription = kHAPServiceDebugDescription_LightBulb,
+    .characteristics = (const HAPCharacteristic* const[]) { &deferredCharacteristic, &synchronousCharacteristic, NULL }
+};
+
+HAP_RESULT_USE_CHECK
+static HAPError IdentifyAccessory(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        const HAPAccessoryIdentifyRequest* request HAP_UNUSED,
+        void* _Nullable context HAP_UNUSED) {
+    return kHAPError_None;
+}
+
+static const HAPAccessory accessory = { .aid = 1,
+                                        .category = kHAPAccessoryCategory_Lighting,
+                                        .name = "Acme Test",
+                                        .manufacturer = "Acme",
+                                        .model = "Test1,1",
+                                        .serialNumber = "099DB48E9E28",
+                                        .firmwareVersion = "1",
+                                        .hardwareVersion = "1",
+                                        .services = (const HAPService* const[]) { &accessoryInformationService,
+                                                                                  &hapProtocolInformationService,
+                                                                                  &pairingService,
+                                                                                  &lightBulbService,
+                                                                                  NULL },
+                                        .callbacks = { .identify = IdentifyAccessory } };
+
+static void HandleUpdatedAccessoryServerState(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        void* _Nullable context HAP_UNUSED) {
+}
+
+/**
+ * Receives the next message and checks that it has the expected status line and body.
+ */
+static void ExpectMessage(HAPTestControllerIPSession* session, const char* statusLine, const char* _Nullable body) {
+    static char message[4096];
+    size_t numMessageBytes;
+    HAPError err = HAPTestControllerReceiveIPMessage(session, message, sizeof message, &numMessageBytes);
+    HAPAssert(!err);
+    HAPLogInfo(&kHAPLog_Default, "Received:\n%s", message);
+    HAPAssert(HAPRawBufferAreEqual(message, statusLine, HAPStringGetNumBytes(statusLine)));
+    const char* messageBody = strstr(message, "\r\n\r\n") + 4;
+    HAPAssert(HAPStringAreEqual(messageBody, body ? body : ""));
+}
+
+/**
+ * Checks that no message is pending.
+ */
+static void ExpectNoMessage(HAPTestControllerIPSession* session) {
+    char message[1024];
+    size_t numMessageBytes;
+    HAPError err = HAPTestControllerReceiveIPMessage(session, message, sizeof message, &numMessageBytes);
+    HAPAssert(err == kHAPError_Busy);
+}
+
+/**
+ * Sends a PUT /characteristics request.
+ */
+static void SendWriteRequest(HAPTestControllerIPSession* session, const char* body) {
+    char request[512];
+    HAPError err = HAPStringWithFormat(
+            request,
+            sizeof request,
+            "PUT /characteristics HTTP/1.1\r\n"
+            "Content-Type: application/hap+json\r\n"
+            "Content-Length: %zu\r\n\r\n"
+            "%s",
+            HAPStringGetNumBytes(body),
+            body);
+    HAPAssert(!err);
+    HAPTestControllerSendIPRequest(session, request);
+}
+
+int main() {
+    HAPError err;
+    HAPPlatformCreate();
+
+    // Prepare accessory server storage.
+    static HAPIPSession ipSessions[kHAPIPSessionStorage_DefaultNumElements];
+    static uint8_t ipScratchBuffer[kHAPIPSession_DefaultScratchBufferSize];
+    static HAPIPAccessoryServerStorage ipAccessoryServerStorage = {
+        .sessions = ipSessions,
+        .numSessions = HAPArrayCount(ipSessions),
+        .scratchBuffer = { .bytes = ipScratchBuffer, .numBytes = sizeof ipScratchBuffer },
+    };
+
+    // Initialize accessory server.
+    HAPAccessoryServerCreate(
+            &accessoryServer,
+            &(const HAPAccessoryServerOptions) {
+                    .maxPairings = kHAPPairingStorage_MinElements,
+                    .ip = { .transport = &kHAPAccessoryServerTransport_IP,
+                            .accessoryServerStorage = &ipAccessoryServerStorage } },
+            &platform,
+            &(const HAPAccessoryServerCallbacks) { .handleUpdatedState = HandleUpdatedAccessoryServerState },
+            /* context: */ NULL);
+
+    // Start accessory server.
+    HAPAccessoryServerStart(&accessoryServer, &accessory);
+    HAPPlatformClockAdvance(0);
+    HAPAssert(HAPAccessoryServerGetState(&accessoryServer) == kHAPAccessoryServerState_Running);
+
+    // Pair controller.
+    static HAPTestControllerPairing pairing;
+    HAPTestControllerCreatePairing(platform.keyValueStore, &pairing);
+
+    // Open sessions.
+    static HAPTestControllerIPSession sessionA;
+    static HAPTestControllerIPSession sessionB;
+    err = HAPTestControllerOpenIPSession(HAPNonnull(platform.ip.tcpStreamManager), &pairing, &sessionA);
+    HAPAssert(!err);
+    err = HAPTestControllerOpenIPSession(HAPNonnull(platform.ip.tcpStreamManager), &pairing, &sessionB);
+    HAPAssert(!err);
+
+    // Deferred read. Other sessions are served while the read is pending.
+    test.value = 7;
+    HAPTestControllerSendIPRequest(&sessionA, "GET /characteristics?id=1.256,1.257 HTTP/1.1\r\n\r\n");
+    ExpectNoMessage(&sessionA);
+    HAPAssert(test.numReads == 1);
+    HAPTestControllerSendIPRequest(&sessionB, "GET /characteristics?id=1.257 HTTP/1.1\r\n\r\n");
+    ExpectMessage(&sessionB, "HTTP/1.1 200 OK\r\n", "{\"characteristics\":[{\"aid\":1,\"iid\":257,\"value\":99}]}");
+    HAPPlatformClockAdvance(400 * HAPMillisecond);
+    ExpectNoMessage(&sessionA);
+    HAPAssert(test.numReads == 1);
+    HAPPlatformClockAdvance(100 * HAPMillisecond);
+    ExpectMessage(
+            &sessionA,
+            "HTTP/1.1 200 OK\r\n",
+            "{\"characteristics\":[{\"aid\":1,\"iid\":256,\"value\":7},{\"aid\":1,\"iid\":257,\"value\":99}]}");
+    HAPAssert(test.numReads == 2);
+
+    // Deferred read completed from within the handler of another session's request.
+    test.completeFromOtherHandler = true;
+    HAPTestControllerSendIPRequest(&sessionA, "GET /characteristics?id=1.256 HTTP/1.1\r\n\r\n");
+    ExpectNoMessage(&sessionA);
+    HAPTestControllerSendIPRequest(&sessionB, "GET /characteristics?id=1.257 HTTP/1.1\r\n\r\n");
+    ExpectMessage(&sessionB, "HTTP/1.1 200 OK\r\n", "{\"characteristics\":[{\"aid\":1,\"iid\":257,\"value\":99}]}");
+    ExpectMessage(&sessionA, "HTTP/1.1 200 OK\r\n", "{\"characteristics\":[{\"aid\":1,\"iid\":256,\"value\":7}]}");
+    test.completeFromOtherHandler = false;
+
+    // Deferring a resumed read again is rejected so that the request completes.
+    test.skipFetch = true;
+    test.numRejectedDeferrals = 0;
+    HAPTestControllerSendIPRequest(&sessionA, "GET /characteristics?id=1.256 HTTP/1.1\r\n\r\n");
+    ExpectNoMessage(&sessionA);
+    HAPPlatformClockAdvance(500 * HAPMillisecond);
+    ExpectMessage(&sessionA, "HTTP/1.1 200 OK\r\n", "{\"characteristics\":[{\"aid\":1,\"iid\":256,\"value\":7}]}");
+    HAPAssert(test.numRejectedDeferrals == 1);
+    HAPAssert(!test.isReadPending);
+    test.skipFetch = false;
+
+    // Register for events on both sessions.
+    SendWriteRequest(&sessionA, "{\"characteristics\":[{\"aid\":1,\"iid\":256,\"ev\":true}]}");
+    ExpectMessage(&sessionA, "HTTP/1.1 204 No Content\r\n", NULL);
+    SendWriteRequest(&sessionB, "{\"characteristics\":[{\"aid\":1,\"iid\":256,\"ev\":true}]}");
+    ExpectMessage(&sessionB, "HTTP/1.1 204 No Content\r\n", NULL);
+
+    // Deferred write. The writing controller does not receive an event for its own write.
+    test.numRejectedDeferrals = 0;
+    SendWriteRequest(&sessionA, "{\"characteristics\":[{\"aid\":1,\"iid\":256,\"value\":5}]}");
+    ExpectNoMessage(&sessionA);
+    HAPAssert(test.numWrites == 1);
+    HAPPlatformClockAdvance(300 * HAPMillisecond);
+    ExpectMessage(&sessionA, "HTTP/1.1 204 No Content\r\n", NULL);
+    HAPAssert(test.value == 5);
+    HAPPlatformClockAdvance(1 * HAPSecond);
+    ExpectNoMessage(&sessionA);
+    ExpectMessage(&sessionB, "EVENT/1.0 200 OK\r\n", "{\"characteristics\":[{\"aid\":1,\"iid\":256,\"value\":5}]}");
+    HAPAssert(test.numRejectedDeferrals == 1);
+
+    // Deferred write together with a failing write.
+    SendWriteRequest(
+            &sessionA,
+            "{\"characteristics\":[{\"aid\":1,\"iid\":256,\"value\":42},{\"aid\":1,\"iid\":999,\"value\":1}]}");
+    ExpectNoMessage(&sessionA);
+    HAPPlatformClockAdvance(300 * HAPMillisecond);
+    ExpectMessage(
+            &sessionA,
+            "HTTP/1.1 207 Multi-Status\r\n",
+            "{\"characteristics\":[{\"aid\":1,\"iid\":256,\"status\":0},{\"aid\":1,\"iid\":999,\"status\":-70409}]}");
+    HAPAssert(test.value == 42);
+    HAPPlatformClockAdvance(1 * HAPSecond);
+    ExpectNoMessage(&sessionA);
+    ExpectMessage(&sessionB, "EVENT/1.0 200 OK\r\n", "{\"characteristics\":[{\"aid\":1,\"iid\":256,\"value\":42}]}");
+
+    // Deferred write that is never completed. It times out and the session is served again.
+    test.isStuck = true;
+    SendWriteRequest(&sessionA, "{\"characteristics\":[{\"aid\":1,\"iid\":256,\"value\":9}]}");
+    ExpectNoMessage(&sessionA);
+    HAPAssert(test.isWritePending);
+    HAPPlatformClockAdvance(10 * HAPSecond - 1);
+    ExpectNoMessage(&sessionA);
+    HAPPlatformClockAdvance(1);
+    ExpectMessage(
+            &sessionA,
+            "HTTP/1.1 207 Multi-Status\r\n",
+            "{\"characteristics\":[{\"aid\":1,\"iid\":256,\"status\":-70408}]}");
+
+    // Completion after the timeout is ignored.
+    test.isWritePending = false;
+    HAPAccessoryServerCompleteCharacteristicRequest(&accessoryServer, &test.writeToken, kHAPError_None);
+    HAPPlatformClockAdvance(1 * HAPSecond);
+    ExpectNoMessage(&sessionA);
+    ExpectNoMessage(&sessionB);
+    HAPAssert(test.value == 42);
+
+    // Deferred read that is never completed. The handler still reports busy when the request is handled again.
+    test.numRejectedDeferrals = 0;
+    HAPTestControllerSendIPRequest(&sessionA, "GET /characteristics?id=1.256,1.257 HTTP/1.1\r\n\r\n");
+    ExpectNoMessage(&sessionA);
+    HAPAssert(test.isReadPending);
+    HAPPlatformClockAdvance(10 * HAPSecond - 1);
+    ExpectNoMessage(&sessionA);
+    HAPAssert(test.numRejectedDeferrals == 0);
+    HAPPlatformClockAdvance(1);
+    ExpectMessage(
+            &sessionA,
+            "HTTP/1.1 207 Multi-Status\r\n",
+            "{\"characteristics\":[{\"aid\":1,\"iid\":256,\"status\":-70408},"
+            "{\"aid\":1,\"iid\":257,\"status\":0,\"value\":99}]}");
+    HAPAssert(test.numRejectedDeferrals == 1);
+    test.isReadPending = false;
+    HAPAccessoryServerCompleteCharacteristicRequest(&accessoryServer, &test.readToken, kHAPError_None);
+    test.isStuck = false;
+
+    // The session is served normally afterwards.
+    test.isFetched = true;
+    HAPTestControllerSendIPRequest(&sessionA, "GET /characteristics?id=1.256 HTTP/1.1\r\n\r\n");
+    ExpectMessage(&sessionA, "HTTP/1.1 200 OK\r\n", "{\"characteristics\":[{\"aid\":1,\"iid\":256,\"value\":42}]}");
+
+    // Controller closes the session while the read is pending. Parked sessions do not wait for input, so the closure
+    // is only detected once the request has been resumed.
+    HAPTestControllerSendIPRequest(&sessionA, "GET /characteristics?id=1.256 HTTP/1.1\r\n\r\n");
+    ExpectNoMessage(&sessionA);
+    HAPAssert(test.isReadPending);
+    HAPTestControllerCloseIPSession(&sessionA);
+    HAPPlatformClockAdvance(500 * HAPMillisecond);
+    HAPAssert(!test.isReadPending);
+    HAPPlatformClockAdvance(0);
+    HAPAssert(!test.isFetched);
+
+    // Completion after the accessory server has been stopped is ignored.
+    HAPTestControllerSendIPRequest(&sessionB, "GET /characteristics?id=1.256 HTTP/1.1\r\n\r\n");
+    ExpectNoMessage(&sessionB);
+    HAPAssert(test.isReadPending);
+    HAPAccessoryServerStop(&accessoryServer);
+    HAPPlatformClockAdvance(0);
+    HAPPlatformClockAdvance(500 * HAPMillisecond);
+    HAPAssert(!test.isReadPending);
+    HAPPlatformClockAdvance(0);
+    HAPAssert(HAPAccessoryServerGetState(&accessoryServer) == kHAPAccessoryServerState_Idle);
+
+    return 0;
+}
@@ -0,0 +1,242 @@
+// Copyright (c) 2015-2019 The HomeKit ADK Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the “License”);
+// you may not use this file except in compliance with the License.
+// See [CONTRIBUTORS.md] for the list of HomeKit ADK project authors.
+
+#include <string.h>
+
+#include "HAP+Internal.h"
+#include "HAPPlatform+Init.h"
+
+#include "Harness/HAPTestController.c"
+#include "Harness/TemplateDB.c"
+
+static HAPAccessoryServerRef accessoryServer;
+
+/** Test state. */
+static struct {
+    /** Value of the event characteristic. */
+    uint8_t eventValue;
+
+    /** Token of the pending read of the deferred characteristic, if any. */
+    HAPCharacteristicRequestToken readToken;
+    bool isReadPending;
+} test;
+
+HAP_RESULT_USE_CHECK
+static HAPError HandleDeferredRead(
+        HAPAccessoryServerRef* server,
+        const HAPUInt8CharacteristicReadRequest* request,
+        uint8_t* value,
+        void* _Nullable context HAP_UNUSED) {
+    if (test.isReadPending) {
+        // Resumed read.
+        test.isReadPending = false;
+        *value = 1;
+        return kHAPError_None;
+    }
+    HAPError err = HAPAccessoryServerDeferCharacteristicRequest(server, request->session, &test.readToken);
+    HAPAssert(!err);
+    test.isReadPending = true;
+    return kHAPError_Busy;
+}
+
+HAP_RESULT_USE_CHECK
+static HAPError HandleEventRead(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        const HAPUInt8CharacteristicReadRequest* request HAP_UNUSED,
+        uint8_t* value,
+        void* _Nullable context HAP_UNUSED) {
+    *value = test.eventValue;
+    return kHAPError_None;
+}
+
+static const HAPUInt8Characteristic deferredCharacteristic = {
+    .format = kHAPCharacteristicFormat_UInt8,
+    .iid = 0x100,
+    .characteristicType = &kHAPCharacteristicType_Brightness,
+    .debugDescription = kHAPCharacteristicDebugDescription_Brightness,
+    .properties = { .readable = true },
+    .constraints = { .maximumValue = 100, .stepValue = 1 },
+    .callbacks = { .handleRead = HandleDeferredRead }
+};
+
+static const HAPUInt8Characteristic eventCharacteristic = {
+    .format = kHAPCharacteristicFormat_UInt8,
+    .iid = 0x101,
+    .characteristicType = &kHAPCharacteristicType_Brightness,
+    .debugDescription = kHAPCharacteristicDebugDescription_Brightness,
+    .properties = { .readable = true, .supportsEventNotification = true },
+    .constraints = { .maximumValue = 100, .stepValue = 1 },
+    .callbacks = { .handleRead = HandleEventRead }
+};
+
+static const HAPService lightBulbService = {
+    .iid = 0xF0,
+    .serviceType = &kHAPServiceType_LightBulb,
+    .debugDescription = kHAPServiceDebugDescription_LightBulb,
+    .characteristics = (const HAPCharacteristic* const[]) { &deferredCharacteristic, &eventCharacteristic, NULL }
+};
+
+HAP_RESULT_USE_CHECK
+static HAPError IdentifyAccessory(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        const HAPAccessoryIdentifyRequest* request HAP_UNUSED,
+        void* _Nullable context HAP_UNUSED) {
+    return kHAPError_None;
+}
+
+static const HAPAccessory accessory = { .aid = 1,
+                                        .category = kHAPAccessoryCategory_Lighting,
+                                        .name = "Acme Test",
+                                        .manufacturer = "Acme",
+                                        .model = "Test1,1",
+                                        .serialNumber = "099DB48E9E28",
+                                        .firmwareVersion = "1",
+                                        .hardwareVersion = "1",
+                                        .services = (const HAPService* const[]) { &accessoryInformationService,
+                                                                                  &hapProtocolInformationService,
+                                                                                  &pairingService,
+                                                                                  &lightBulbService,
+                                                                                  NULL },
+                                        .callbacks = { .identify = IdentifyAccessory } };
+
+static void HandleUpdatedAccessoryServerState(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        void* _Nullable context HAP_UNUSED) {
+}
+
+/**
+ * Receives the next message and checks that it has the expected status line and body.
+ */
+static void ExpectMessage(HAPTestControllerIPSession* session, const char* statusLine, const char* _Nullable body) {
+    static char message[4096];
+    size_t numMessageBytes;
+    HAPError err = HAPTestControllerReceiveIPMessage(session, message, sizeof message, &numMessageBytes);
+    HAPAssert(!err);
+    HAPLogInfo(&kHAPLog_Default, "Received:\n%s", message);
+    HAPAssert(HAPRawBufferAreEqual(message, statusLine, HAPStringGetNumBytes(statusLine)));
+    const char* messageBody = strstr(message, "\r\n\r\n") + 4;
+    HAPAssert(HAPStringAreEqual(messageBody, body ? body : ""));
+}
+
+/**
+ * Checks that no message is pending.
+ */
+static void ExpectNoMessage(HAPTestControllerIPSession* session) {
+    char message[1024];
+    size_t numMessageBytes;
+    HAPError err = HAPTestControllerReceiveIPMessage(session, message, sizeof message, &numMessageBytes);
+    HAPAssert(err == kHAPError_Busy);
+}
+
+/**
+ * Changes the value of the event characteristic and raises an event.
+ */
+static void ChangeEventValue(uint8_t value) {
+    test.eventValue = value;
+    HAPAccessoryServerRaiseEvent(&accessoryServer, &eventCharacteristic, &lightBulbService, &accessory);
+}
+
+/**
+ * Completes the pending read of the deferred characteristic.
+ */
+static void CompleteRead(void) {
+    HAPAssert(test.isReadPending);
+    HAPAccessoryServerCompleteCharacteristicRequest(&accessoryServer, &test.readToken, kHAPError_None);
+}
+
+int main() {
+    HAPError err;
+    HAPPlatformCreate();
+
+    // Prepare accessory server storage.
+    static HAPIPSession ipSessions[kHAPIPSessionStorage_DefaultNumElements];
+    static uint8_t ipScratchBuffer[kHAPIPSession_DefaultScratchBufferSize];
+    static HAPIPAccessoryServerStorage ipAccessoryServerStorage = {
+        .sessions = ipSessions,
+        .numSessions = HAPArrayCount(ipSessions),
+        .scratchBuffer = { .bytes = ipScratchBuffer, .numBytes = sizeof ipScratchBuffer },
+    };
+
+    // Initialize accessory server.
+    HAPAccessoryServerCreate(
+            &accessoryServer,
+            &(const HAPAccessoryServerOptions) {
+                    .maxPairings = kHAPPairingStorage_MinElements,
+                    .ip = { .transport = &kHAPAccessoryServerTransport_IP,
+                            .accessoryServerStorage = &ipAccessoryServerStorage } },
+            &platform,
+            &(const HAPAccessoryServerCallbacks) { .handleUpdatedState = HandleUpdatedAccessoryServerState },
+            /* context: */ NULL);
+
+    // Start accessory server.
+    HAPAccessoryServerStart(&accessoryServer, &accessory);
+    HAPPlatformClockAdvance(0);
+    HAPAssert(HAPAccessoryServerGetState(&accessoryServer) == kHAPAccessoryServerState_Running);
+
+    // Pair controller and open session.
+    static HAPTestControllerPairing pairing;
+    HAPTestControllerCreatePairing(platform.keyValueStore, &pairing);
+    static HAPTestControllerIPSession session;
+    err = HAPTestControllerOpenIPSession(HAPNonnull(platform.ip.tcpStreamManager), &pairing, &session);
+    HAPAssert(!err);
+
+    // Register for events.
+    const char* registerRequest =
+            "PUT /characteristics HTTP/1.1\r\n"
+            "Content-Type: application/hap+json\r\n"
+            "Content-Length: 51\r\n\r\n"
+            "{\"characteristics\":[{\"aid\":1,\"iid\":257,\"ev\":true}]}";
+    HAPTestControllerSendIPRequest(&session, registerRequest);
+    ExpectMessage(&session, "HTTP/1.1 204 No Content\r\n", NULL);
+
+    // Events are sent while the session is idle.
+    ChangeEventValue(10);
+    HAPPlatformClockAdvance(1 * HAPSecond);
+    ExpectMessage(&session, "EVENT/1.0 200 OK\r\n", "{\"characteristics\":[{\"aid\":1,\"iid\":257,\"value\":10}]}");
+    ExpectNoMessage(&session);
+
+    // Events are not written while a response is pending. They are flushed after the response has been written.
+    HAPTestControllerSendIPRequest(&session, "GET /characteristics?id=1.256 HTTP/1.1\r\n\r\n");
+    ExpectNoMessage(&session);
+    HAPAssert(test.isReadPending);
+    ChangeEventValue(20);
+    HAPPlatformClockAdvance(2 * HAPSecond);
+    ExpectNoMessage(&session);
+    CompleteRead();
+    ExpectMessage(&session, "HTTP/1.1 200 OK\r\n", "{\"characteristics\":[{\"aid\":1,\"iid\":256,\"value\":1}]}");
+    HAPPlatformClockAdvance(1 * HAPSecond);
+    ExpectMessage(&session, "EVENT/1.0 200 OK\r\n", "{\"characteristics\":[{\"aid\":1,\"iid\":257,\"value\":20}]}");
+    ExpectNoMessage(&session);
+
+    // Pipelined requests. Events that became due while the first response was pending are written between the
+    // responses, before the next buffered request is processed.
+    HAPTestControllerSendIPRequest(
+            &session,
+            "GET /characteristics?id=1.256 HTTP/1.1\r\n\r\n"
+            "GET /characteristics?id=1.257 HTTP/1.1\r\n\r\n");
+    ExpectNoMessage(&session);
+    HAPAssert(test.isReadPending);
+    ChangeEventValue(30);
+    HAPPlatformClockAdvance(2 * HAPSecond);
+    ExpectNoMessage(&session);
+    CompleteRead();
+    ExpectMessage(&session, "HTTP/1.1 200 OK\r\n", "{\"characteristics\":[{\"aid\":1,\"iid\":256,\"value\":1}]}");
+    ExpectMessage(&session, "EVENT/1.0 200 OK\r\n", "{\"characteristics\":[{\"aid\":1,\"iid\":257,\"value\":30}]}");
+    ExpectMessage(&session, "HTTP/1.1 200 OK\r\n", "{\"characteristics\":[{\"aid\":1,\"iid\":257,\"value\":30}]}");
+    ExpectNoMessage(&session);
+
+    // Pipelined requests without pending events are processed back to back.
+    HAPTestControllerSendIPRequest(
+            &session,
+            "GET /characteristics?id=1.257 HTTP/1.1\r\n\r\n"
+            "GET /characteristics?id=1.257 HTTP/1.1\r\n\r\n");
+    ExpectMessage(&session, "HTTP/1.1 200 OK\r\n", "{\"characteristics\":[{\"aid\":1,\"iid\":257,\"value\":30}]}");
+    ExpectMessage(&session, "HTTP/1.1 200 OK\r\n", "{\"characteristics\":[{\"aid\":1,\"iid\":257,\"value\":30}]}");
+    ExpectNoMessage(&session);
+
+    HAPTestControllerCloseIPSession(&session);
+    return 0;
+}
@@ -0,0 +1,295 @@
+// Copyright (c) 2015-2019 The HomeKit ADK Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the “License”);
+// you may not use this file except in compliance with the License.
+// See [CONTRIBUTORS.md] for the list of HomeKit ADK project authors.
+
+#include <string.h>
+
+#include "HAP+Internal.h"
+#include "HAPPlatform+Init.h"
+
+#include "Harness/HAPTestController.c"
+#include "Harness/TemplateDB.c"
+
+static HAPAccessoryServerRef accessoryServer;
+
+/**
+ * Length of the values that fit into a chunk.
+ */
+#define kShortValueLength ((size_t) 400)
+
+/**
+ * Length of the value that does not fit into a chunk.
+ */
+#define kLongValueLength ((size_t) 1100)
+
+/**
+ * Vendor specific characteristic type used for the test characteristics.
+ */
+static const HAPUUID kCharacteristicType_Test = {
+    { 0x8A, 0x3C, 0x2B, 0x6E, 0x1F, 0x4D, 0x4B, 0x9E, 0x9C, 0x55, 0x2D, 0x71, 0xE0, 0x01, 0x7A, 0x51 }
+};
+
+/**
+ * Builds the value of a test characteristic. The value contains a quotation mark to exercise JSON escaping.
+ */
+static void GetValue(char* value, size_t length, char c) {
+    for (size_t i = 0; i < length; i++) {
+        value[i] = c;
+    }
+    value[length / 2] = '"';
+    value[length] = '\0';
+}
+
+HAP_RESULT_USE_CHECK
+static HAPError HandleStringRead(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        const HAPStringCharacteristicReadRequest* request,
+        char* value,
+        size_t maxValueBytes,
+        void* _Nullable context HAP_UNUSED) {
+    size_t length = request->characteristic->iid == 0x1FF ? kLongValueLength : kShortValueLength;
+    if (maxValueBytes <= length) {
+        return kHAPError_OutOfResources;
+    }
+    GetValue(value, length, (char) ('a' + (request->characteristic->iid & 0xF)));
+    return kHAPError_None;
+}
+
+HAP_RESULT_USE_CHECK
+static HAPError HandleUInt8Read(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        const HAPUInt8CharacteristicReadRequest* request HAP_UNUSED,
+        uint8_t* value,
+        void* _Nullable context HAP_UNUSED) {
+    *value = 42;
+    return kHAPError_None;
+}
+
+#define TEST_STRING_CHARACTERISTIC(name, iid_) \
+    static const HAPStringCharacteristic name = { .format = kHAPCharacteristicFormat_String, \
+                                                  .iid = iid_, \
+                                                  .characteristicType = &kCharacteristicType_Test, \
+                                                  .debugDescription = "test", \
+                                                  .properties = { .readable = true }, \
+                                                  .constraints = { .maxLength = 2048 }, \
+                                                  .callbacks = { .handleRead = HandleStringRead } }
+
+TEST_STRING_CHARACTERISTIC(stringCharacteristic0, 0x100);
+TEST_STRING_CHARACTERISTIC(stringCharacteristic1, 0x101);
+TEST_STRING_CHARACTERISTIC(stringCharacteristic2, 0x102);
+TEST_STRING_CHARACTERISTIC(stringCharacteristic3, 0x103);
+TEST_STRING_CHARACTERISTIC(stringCharacteristic4, 0x104);
+TEST_STRING_CHARACTERISTIC(longStringCharacteristic, 0x1FF);
+
+static const HAPUInt8Characteristic uint8Characteristic = {
+    .format = kHAPCharacteristicFormat_UInt8,
+    .iid = 0x105,
+    .characteristicType = &kHAPCharacteristicType_Brightness,
+    .debugDescription = kHAPCharacteristicDebugDescription_Brightness,
+    .properties = { .readable = true },
+    .constraints = { .maximumValue = 100, .stepValue = 1 },
+    .callbacks = { .handleRead = HandleUInt8Read }
+};
+
+static const HAPService testService = {
+    .iid = 0xF0,
+    .serviceType = &kHAPServiceType_LightBulb,
+    .debugDescription = kHAPServiceDebugDescription_LightBulb,
+    .characteristics = (const HAPCharacteristic* const[]) { &stringCharacteristic0,
+                                                            &stringCharacteristic1,
+                                                            &uint8Characteristic,
+                                                            &stringCharacteristic2,
+                                                            &longStringCharacteristic,
+                                                            &stringCharacteristic3,
+                                                            &stringCharacteristic4,
+                                                            NULL }
+};
+
+HAP_RESULT_USE_CHECK
+static HAPError IdentifyAccessory(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        const HAPAccessoryIdentifyRequest* request HAP_UNUSED,
+        void* _Nullable context HAP_UNUSED) {
+    return kHAPError_None;
+}
+
+static const HAPAccessory accessory = { .aid = 1,
+                                        .category = kHAPAccessoryCategory_Lighting,
+                                        .name = "Acme Test",
+                                        .manufacturer = "Acme",
+                                        .model = "Test1,1",
+                                        .serialNumber = "099DB48E9E28",
+                                        .firmwareVersion = "1",
+                                        .hardwareVersion = "1",
+                                        .services = (const HAPService* const[]) { &accessoryInformationService,
+                                                                                  &hapProtocolInformationService,
+                                                                                  &pairingService,
+                                                                                  &testService,
+                                                                                  NULL },
+                                        .callbacks = { .identify = IdentifyAccessory } };
+
+static void HandleUpdatedAccessoryServerState(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        void* _Nullable context HAP_UNUSED) {
+}
+
+/**
+ * Decodes a chunked message body in place and returns the number of chunks.
+ */
+static size_t DecodeChunkedBody(char* body, size_t* numBodyBytes) {
+    const char* p = body;
+    char* q = body;
+    size_t numChunks = 0;
+    for (;;) {
+        size_t chunkLength = 0;
+        for (; *p != '\r'; p++) {
+            char c = (char) (*p | 0x20);
+            HAPAssert((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'));
+            chunkLength = chunkLength * 16 + (size_t)(c <= '9' ? c - '0' : c - 'a' + 10);
+        }
+        HAPAssert(HAPRawBufferAreEqual(p, "\r\n", 2));
+        p += 2;
+        if (!chunkLength) {
+            HAPAssert(HAPStringAreEqual(p, "\r\n"));
+            break;
+        }
+        HAPAssert(chunkLength < kHAPIPSecurityProtocol_MaxFrameBytes);
+        HAPRawBufferCopyBytes(q, p, chunkLength);
+        p += chunkLength;
+        q += chunkLength;
+        HAPAssert(HAPRawBufferAreEqual(p, "\r\n", 2));
+        p += 2;
+        numChunks++;
+    }
+    *q = '\0';
+    *numBodyBytes = (size_t)(q - body);
+    return numChunks;
+}
+
+/**
+ * Checks that brackets and strings of a JSON text are balanced and that the text is a single object.
+ */
+static void ExpectBalancedJSON(const char* json, size_t numJSONBytes) {
+    char stack[16];
+    size_t depth = 0;
+    HAPAssert(numJSONBytes > 0 && json[0] == '{');
+    for (size_t i = 0; i < numJSONBytes; i++) {
+        char c = json[i];
+        if (c == '"') {
+            for (i++; i < numJSONBytes && json[i] != '"'; i++) {
+                if (json[i] == '\\') {
+                    i++;
+                }
+            }
+            HAPAssert(i < numJSONBytes);
+        } else if (c == '{' || c == '[') {
+            HAPAssert(depth < sizeof stack);
+            stack[depth++] = c == '{' ? '}' : ']';
+        } else if (c == '}' || c == ']') {
+            HAPAssert(depth > 0 && stack[depth - 1] == c);
+            depth--;
+            HAPAssert(depth > 0 || i == numJSONBytes - 1);
+        } else {
+            HAPAssert(depth > 0);
+            HAPAssert(c != ',' || (json[i + 1] != ',' && json[i + 1] != '}' && json[i + 1] != ']'));
+        }
+    }
+    HAPAssert(depth == 0);
+}
+
+/**
+ * Checks that the characteristic with the given iid is serialized with the expected value.
+ */
+static void ExpectValue(const char* json, uint64_t iid, const char* value) {
+    char needle[1024];
+    HAPError err = HAPStringWithFormat(needle, sizeof needle, "\"iid\":%llu,", (unsigned long long) iid);
+    HAPAssert(!err);
+    const char* characteristic = strstr(json, needle);
+    HAPAssert(characteristic);
+    const char* end = strchr(characteristic, '}');
+    HAPAssert(end);
+    err = HAPStringWithFormat(needle, sizeof needle, "\"value\":%s", value);
+    HAPAssert(!err);
+    const char* v = strstr(characteristic, needle);
+    HAPAssert(v && v < end);
+}
+
+int main() {
+    HAPError err;
+    HAPPlatformCreate();
+
+    // Prepare accessory server storage.
+    static HAPIPSession ipSessions[kHAPIPSessionStorage_DefaultNumElements];
+    static uint8_t ipScratchBuffer[kHAPIPSession_DefaultScratchBufferSize];
+    static HAPIPAccessoryServerStorage ipAccessoryServerStorage = {
+        .sessions = ipSessions,
+        .numSessions = HAPArrayCount(ipSessions),
+        .scratchBuffer = { .bytes = ipScratchBuffer, .numBytes = sizeof ipScratchBuffer },
+    };
+
+    // Initialize accessory server.
+    HAPAccessoryServerCreate(
+            &accessoryServer,
+            &(const HAPAccessoryServerOptions) {
+                    .maxPairings = kHAPPairingStorage_MinElements,
+                    .ip = { .transport = &kHAPAccessoryServerTransport_IP,
+                            .accessoryServerStorage = &ipAccessoryServerStorage } },
+            &platform,
+            &(const HAPAccessoryServerCallbacks) { .handleUpdatedState = HandleUpdatedAccessoryServerState },
+            /* context: */ NULL);
+
+    // Start accessory server.
+    HAPAccessoryServerStart(&accessoryServer, &accessory);
+    HAPPlatformClockAdvance(0);
+    HAPAssert(HAPAccessoryServerGetState(&accessoryServer) == kHAPAccessoryServerState_Running);
+
+    // Pair controller and open session.
+    static HAPTestControllerPairing pairing;
+    HAPTestControllerCreatePairing(platform.keyValueStore, &pairing);
+    static HAPTestControllerIPSession session;
+    err = HAPTestControllerOpenIPSession(HAPNonnull(platform.ip.tcpStreamManager), &pairing, &session);
+    HAPAssert(!err);
+
+    // Request the attribute database. It spans multiple chunks.
+    HAPTestControllerSendIPRequest(&session, "GET /accessories HTTP/1.1\r\n\r\n");
+    static char message[16384];
+    size_t numMessageBytes;
+    err = HAPTestControllerReceiveIPMessage(&session, message, sizeof message, &numMessageBytes);
+    HAPAssert(!err);
+    const char* statusLine = "HTTP/1.1 200 OK\r\n";
+    HAPAssert(HAPRawBufferAreEqual(message, statusLine, HAPStringGetNumBytes(statusLine)));
+    HAPAssert(strstr(message, "Transfer-Encoding: chunked\r\n"));
+    char* body = strstr(message, "\r\n\r\n");
+    HAPAssert(body);
+    body += 4;
+    size_t numBodyBytes;
+    size_t numChunks = DecodeChunkedBody(body, &numBodyBytes);
+    HAPLogInfo(&kHAPLog_Default, "Received %zu chunks:\n%s", numChunks, body);
+    HAPAssert(numChunks > 4);
+    HAPAssert(HAPRawBufferAreEqual(body, "{\"accessories\":[{\"aid\":1,", 25));
+    ExpectBalancedJSON(body, numBodyBytes);
+
+    // Values that fit into a chunk are sent intact, even if they did not fit into the rest of the previous chunk.
+    for (uint64_t iid = 0x100; iid <= 0x104; iid++) {
+        char value[kShortValueLength + 1];
+        GetValue(value, kShortValueLength, (char) ('a' + (iid & 0xF)));
+        char escapedValue[2 * kShortValueLength + 3];
+        escapedValue[0] = '"';
+        size_t numEscapedBytes = kShortValueLength;
+        HAPRawBufferCopyBytes(&escapedValue[1], value, numEscapedBytes);
+        err = HAPJSONUtilsEscapeStringData(&escapedValue[1], sizeof escapedValue - 3, &numEscapedBytes);
+        HAPAssert(!err);
+        escapedValue[1 + numEscapedBytes] = '"';
+        escapedValue[2 + numEscapedBytes] = '\0';
+        ExpectValue(body, iid, escapedValue);
+    }
+    ExpectValue(body, 0x105, "42");
+
+    // Values that do not fit into a chunk are sent as null.
+    ExpectValue(body, 0x1FF, "null");
+
+    HAPTestControllerCloseIPSession(&session);
+    return 0;
+}
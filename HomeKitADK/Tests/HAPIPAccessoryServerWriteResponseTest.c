@@ -0,0 +1,369 @@
+// Copyright (c) 2015-2019 The HomeKit ADK Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the “License”);
+// you may not use this file except in compliance with the License.
+// See [CONTRIBUTORS.md] for the list of HomeKit ADK project authors.
+
+#include <string.h>
+
+#include "HAP+Internal.h"
+#include "HAPPlatform+Init.h"
+
+#include "Harness/HAPTestController.c"
+#include "Harness/TemplateDB.c"
+
+static HAPAccessoryServerRef accessoryServer;
+
+/**
+ * Maximum length of the string value.
+ */
+#define kMaxStringLength ((size_t) 256)
+
+/**
+ * Characters the string value is built from, including characters that must be escaped.
+ */
+static const char kStringCharacters[] = { 'a', '"', 'b', '\\', 'c', '\n', 'd', '\x01', 'e', '/' };
+
+/**
+ * Escaped representation of each character of kStringCharacters.
+ */
+static const char* const kEscapedStringCharacters[] = {
+    "a", "\\\"", "b", "\\\\", "c", "\\n", "d", "\\u0001", "e", "/"
+};
+
+/** Length of the string value returned by the read handler. */
+static size_t stringLength;
+
+/**
+ * Builds the string value of the given length.
+ */
+static void GetStringValue(char* value, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        value[i] = kStringCharacters[i % sizeof kStringCharacters];
+    }
+    value[length] = '\0';
+}
+
+HAP_RESULT_USE_CHECK
+static HAPError HandleStringRead(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        const HAPStringCharacteristicReadRequest* request HAP_UNUSED,
+        char* value,
+        size_t maxValueBytes,
+        void* _Nullable context HAP_UNUSED) {
+    HAPAssert(maxValueBytes > stringLength);
+    GetStringValue(value, stringLength);
+    return kHAPError_None;
+}
+
+HAP_RESULT_USE_CHECK
+static HAPError HandleStringWrite(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        const HAPStringCharacteristicWriteRequest* request HAP_UNUSED,
+        const char* value HAP_UNUSED,
+        void* _Nullable context HAP_UNUSED) {
+    return kHAPError_None;
+}
+
+HAP_RESULT_USE_CHECK
+static HAPError HandleUInt32Read(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        const HAPUInt32CharacteristicReadRequest* request HAP_UNUSED,
+        uint32_t* value,
+        void* _Nullable context HAP_UNUSED) {
+    *value = 4000000000;
+    return kHAPError_None;
+}
+
+HAP_RESULT_USE_CHECK
+static HAPError HandleUInt32Write(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        const HAPUInt32CharacteristicWriteRequest* request HAP_UNUSED,
+        uint32_t value HAP_UNUSED,
+        void* _Nullable context HAP_UNUSED) {
+    return kHAPError_None;
+}
+
+HAP_RESULT_USE_CHECK
+static HAPError HandleIntRead(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        const HAPIntCharacteristicReadRequest* request HAP_UNUSED,
+        int32_t* value,
+        void* _Nullable context HAP_UNUSED) {
+    *value = -42;
+    return kHAPError_None;
+}
+
+HAP_RESULT_USE_CHECK
+static HAPError HandleIntWrite(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        const HAPIntCharacteristicWriteRequest* request HAP_UNUSED,
+        int32_t value HAP_UNUSED,
+        void* _Nullable context HAP_UNUSED) {
+    return kHAPError_None;
+}
+
+HAP_RESULT_USE_CHECK
+static HAPError HandleFloatRead(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        const HAPFloatCharacteristicReadRequest* request HAP_UNUSED,
+        float* value,
+        void* _Nullable context HAP_UNUSED) {
+    *value = 21.5f;
+    return kHAPError_None;
+}
+
+HAP_RESULT_USE_CHECK
+static HAPError HandleFloatWrite(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        const HAPFloatCharacteristicWriteRequest* request HAP_UNUSED,
+        float value HAP_UNUSED,
+        void* _Nullable context HAP_UNUSED) {
+    return kHAPError_None;
+}
+
+HAP_RESULT_USE_CHECK
+static HAPError HandleBoolRead(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        const HAPBoolCharacteristicReadRequest* request HAP_UNUSED,
+        bool* value,
+        void* _Nullable context HAP_UNUSED) {
+    *value = true;
+    return kHAPError_None;
+}
+
+HAP_RESULT_USE_CHECK
+static HAPError HandleBoolWrite(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        const HAPBoolCharacteristicWriteRequest* request HAP_UNUSED,
+        bool value HAP_UNUSED,
+        void* _Nullable context HAP_UNUSED) {
+    return kHAPError_None;
+}
+
+/**
+ * Vendor specific characteristic type used for the test characteristics.
+ */
+static const HAPUUID kCharacteristicType_Test = {
+    { 0x3E, 0x7B, 0x51, 0x0C, 0x94, 0x2F, 0x4E, 0x61, 0xA8, 0x17, 0x6D, 0xC2, 0x05, 0xB9, 0x48, 0xF3 }
+};
+
+#define TEST_PROPERTIES \
+    { .readable = true, .writable = true, .ip = { .supportsWriteResponse = true } }
+
+static const HAPStringCharacteristic stringCharacteristic = {
+    .format = kHAPCharacteristicFormat_String,
+    .iid = 0x100,
+    .characteristicType = &kCharacteristicType_Test,
+    .debugDescription = "string",
+    .properties = TEST_PROPERTIES,
+    .constraints = { .maxLength = kMaxStringLength },
+    .callbacks = { .handleRead = HandleStringRead, .handleWrite = HandleStringWrite }
+};
+
+static const HAPUInt32Characteristic uint32Characteristic = {
+    .format = kHAPCharacteristicFormat_UInt32,
+    .iid = 0x101,
+    .characteristicType = &kCharacteristicType_Test,
+    .debugDescription = "uint32",
+    .properties = TEST_PROPERTIES,
+    .constraints = { .maximumValue = UINT32_MAX, .stepValue = 1 },
+    .callbacks = { .handleRead = HandleUInt32Read, .handleWrite = HandleUInt32Write }
+};
+
+static const HAPIntCharacteristic intCharacteristic = {
+    .format = kHAPCharacteristicFormat_Int,
+    .iid = 0x102,
+    .characteristicType = &kCharacteristicType_Test,
+    .debugDescription = "int",
+    .properties = TEST_PROPERTIES,
+    .constraints = { .minimumValue = -100, .maximumValue = 100, .stepValue = 1 },
+    .callbacks = { .handleRead = HandleIntRead, .handleWrite = HandleIntWrite }
+};
+
+static const HAPFloatCharacteristic floatCharacteristic = {
+    .format = kHAPCharacteristicFormat_Float,
+    .iid = 0x103,
+    .characteristicType = &kCharacteristicType_Test,
+    .debugDescription = "float",
+    .properties = TEST_PROPERTIES,
+    .constraints = { .minimumValue = 0, .maximumValue = 100, .stepValue = 0.5f },
+    .callbacks = { .handleRead = HandleFloatRead, .handleWrite = HandleFloatWrite }
+};
+
+static const HAPBoolCharacteristic boolCharacteristic = {
+    .format = kHAPCharacteristicFormat_Bool,
+    .iid = 0x104,
+    .characteristicType = &kCharacteristicType_Test,
+    .debugDescription = "bool",
+    .properties = TEST_PROPERTIES,
+    .callbacks = { .handleRead = HandleBoolRead, .handleWrite = HandleBoolWrite }
+};
+
+static const HAPService testService = {
+    .iid = 0xF0,
+    .serviceType = &kHAPServiceType_LightBulb,
+    .debugDescription = kHAPServiceDebugDescription_LightBulb,
+    .characteristics = (const HAPCharacteristic* const[]) { &stringCharacteristic,
+                                                            &uint32Characteristic,
+                                                            &intCharacteristic,
+                                                            &floatCharacteristic,
+                                                            &boolCharacteristic,
+                                                            NULL }
+};
+
+HAP_RESULT_USE_CHECK
+static HAPError IdentifyAccessory(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        const HAPAccessoryIdentifyRequest* request HAP_UNUSED,
+        void* _Nullable context HAP_UNUSED) {
+    return kHAPError_None;
+}
+
+static const HAPAccessory accessory = { .aid = 1,
+                                        .category = kHAPAccessoryCategory_Lighting,
+                                        .name = "Acme Test",
+                                        .manufacturer = "Acme",
+                                        .model = "Test1,1",
+                                        .serialNumber = "099DB48E9E28",
+                                        .firmwareVersion = "1",
+                                        .hardwareVersion = "1",
+                                        .services = (const HAPService* const[]) { &accessoryInformationService,
+                                                                                  &hapProtocolInformationService,
+                                                                                  &pairingService,
+                                                                                  &testService,
+                                                                                  NULL },
+                                        .callbacks = { .identify = IdentifyAccessory } };
+
+static void HandleUpdatedAccessoryServerState(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        void* _Nullable context HAP_UNUSED) {
+}
+
+/**
+ * Sends a PUT /characteristics request.
+ */
+static void SendWriteRequest(HAPTestControllerIPSession* session, const char* body) {
+    char request[1024];
+    HAPError err = HAPStringWithFormat(
+            request,
+            sizeof request,
+            "PUT /characteristics HTTP/1.1\r\n"
+            "Content-Type: application/hap+json\r\n"
+            "Content-Length: %zu\r\n\r\n"
+            "%s",
+            HAPStringGetNumBytes(body),
+            body);
+    HAPAssert(!err);
+    HAPTestControllerSendIPRequest(session, request);
+}
+
+/**
+ * Appends a string to a buffer.
+ */
+static void Append(char* bytes, size_t maxBytes, size_t* numBytes, const char* string) {
+    size_t numStringBytes = HAPStringGetNumBytes(string);
+    HAPAssert(maxBytes - *numBytes > numStringBytes);
+    HAPRawBufferCopyBytes(&bytes[*numBytes], string, numStringBytes);
+    *numBytes += numStringBytes;
+    bytes[*numBytes] = '\0';
+}
+
+/**
+ * Builds the expected response to the write request for a string value of the given length.
+ */
+static void GetExpectedResponse(char* bytes, size_t maxBytes, size_t length) {
+    static char body[2048];
+    size_t numBodyBytes = 0;
+    Append(body, sizeof body, &numBodyBytes, "{\"characteristics\":[{\"aid\":1,\"iid\":256,\"status\":0,\"value\":\"");
+    for (size_t i = 0; i < length; i++) {
+        Append(body, sizeof body, &numBodyBytes, kEscapedStringCharacters[i % sizeof kStringCharacters]);
+    }
+    Append(body,
+           sizeof body,
+           &numBodyBytes,
+           "\"},"
+           "{\"aid\":1,\"iid\":257,\"status\":0,\"value\":4000000000},"
+           "{\"aid\":1,\"iid\":258,\"status\":0,\"value\":-42},"
+           "{\"aid\":1,\"iid\":259,\"status\":0,\"value\":21.5},"
+           "{\"aid\":1,\"iid\":260,\"status\":0,\"value\":1}]}");
+    HAPError err = HAPStringWithFormat(
+            bytes,
+            maxBytes,
+            "HTTP/1.1 207 Multi-Status\r\n"
+            "Content-Type: application/hap+json\r\n"
+            "Content-Length: %zu\r\n\r\n"
+            "%s",
+            numBodyBytes,
+            body);
+    HAPAssert(!err);
+}
+
+int main() {
+    HAPError err;
+    HAPPlatformCreate();
+
+    // Prepare accessory server storage.
+    static HAPIPSession ipSessions[kHAPIPSessionStorage_DefaultNumElements];
+    static uint8_t ipScratchBuffer[kHAPIPSession_DefaultScratchBufferSize];
+    static HAPIPAccessoryServerStorage ipAccessoryServerStorage = {
+        .sessions = ipSessions,
+        .numSessions = HAPArrayCount(ipSessions),
+        .scratchBuffer = { .bytes = ipScratchBuffer, .numBytes = sizeof ipScratchBuffer },
+    };
+
+    // Initialize accessory server.
+    HAPAccessoryServerCreate(
+            &accessoryServer,
+            &(const HAPAccessoryServerOptions) {
+                    .maxPairings = kHAPPairingStorage_MinElements,
+                    .ip = { .transport = &kHAPAccessoryServerTransport_IP,
+                            .accessoryServerStorage = &ipAccessoryServerStorage } },
+            &platform,
+            &(const HAPAccessoryServerCallbacks) { .handleUpdatedState = HandleUpdatedAccessoryServerState },
+            /* context: */ NULL);
+
+    // Start accessory server.
+    HAPAccessoryServerStart(&accessoryServer, &accessory);
+    HAPPlatformClockAdvance(0);
+    HAPAssert(HAPAccessoryServerGetState(&accessoryServer) == kHAPAccessoryServerState_Running);
+
+    // Pair controller and open session.
+    static HAPTestControllerPairing pairing;
+    HAPTestControllerCreatePairing(platform.keyValueStore, &pairing);
+    static HAPTestControllerIPSession session;
+    err = HAPTestControllerOpenIPSession(HAPNonnull(platform.ip.tcpStreamManager), &pairing, &session);
+    HAPAssert(!err);
+
+    // Write with write response for every string length. The outbound buffer grows in steps of 64 bytes, so the
+    // escaped value and the inserted header end at every offset relative to its capacity.
+    for (stringLength = 0; stringLength < kMaxStringLength; stringLength++) {
+        SendWriteRequest(
+                &session,
+                "{\"characteristics\":["
+                "{\"aid\":1,\"iid\":256,\"value\":\"x\",\"r\":true},"
+                "{\"aid\":1,\"iid\":257,\"value\":1,\"r\":true},"
+                "{\"aid\":1,\"iid\":258,\"value\":1,\"r\":true},"
+                "{\"aid\":1,\"iid\":259,\"value\":1,\"r\":true},"
+                "{\"aid\":1,\"iid\":260,\"value\":true,\"r\":true}]}");
+        static char message[4096];
+        size_t numMessageBytes;
+        err = HAPTestControllerReceiveIPMessage(&session, message, sizeof message, &numMessageBytes);
+        HAPAssert(!err);
+        static char expectedMessage[4096];
+        GetExpectedResponse(expectedMessage, sizeof expectedMessage, stringLength);
+        if (!HAPStringAreEqual(message, expectedMessage)) {
+            HAPLogError(
+                    &kHAPLog_Default,
+                    "Unexpected response for length %zu:\n%s\nExpected:\n%s",
+                    stringLength,
+                    message,
+                    expectedMessage);
+            HAPFatalError();
+        }
+        HAPAssert(numMessageBytes == HAPStringGetNumBytes(expectedMessage));
+    }
+
+    HAPTestControllerCloseIPSession(&session);
+    return 0;
+}
@@ -0,0 +1,48 @@
+// Copyright (c) 2015-2019 The HomeKit ADK Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the “License”);
+// you may not use this file except in compliance with the License.
+// See [CONTRIBUTORS.md] for the list of HomeKit ADK project authors.
+
+#include "HAP+Internal.h"
+
+int main() {
+    // Discarding a processed request preserves the pipelined data that follows it.
+    {
+        char bytes[64];
+        HAPIPByteBuffer buffer = { .capacity = sizeof bytes, .position = 0, .limit = sizeof bytes, .data = bytes };
+
+        // Decrypted part: first request, start of second request. Undecrypted part: remainder of second request.
+        static const char request[] = "GET /accessories HTTP/1.1\r\n\r\n";
+        static const char pipelined[] = "GET /";
+        static const char undecrypted[] = "<frame>";
+        HAPRawBufferCopyBytes(&bytes[0], request, sizeof request - 1);
+        HAPRawBufferCopyBytes(&bytes[sizeof request - 1], pipelined, sizeof pipelined - 1);
+        HAPRawBufferCopyBytes(
+                &bytes[sizeof request - 1 + sizeof pipelined - 1], undecrypted, sizeof undecrypted - 1);
+        buffer.position = sizeof request - 1 + sizeof pipelined - 1 + sizeof undecrypted - 1;
+        buffer.limit = buffer.position;
+
+        HAPIPByteBufferShiftLeft(&buffer, sizeof request - 1);
+        HAPAssert(buffer.position == sizeof pipelined - 1 + sizeof undecrypted - 1);
+        HAPAssert(buffer.limit == buffer.position);
+        HAPAssert(HAPRawBufferAreEqual(&bytes[0], pipelined, sizeof pipelined - 1));
+        HAPAssert(HAPRawBufferAreEqual(&bytes[sizeof pipelined - 1], undecrypted, sizeof undecrypted - 1));
+    }
+
+    // Only the bytes before position are moved.
+    {
+        char bytes[16];
+        HAPIPByteBuffer buffer = { .capacity = sizeof bytes, .position = 0, .limit = sizeof bytes, .data = bytes };
+
+        HAPRawBufferCopyBytes(bytes, "abcdefghijklmnop", sizeof bytes);
+        buffer.position = 5;
+
+        HAPIPByteBufferShiftLeft(&buffer, 3);
+        HAPAssert(buffer.position == 2);
+        HAPAssert(buffer.limit == sizeof bytes - 3);
+        HAPAssert(HAPRawBufferAreEqual(bytes, "decdefghijklmnop", sizeof bytes));
+    }
+
+    return 0;
+}
@@ -0,0 +1,113 @@
+// Copyright (c) 2015-2019 The HomeKit ADK Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the “License”);
+// you may not use this file except in compliance with the License.
+// See [CONTRIBUTORS.md] for the list of HomeKit ADK project authors.
+
+#include "HAP+Internal.h"
+
+/**
+ * Sets up a pair of secured sessions. Data encrypted by the accessory session is decrypted by the controller session.
+ */
+static void CreateSessions(HAPSessionRef* accessorySession_, HAPSessionRef* controllerSession_) {
+    HAPSession* accessorySession = (HAPSession*) accessorySession_;
+    HAPSession* controllerSession = (HAPSession*) controllerSession_;
+    HAPRawBufferZero(accessorySession, sizeof *accessorySession);
+    HAPRawBufferZero(controllerSession, sizeof *controllerSession);
+
+    HAPSessionChannelState* accessoryToController = &accessorySession->hap.accessoryToController.controlChannel;
+    HAPSessionChannelState* controllerToAccessory = &accessorySession->hap.controllerToAccessory.controlChannel;
+    for (size_t i = 0; i < sizeof accessoryToController->key.bytes; i++) {
+        accessoryToController->key.bytes[i] = (uint8_t) i;
+        controllerToAccessory->key.bytes[i] = (uint8_t)(0xFF - i);
+    }
+    accessorySession->hap.active = true;
+
+    controllerSession->hap.controllerToAccessory.controlChannel = *accessoryToController;
+    controllerSession->hap.accessoryToController.controlChannel = *controllerToAccessory;
+    controllerSession->hap.active = true;
+}
+
+/**
+ * Encrypts a message of a given length and decrypts it again.
+ */
+static void TestRoundTrip(size_t numPlaintextBytes) {
+    static HAPAccessoryServerRef server;
+    static HAPSessionRef accessorySession;
+    static HAPSessionRef controllerSession;
+    CreateSessions(&accessorySession, &controllerSession);
+
+    static uint8_t plaintext[4 * kHAPIPSecurityProtocol_MaxFrameBytes];
+    HAPAssert(numPlaintextBytes <= sizeof plaintext);
+    for (size_t i = 0; i < numPlaintextBytes; i++) {
+        plaintext[i] = (uint8_t)(i * 7 + 3);
+    }
+
+    // Encrypt behind a prefix that must be left intact.
+    static char bytes[sizeof plaintext + 4 * (2 + CHACHA20_POLY1305_TAG_BYTES) + 3];
+    HAPRawBufferCopyBytes(bytes, "abc", 3);
+    HAPRawBufferCopyBytes(&bytes[3], plaintext, numPlaintextBytes);
+    HAPIPByteBuffer buffer = { .capacity = sizeof bytes, .position = 3, .limit = 3 + numPlaintextBytes, .data = bytes };
+    HAPIPSecurityProtocolEncryptData(&server, &accessorySession, &buffer);
+    size_t numEncryptedBytes = HAPIPSecurityProtocolGetNumEncryptedBytes(numPlaintextBytes);
+    HAPAssert(buffer.position == 3);
+    HAPAssert(buffer.limit == 3 + numEncryptedBytes);
+    HAPAssert(HAPRawBufferAreEqual(bytes, "abc", 3));
+
+    // Check frame layout.
+    size_t numFrames = 0;
+    for (size_t offset = 0; offset < numEncryptedBytes; numFrames++) {
+        size_t numFrameBytes = HAPReadLittleUInt16(&bytes[3 + offset]);
+        size_t numRemainingBytes = numPlaintextBytes - numFrames * kHAPIPSecurityProtocol_MaxFrameBytes;
+        HAPAssert(
+                numFrameBytes == (numRemainingBytes < kHAPIPSecurityProtocol_MaxFrameBytes ?
+                                          numRemainingBytes :
+                                          kHAPIPSecurityProtocol_MaxFrameBytes));
+        offset += 2 + numFrameBytes + CHACHA20_POLY1305_TAG_BYTES;
+        HAPAssert(offset <= numEncryptedBytes);
+    }
+    HAPAssert(numFrames == (numPlaintextBytes + kHAPIPSecurityProtocol_MaxFrameBytes - 1) /
+                                   kHAPIPSecurityProtocol_MaxFrameBytes);
+    HAPAssert(((HAPSession*) &accessorySession)->hap.accessoryToController.controlChannel.nonce == numFrames);
+
+    // Decrypt.
+    HAPError err = HAPIPSecurityProtocolDecryptData(&server, &controllerSession, &buffer);
+    HAPAssert(!err);
+    HAPAssert(buffer.position == 3 + numPlaintextBytes);
+    HAPAssert(buffer.limit == 3 + numPlaintextBytes);
+    HAPAssert(HAPRawBufferAreEqual(bytes, "abc", 3));
+    HAPAssert(HAPRawBufferAreEqual(&bytes[3], plaintext, numPlaintextBytes));
+    HAPAssert(((HAPSession*) &controllerSession)->hap.controllerToAccessory.controlChannel.nonce == numFrames);
+}
+
+int main() {
+    // Single partial frame.
+    TestRoundTrip(1);
+
+    // Single full frame.
+    TestRoundTrip(kHAPIPSecurityProtocol_MaxFrameBytes);
+
+    // More than two frames with a partial last frame.
+    TestRoundTrip(3 * kHAPIPSecurityProtocol_MaxFrameBytes + 17);
+
+    // Multiple full frames.
+    TestRoundTrip(4 * kHAPIPSecurityProtocol_MaxFrameBytes);
+
+    // Tampered data is rejected.
+    {
+        static HAPAccessoryServerRef server;
+        static HAPSessionRef accessorySession;
+        static HAPSessionRef controllerSession;
+        CreateSessions(&accessorySession, &controllerSession);
+
+        char bytes[64 + 2 + CHACHA20_POLY1305_TAG_BYTES];
+        HAPRawBufferZero(bytes, sizeof bytes);
+        HAPIPByteBuffer buffer = { .capacity = sizeof bytes, .position = 0, .limit = 64, .data = bytes };
+        HAPIPSecurityProtocolEncryptData(&server, &accessorySession, &buffer);
+        bytes[10] ^= 0x01;
+        HAPError err = HAPIPSecurityProtocolDecryptData(&server, &controllerSession, &buffer);
+        HAPAssert(err == kHAPError_InvalidData);
+    }
+
+    return 0;
+}
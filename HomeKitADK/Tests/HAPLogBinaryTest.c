@@ -0,0 +1,189 @@
+// Copyright (c) 2015-2019 The HomeKit ADK Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the “License”);
+// you may not use this file except in compliance with the License.
+// See [CONTRIBUTORS.md] for the list of HomeKit ADK project authors.
+
+// Binary logging is compiled into this test, independently of the configuration of the HAP library.
+// A small ring buffer is used so that it wraps around after a few messages.
+#define HAP_LOG_BINARY              1
+#define HAP_LOG_BINARY_BUFFER_BYTES 1024
+#include "../PAL/HAPLog+Binary.c"
+
+#include <string.h>
+
+#include "HAP+Internal.h"
+#include "HAPPlatform+Init.h"
+
+#include "../Tools/LogDecoder/HAPLogDecoder.c"
+
+static const HAPLogObject logObject = { .subsystem = kHAP_LogSubsystem, .category = "Test" };
+static const HAPLogObject defaultLogObject = { .subsystem = kHAP_LogSubsystem };
+
+static const char kFormat_AllTypes[] = "s=%s d=%d u=%u x=0x%02X c=%c g=%g z=%zu ld=%ld %%";
+static const char kFormat_String[] = "%s";
+static const char kFormat_Counter[] = "Message %u.";
+
+/**
+ * Resolves a format string or log category recorded by this process.
+ */
+static const char* _Nullable ResolveString(void* _Nullable context HAP_UNUSED, uint64_t address) {
+    const char* const strings[] = { kFormat_AllTypes, kFormat_String, kFormat_Counter, logObject.category };
+    for (size_t i = 0; i < HAPArrayCount(strings); i++) {
+        if ((uint64_t)(uintptr_t) strings[i] == address) {
+            return strings[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Records a message in the binary log.
+ */
+HAP_PRINTFLIKE(5, 6)
+static void Capture(
+        const HAPLogObject* log,
+        const void* _Nullable bufferBytes,
+        size_t numBufferBytes,
+        HAPLogType type,
+        const char* format,
+        ...) {
+    va_list args;
+    va_start(args, format);
+    HAPLogBinaryCaptureInternal(log, bufferBytes, numBufferBytes, type, format, args);
+    va_end(args);
+}
+
+/**
+ * Retrieves the binary log and decodes it.
+ *
+ * @param[out] numLogBytes          Length of the binary log.
+ *
+ * @return Decoded binary log.
+ */
+static const char* Decode(size_t* numLogBytes) {
+    static uint8_t bytes[kHAPLogBinary_MaxBytes];
+    HAPError err = HAPLogBinaryGetContents(bytes, sizeof bytes, numLogBytes);
+    HAPAssert(!err);
+
+    FILE* file = tmpfile();
+    HAPAssert(file);
+    bool decoded = HAPLogDecoderDecode(bytes, *numLogBytes, ResolveString, /* context: */ NULL, file);
+    HAPAssert(decoded);
+
+    static char output[8192];
+    rewind(file);
+    size_t numOutputBytes = fread(output, 1, sizeof output - 1, file);
+    HAPAssert(!ferror(file) && numOutputBytes < sizeof output - 1);
+    output[numOutputBytes] = '\0';
+    fclose(file);
+    return output;
+}
+
+int main() {
+    HAPError err;
+    HAPPlatformCreate();
+    HAPPlatformClockAdvance(1234);
+
+    // All argument types are recorded and decoded. Logged buffers are decoded as hex dumps.
+    {
+        static const uint8_t buffer[] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09,
+                                          0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10, 0x11 };
+        Capture(&logObject,
+                buffer,
+                sizeof buffer,
+                kHAPLogType_Error,
+                kFormat_AllTypes,
+                "abc",
+                -5,
+                42U,
+                0xABU,
+                'x',
+                1.5,
+                (size_t) 7,
+                -100000L);
+        Capture(&defaultLogObject, NULL, 0, kHAPLogType_Info, kFormat_String, "No category.");
+        size_t numLogBytes;
+        const char* output = Decode(&numLogBytes);
+        HAPLogInfo(&kHAPLog_Default, "Decoded:\n%s", output);
+        HAPAssert(HAPStringAreEqual(
+                output,
+                "1.234\tError  \tTest\ts=abc d=-5 u=42 x=0xAB c=x g=1.5 z=7 ld=-100000 %\n"
+                "\t0000: 01 02 03 04 05 06 07 08 09 0a 0b 0c 0d 0e 0f 10\n"
+                "\t0010: 11\n"
+                "1.234\tInfo   \tDefault\tNo category.\n"));
+        HAPLogBinaryClear();
+    }
+
+    // Long strings and buffers are truncated.
+    {
+        char string[kHAPLogBinary_MaxStringBytes + 16];
+        HAPRawBufferZero(string, sizeof string);
+        for (size_t i = 0; i < sizeof string - 1; i++) {
+            string[i] = 'a';
+        }
+        uint8_t buffer[kHAPLogBinary_MaxBufferBytes + 16];
+        for (size_t i = 0; i < sizeof buffer; i++) {
+            buffer[i] = 0xEE;
+        }
+        Capture(&logObject, buffer, sizeof buffer, kHAPLogType_Debug, kFormat_String, string);
+        size_t numLogBytes;
+        const char* output = Decode(&numLogBytes);
+        const char* message = strstr(output, "\tTest\t");
+        HAPAssert(message);
+        message += sizeof "\tTest\t" - 1;
+        HAPAssert(strspn(message, "a") == kHAPLogBinary_MaxStringBytes);
+        HAPAssert(message[kHAPLogBinary_MaxStringBytes] == '\n');
+        size_t numDumpedBytes = 0;
+        for (const char* c = strstr(output, " ee"); c; c = strstr(c + 1, " ee")) {
+            numDumpedBytes++;
+        }
+        HAPAssert(numDumpedBytes == kHAPLogBinary_MaxBufferBytes);
+        HAPLogBinaryClear();
+    }
+
+    // When the ring buffer is full, the oldest messages are evicted. The retained messages wrap around the end of
+    // the ring buffer and are returned oldest first.
+    {
+        const size_t numMessageBytes = kHAPLogBinary_NumMessageHeaderBytes + 1 + sizeof(uint64_t) + sizeof(uint16_t);
+        const size_t numRetainedMessages = HAP_LOG_BINARY_BUFFER_BYTES / numMessageBytes;
+        const size_t numMessages = 100;
+        for (size_t i = 0; i < numMessages; i++) {
+            Capture(&logObject, NULL, 0, kHAPLogType_Default, kFormat_Counter, (unsigned int) i);
+        }
+        HAPAssert(logBuffer.numBytes == numRetainedMessages * numMessageBytes);
+        HAPAssert(logBuffer.start + logBuffer.numBytes > sizeof logBuffer.bytes);
+
+        size_t numLogBytes;
+        const char* output = Decode(&numLogBytes);
+        HAPAssert(numLogBytes == kHAPLogBinary_NumHeaderBytes + numRetainedMessages * numMessageBytes);
+        for (size_t i = numMessages - numRetainedMessages; i < numMessages; i++) {
+            char expectedLine[64];
+            err = HAPStringWithFormat(expectedLine, sizeof expectedLine, "1.234\tDefault\tTest\tMessage %zu.\n", i);
+            HAPAssert(!err);
+            size_t numExpectedLineBytes = HAPStringGetNumBytes(expectedLine);
+            HAPAssert(HAPRawBufferAreEqual(output, expectedLine, numExpectedLineBytes));
+            output += numExpectedLineBytes;
+        }
+        HAPAssert(!*output);
+    }
+
+    // The binary log is not returned if it does not fit.
+    {
+        uint8_t bytes[kHAPLogBinary_NumHeaderBytes + 1];
+        size_t numBytes;
+        err = HAPLogBinaryGetContents(bytes, sizeof bytes, &numBytes);
+        HAPAssert(err == kHAPError_OutOfResources);
+    }
+
+    // A cleared binary log has no messages.
+    {
+        HAPLogBinaryClear();
+        size_t numLogBytes;
+        const char* output = Decode(&numLogBytes);
+        HAPAssert(numLogBytes == kHAPLogBinary_NumHeaderBytes);
+        HAPAssert(!*output);
+    }
+
+    return 0;
+}
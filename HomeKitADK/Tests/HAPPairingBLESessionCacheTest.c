@@ -0,0 +1,206 @@
+// Copyright (c) 2015-2019 The HomeKit ADK Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the “License”);
+// you may not use this file except in compliance with the License.
+// See [CONTRIBUTORS.md] for the list of HomeKit ADK project authors.
+
+#include "HAP+Internal.h"
+#include "HAPPlatform+Init.h"
+
+#include "Harness/TemplateDB.c"
+
+static HAPAccessoryServerRef accessoryServer;
+
+HAP_RESULT_USE_CHECK
+static HAPError IdentifyAccessory(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        const HAPAccessoryIdentifyRequest* request HAP_UNUSED,
+        void* _Nullable context HAP_UNUSED) {
+    return kHAPError_None;
+}
+
+static const HAPAccessory accessory = { .aid = 1,
+                                        .category = kHAPAccessoryCategory_Other,
+                                        .name = "Acme Test",
+                                        .manufacturer = "Acme",
+                                        .model = "Test1,1",
+                                        .serialNumber = "099DB48E9E28",
+                                        .firmwareVersion = "1",
+                                        .hardwareVersion = "1",
+                                        .services = (const HAPService* const[]) { &accessoryInformationService,
+                                                                                  &hapProtocolInformationService,
+                                                                                  &pairingService,
+                                                                                  NULL },
+                                        .callbacks = { .identify = IdentifyAccessory } };
+
+static void HandleUpdatedAccessoryServerState(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        void* _Nullable context HAP_UNUSED) {
+}
+
+/**
+ * Builds the session ID of a test session.
+ *
+ * - Sessions 0 to 3 share a hash bucket. Sessions 4 and higher are spread over the other buckets.
+ */
+static void GetSessionID(size_t session, HAPPairingBLESessionID* sessionID) {
+    HAPRawBufferZero(sessionID, sizeof *sessionID);
+    size_t numBuckets = kHAPPairingBLESessionCache_NumBuckets;
+    sessionID->value[0] = (uint8_t)(session < 4 ? 3 + session * numBuckets : session % numBuckets);
+    sessionID->value[1] = (uint8_t) session;
+}
+
+/**
+ * Saves a test session.
+ */
+static void Save(size_t session, int pairingID) {
+    HAPPairingBLESessionID sessionID;
+    GetSessionID(session, &sessionID);
+    uint8_t sharedSecret[X25519_SCALAR_BYTES];
+    for (size_t i = 0; i < sizeof sharedSecret; i++) {
+        sharedSecret[i] = (uint8_t)(session + i);
+    }
+    HAPPairingBLESessionCacheSave(&accessoryServer, &sessionID, sharedSecret, pairingID);
+}
+
+/**
+ * Fetches a test session and checks that it is found with the expected shared secret and pairing ID.
+ */
+static void ExpectFound(size_t session, int pairingID) {
+    HAPPairingBLESessionID sessionID;
+    GetSessionID(session, &sessionID);
+    uint8_t sharedSecret[X25519_SCALAR_BYTES];
+    int fetchedPairingID;
+    HAPPairingBLESessionCacheFetch(&accessoryServer, &sessionID, sharedSecret, &fetchedPairingID);
+    HAPAssert(fetchedPairingID == pairingID);
+    for (size_t i = 0; i < sizeof sharedSecret; i++) {
+        HAPAssert(sharedSecret[i] == (uint8_t)(session + i));
+    }
+}
+
+/**
+ * Fetches a test session and checks that it is not found.
+ */
+static void ExpectNotFound(size_t session) {
+    HAPPairingBLESessionID sessionID;
+    GetSessionID(session, &sessionID);
+    uint8_t sharedSecret[X25519_SCALAR_BYTES];
+    int fetchedPairingID;
+    HAPPairingBLESessionCacheFetch(&accessoryServer, &sessionID, sharedSecret, &fetchedPairingID);
+    HAPAssert(fetchedPairingID == -1);
+}
+
+int main() {
+    HAPPlatformCreate();
+
+    // Prepare accessory server storage.
+    static HAPBLEGATTTableElementRef gattTableElements[kAttributeCount];
+    static HAPBLESessionCacheElementRef sessionCacheElements[kHAPBLESessionCache_MinElements];
+    static HAPSessionRef session;
+    static uint8_t procedureBytes[2048];
+    static HAPBLEProcedureRef procedures[1];
+    static HAPBLEAccessoryServerStorage bleAccessoryServerStorage = {
+        .gattTableElements = gattTableElements,
+        .numGATTTableElements = HAPArrayCount(gattTableElements),
+        .sessionCacheElements = sessionCacheElements,
+        .numSessionCacheElements = HAPArrayCount(sessionCacheElements),
+        .session = &session,
+        .procedures = procedures,
+        .numProcedures = HAPArrayCount(procedures),
+        .procedureBuffer = { .bytes = procedureBytes, .numBytes = sizeof procedureBytes },
+    };
+    const size_t numElements = HAPArrayCount(sessionCacheElements);
+
+    // Initialize and start accessory server.
+    HAPAccessoryServerCreate(
+            &accessoryServer,
+            &(const HAPAccessoryServerOptions) {
+                    .maxPairings = kHAPPairingStorage_MinElements,
+                    .ble = { .transport = &kHAPAccessoryServerTransport_BLE,
+                             .accessoryServerStorage = &bleAccessoryServerStorage,
+                             .preferredAdvertisingInterval = kHAPBLEAdvertisingInterval_Minimum,
+                             .preferredNotificationDuration = kHAPBLENotification_MinDuration } },
+            &platform,
+            &(const HAPAccessoryServerCallbacks) { .handleUpdatedState = HandleUpdatedAccessoryServerState },
+            /* context: */ NULL);
+    HAPAccessoryServerStart(&accessoryServer, &accessory);
+    HAPPlatformClockAdvance(0);
+    HAPAssert(HAPAccessoryServerGetState(&accessoryServer) == kHAPAccessoryServerState_Running);
+
+    // Sessions that share a hash bucket are found in any order. Fetched sessions are removed.
+    for (size_t i = 0; i < 4; i++) {
+        Save(i, (int) i);
+    }
+    ExpectNotFound(4);
+    ExpectFound(2, 2);
+    ExpectNotFound(2);
+    ExpectFound(0, 0);
+    ExpectFound(3, 3);
+    ExpectFound(1, 1);
+    ExpectNotFound(1);
+
+    // When the cache is full, the least recently used session is evicted.
+    for (size_t i = 0; i < numElements + 2; i++) {
+        Save(i, 0);
+    }
+    ExpectNotFound(0);
+    ExpectNotFound(1);
+    for (size_t i = 2; i < numElements + 2; i++) {
+        ExpectFound(i, 0);
+    }
+
+    // A fetched session frees its element. No session is evicted for the next one.
+    for (size_t i = 0; i < numElements; i++) {
+        Save(i, 0);
+    }
+    ExpectFound(3, 0);
+    Save(numElements, 0);
+    for (size_t i = 0; i <= numElements; i++) {
+        if (i != 3) {
+            ExpectFound(i, 0);
+        }
+    }
+
+    // Sessions of a removed pairing are invalidated. The order of the remaining sessions is kept.
+    for (size_t i = 0; i < numElements; i++) {
+        Save(i, i == 2 || i == 5 ? 1 : 0);
+    }
+    HAPPairingBLESessionCacheInvalidateEntriesForPairing(&accessoryServer, 1);
+    Save(numElements, 0);
+    Save(numElements + 1, 0);
+    Save(numElements + 2, 0);
+    ExpectNotFound(0);
+    ExpectNotFound(2);
+    ExpectNotFound(5);
+    ExpectFound(1, 0);
+    ExpectFound(3, 0);
+    ExpectFound(4, 0);
+    for (size_t i = 6; i < numElements + 3; i++) {
+        ExpectFound(i, 0);
+    }
+
+    // All sessions are invalidated.
+    for (size_t i = 0; i < numElements; i++) {
+        Save(i, 0);
+    }
+    HAPPairingBLESessionCacheInvalidateAllEntries(&accessoryServer);
+    for (size_t i = 0; i < numElements; i++) {
+        ExpectNotFound(i);
+    }
+
+    // The cache is fully usable after invalidation.
+    for (size_t i = 0; i < numElements + 1; i++) {
+        Save(i, 0);
+    }
+    ExpectNotFound(0);
+    for (size_t i = 1; i < numElements + 1; i++) {
+        ExpectFound(i, 0);
+    }
+
+    HAPAccessoryServerStop(&accessoryServer);
+    HAPPlatformClockAdvance(0);
+    HAPAssert(HAPAccessoryServerGetState(&accessoryServer) == kHAPAccessoryServerState_Idle);
+    HAPAccessoryServerRelease(&accessoryServer);
+
+    return 0;
+}
@@ -0,0 +1,145 @@
+// Copyright (c) 2015-2019 The HomeKit ADK Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the “License”);
+// you may not use this file except in compliance with the License.
+// See [CONTRIBUTORS.md] for the list of HomeKit ADK project authors.
+
+#include "HAP+Internal.h"
+#include "HAPPlatform+Init.h"
+#include "HAPPlatformKeyValueStore+Test.h"
+
+static const HAPPlatformKeyValueStoreDomain kTestDomain = 0x01;
+
+static void HandleUpdatedAccessoryServerState(
+        HAPAccessoryServerRef* server HAP_UNUSED,
+        void* _Nullable context HAP_UNUSED) {
+}
+
+/**
+ * Returns whether a key is present in the key-value store.
+ */
+static bool HasKey(HAPPlatformKeyValueStoreDomain domain, HAPPlatformKeyValueStoreKey key) {
+    bool found;
+    HAPError err = HAPPlatformKeyValueStoreGet(platform.keyValueStore, domain, key, NULL, 0, NULL, &found);
+    HAPAssert(!err);
+    return found;
+}
+
+/**
+ * Stores a pairing without admin permissions, and broadcast parameters.
+ */
+static void StoreNonAdminPairing(void) {
+    uint8_t pairingBytes[36 + 1 + 32 + 1];
+    HAPRawBufferZero(pairingBytes, sizeof pairingBytes);
+    HAPRawBufferCopyBytes(pairingBytes, "C0FFEE00-0000-0000-0000-000000000000", 36);
+    pairingBytes[36] = 36;
+    HAPError err = HAPPlatformKeyValueStoreSet(
+            platform.keyValueStore, kHAPKeyValueStoreDomain_Pairings, 0, pairingBytes, sizeof pairingBytes);
+    HAPAssert(!err);
+
+    uint8_t parametersBytes[2 + 32 + 1 + 6] = { 0 };
+    err = HAPPlatformKeyValueStoreSet(
+            platform.keyValueStore,
+            kHAPKeyValueStoreDomain_Configuration,
+            kHAPKeyValueStoreKey_Configuration_BLEBroadcastParameters,
+            parametersBytes,
+            sizeof parametersBytes);
+    HAPAssert(!err);
+}
+
+int main() {
+    HAPError err;
+    HAPPlatformCreate();
+    HAPPlatformKeyValueStoreRef keyValueStore = platform.keyValueStore;
+
+    // Modifications outside of a batch are written immediately.
+    size_t numWrites = HAPPlatformKeyValueStoreGetNumWrites(keyValueStore);
+    err = HAPPlatformKeyValueStoreSet(keyValueStore, kTestDomain, 0, "a", 1);
+    HAPAssert(!err);
+    HAPAssert(HAPPlatformKeyValueStoreGetNumWrites(keyValueStore) == numWrites + 1);
+
+    // Modifications within nested batches are visible immediately and written once on the outermost commit.
+    numWrites = HAPPlatformKeyValueStoreGetNumWrites(keyValueStore);
+    HAPPlatformKeyValueStoreBeginBatch(keyValueStore);
+    err = HAPPlatformKeyValueStoreSet(keyValueStore, kTestDomain, 1, "b", 1);
+    HAPAssert(!err);
+    HAPAssert(HasKey(kTestDomain, 1));
+    HAPPlatformKeyValueStoreBeginBatch(keyValueStore);
+    HAPAssert(HAPPlatformKeyValueStoreGetNumBatches(keyValueStore) == 2);
+    err = HAPPlatformKeyValueStoreRemove(keyValueStore, kTestDomain, 0);
+    HAPAssert(!err);
+    HAPAssert(!HasKey(kTestDomain, 0));
+    err = HAPPlatformKeyValueStoreCommitBatch(keyValueStore);
+    HAPAssert(!err);
+    HAPAssert(HAPPlatformKeyValueStoreGetNumWrites(keyValueStore) == numWrites);
+    err = HAPPlatformKeyValueStorePurgeDomain(keyValueStore, kTestDomain);
+    HAPAssert(!err);
+    err = HAPPlatformKeyValueStoreCommitBatch(keyValueStore);
+    HAPAssert(!err);
+    HAPAssert(HAPPlatformKeyValueStoreGetNumBatches(keyValueStore) == 0);
+    HAPAssert(HAPPlatformKeyValueStoreGetNumWrites(keyValueStore) == numWrites + 1);
+    HAPAssert(!HasKey(kTestDomain, 1));
+
+    // A batch without modifications is not written.
+    numWrites = HAPPlatformKeyValueStoreGetNumWrites(keyValueStore);
+    HAPPlatformKeyValueStoreBeginBatch(keyValueStore);
+    err = HAPPlatformKeyValueStoreCommitBatch(keyValueStore);
+    HAPAssert(!err);
+    HAPAssert(HAPPlatformKeyValueStoreGetNumWrites(keyValueStore) == numWrites);
+
+    // A batch whose write fails is still ended.
+    numWrites = HAPPlatformKeyValueStoreGetNumWrites(keyValueStore);
+    HAPPlatformKeyValueStoreSetFailWrites(keyValueStore, true);
+    HAPPlatformKeyValueStoreBeginBatch(keyValueStore);
+    err = HAPPlatformKeyValueStoreSet(keyValueStore, kTestDomain, 2, "c", 1);
+    HAPAssert(!err);
+    err = HAPPlatformKeyValueStoreCommitBatch(keyValueStore);
+    HAPAssert(err == kHAPError_Unknown);
+    HAPAssert(HAPPlatformKeyValueStoreGetNumBatches(keyValueStore) == 0);
+    HAPAssert(HAPPlatformKeyValueStoreGetNumWrites(keyValueStore) == numWrites);
+    HAPPlatformKeyValueStoreSetFailWrites(keyValueStore, false);
+    err = HAPPlatformKeyValueStorePurgeDomain(keyValueStore, kTestDomain);
+    HAPAssert(!err);
+
+    // Initialize accessory server.
+    static HAPIPSession ipSessions[kHAPIPSessionStorage_DefaultNumElements];
+    static uint8_t ipScratchBuffer[kHAPIPSession_DefaultScratchBufferSize];
+    static HAPIPAccessoryServerStorage ipAccessoryServerStorage = {
+        .sessions = ipSessions,
+        .numSessions = HAPArrayCount(ipSessions),
+        .scratchBuffer = { .bytes = ipScratchBuffer, .numBytes = sizeof ipScratchBuffer },
+    };
+    static HAPAccessoryServerRef accessoryServer;
+    HAPAccessoryServerCreate(
+            &accessoryServer,
+            &(const HAPAccessoryServerOptions) {
+                    .maxPairings = kHAPPairingStorage_MinElements,
+                    .ip = { .transport = &kHAPAccessoryServerTransport_IP,
+                            .accessoryServerStorage = &ipAccessoryServerStorage } },
+            &platform,
+            &(const HAPAccessoryServerCallbacks) { .handleUpdatedState = HandleUpdatedAccessoryServerState },
+            /* context: */ NULL);
+
+    // Cleaning up pairings without an admin pairing removes pairings and broadcast parameters in a single write.
+    StoreNonAdminPairing();
+    numWrites = HAPPlatformKeyValueStoreGetNumWrites(keyValueStore);
+    err = HAPAccessoryServerCleanupPairings(&accessoryServer);
+    HAPAssert(!err);
+    HAPAssert(HAPPlatformKeyValueStoreGetNumWrites(keyValueStore) == numWrites + 1);
+    HAPAssert(HAPPlatformKeyValueStoreGetNumBatches(keyValueStore) == 0);
+    HAPAssert(!HasKey(kHAPKeyValueStoreDomain_Pairings, 0));
+    HAPAssert(!HasKey(
+            kHAPKeyValueStoreDomain_Configuration, kHAPKeyValueStoreKey_Configuration_BLEBroadcastParameters));
+
+    // If the write fails, the error is reported and the batch is ended.
+    StoreNonAdminPairing();
+    HAPPlatformKeyValueStoreSetFailWrites(keyValueStore, true);
+    err = HAPAccessoryServerCleanupPairings(&accessoryServer);
+    HAPAssert(err == kHAPError_Unknown);
+    HAPAssert(HAPPlatformKeyValueStoreGetNumBatches(keyValueStore) == 0);
+    HAPPlatformKeyValueStoreSetFailWrites(keyValueStore, false);
+
+    HAPAccessoryServerRelease(&accessoryServer);
+
+    return 0;
+}
@@ -0,0 +1,131 @@
+// Copyright (c) 2015-2019 The HomeKit ADK Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the “License”);
+// you may not use this file except in compliance with the License.
+// See [CONTRIBUTORS.md] for the list of HomeKit ADK project authors.
+
+
+// The validator is compiled into this test so that the portable and the vectorized implementation can be compared
+// directly. The build enables the instruction set of the vectorized implementation for this test (see Build/Makefile).
+#include "../PAL/HAPBase+UTF8.c"
+
+#include "HAP+Internal.h"
+
+#include "Harness/UTF8Reference.c"
+
+/**
+ * Deterministic xorshift32 generator so that fuzzing failures are reproducible.
+ */
+static uint32_t NextRandom(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/**
+ * Appends the UTF-8 style encoding of a code point. Surrogates and values beyond U+10FFFF are encoded as well
+ * so that the validators see ill-formed but structurally plausible sequences.
+ */
+static size_t AppendCodePoint(uint8_t* bytes, uint32_t codePoint) {
+    if (codePoint < 0x80) {
+        bytes[0] = (uint8_t) codePoint;
+        return 1;
+    }
+    if (codePoint < 0x800) {
+        bytes[0] = (uint8_t)(0xC0 | (codePoint >> 6));
+        bytes[1] = (uint8_t)(0x80 | (codePoint & 0x3F));
+        return 2;
+    }
+    if (codePoint < 0x10000) {
+        bytes[0] = (uint8_t)(0xE0 | (codePoint >> 12));
+        bytes[1] = (uint8_t)(0x80 | ((codePoint >> 6) & 0x3F));
+        bytes[2] = (uint8_t)(0x80 | (codePoint & 0x3F));
+        return 3;
+    }
+    bytes[0] = (uint8_t)(0xF0 | ((codePoint >> 18) & 0x07));
+    bytes[1] = (uint8_t)(0x80 | ((codePoint >> 12) & 0x3F));
+    bytes[2] = (uint8_t)(0x80 | ((codePoint >> 6) & 0x3F));
+    bytes[3] = (uint8_t)(0x80 | (codePoint & 0x3F));
+    return 4;
+}
+
+/**
+ * Checks all implementations against the reference.
+ */
+static void Check(const uint8_t* bytes, size_t numBytes) {
+    bool isValidData = HAPUTF8IsValidDataRef(bytes, numBytes);
+    HAPAssert(IsValidDataScalar(bytes, numBytes) == isValidData);
+#if HAP_UTF8_SSE4 || HAP_UTF8_NEON
+    HAPAssert(IsValidDataSIMD(bytes, numBytes) == isValidData);
+#endif
+    HAPAssert(HAPUTF8IsValidData(bytes, numBytes) == isValidData);
+}
+
+int main() {
+#if HAP_UTF8_SSE4
+    if (!__builtin_cpu_supports("sse4.1")) {
+        HAPLogInfo(&kHAPLog_Default, "SSE4.1 is not supported by this CPU. Skipping test.");
+        return 0;
+    }
+#elif !HAP_UTF8_NEON
+    HAPLogInfo(&kHAPLog_Default, "Vectorized validator is not available on this target. Testing portable validator.");
+#endif
+
+    // Every byte pair, surrounded by ASCII, at the start, across and at the end of 16-byte blocks.
+    {
+        static const size_t offsets[] = { 0, 13, 14, 15, 16, 29, 30 };
+        uint8_t bytes[32];
+        for (size_t i = 0; i < HAPArrayCount(offsets); i++) {
+            for (unsigned int value = 0; value <= UINT16_MAX; value++) {
+                for (size_t j = 0; j < sizeof bytes; j++) {
+                    bytes[j] = 'a';
+                }
+                bytes[offsets[i]] = (uint8_t)(value >> 8);
+                bytes[offsets[i] + 1] = (uint8_t) value;
+                Check(bytes, offsets[i] + 2);
+                Check(bytes, sizeof bytes);
+            }
+        }
+    }
+
+    // Random inputs at every alignment. Mostly ASCII runs with occasional multi-byte characters.
+    {
+        static const uint32_t codePointLimits[] = { 0x80, 0x800, 0x10000, 0x110000, 0x200000 };
+
+        uint32_t randomState = 0x48415055;
+        uint8_t buffer[256 + 16];
+        for (int iteration = 0; iteration < 100000; iteration++) {
+            size_t offset = NextRandom(&randomState) % 16;
+            size_t numBytes = NextRandom(&randomState) % (sizeof buffer - offset);
+            uint8_t* bytes = &buffer[offset];
+
+            uint32_t asciiBias = NextRandom(&randomState) % 4;
+            size_t i = 0;
+            while (i < numBytes) {
+                uint8_t character[4];
+                uint32_t limit = codePointLimits[0];
+                if (NextRandom(&randomState) % 4 < asciiBias) {
+                    limit = codePointLimits[NextRandom(&randomState) % HAPArrayCount(codePointLimits)];
+                }
+                size_t numCharacterBytes = AppendCodePoint(character, NextRandom(&randomState) % limit);
+                for (size_t j = 0; j < numCharacterBytes && i < numBytes; j++) {
+                    bytes[i++] = character[j];
+                }
+            }
+
+            // Corrupt up to two bytes.
+            if (numBytes) {
+                for (uint32_t numCorruptions = NextRandom(&randomState) % 3; numCorruptions; numCorruptions--) {
+                    bytes[NextRandom(&randomState) % numBytes] = (uint8_t) NextRandom(&randomState);
+                }
+            }
+
+            Check(bytes, numBytes);
+        }
+    }
+
+    return 0;
+}
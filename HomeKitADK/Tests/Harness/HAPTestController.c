@@ -4,9 +4,15 @@
 // you may not use this file except in compliance with the License.
 // See [CONTRIBUTORS.md] for the list of HomeKit ADK project authors.
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "HAP.h"
+#include "HAP+KeyValueStoreDomains.h"
 #include "HAPPlatformBLEPeripheralManager+Test.h"
+#include "HAPPlatformClock+Test.h"
 #include "HAPPlatformServiceDiscovery+Test.h"
+#include "HAPPlatformTCPStreamManager+Test.h"
 #include "HAPTestController.h"
 
 #include "util_base64.h"
@@ -888,3 +894,492 @@ HAPError HAPDiscoverBLEAccessoryServer(
 
     return kHAPError_None;
 }
+
+void HAPTestControllerCreatePairing(HAPPlatformKeyValueStoreRef keyValueStore, HAPTestControllerPairing* pairing) {
+    HAPPrecondition(keyValueStore);
+    HAPPrecondition(pairing);
+
+    HAPError err;
+
+    HAPRawBufferZero(pairing, sizeof *pairing);
+    err = HAPStringWithFormat(pairing->identifier, sizeof pairing->identifier, "%s", "TestController");
+    HAPAssert(!err);
+    HAPPlatformRandomNumberFill(pairing->ltsk, sizeof pairing->ltsk);
+    HAP_ed25519_public_key(pairing->ltpk, pairing->ltsk);
+
+    // See HAP+KeyValueStoreDomains.h for the format of kHAPKeyValueStoreDomain_Pairings.
+    size_t numIdentifierBytes = HAPStringGetNumBytes(pairing->identifier);
+    uint8_t pairingBytes[36 + 1 + ED25519_PUBLIC_KEY_BYTES + 1];
+    HAPRawBufferZero(pairingBytes, sizeof pairingBytes);
+    HAPRawBufferCopyBytes(&pairingBytes[0], pairing->identifier, numIdentifierBytes);
+    pairingBytes[36] = (uint8_t) numIdentifierBytes;
+    HAPRawBufferCopyBytes(&pairingBytes[37], pairing->ltpk, ED25519_PUBLIC_KEY_BYTES);
+    pairingBytes[69] = 0x01; // Admin.
+    err = HAPPlatformKeyValueStoreSet(
+            keyValueStore, kHAPKeyValueStoreDomain_Pairings, 0, pairingBytes, sizeof pairingBytes);
+    HAPAssert(!err);
+}
+
+/**
+ * Determines the length of the first complete HTTP message in a buffer.
+ *
+ * @param      bytes                Buffer. NULL-terminated. Only the body may contain NULL characters.
+ * @param      numBytes             Length of buffer.
+ * @param[out] numMessageBytes      Length of the message.
+ *
+ * @return true                     If the buffer starts with a complete message.
+ * @return false                    Otherwise.
+ */
+static bool GetHTTPMessageLength(const char* bytes, size_t numBytes, size_t* numMessageBytes) {
+    HAPPrecondition(bytes);
+    HAPPrecondition(numMessageBytes);
+
+    const char* body = strstr(bytes, "\r\n\r\n");
+    if (!body) {
+        return false;
+    }
+    body += 4;
+    const char* contentLength = strstr(bytes, "Content-Length: ");
+    if (contentLength && contentLength < body) {
+        size_t numBodyBytes = strtoul(&contentLength[16], NULL, 10);
+        if (numBytes - (size_t)(body - bytes) < numBodyBytes) {
+            return false;
+        }
+        *numMessageBytes = (size_t)(body - bytes) + numBodyBytes;
+        return true;
+    }
+    const char* transferEncoding = strstr(bytes, "Transfer-Encoding: chunked");
+    if (transferEncoding && transferEncoding < body) {
+        const char* chunk = body;
+        for (;;) {
+            char* end;
+            size_t numChunkBytes = strtoul(chunk, &end, 16);
+            if (end == chunk || !HAPRawBufferAreEqual(end, "\r\n", 2)) {
+                return false;
+            }
+            chunk = &end[2];
+            if (numBytes - (size_t)(chunk - bytes) < numChunkBytes + 2) {
+                return false;
+            }
+            chunk += numChunkBytes + 2;
+            if (!numChunkBytes) {
+                *numMessageBytes = (size_t)(chunk - bytes);
+                return true;
+            }
+        }
+    }
+    *numMessageBytes = (size_t)(body - bytes);
+    return true;
+}
+
+/**
+ * Reads and decrypts all available data of an IP session.
+ *
+ * @param      session              IP session.
+ * @param      isSecured            Whether or not the session is encrypted.
+ *
+ * @return true                     If data has been read.
+ * @return false                    Otherwise.
+ */
+static bool ReadIPSession(HAPTestControllerIPSession* session, bool isSecured) {
+    HAPPrecondition(session);
+
+    HAPError err;
+
+    size_t numBytes;
+    err = HAPPlatformTCPStreamClientRead(
+            session->tcpStreamManager,
+            session->tcpStream,
+            &session->inboundBytes[session->numInboundBytes],
+            sizeof session->inboundBytes - session->numInboundBytes,
+            &numBytes);
+    if (err || !numBytes) {
+        return false;
+    }
+    session->numInboundBytes += numBytes;
+
+    size_t position = 0;
+    for (;;) {
+        size_t numFrameBytes;
+        size_t numPlaintextBytes;
+        if (isSecured) {
+            if (session->numInboundBytes - position < 2) {
+                break;
+            }
+            numPlaintextBytes = HAPReadLittleUInt16(&session->inboundBytes[position]);
+            numFrameBytes = 2 + numPlaintextBytes + CHACHA20_POLY1305_TAG_BYTES;
+        } else {
+            numPlaintextBytes = session->numInboundBytes - position;
+            numFrameBytes = numPlaintextBytes;
+        }
+        if (!numFrameBytes || session->numInboundBytes - position < numFrameBytes) {
+            break;
+        }
+        HAPAssert(session->numPlaintextBytes + numPlaintextBytes < sizeof session->plaintextBytes);
+        char* plaintext = &session->plaintextBytes[session->numPlaintextBytes];
+        if (isSecured) {
+            uint8_t nonce[] = { HAPExpandLittleUInt64(session->accessoryToController.nonce) };
+            int e = HAP_chacha20_poly1305_decrypt_aad(
+                    &session->inboundBytes[position + 2 + numPlaintextBytes],
+                    (uint8_t*) plaintext,
+                    &session->inboundBytes[position + 2],
+                    numPlaintextBytes,
+                    &session->inboundBytes[position],
+                    2,
+                    nonce,
+                    sizeof nonce,
+                    session->accessoryToController.key);
+            HAPAssert(!e);
+            session->accessoryToController.nonce++;
+        } else {
+            HAPRawBufferCopyBytes(plaintext, &session->inboundBytes[position], numPlaintextBytes);
+        }
+        session->numPlaintextBytes += numPlaintextBytes;
+        session->plaintextBytes[session->numPlaintextBytes] = '\0';
+        position += numFrameBytes;
+    }
+    HAPRawBufferCopyBytes(
+            &session->inboundBytes[0], &session->inboundBytes[position], session->numInboundBytes - position);
+    session->numInboundBytes -= position;
+    return true;
+}
+
+/**
+ * Receives the next HTTP message from an IP session.
+ *
+ * @param      session              IP session.
+ * @param      isSecured            Whether or not the session is encrypted.
+ * @param[out] bytes                Message. NULL-terminated.
+ * @param      maxBytes             Capacity of bytes.
+ * @param[out] numBytes             Length of the message.
+ *
+ * @return kHAPError_None           If successful.
+ * @return kHAPError_Busy           If no complete message has been received.
+ * @return kHAPError_OutOfResources If the message does not fit into the buffer.
+ */
+HAP_RESULT_USE_CHECK
+static HAPError ReceiveIPMessage(
+        HAPTestControllerIPSession* session,
+        bool isSecured,
+        char* bytes,
+        size_t maxBytes,
+        size_t* numBytes) {
+    HAPPrecondition(session);
+    HAPPrecondition(bytes);
+    HAPPrecondition(numBytes);
+
+    // Timers that are registered while expired timers are processed only fire on the next clock advance.
+    // Keep the run loop going until no more progress is made.
+    size_t numMessageBytes = 0;
+    for (int numIdleIterations = 0; numIdleIterations < 8;) {
+        if (GetHTTPMessageLength(session->plaintextBytes, session->numPlaintextBytes, &numMessageBytes)) {
+            break;
+        }
+        HAPPlatformClockAdvance(0);
+        if (ReadIPSession(session, isSecured)) {
+            numIdleIterations = 0;
+        } else {
+            numIdleIterations++;
+        }
+    }
+    if (!numMessageBytes) {
+        return kHAPError_Busy;
+    }
+    if (numMessageBytes >= maxBytes) {
+        return kHAPError_OutOfResources;
+    }
+    HAPRawBufferCopyBytes(bytes, session->plaintextBytes, numMessageBytes);
+    bytes[numMessageBytes] = '\0';
+    *numBytes = numMessageBytes;
+
+    HAPRawBufferCopyBytes(
+            &session->plaintextBytes[0],
+            &session->plaintextBytes[numMessageBytes],
+            session->numPlaintextBytes - numMessageBytes + 1);
+    session->numPlaintextBytes -= numMessageBytes;
+    return kHAPError_None;
+}
+
+/**
+ * Writes bytes to the TCP stream of an IP session.
+ *
+ * @param      session              IP session.
+ * @param      bytes                Bytes to write.
+ * @param      numBytes             Length of bytes.
+ */
+static void WriteIPSession(HAPTestControllerIPSession* session, const void* bytes, size_t numBytes) {
+    HAPPrecondition(session);
+    HAPPrecondition(bytes);
+
+    while (numBytes) {
+        size_t numWrittenBytes;
+        HAPError err = HAPPlatformTCPStreamClientWrite(
+                session->tcpStreamManager, session->tcpStream, bytes, numBytes, &numWrittenBytes);
+        if (err == kHAPError_Busy) {
+            HAPPlatformClockAdvance(0);
+            continue;
+        }
+        HAPAssert(!err);
+        bytes = &((const uint8_t*) bytes)[numWrittenBytes];
+        numBytes -= numWrittenBytes;
+    }
+    HAPPlatformClockAdvance(0);
+}
+
+/**
+ * Sends a Pair Verify request and receives the response.
+ *
+ * @param      session              IP session.
+ * @param      requestBytes         Request body.
+ * @param      numRequestBytes      Length of the request body.
+ * @param[out] responseBytes        Response body.
+ * @param      maxResponseBytes     Capacity of the response body buffer.
+ * @param[out] numResponseBytes     Length of the response body.
+ *
+ * @return kHAPError_None           If successful.
+ * @return kHAPError_InvalidData    If no valid response has been received.
+ */
+HAP_RESULT_USE_CHECK
+static HAPError ExchangePairVerifyMessage(
+        HAPTestControllerIPSession* session,
+        const uint8_t* requestBytes,
+        size_t numRequestBytes,
+        uint8_t* responseBytes,
+        size_t maxResponseBytes,
+        size_t* numResponseBytes) {
+    HAPPrecondition(session);
+    HAPPrecondition(requestBytes);
+    HAPPrecondition(responseBytes);
+    HAPPrecondition(numResponseBytes);
+
+    HAPError err;
+
+    char header[128];
+    err = HAPStringWithFormat(
+            header,
+            sizeof header,
+            "POST /pair-verify HTTP/1.1\r\n"
+            "Content-Type: application/pairing+tlv8\r\n"
+            "Content-Length: %zu\r\n\r\n",
+            numRequestBytes);
+    HAPAssert(!err);
+    WriteIPSession(session, header, HAPStringGetNumBytes(header));
+    WriteIPSession(session, requestBytes, numRequestBytes);
+
+    static char message[1024];
+    size_t numMessageBytes;
+    err = ReceiveIPMessage(session, /* isSecured: */ false, message, sizeof message, &numMessageBytes);
+    if (err || !HAPRawBufferAreEqual(message, "HTTP/1.1 200 OK\r\n", 17)) {
+        HAPLogError(&logObject, "Pair Verify request failed.");
+        return kHAPError_InvalidData;
+    }
+    const char* body = strstr(message, "\r\n\r\n") + 4;
+    *numResponseBytes = numMessageBytes - (size_t)(body - message);
+    HAPAssert(*numResponseBytes <= maxResponseBytes);
+    HAPRawBufferCopyBytes(responseBytes, body, *numResponseBytes);
+    return kHAPError_None;
+}
+
+/**
+ * Finds a TLV item in a TLV8 encoded buffer.
+ *
+ * - Only items that are not fragmented are supported.
+ *
+ * @param      bytes                Buffer.
+ * @param      numBytes             Length of buffer.
+ * @param      type                 Type of the TLV item.
+ * @param[out] numValueBytes        Length of the value.
+ *
+ * @return Value of the TLV item, if found. NULL otherwise.
+ */
+static const uint8_t* _Nullable FindTLV(const uint8_t* bytes, size_t numBytes, uint8_t type, size_t* numValueBytes) {
+    HAPPrecondition(bytes);
+    HAPPrecondition(numValueBytes);
+
+    size_t position = 0;
+    while (numBytes - position >= 2 && numBytes - position - 2 >= bytes[position + 1]) {
+        if (bytes[position] == type) {
+            *numValueBytes = bytes[position + 1];
+            return &bytes[position + 2];
+        }
+        position += 2 + bytes[position + 1];
+    }
+    return NULL;
+}
+
+HAPError HAPTestControllerOpenIPSession(
+        HAPPlatformTCPStreamManagerRef tcpStreamManager,
+        const HAPTestControllerPairing* pairing,
+        HAPTestControllerIPSession* session) {
+    HAPPrecondition(tcpStreamManager);
+    HAPPrecondition(pairing);
+    HAPPrecondition(session);
+
+    HAPError err;
+
+    HAPRawBufferZero(session, sizeof *session);
+    session->tcpStreamManager = tcpStreamManager;
+    err = HAPPlatformTCPStreamManagerConnectToListener(tcpStreamManager, &session->tcpStream);
+    HAPAssert(!err);
+    HAPPlatformClockAdvance(0);
+
+    // See HomeKit Accessory Protocol Specification R14
+    // Section 5.7 Pair Verify
+    uint8_t cv_SK[X25519_SCALAR_BYTES];
+    uint8_t cv_PK[X25519_BYTES];
+    HAPPlatformRandomNumberFill(cv_SK, sizeof cv_SK);
+    HAP_X25519_scalarmult_base(cv_PK, cv_SK);
+
+    // M1: kTLVType_State, kTLVType_PublicKey.
+    uint8_t request[2 + 1 + 2 + X25519_BYTES + 2 + 255];
+    uint8_t response[512];
+    size_t numResponseBytes;
+    request[0] = 0x06;
+    request[1] = 1;
+    request[2] = 1;
+    request[3] = 0x03;
+    request[4] = X25519_BYTES;
+    HAPRawBufferCopyBytes(&request[5], cv_PK, X25519_BYTES);
+    err = ExchangePairVerifyMessage(session, request, 5 + X25519_BYTES, response, sizeof response, &numResponseBytes);
+    if (err) {
+        return err;
+    }
+
+    // M2: The accessory's signature is not verified.
+    size_t numValueBytes;
+    const uint8_t* accessory_cv_PK = FindTLV(response, numResponseBytes, 0x03, &numValueBytes);
+    if (!accessory_cv_PK || numValueBytes != X25519_BYTES) {
+        HAPLogError(&logObject, "Pair Verify M2: Missing public key.");
+        return kHAPError_InvalidData;
+    }
+    uint8_t accessoryPK[X25519_BYTES];
+    HAPRawBufferCopyBytes(accessoryPK, HAPNonnull(accessory_cv_PK), X25519_BYTES);
+    uint8_t cv_KEY[X25519_BYTES];
+    HAP_X25519_scalarmult(cv_KEY, cv_SK, accessoryPK);
+    uint8_t sessionKey[CHACHA20_POLY1305_KEY_BYTES];
+    {
+        static const uint8_t salt[] = "Pair-Verify-Encrypt-Salt";
+        static const uint8_t info[] = "Pair-Verify-Encrypt-Info";
+        HAP_hkdf_sha512(
+                sessionKey, sizeof sessionKey, cv_KEY, sizeof cv_KEY, salt, sizeof salt - 1, info, sizeof info - 1);
+    }
+
+    // M3: kTLVType_State, kTLVType_EncryptedData(kTLVType_Identifier, kTLVType_Signature).
+    {
+        size_t numIdentifierBytes = HAPStringGetNumBytes(pairing->identifier);
+        uint8_t info[X25519_BYTES + sizeof pairing->identifier + X25519_BYTES];
+        HAPRawBufferCopyBytes(&info[0], cv_PK, X25519_BYTES);
+        HAPRawBufferCopyBytes(&info[X25519_BYTES], pairing->identifier, numIdentifierBytes);
+        HAPRawBufferCopyBytes(&info[X25519_BYTES + numIdentifierBytes], accessoryPK, X25519_BYTES);
+
+        uint8_t subTLV[2 + sizeof pairing->identifier + 2 + ED25519_BYTES + CHACHA20_POLY1305_TAG_BYTES];
+        size_t numSubTLVBytes = 0;
+        subTLV[numSubTLVBytes++] = 0x01;
+        subTLV[numSubTLVBytes++] = (uint8_t) numIdentifierBytes;
+        HAPRawBufferCopyBytes(&subTLV[numSubTLVBytes], pairing->identifier, numIdentifierBytes);
+        numSubTLVBytes += numIdentifierBytes;
+        subTLV[numSubTLVBytes++] = 0x0A;
+        subTLV[numSubTLVBytes++] = ED25519_BYTES;
+        HAP_ed25519_sign(
+                &subTLV[numSubTLVBytes],
+                info,
+                X25519_BYTES + numIdentifierBytes + X25519_BYTES,
+                pairing->ltsk,
+                pairing->ltpk);
+        numSubTLVBytes += ED25519_BYTES;
+
+        static const uint8_t nonce[] = "PV-Msg03";
+        HAP_chacha20_poly1305_encrypt(
+                &subTLV[numSubTLVBytes], subTLV, subTLV, numSubTLVBytes, nonce, sizeof nonce - 1, sessionKey);
+        numSubTLVBytes += CHACHA20_POLY1305_TAG_BYTES;
+
+        size_t numRequestBytes = 0;
+        request[numRequestBytes++] = 0x06;
+        request[numRequestBytes++] = 1;
+        request[numRequestBytes++] = 3;
+        request[numRequestBytes++] = 0x05;
+        request[numRequestBytes++] = (uint8_t) numSubTLVBytes;
+        HAPRawBufferCopyBytes(&request[numRequestBytes], subTLV, numSubTLVBytes);
+        numRequestBytes += numSubTLVBytes;
+        err = ExchangePairVerifyMessage(
+                session, request, numRequestBytes, response, sizeof response, &numResponseBytes);
+        if (err) {
+            return err;
+        }
+    }
+
+    // M4: kTLVType_State.
+    const uint8_t* state = FindTLV(response, numResponseBytes, 0x06, &numValueBytes);
+    if (!state || numValueBytes != 1 || *state != 4 || FindTLV(response, numResponseBytes, 0x07, &numValueBytes)) {
+        HAPLogError(&logObject, "Pair Verify M4: Pair Verify failed.");
+        return kHAPError_InvalidData;
+    }
+
+    // See HomeKit Accessory Protocol Specification R14
+    // Section 6.5.2 Session Security
+    {
+        static const uint8_t salt[] = "Control-Salt";
+        static const uint8_t readInfo[] = "Control-Read-Encryption-Key";
+        static const uint8_t writeInfo[] = "Control-Write-Encryption-Key";
+        HAP_hkdf_sha512(
+                session->accessoryToController.key,
+                sizeof session->accessoryToController.key,
+                cv_KEY,
+                sizeof cv_KEY,
+                salt,
+                sizeof salt - 1,
+                readInfo,
+                sizeof readInfo - 1);
+        HAP_hkdf_sha512(
+                session->controllerToAccessory.key,
+                sizeof session->controllerToAccessory.key,
+                cv_KEY,
+                sizeof cv_KEY,
+                salt,
+                sizeof salt - 1,
+                writeInfo,
+                sizeof writeInfo - 1);
+    }
+    return kHAPError_None;
+}
+
+void HAPTestControllerCloseIPSession(HAPTestControllerIPSession* session) {
+    HAPPrecondition(session);
+
+    HAPPlatformTCPStreamManagerClientClose(session->tcpStreamManager, session->tcpStream);
+    HAPPlatformClockAdvance(0);
+}
+
+void HAPTestControllerSendIPRequest(HAPTestControllerIPSession* session, const char* request) {
+    HAPPrecondition(session);
+    HAPPrecondition(request);
+
+    size_t numRequestBytes = HAPStringGetNumBytes(request);
+    for (size_t position = 0; position < numRequestBytes;) {
+        size_t numFrameBytes = numRequestBytes - position < 1024 ? numRequestBytes - position : 1024;
+        uint8_t frame[2 + 1024 + CHACHA20_POLY1305_TAG_BYTES];
+        HAPWriteLittleUInt16(frame, numFrameBytes);
+        uint8_t nonce[] = { HAPExpandLittleUInt64(session->controllerToAccessory.nonce) };
+        HAP_chacha20_poly1305_encrypt_aad(
+                &frame[2 + numFrameBytes],
+                &frame[2],
+                (const uint8_t*) &request[position],
+                numFrameBytes,
+                frame,
+                2,
+                nonce,
+                sizeof nonce,
+                session->controllerToAccessory.key);
+        session->controllerToAccessory.nonce++;
+        WriteIPSession(session, frame, 2 + numFrameBytes + CHACHA20_POLY1305_TAG_BYTES);
+        position += numFrameBytes;
+    }
+}
+
+HAPError HAPTestControllerReceiveIPMessage(
+        HAPTestControllerIPSession* session,
+        char* bytes,
+        size_t maxBytes,
+        size_t* numBytes) {
+    return ReceiveIPMessage(session, /* isSecured: */ true, bytes, maxBytes, numBytes);
+}
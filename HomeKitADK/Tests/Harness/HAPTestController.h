@@ -12,6 +12,7 @@ extern "C" {
 #endif
 
 #include "HAP.h"
+#include "HAPCrypto.h"
 
 #if __has_feature(nullability)
 #pragma clang assume_nonnull begin
@@ -107,6 +108,114 @@ HAPError HAPDiscoverBLEAccessoryServer(
         HAPAccessoryServerInfo* serverInfo,
         HAPPlatformBLEPeripheralManagerDeviceAddress* deviceAddress);
 
+/**
+ * Controller pairing.
+ */
+typedef struct {
+    /** Pairing identifier. NULL-terminated. */
+    char identifier[37];
+
+    /** Long-term secret key. */
+    uint8_t ltsk[ED25519_SECRET_KEY_BYTES];
+
+    /** Long-term public key. */
+    uint8_t ltpk[ED25519_PUBLIC_KEY_BYTES];
+} HAPTestControllerPairing;
+
+/**
+ * Encrypted IP session of a controller.
+ */
+typedef struct {
+    /** TCP stream manager. */
+    HAPPlatformTCPStreamManagerRef tcpStreamManager;
+
+    /** TCP stream. */
+    HAPPlatformTCPStreamRef tcpStream;
+
+    /** Controller to accessory key and nonce. */
+    struct {
+        uint8_t key[CHACHA20_POLY1305_KEY_BYTES];
+        uint64_t nonce;
+    } controllerToAccessory;
+
+    /** Accessory to controller key and nonce. */
+    struct {
+        uint8_t key[CHACHA20_POLY1305_KEY_BYTES];
+        uint64_t nonce;
+    } accessoryToController;
+
+    /** Received bytes that have not been decrypted yet. */
+    uint8_t inboundBytes[16384];
+    size_t numInboundBytes; /**< Length of inboundBytes. */
+
+    /** Decrypted bytes that have not been read yet. */
+    char plaintextBytes[16384];
+    size_t numPlaintextBytes; /**< Length of plaintextBytes. */
+} HAPTestControllerIPSession;
+
+/**
+ * Creates a random admin controller pairing and stores it in the key-value store of an accessory server.
+ *
+ * - The pairing must be created after the accessory server has been started, as the accessory server resets all
+ *   pairings when it generates its long-term secret key on first start.
+ *
+ * @param      keyValueStore        Key-value store of the accessory server.
+ * @param[out] pairing              Controller pairing.
+ */
+void HAPTestControllerCreatePairing(HAPPlatformKeyValueStoreRef keyValueStore, HAPTestControllerPairing* pairing);
+
+/**
+ * Connects to an IP accessory server and establishes an encrypted session using Pair Verify.
+ *
+ * @param      tcpStreamManager     TCP stream manager of the accessory server.
+ * @param      pairing              Controller pairing created with HAPTestControllerCreatePairing.
+ * @param[out] session              Encrypted IP session.
+ *
+ * @return kHAPError_None           If successful.
+ * @return kHAPError_InvalidData    If Pair Verify failed.
+ */
+HAP_RESULT_USE_CHECK
+HAPError HAPTestControllerOpenIPSession(
+        HAPPlatformTCPStreamManagerRef tcpStreamManager,
+        const HAPTestControllerPairing* pairing,
+        HAPTestControllerIPSession* session);
+
+/**
+ * Closes an encrypted IP session.
+ *
+ * @param      session              Encrypted IP session.
+ */
+void HAPTestControllerCloseIPSession(HAPTestControllerIPSession* session);
+
+/**
+ * Sends an HTTP request over an encrypted IP session.
+ *
+ * @param      session              Encrypted IP session.
+ * @param      request              HTTP request.
+ */
+void HAPTestControllerSendIPRequest(HAPTestControllerIPSession* session, const char* request);
+
+/**
+ * Receives the next HTTP response or event notification from an encrypted IP session.
+ *
+ * - The run loop is advanced until a complete message has been received.
+ *
+ * @param      session              Encrypted IP session.
+ * @param[out] bytes                Message. NULL-terminated. Chunked bodies are not decoded.
+ * @param      maxBytes             Capacity of bytes.
+ * @param[out] numBytes             Length of the message.
+ *
+ * @return kHAPError_None           If successful.
+ * @return kHAPError_Busy           If no complete message has been received.
+ * @return kHAPError_OutOfResources If the message does not fit into the buffer.
+ */
+HAP_RESULT_USE_CHECK
+HAPError HAPTestControllerReceiveIPMessage(
+        HAPTestControllerIPSession* session,
+        char* bytes,
+        size_t maxBytes,
+        size_t* numBytes);
+
 #if __has_feature(nullability)
 #pragma clang assume_nonnull end
 #endif
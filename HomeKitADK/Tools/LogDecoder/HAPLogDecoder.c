@@ -0,0 +1,180 @@
+// Copyright (c) 2015-2019 The HomeKit ADK Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the “License”);
+// you may not use this file except in compliance with the License.
+// See [CONTRIBUTORS.md] for the list of HomeKit ADK project authors.
+
+#include <string.h>
+
+#include "HAPLog+Binary.h"
+#include "HAPLogDecoder.h"
+
+/**
+ * Prints a recorded message.
+ *
+ * @param      output               Stream to print to.
+ * @param      format               Format string.
+ * @param      args                 Recorded arguments.
+ * @param      numArgs              Number of recorded arguments.
+ * @param      maxArgBytes          Length of recorded arguments.
+ */
+static void PrintMessage(FILE* output, const char* format, const uint8_t* args, size_t numArgs, size_t maxArgBytes) {
+    size_t argOffset = 0;
+    for (const char* c = format; *c; c++) {
+        if (*c != '%') {
+            fputc(*c, output);
+            continue;
+        }
+        if (c[1] == '%') {
+            fputc('%', output);
+            c++;
+            continue;
+        }
+
+        // Flags and width are kept, length modifiers are replaced by the recorded 64-bit width.
+        char spec[16] = "%";
+        size_t numSpecBytes = 1;
+        c++;
+        while ((*c == '+' || *c == ' ' || (*c >= '0' && *c <= '9')) && numSpecBytes < sizeof spec - 4) {
+            spec[numSpecBytes++] = *c++;
+        }
+        while (*c == 'l' || *c == 'z') {
+            c++;
+        }
+        if (!*c) {
+            break;
+        }
+        if (!numArgs || argOffset >= maxArgBytes) {
+            fprintf(output, "<missing>");
+            continue;
+        }
+        numArgs--;
+
+        uint8_t argumentType = args[argOffset++];
+        if (argumentType == kHAPLogBinaryArgumentType_String) {
+            size_t numStringBytes = argOffset < maxArgBytes ? args[argOffset++] : 0;
+            if (numStringBytes > maxArgBytes - argOffset) {
+                numStringBytes = maxArgBytes - argOffset;
+            }
+            fprintf(output, "%.*s", (int) numStringBytes, (const char*) &args[argOffset]);
+            argOffset += numStringBytes;
+            continue;
+        }
+        if (maxArgBytes - argOffset < sizeof(uint64_t)) {
+            fprintf(output, "<missing>");
+            argOffset = maxArgBytes;
+            continue;
+        }
+        uint64_t value = HAPReadLittleUInt64(&args[argOffset]);
+        argOffset += sizeof value;
+        switch (argumentType) {
+            case kHAPLogBinaryArgumentType_Int: {
+                memcpy(&spec[numSpecBytes], "lld", 4);
+                fprintf(output, spec, (long long) value);
+            } break;
+            case kHAPLogBinaryArgumentType_UInt: {
+                spec[numSpecBytes++] = 'l';
+                spec[numSpecBytes++] = 'l';
+                spec[numSpecBytes] = *c == 'X' ? 'X' : *c == 'x' ? 'x' : 'u';
+                fprintf(output, spec, (unsigned long long) value);
+            } break;
+            case kHAPLogBinaryArgumentType_Pointer: {
+                fprintf(output, "0x%llx", (unsigned long long) value);
+            } break;
+            case kHAPLogBinaryArgumentType_Char: {
+                fputc((int) value, output);
+            } break;
+            case kHAPLogBinaryArgumentType_Double: {
+                double doubleValue;
+                memcpy(&doubleValue, &value, sizeof doubleValue);
+                fprintf(output, "%g", doubleValue);
+            } break;
+            default: {
+                fprintf(output, "<unknown>");
+            } break;
+        }
+    }
+}
+
+HAP_RESULT_USE_CHECK
+bool HAPLogDecoderDecode(
+        const uint8_t* bytes,
+        size_t numBytes,
+        HAPLogDecoderResolveStringCallback resolveString,
+        void* _Nullable context,
+        FILE* output) {
+    if (numBytes < kHAPLogBinary_NumHeaderBytes ||
+        memcmp(bytes, kHAPLogBinary_Magic, sizeof kHAPLogBinary_Magic - 1) != 0 ||
+        bytes[4] != kHAPLogBinary_Version) {
+        fprintf(stderr, "Not a supported binary log.\n");
+        return false;
+    }
+
+    static const char* const typeNames[] = { "Debug", "Info", "Default", "Error", "Fault" };
+
+    size_t offset = kHAPLogBinary_NumHeaderBytes;
+    while (numBytes - offset >= kHAPLogBinary_NumMessageHeaderBytes + sizeof(uint16_t)) {
+        const uint8_t* message = &bytes[offset];
+        size_t numMessageBytes = HAPReadLittleUInt16(&message[0]);
+        if (numMessageBytes < kHAPLogBinary_NumMessageHeaderBytes + sizeof(uint16_t) ||
+            numMessageBytes > numBytes - offset) {
+            fprintf(stderr, "Truncated message at offset %zu.\n", offset);
+            return false;
+        }
+        offset += numMessageBytes;
+
+        uint8_t type = message[2];
+        size_t numArgs = message[3];
+        uint64_t time = HAPReadLittleUInt64(&message[4]);
+        const char* _Nullable format = resolveString(context, HAPReadLittleUInt64(&message[12]));
+        uint64_t categoryAddress = HAPReadLittleUInt64(&message[20]);
+        const char* _Nullable category = categoryAddress ? resolveString(context, categoryAddress) : "Default";
+
+        // The buffer is at the end of the message.
+        size_t numArgBytes = numMessageBytes - kHAPLogBinary_NumMessageHeaderBytes - sizeof(uint16_t);
+        const uint8_t* args = &message[kHAPLogBinary_NumMessageHeaderBytes];
+        size_t argOffset = 0;
+        for (size_t i = 0; i < numArgs && argOffset < numArgBytes; i++) {
+            if (args[argOffset] == kHAPLogBinaryArgumentType_String) {
+                argOffset += 2 + (argOffset + 1 < numArgBytes ? args[argOffset + 1] : 0);
+            } else {
+                argOffset += 1 + sizeof(uint64_t);
+            }
+        }
+        if (argOffset > numArgBytes) {
+            fprintf(stderr, "Malformed message at offset %zu.\n", offset - numMessageBytes);
+            return false;
+        }
+        size_t numBufferBytes = HAPReadLittleUInt16(&args[argOffset]);
+        const uint8_t* buffer = &args[argOffset + sizeof(uint16_t)];
+        if (numBufferBytes > numArgBytes - argOffset) {
+            numBufferBytes = numArgBytes - argOffset;
+        }
+
+        fprintf(output,
+                "%llu.%03llu\t%-7s\t%s\t",
+                (unsigned long long) (time / 1000),
+                (unsigned long long) (time % 1000),
+                type < HAPArrayCount(typeNames) ? typeNames[type] : "?",
+                category ? category : "?");
+        if (format) {
+            PrintMessage(output, format, args, numArgs, argOffset);
+        } else {
+            fprintf(output,
+                    "<unknown format string 0x%llx>",
+                    (unsigned long long) HAPReadLittleUInt64(&message[12]));
+        }
+        fputc('\n', output);
+        for (size_t i = 0; i < numBufferBytes; i++) {
+            if (i % 16 == 0) {
+                fprintf(output, "\t%04zx:", i);
+            }
+            fprintf(output, " %02x", buffer[i]);
+            if (i % 16 == 15 || i == numBufferBytes - 1) {
+                fputc('\n', output);
+            }
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,63 @@
+// Copyright (c) 2015-2019 The HomeKit ADK Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the “License”);
+// you may not use this file except in compliance with the License.
+// See [CONTRIBUTORS.md] for the list of HomeKit ADK project authors.
+
+#ifndef HAP_LOG_DECODER_H
+#define HAP_LOG_DECODER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+
+#include "HAPBase.h"
+
+#if __has_feature(nullability)
+#pragma clang assume_nonnull begin
+#endif
+
+/**
+ * Resolves a string that was recorded by address, i.e., a format string or a log category.
+ *
+ * @param      context              Context.
+ * @param      address              Address of the string in the image that recorded the binary log.
+ *
+ * @return String, or NULL if the address cannot be resolved.
+ */
+typedef const char* _Nullable (*HAPLogDecoderResolveStringCallback)(void* _Nullable context, uint64_t address);
+
+/**
+ * Decodes a binary log and prints one line per message, followed by a hex dump of the logged buffer, if any.
+ *
+ * - Errors are reported on stderr.
+ * - The decoder is self-contained and does not depend on the HAP library or a crypto module.
+ *
+ * @param      bytes                Binary log, as returned by HAPLogBinaryGetContents.
+ * @param      numBytes             Length of binary log.
+ * @param      resolveString        Callback to resolve format strings and log categories.
+ * @param      context              Context passed to the callback.
+ * @param      output               Stream to print the decoded messages to.
+ *
+ * @return true                     If successful.
+ * @return false                    If the binary log is malformed or has an unsupported version.
+ */
+HAP_RESULT_USE_CHECK
+bool HAPLogDecoderDecode(
+        const uint8_t* bytes,
+        size_t numBytes,
+        HAPLogDecoderResolveStringCallback resolveString,
+        void* _Nullable context,
+        FILE* output);
+
+#if __has_feature(nullability)
+#pragma clang assume_nonnull end
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
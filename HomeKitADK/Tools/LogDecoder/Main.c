@@ -0,0 +1,151 @@
+// Copyright (c) 2015-2019 The HomeKit ADK Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the “License”);
+// you may not use this file except in compliance with the License.
+// See [CONTRIBUTORS.md] for the list of HomeKit ADK project authors.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "HAPLogDecoder.h"
+
+/**
+ * Maximum number of loadable segments of a firmware image.
+ */
+#define kMaxSegments ((size_t) 64)
+
+/**
+ * Loadable segment of a firmware image.
+ */
+typedef struct {
+    uint64_t address;     /**< Virtual address. */
+    const uint8_t* bytes; /**< Contents. */
+    uint64_t numBytes;    /**< Length of contents. */
+} Segment;
+
+static Segment segments[kMaxSegments];
+static size_t numSegments;
+
+/**
+ * Reads a file into memory.
+ *
+ * @param      path                 Path of the file.
+ * @param[out] numBytes             Length of the file.
+ *
+ * @return Contents of the file, or NULL if the file could not be read.
+ */
+static uint8_t* _Nullable ReadFile(const char* path, size_t* numBytes) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+    uint8_t* bytes = NULL;
+    *numBytes = 0;
+    for (;;) {
+        uint8_t* newBytes = realloc(bytes, *numBytes + 4096);
+        if (!newBytes) {
+            free(bytes);
+            fclose(file);
+            return NULL;
+        }
+        bytes = newBytes;
+        size_t n = fread(&bytes[*numBytes], 1, 4096, file);
+        *numBytes += n;
+        if (n < 4096) {
+            break;
+        }
+    }
+    fclose(file);
+    return bytes;
+}
+
+/**
+ * Loads the loadable segments of a little-endian ELF firmware image.
+ *
+ * @param      bytes                ELF file.
+ * @param      numBytes             Length of ELF file.
+ *
+ * @return true                     If successful.
+ * @return false                    If the file is not a supported ELF file.
+ */
+static bool LoadSegments(const uint8_t* bytes, size_t numBytes) {
+    if (numBytes < 64 || memcmp(bytes, "\x7F" "ELF", 4) != 0 || bytes[5] != 1) {
+        return false;
+    }
+    bool is64Bit = bytes[4] == 2;
+    uint64_t phoff = is64Bit ? HAPReadLittleUInt64(&bytes[32]) : HAPReadLittleUInt32(&bytes[28]);
+    size_t phentsize = HAPReadLittleUInt16(&bytes[is64Bit ? 54 : 42]);
+    size_t phnum = HAPReadLittleUInt16(&bytes[is64Bit ? 56 : 44]);
+    for (size_t i = 0; i < phnum; i++) {
+        if (phoff + (i + 1) * phentsize > numBytes) {
+            return false;
+        }
+        const uint8_t* phdr = &bytes[phoff + i * phentsize];
+        uint32_t type = HAPReadLittleUInt32(&phdr[0]);
+        uint64_t offset = is64Bit ? HAPReadLittleUInt64(&phdr[8]) : HAPReadLittleUInt32(&phdr[4]);
+        uint64_t address = is64Bit ? HAPReadLittleUInt64(&phdr[16]) : HAPReadLittleUInt32(&phdr[8]);
+        uint64_t size = is64Bit ? HAPReadLittleUInt64(&phdr[32]) : HAPReadLittleUInt32(&phdr[16]);
+        if (type != 1 /* PT_LOAD */ || offset > numBytes || size > numBytes - offset) {
+            continue;
+        }
+        if (numSegments == kMaxSegments) {
+            return false;
+        }
+        segments[numSegments++] = (Segment) { .address = address, .bytes = &bytes[offset], .numBytes = size };
+    }
+    return numSegments > 0;
+}
+
+/**
+ * Resolves a string in the firmware image.
+ *
+ * @param      context              Context. Unused.
+ * @param      address              Address of the string.
+ *
+ * @return String, or NULL if the address does not point to a NULL-terminated string in the firmware image.
+ */
+static const char* _Nullable ResolveString(void* _Nullable context HAP_UNUSED, uint64_t address) {
+    for (size_t i = 0; i < numSegments; i++) {
+        const Segment* segment = &segments[i];
+        if (address < segment->address || address - segment->address >= segment->numBytes) {
+            continue;
+        }
+        const char* string = (const char*) &segment->bytes[address - segment->address];
+        if (!memchr(string, '\0', segment->numBytes - (address - segment->address))) {
+            return NULL;
+        }
+        return string;
+    }
+    return NULL;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        fprintf(stderr,
+                "Usage: %s <firmware.elf> <log.bin>\n"
+                "\n"
+                "Decodes a binary log recorded with HAP_LOG_BINARY=1 and retrieved with HAPLogBinaryGetContents.\n"
+                "The firmware image must be the exact (non position-independent) image that recorded the log.\n",
+                argv[0]);
+        return 1;
+    }
+
+    size_t numImageBytes;
+    uint8_t* image = ReadFile(argv[1], &numImageBytes);
+    if (!image || !LoadSegments(image, numImageBytes)) {
+        fprintf(stderr, "%s: Not a supported ELF file.\n", argv[1]);
+        return 1;
+    }
+
+    size_t numLogBytes;
+    uint8_t* log = ReadFile(argv[2], &numLogBytes);
+    if (!log || !HAPLogDecoderDecode(log, numLogBytes, ResolveString, /* context: */ NULL, stdout)) {
+        fprintf(stderr, "%s: Failed to decode binary log.\n", argv[2]);
+        return 1;
+    }
+
+    free(log);
+    free(image);
+    return 0;
+}
@@ -105,6 +105,16 @@ bool mgos_hap_setup_info_from_string(
         const char* _Nonnull salt,
         const char* _Nonnull verifier);
 
+/*
+ * Override cs_log_level for HAP messages of the given log category
+ * (HAPLogObject.category, "HAP" for messages without one).
+ * Messages above the effective level are not formatted at all.
+ * MGOS_HAP_LOG_LEVEL_DEFAULT removes the override.
+ * Returns false if there are too many overrides.
+ */
+#define MGOS_HAP_LOG_LEVEL_DEFAULT (-2)
+bool mgos_hap_log_set_level(const char* _Nonnull category, int level);
+
 #ifdef MGOS_HAP_SIMPLE_CONFIG
 #define MGOS_HAP_CONFIG_SET_SETUP_INFO (1 << 0)
 #define MGOS_HAP_CONFIG_SET_SETUP_ID (1 << 2)
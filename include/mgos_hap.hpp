@@ -20,4 +20,5 @@
 #include "mgos_hap.h"
 #include "mgos_hap_accessory.hpp"
 #include "mgos_hap_chars.hpp"
+#include "mgos_hap_db.hpp"
 #include "mgos_hap_service.hpp"
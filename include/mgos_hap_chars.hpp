@@ -38,11 +38,6 @@ class Service;
 
 class Characteristic {
 public:
-    Characteristic(
-            uint16_t iid,
-            HAPCharacteristicFormat format,
-            const HAPUUID* type,
-            const char* debug_description = nullptr);
     virtual ~Characteristic();
 
     const Service* parent() const;
@@ -52,26 +47,15 @@ public:
         return hap_charactristic();
     }
 
-    const HAPCharacteristic* hap_charactristic();
+    virtual const HAPCharacteristic* hap_charactristic() = 0;
 
     void RaiseEvent();
 
+    // Raises events for multiple characteristics at once, with a single flush per accessory server.
+    static void RaiseEvents(const std::vector<Characteristic*>& chars);
+
 protected:
-    struct HAPCharacteristicWithInstance {
-        union AllHAPCHaracteristicTypes {
-            HAPDataCharacteristic data;
-            HAPBoolCharacteristic bool_;
-            HAPUInt8Characteristic uint8;
-            HAPUInt16Characteristic uint16;
-            HAPUInt32Characteristic uint32;
-            HAPUInt64Characteristic uint64;
-            HAPIntCharacteristic int_;
-            HAPFloatCharacteristic float_;
-            HAPStringCharacteristic string;
-            HAPTLV8Characteristic tlv8;
-        } char_;
-        Characteristic* inst; // Pointer back to the instance.
-    } hap_char_;
+    Characteristic();
 
 private:
     const Service* parent_ = nullptr;
@@ -79,7 +63,44 @@ private:
     Characteristic(const Characteristic& other) = delete;
 };
 
-class StringCharacteristic : public Characteristic {
+// Characteristic that stores only the HAP structure of its format.
+template <class HAPCharType>
+class TypedCharacteristic : public Characteristic {
+public:
+    virtual ~TypedCharacteristic() {
+    }
+
+    const HAPCharacteristic* hap_charactristic() override {
+        return &hap_char_.char_;
+    }
+
+protected:
+    TypedCharacteristic(
+            uint16_t iid,
+            HAPCharacteristicFormat format,
+            const HAPUUID* type,
+            const char* debug_description = nullptr)
+        : hap_char_() {
+        HAPCharType* c = &hap_char_.char_;
+        c->iid = iid;
+        c->format = format;
+        c->characteristicType = type;
+        c->debugDescription = debug_description;
+        hap_char_.inst = this;
+    }
+
+    // Returns the instance that owns the HAP characteristic passed to a callback.
+    static TypedCharacteristic* FromHAPCharacteristic(const HAPCharType* c) {
+        return reinterpret_cast<const HAPCharacteristicWithInstance*>(c)->inst;
+    }
+
+    struct HAPCharacteristicWithInstance {
+        HAPCharType char_;
+        TypedCharacteristic* inst; // Pointer back to the instance.
+    } hap_char_;
+};
+
+class StringCharacteristic : public TypedCharacteristic<HAPStringCharacteristic> {
 public:
     StringCharacteristic(
             uint16_t iid,
@@ -105,7 +126,7 @@ private:
 
 // Template class that can be used to create scalar-value characteristics.
 template <class ValType, class HAPBaseClass, class HAPReadRequestType, class HAPWriteRequestType>
-class ScalarCharacteristic : public Characteristic {
+class ScalarCharacteristic : public TypedCharacteristic<HAPBaseClass> {
 public:
     typedef std::function<HAPError(HAPAccessoryServerRef* server, const HAPReadRequestType* request, ValType* value)>
             ReadHandler;
@@ -120,10 +141,10 @@ public:
             bool supports_notification,
             WriteHandler write_handler = nullptr,
             const char* debug_description = nullptr)
-        : Characteristic(iid, format, type, debug_description)
+        : TypedCharacteristic<HAPBaseClass>(iid, format, type, debug_description)
         , read_handler_(read_handler)
         , write_handler_(write_handler) {
-        HAPBaseClass* c = reinterpret_cast<HAPBaseClass*>(&hap_char_.char_);
+        HAPBaseClass* c = &this->hap_char_.char_;
         if (read_handler) {
             c->properties.readable = true;
             c->callbacks.handleRead = ScalarCharacteristic::HandleReadCB;
@@ -146,20 +167,20 @@ private:
             const HAPReadRequestType* request,
             ValType* value,
             void* context) {
-        auto* hci = reinterpret_cast<const HAPCharacteristicWithInstance*>(request->characteristic);
-        auto* c = static_cast<const ScalarCharacteristic*>(hci->inst);
+        auto* c = static_cast<ScalarCharacteristic*>(
+                TypedCharacteristic<HAPBaseClass>::FromHAPCharacteristic(request->characteristic));
         (void) context;
-        return const_cast<ScalarCharacteristic*>(c)->read_handler_(server, request, value);
+        return c->read_handler_(server, request, value);
     }
     static HAPError HandleWriteCB(
             HAPAccessoryServerRef* server,
             const HAPWriteRequestType* request,
             ValType value,
             void* context) {
-        auto* hci = reinterpret_cast<const HAPCharacteristicWithInstance*>(request->characteristic);
-        auto* c = static_cast<const ScalarCharacteristic*>(hci->inst);
+        auto* c = static_cast<ScalarCharacteristic*>(
+                TypedCharacteristic<HAPBaseClass>::FromHAPCharacteristic(request->characteristic));
         (void) context;
-        return const_cast<ScalarCharacteristic*>(c)->write_handler_(server, request, value);
+        return c->write_handler_(server, request, value);
     }
 
     const ReadHandler read_handler_;
@@ -216,7 +237,7 @@ public:
                   supports_notification,
                   write_handler,
                   debug_description) {
-        HAPIntCharacteristic* c = &hap_char_.char_.int_;
+        HAPIntCharacteristic* c = &hap_char_.char_;
         c->constraints.minimumValue = min;
         c->constraints.maximumValue = max;
         c->constraints.stepValue = step;
@@ -249,7 +270,7 @@ public:
                   supports_notification,
                   write_handler,
                   debug_description) {
-        HAPFloatCharacteristic* c = &hap_char_.char_.float_;
+        HAPFloatCharacteristic* c = &hap_char_.char_;
         c->constraints.minimumValue = min;
         c->constraints.maximumValue = max;
         c->constraints.stepValue = step;
@@ -282,7 +303,7 @@ public:
                   supports_notification,
                   write_handler,
                   debug_description) {
-        HAPUInt8Characteristic* c = &hap_char_.char_.uint8;
+        HAPUInt8Characteristic* c = &hap_char_.char_;
         c->constraints.minimumValue = min;
         c->constraints.maximumValue = max;
         c->constraints.stepValue = step;
@@ -315,7 +336,7 @@ public:
                   supports_notification,
                   write_handler,
                   debug_description) {
-        HAPUInt16Characteristic* c = &hap_char_.char_.uint16;
+        HAPUInt16Characteristic* c = &hap_char_.char_;
         c->constraints.minimumValue = min;
         c->constraints.maximumValue = max;
         c->constraints.stepValue = step;
@@ -348,7 +369,7 @@ public:
                   supports_notification,
                   write_handler,
                   debug_description) {
-        HAPUInt32Characteristic* c = &hap_char_.char_.uint32;
+        HAPUInt32Characteristic* c = &hap_char_.char_;
         c->constraints.minimumValue = min;
         c->constraints.maximumValue = max;
         c->constraints.stepValue = step;
@@ -381,7 +402,7 @@ public:
                   supports_notification,
                   write_handler,
                   debug_description) {
-        HAPUInt64Characteristic* c = &hap_char_.char_.uint64;
+        HAPUInt64Characteristic* c = &hap_char_.char_;
         c->constraints.minimumValue = min;
         c->constraints.maximumValue = max;
         c->constraints.stepValue = step;
@@ -390,6 +411,339 @@ public:
     }
 };
 
+// Scalar characteristic that keeps its value in memory.
+// Reads are served from the stored value. set_value() raises an event only if
+// the value differs from the last notified value by at least the deadband.
+// The reference is the value of the last event, not the previous set_value(),
+// so a slow drift raises an event once it has accumulated to the deadband.
+// Successful controller writes always raise an event if the value changed.
+template <class ValType, class HAPBaseClass, class HAPReadRequestType, class HAPWriteRequestType>
+class CachedScalarCharacteristic : public TypedCharacteristic<HAPBaseClass> {
+public:
+    // Invoked on controller writes. The stored value is updated if it returns kHAPError_None.
+    typedef std::function<HAPError(HAPAccessoryServerRef* server, const HAPWriteRequestType* request, ValType value)>
+            WriteHandler;
+
+    CachedScalarCharacteristic(
+            HAPCharacteristicFormat format,
+            uint16_t iid,
+            const HAPUUID* type,
+            ValType initial_value,
+            bool supports_notification,
+            WriteHandler write_handler = nullptr,
+            ValType deadband = ValType(),
+            const char* debug_description = nullptr)
+        : TypedCharacteristic<HAPBaseClass>(iid, format, type, debug_description)
+        , value_(initial_value)
+        , notified_value_(initial_value)
+        , deadband_(deadband)
+        , write_handler_(write_handler) {
+        HAPBaseClass* c = &this->hap_char_.char_;
+        c->properties.readable = true;
+        c->callbacks.handleRead = CachedScalarCharacteristic::HandleReadCB;
+        c->properties.supportsEventNotification = supports_notification;
+        c->properties.ble.supportsBroadcastNotification = true;
+        c->properties.ble.supportsDisconnectedNotification = true;
+        if (write_handler) {
+            c->properties.writable = true;
+            c->callbacks.handleWrite = CachedScalarCharacteristic::HandleWriteCB;
+        }
+    }
+
+    virtual ~CachedScalarCharacteristic() {
+    }
+
+    ValType value() const {
+        return value_;
+    }
+
+    void set_value(ValType value) {
+        value_ = value;
+        if (!IsSignificantChange(value)) {
+            return;
+        }
+        Notify();
+    }
+
+private:
+    void Notify() {
+        notified_value_ = value_;
+        this->RaiseEvent();
+    }
+
+    bool IsSignificantChange(ValType value) const {
+        ValType diff = (value > notified_value_ ? value - notified_value_ : notified_value_ - value);
+        return (value != notified_value_ && !(diff < deadband_));
+    }
+
+    static HAPError HandleReadCB(
+            HAPAccessoryServerRef* server,
+            const HAPReadRequestType* request,
+            ValType* value,
+            void* context) {
+        auto* c = static_cast<const CachedScalarCharacteristic*>(
+                TypedCharacteristic<HAPBaseClass>::FromHAPCharacteristic(request->characteristic));
+        *value = c->value_;
+        (void) server;
+        (void) context;
+        return kHAPError_None;
+    }
+    static HAPError HandleWriteCB(
+            HAPAccessoryServerRef* server,
+            const HAPWriteRequestType* request,
+            ValType value,
+            void* context) {
+        auto* c = static_cast<CachedScalarCharacteristic*>(
+                TypedCharacteristic<HAPBaseClass>::FromHAPCharacteristic(request->characteristic));
+        HAPError err = c->write_handler_(server, request, value);
+        if (err == kHAPError_None) {
+            c->value_ = value;
+            if (value != c->notified_value_) {
+                c->Notify();
+            }
+        }
+        (void) context;
+        return err;
+    }
+
+    ValType value_;
+    ValType notified_value_;
+    const ValType deadband_;
+    const WriteHandler write_handler_;
+};
+
+class CachedBoolCharacteristic : public CachedScalarCharacteristic<
+                                         bool,
+                                         HAPBoolCharacteristic,
+                                         HAPBoolCharacteristicReadRequest,
+                                         HAPBoolCharacteristicWriteRequest> {
+public:
+    CachedBoolCharacteristic(
+            uint16_t iid,
+            const HAPUUID* type,
+            bool initial_value,
+            bool supports_notification,
+            WriteHandler write_handler = nullptr,
+            const char* debug_description = nullptr)
+        : CachedScalarCharacteristic(
+                  kHAPCharacteristicFormat_Bool,
+                  iid,
+                  type,
+                  initial_value,
+                  supports_notification,
+                  write_handler,
+                  false /* deadband */,
+                  debug_description) {
+    }
+    virtual ~CachedBoolCharacteristic() {
+    }
+};
+
+class CachedIntCharacteristic : public CachedScalarCharacteristic<
+                                        int32_t,
+                                        HAPIntCharacteristic,
+                                        HAPIntCharacteristicReadRequest,
+                                        HAPIntCharacteristicWriteRequest> {
+public:
+    CachedIntCharacteristic(
+            uint16_t iid,
+            const HAPUUID* type,
+            int32_t min,
+            int32_t max,
+            int32_t step,
+            int32_t initial_value,
+            bool supports_notification,
+            WriteHandler write_handler = nullptr,
+            const char* debug_description = nullptr)
+        : CachedScalarCharacteristic(
+                  kHAPCharacteristicFormat_Int,
+                  iid,
+                  type,
+                  initial_value,
+                  supports_notification,
+                  write_handler,
+                  0 /* deadband */,
+                  debug_description) {
+        HAPIntCharacteristic* c = &hap_char_.char_;
+        c->constraints.minimumValue = min;
+        c->constraints.maximumValue = max;
+        c->constraints.stepValue = step;
+    }
+    virtual ~CachedIntCharacteristic() {
+    }
+};
+
+class CachedFloatCharacteristic : public CachedScalarCharacteristic<
+                                          float,
+                                          HAPFloatCharacteristic,
+                                          HAPFloatCharacteristicReadRequest,
+                                          HAPFloatCharacteristicWriteRequest> {
+public:
+    CachedFloatCharacteristic(
+            uint16_t iid,
+            const HAPUUID* type,
+            float min,
+            float max,
+            float step,
+            float initial_value,
+            bool supports_notification,
+            WriteHandler write_handler = nullptr,
+            float deadband = 0,
+            const char* debug_description = nullptr)
+        : CachedScalarCharacteristic(
+                  kHAPCharacteristicFormat_Float,
+                  iid,
+                  type,
+                  initial_value,
+                  supports_notification,
+                  write_handler,
+                  deadband,
+                  debug_description) {
+        HAPFloatCharacteristic* c = &hap_char_.char_;
+        c->constraints.minimumValue = min;
+        c->constraints.maximumValue = max;
+        c->constraints.stepValue = step;
+    }
+    virtual ~CachedFloatCharacteristic() {
+    }
+};
+
+class CachedUInt8Characteristic : public CachedScalarCharacteristic<
+                                          uint8_t,
+                                          HAPUInt8Characteristic,
+                                          HAPUInt8CharacteristicReadRequest,
+                                          HAPUInt8CharacteristicWriteRequest> {
+public:
+    CachedUInt8Characteristic(
+            uint16_t iid,
+            const HAPUUID* type,
+            uint8_t min,
+            uint8_t max,
+            uint8_t step,
+            uint8_t initial_value,
+            bool supports_notification,
+            WriteHandler write_handler = nullptr,
+            const char* debug_description = nullptr)
+        : CachedScalarCharacteristic(
+                  kHAPCharacteristicFormat_UInt8,
+                  iid,
+                  type,
+                  initial_value,
+                  supports_notification,
+                  write_handler,
+                  0 /* deadband */,
+                  debug_description) {
+        HAPUInt8Characteristic* c = &hap_char_.char_;
+        c->constraints.minimumValue = min;
+        c->constraints.maximumValue = max;
+        c->constraints.stepValue = step;
+    }
+    virtual ~CachedUInt8Characteristic() {
+    }
+};
+
+class CachedUInt16Characteristic : public CachedScalarCharacteristic<
+                                           uint16_t,
+                                           HAPUInt16Characteristic,
+                                           HAPUInt16CharacteristicReadRequest,
+                                           HAPUInt16CharacteristicWriteRequest> {
+public:
+    CachedUInt16Characteristic(
+            uint16_t iid,
+            const HAPUUID* type,
+            uint16_t min,
+            uint16_t max,
+            uint16_t step,
+            uint16_t initial_value,
+            bool supports_notification,
+            WriteHandler write_handler = nullptr,
+            const char* debug_description = nullptr)
+        : CachedScalarCharacteristic(
+                  kHAPCharacteristicFormat_UInt16,
+                  iid,
+                  type,
+                  initial_value,
+                  supports_notification,
+                  write_handler,
+                  0 /* deadband */,
+                  debug_description) {
+        HAPUInt16Characteristic* c = &hap_char_.char_;
+        c->constraints.minimumValue = min;
+        c->constraints.maximumValue = max;
+        c->constraints.stepValue = step;
+    }
+    virtual ~CachedUInt16Characteristic() {
+    }
+};
+
+class CachedUInt32Characteristic : public CachedScalarCharacteristic<
+                                           uint32_t,
+                                           HAPUInt32Characteristic,
+                                           HAPUInt32CharacteristicReadRequest,
+                                           HAPUInt32CharacteristicWriteRequest> {
+public:
+    CachedUInt32Characteristic(
+            uint16_t iid,
+            const HAPUUID* type,
+            uint32_t min,
+            uint32_t max,
+            uint32_t step,
+            uint32_t initial_value,
+            bool supports_notification,
+            WriteHandler write_handler = nullptr,
+            const char* debug_description = nullptr)
+        : CachedScalarCharacteristic(
+                  kHAPCharacteristicFormat_UInt32,
+                  iid,
+                  type,
+                  initial_value,
+                  supports_notification,
+                  write_handler,
+                  0 /* deadband */,
+                  debug_description) {
+        HAPUInt32Characteristic* c = &hap_char_.char_;
+        c->constraints.minimumValue = min;
+        c->constraints.maximumValue = max;
+        c->constraints.stepValue = step;
+    }
+    virtual ~CachedUInt32Characteristic() {
+    }
+};
+
+class CachedUInt64Characteristic : public CachedScalarCharacteristic<
+                                           uint64_t,
+                                           HAPUInt64Characteristic,
+                                           HAPUInt64CharacteristicReadRequest,
+                                           HAPUInt64CharacteristicWriteRequest> {
+public:
+    CachedUInt64Characteristic(
+            uint16_t iid,
+            const HAPUUID* type,
+            uint64_t min,
+            uint64_t max,
+            uint64_t step,
+            uint64_t initial_value,
+            bool supports_notification,
+            WriteHandler write_handler = nullptr,
+            const char* debug_description = nullptr)
+        : CachedScalarCharacteristic(
+                  kHAPCharacteristicFormat_UInt64,
+                  iid,
+                  type,
+                  initial_value,
+                  supports_notification,
+                  write_handler,
+                  0 /* deadband */,
+                  debug_description) {
+        HAPUInt64Characteristic* c = &hap_char_.char_;
+        c->constraints.minimumValue = min;
+        c->constraints.maximumValue = max;
+        c->constraints.stepValue = step;
+    }
+    virtual ~CachedUInt64Characteristic() {
+    }
+};
+
 // Some helpers to return values from variables.
 template <typename T>
 HAPError ReadBool(
@@ -461,7 +815,7 @@ HAPError ReadFloat(
     return kHAPError_None;
 }
 
-class TLV8Characteristic : public Characteristic {
+class TLV8Characteristic : public TypedCharacteristic<HAPTLV8Characteristic> {
 public:
     typedef std::function<HAPError(
             HAPAccessoryServerRef* server,
@@ -493,18 +847,16 @@ private:
             const HAPTLV8CharacteristicReadRequest* request,
             HAPTLVWriterRef* responseWriter,
             void* context) {
-        auto* hci = reinterpret_cast<const HAPCharacteristicWithInstance*>(request->characteristic);
-        auto* c = static_cast<const TLV8Characteristic*>(hci->inst);
-        return const_cast<TLV8Characteristic*>(c)->read_handler_(server, request, responseWriter, context);
+        auto* c = static_cast<TLV8Characteristic*>(FromHAPCharacteristic(request->characteristic));
+        return c->read_handler_(server, request, responseWriter, context);
     };
     static HAPError HandleWriteCB(
             HAPAccessoryServerRef* server,
             const HAPTLV8CharacteristicWriteRequest* request,
             HAPTLVReaderRef* responseReader,
             void* context) {
-        auto* hci = reinterpret_cast<const HAPCharacteristicWithInstance*>(request->characteristic);
-        auto* c = static_cast<const TLV8Characteristic*>(hci->inst);
-        return const_cast<TLV8Characteristic*>(c)->write_handler_(server, request, responseReader, context);
+        auto* c = static_cast<TLV8Characteristic*>(FromHAPCharacteristic(request->characteristic));
+        return c->write_handler_(server, request, responseReader, context);
     }
 
     const ReadHandler read_handler_;
@@ -0,0 +1,428 @@
+/*
+ * Copyright (c) 2020 Deomid "rojer" Ryabkov
+ * All rights reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wnullability-completeness"
+#endif
+
+#include <cstddef>
+#include <utility>
+
+#include "HAP.h"
+
+/*
+ * Compile-time accessory database.
+ *
+ * The Characteristic, Service and Accessory classes build the attribute database
+ * on the heap at runtime. For static databases (e.g. bridges with many identical
+ * accessories) the helpers below produce the HAP structures as constant expressions
+ * instead, so the whole tree is placed in read-only storage and costs no RAM.
+ *
+ * Objects must be declared constexpr (or const with constant initializers)
+ * at namespace scope or as static members, e.g.:
+ *
+ *   namespace db = mgos::hap::db;
+ *
+ *   static HAPError ReadOn(HAPAccessoryServerRef* server,
+ *                          const HAPBoolCharacteristicReadRequest* request,
+ *                          bool* value, void* context);
+ *   static HAPError WriteOn(...);
+ *
+ *   static constexpr HAPBoolCharacteristic kOn = db::BoolChar(
+ *       0x31, &kHAPCharacteristicType_On, kHAPCharacteristicDebugDescription_On,
+ *       db::kRead | db::kWrite | db::kNotify, ReadOn, WriteOn);
+ *   static constexpr auto kLightChars = db::CharList(&kOn);
+ *   static constexpr HAPService kLight = db::MakeService(
+ *       0x30, &kHAPServiceType_LightBulb, kHAPServiceDebugDescription_LightBulb,
+ *       "Light", kLightChars.items, db::kPrimary);
+ *
+ * Characteristics in a constant database have no per-instance state: handlers
+ * are plain functions that receive the HAPAccessoryServerCreate context and can
+ * use request->characteristic / request->accessory to find their target.
+ * Constant services can be added to a runtime Accessory with AddHAPService(),
+ * or combined into a constant HAPAccessory with MakeAccessory().
+ */
+
+namespace mgos {
+namespace hap {
+namespace db {
+
+// Characteristic property flags.
+enum Property : unsigned {
+    kRead = 1 << 0,
+    kWrite = 1 << 1,
+    kNotify = 1 << 2, // Also enables BLE broadcast and disconnected notifications.
+    kHidden = 1 << 3,
+    kTimedWrite = 1 << 4,
+    kControlPoint = 1 << 5,
+    kWriteResponse = 1 << 6,
+    kAdminOnly = 1 << 7,
+};
+
+// Service property flags.
+enum ServiceProperty : unsigned {
+    kPrimary = 1 << 0,
+    kHiddenService = 1 << 1,
+    kSupportsConfiguration = 1 << 2,
+};
+
+constexpr HAPCharacteristicProperties Properties(unsigned flags) {
+    return HAPCharacteristicProperties{
+        (flags & kRead) != 0,
+        (flags & kWrite) != 0,
+        (flags & kNotify) != 0,
+        (flags & kHidden) != 0,
+        false /* requiresAdminPermissions */,
+        (flags & kAdminOnly) != 0 /* readRequiresAdminPermissions */,
+        (flags & kAdminOnly) != 0 /* writeRequiresAdminPermissions */,
+        (flags & kTimedWrite) != 0,
+        false /* supportsAuthorizationData */,
+        { (flags & kControlPoint) != 0, (flags & kWriteResponse) != 0 },
+        { (flags & kNotify) != 0, (flags & kNotify) != 0, false, false },
+    };
+}
+
+template <class HAPCharType>
+using ReadCB = decltype(std::declval<HAPCharType&>().callbacks.handleRead);
+
+template <class HAPCharType>
+using WriteCB = decltype(std::declval<HAPCharType&>().callbacks.handleWrite);
+
+constexpr HAPBoolCharacteristic BoolChar(
+        uint64_t iid,
+        const HAPUUID* type,
+        const char* debug_description,
+        unsigned flags,
+        ReadCB<HAPBoolCharacteristic> read_handler,
+        WriteCB<HAPBoolCharacteristic> write_handler = nullptr) {
+    return HAPBoolCharacteristic{
+        kHAPCharacteristicFormat_Bool,
+        iid,
+        type,
+        debug_description,
+        nullptr /* manufacturerDescription */,
+        Properties(flags),
+        { read_handler, write_handler, nullptr, nullptr },
+    };
+}
+
+// Range-constrained formats: int, uint16, uint32, uint64 and float.
+template <class HAPCharType, class ValType>
+constexpr HAPCharType RangeChar(
+        HAPCharacteristicFormat format,
+        uint64_t iid,
+        const HAPUUID* type,
+        const char* debug_description,
+        unsigned flags,
+        HAPCharacteristicUnits units,
+        ValType min,
+        ValType max,
+        ValType step,
+        ReadCB<HAPCharType> read_handler,
+        WriteCB<HAPCharType> write_handler) {
+    return HAPCharType{
+        format,
+        iid,
+        type,
+        debug_description,
+        nullptr /* manufacturerDescription */,
+        Properties(flags),
+        units,
+        { min, max, step },
+        { read_handler, write_handler, nullptr, nullptr },
+    };
+}
+
+constexpr HAPUInt8Characteristic UInt8Char(
+        uint64_t iid,
+        const HAPUUID* type,
+        const char* debug_description,
+        unsigned flags,
+        HAPCharacteristicUnits units,
+        uint8_t min,
+        uint8_t max,
+        uint8_t step,
+        ReadCB<HAPUInt8Characteristic> read_handler,
+        WriteCB<HAPUInt8Characteristic> write_handler = nullptr,
+        const uint8_t* const* valid_values = nullptr,
+        const HAPUInt8CharacteristicValidValuesRange* const* valid_values_ranges = nullptr) {
+    return HAPUInt8Characteristic{
+        kHAPCharacteristicFormat_UInt8,
+        iid,
+        type,
+        debug_description,
+        nullptr /* manufacturerDescription */,
+        Properties(flags),
+        units,
+        { min, max, step, valid_values, valid_values_ranges },
+        { read_handler, write_handler, nullptr, nullptr },
+    };
+}
+
+constexpr HAPUInt16Characteristic UInt16Char(
+        uint64_t iid,
+        const HAPUUID* type,
+        const char* debug_description,
+        unsigned flags,
+        HAPCharacteristicUnits units,
+        uint16_t min,
+        uint16_t max,
+        uint16_t step,
+        ReadCB<HAPUInt16Characteristic> read_handler,
+        WriteCB<HAPUInt16Characteristic> write_handler = nullptr) {
+    return RangeChar<HAPUInt16Characteristic, uint16_t>(
+            kHAPCharacteristicFormat_UInt16,
+            iid,
+            type,
+            debug_description,
+            flags,
+            units,
+            min,
+            max,
+            step,
+            read_handler,
+            write_handler);
+}
+
+constexpr HAPUInt32Characteristic UInt32Char(
+        uint64_t iid,
+        const HAPUUID* type,
+        const char* debug_description,
+        unsigned flags,
+        HAPCharacteristicUnits units,
+        uint32_t min,
+        uint32_t max,
+        uint32_t step,
+        ReadCB<HAPUInt32Characteristic> read_handler,
+        WriteCB<HAPUInt32Characteristic> write_handler = nullptr) {
+    return RangeChar<HAPUInt32Characteristic, uint32_t>(
+            kHAPCharacteristicFormat_UInt32,
+            iid,
+            type,
+            debug_description,
+            flags,
+            units,
+            min,
+            max,
+            step,
+            read_handler,
+            write_handler);
+}
+
+constexpr HAPUInt64Characteristic UInt64Char(
+        uint64_t iid,
+        const HAPUUID* type,
+        const char* debug_description,
+        unsigned flags,
+        HAPCharacteristicUnits units,
+        uint64_t min,
+        uint64_t max,
+        uint64_t step,
+        ReadCB<HAPUInt64Characteristic> read_handler,
+        WriteCB<HAPUInt64Characteristic> write_handler = nullptr) {
+    return RangeChar<HAPUInt64Characteristic, uint64_t>(
+            kHAPCharacteristicFormat_UInt64,
+            iid,
+            type,
+            debug_description,
+            flags,
+            units,
+            min,
+            max,
+            step,
+            read_handler,
+            write_handler);
+}
+
+constexpr HAPIntCharacteristic IntChar(
+        uint64_t iid,
+        const HAPUUID* type,
+        const char* debug_description,
+        unsigned flags,
+        HAPCharacteristicUnits units,
+        int32_t min,
+        int32_t max,
+        int32_t step,
+        ReadCB<HAPIntCharacteristic> read_handler,
+        WriteCB<HAPIntCharacteristic> write_handler = nullptr) {
+    return RangeChar<HAPIntCharacteristic, int32_t>(
+            kHAPCharacteristicFormat_Int,
+            iid,
+            type,
+            debug_description,
+            flags,
+            units,
+            min,
+            max,
+            step,
+            read_handler,
+            write_handler);
+}
+
+constexpr HAPFloatCharacteristic FloatChar(
+        uint64_t iid,
+        const HAPUUID* type,
+        const char* debug_description,
+        unsigned flags,
+        HAPCharacteristicUnits units,
+        float min,
+        float max,
+        float step,
+        ReadCB<HAPFloatCharacteristic> read_handler,
+        WriteCB<HAPFloatCharacteristic> write_handler = nullptr) {
+    return RangeChar<HAPFloatCharacteristic, float>(
+            kHAPCharacteristicFormat_Float,
+            iid,
+            type,
+            debug_description,
+            flags,
+            units,
+            min,
+            max,
+            step,
+            read_handler,
+            write_handler);
+}
+
+constexpr HAPStringCharacteristic StringChar(
+        uint64_t iid,
+        const HAPUUID* type,
+        const char* debug_description,
+        unsigned flags,
+        uint16_t max_length,
+        ReadCB<HAPStringCharacteristic> read_handler,
+        WriteCB<HAPStringCharacteristic> write_handler = nullptr) {
+    return HAPStringCharacteristic{
+        kHAPCharacteristicFormat_String,
+        iid,
+        type,
+        debug_description,
+        nullptr /* manufacturerDescription */,
+        Properties(flags),
+        { max_length },
+        { read_handler, write_handler, nullptr, nullptr },
+    };
+}
+
+constexpr HAPDataCharacteristic DataChar(
+        uint64_t iid,
+        const HAPUUID* type,
+        const char* debug_description,
+        unsigned flags,
+        uint32_t max_length,
+        ReadCB<HAPDataCharacteristic> read_handler,
+        WriteCB<HAPDataCharacteristic> write_handler = nullptr) {
+    return HAPDataCharacteristic{
+        kHAPCharacteristicFormat_Data,
+        iid,
+        type,
+        debug_description,
+        nullptr /* manufacturerDescription */,
+        Properties(flags),
+        { max_length },
+        { read_handler, write_handler, nullptr, nullptr },
+    };
+}
+
+constexpr HAPTLV8Characteristic TLV8Char(
+        uint64_t iid,
+        const HAPUUID* type,
+        const char* debug_description,
+        unsigned flags,
+        ReadCB<HAPTLV8Characteristic> read_handler,
+        WriteCB<HAPTLV8Characteristic> write_handler = nullptr) {
+    return HAPTLV8Characteristic{
+        kHAPCharacteristicFormat_TLV8,
+        iid,
+        type,
+        debug_description,
+        nullptr /* manufacturerDescription */,
+        Properties(flags),
+        { read_handler, write_handler, nullptr, nullptr },
+    };
+}
+
+// NULL-terminated array of pointers, as used for HAPService.characteristics and HAPAccessory.services.
+template <class T, size_t N>
+struct List {
+    const T* items[N + 1];
+};
+
+template <class... Args>
+constexpr List<HAPCharacteristic, sizeof...(Args)> CharList(const Args*... chars) {
+    return List<HAPCharacteristic, sizeof...(Args)>{ { chars..., nullptr } };
+}
+
+template <class... Args>
+constexpr List<HAPService, sizeof...(Args)> ServiceList(const Args*... svcs) {
+    return List<HAPService, sizeof...(Args)>{ { svcs..., nullptr } };
+}
+
+constexpr HAPService MakeService(
+        uint64_t iid,
+        const HAPUUID* type,
+        const char* debug_description,
+        const char* name,
+        const HAPCharacteristic* const* chars,
+        unsigned flags = 0,
+        const uint16_t* linked_services = nullptr) {
+    return HAPService{
+        iid,
+        type,
+        debug_description,
+        name,
+        { (flags & kPrimary) != 0, (flags & kHiddenService) != 0, { (flags & kSupportsConfiguration) != 0 } },
+        linked_services,
+        chars,
+    };
+}
+
+constexpr HAPAccessory MakeAccessory(
+        uint64_t aid,
+        HAPAccessoryCategory category,
+        const char* name,
+        const char* manufacturer,
+        const char* model,
+        const char* serial_number,
+        const char* firmware_version,
+        const char* hardware_version,
+        const HAPService* const* services,
+        decltype(std::declval<HAPAccessory&>().callbacks.identify) identify) {
+    return HAPAccessory{
+        aid,
+        category,
+        name,
+        manufacturer,
+        model,
+        serial_number,
+        firmware_version,
+        hardware_version,
+        services,
+        { identify },
+    };
+}
+
+} // namespace db
+} // namespace hap
+} // namespace mgos
+
+#ifdef __clang__
+#pragma clang diagnostic pop
+#endif
@@ -167,6 +167,9 @@ namespace hap {
 
         std::multimap<uint16_t, struct mgos_bt_gatts_conn*> conns_;
 
+        // Buffer for read responses, allocated on first read and reused.
+        std::unique_ptr<char[]> read_buf_;
+
         // Handles are assigned only after service registration but we have to return them immediately
         // so we have to assign our own and perform translation.
         uint16_t next_handle_ = 1;
@@ -436,23 +439,33 @@ namespace hap {
                 if (handle == 0) {
                     return MGOS_BT_GATT_STATUS_INVALID_HANDLE;
                 }
-                std::unique_ptr<char> buf(new char[kHAPPlatformBLEPeripheralManager_MaxAttributeBytes]);
-                if (buf == nullptr) {
-                    return MGOS_BT_GATT_STATUS_INSUF_RESOURCES;
+                if (read_buf_ == nullptr) {
+                    read_buf_.reset(new char[kHAPPlatformBLEPeripheralManager_MaxAttributeBytes]);
+                    if (read_buf_ == nullptr) {
+                        return MGOS_BT_GATT_STATUS_INSUF_RESOURCES;
+                    }
+                }
+                // Size HAP-BLE fragments to fit into a single ATT Read Response (ATT_MTU - 1)
+                // so that every fragment takes exactly one round trip and no Read Blob requests are needed.
+                size_t max_bytes = kHAPPlatformBLEPeripheralManager_MaxAttributeBytes;
+                if (c->gc.mtu > 1 && (size_t)(c->gc.mtu - 1) < max_bytes) {
+                    max_bytes = c->gc.mtu - 1;
                 }
                 size_t num_bytes = 0;
                 HAPError res = delegate_.handleReadRequest(
-                        bpm_,
-                        conn_id,
-                        handle,
-                        buf.get(),
-                        kHAPPlatformBLEPeripheralManager_MaxAttributeBytes,
-                        &num_bytes,
-                        delegate_.context);
-                LOG(LL_DEBUG, ("BPM %p c %p/%u read h %#x -> %d %d", this, c, conn_id, handle, res, (int) num_bytes));
+                        bpm_, conn_id, handle, read_buf_.get(), max_bytes, &num_bytes, delegate_.context);
+                LOG(LL_DEBUG,
+                    ("BPM %p c %p/%u read h %#x mtu %u -> %d %d",
+                     this,
+                     c,
+                     conn_id,
+                     handle,
+                     c->gc.mtu,
+                     res,
+                     (int) num_bytes));
                 switch (res) {
                     case kHAPError_None:
-                        mgos_bt_gatts_send_resp_data(c, arg, mg_mk_str_n(buf.get(), num_bytes));
+                        mgos_bt_gatts_send_resp_data(c, arg, mg_mk_str_n(read_buf_.get(), num_bytes));
                         return MGOS_BT_GATT_STATUS_OK;
                     case kHAPError_OutOfResources:
                         return MGOS_BT_GATT_STATUS_INSUF_RESOURCES;
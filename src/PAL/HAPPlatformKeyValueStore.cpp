@@ -50,6 +50,8 @@ public:
             HAPPlatformKeyValueStoreEnumerateCallback callback,
             void* _Nullable context) const;
     HAPError PurgeDomain(HAPPlatformKeyValueStoreDomain domain);
+    void BeginBatch();
+    HAPError CommitBatch();
 
 private:
     struct Item {
@@ -82,9 +84,13 @@ private:
     void Load();
     void Clear();
     HAPError Save() const;
+    HAPError SaveOrDefer();
 
     const std::string fileName_;
     Item* items_ = nullptr;
+    // Nesting depth of open batches. While non-zero, changes are only saved on commit.
+    int batchDepth_ = 0;
+    bool dirty_ = false;
 };
 
 KVStore::KVStore(const char* fileName)
@@ -183,6 +189,39 @@ out:
     return err;
 }
 
+HAPError KVStore::SaveOrDefer() {
+    if (batchDepth_ > 0) {
+        dirty_ = true;
+        return kHAPError_None;
+    }
+    HAPError err = Save();
+    if (err == kHAPError_None) {
+        dirty_ = false;
+    }
+    return err;
+}
+
+void KVStore::BeginBatch() {
+    batchDepth_++;
+}
+
+HAPError KVStore::CommitBatch() {
+    if (batchDepth_ <= 0) {
+        LOG(LL_ERROR, ("Commit without a batch"));
+        return kHAPError_Unknown;
+    }
+    batchDepth_--;
+    if (batchDepth_ > 0 || !dirty_) {
+        return kHAPError_None;
+    }
+    // If saving fails, the changes stay pending and are saved by the next commit or write.
+    HAPError err = Save();
+    if (err == kHAPError_None) {
+        dirty_ = false;
+    }
+    return err;
+}
+
 // static
 uint16_t KVStore::KVSKey(HAPPlatformKeyValueStoreDomain domain, HAPPlatformKeyValueStoreKey key) {
     return ((static_cast<uint16_t>(domain) << 8) | static_cast<uint16_t>(key));
@@ -248,7 +287,7 @@ HAPError KVStore::Set(
     if (next != nullptr) {
         itm->next = next;
     }
-    return (changed && save ? Save() : kHAPError_None);
+    return (changed && save ? SaveOrDefer() : kHAPError_None);
 }
 
 HAPError KVStore::Remove(HAPPlatformKeyValueStoreDomain domain, HAPPlatformKeyValueStoreKey key, bool save) {
@@ -290,7 +329,7 @@ HAPError KVStore::PurgeDomain(HAPPlatformKeyValueStoreDomain domain) {
         Remove(itm->dom, itm->key, false /* save */);
         changed = true;
     }
-    return (changed ? Save() : kHAPError_None);
+    return (changed ? SaveOrDefer() : kHAPError_None);
 }
 
 extern "C" {
@@ -336,6 +375,14 @@ HAPError HAPPlatformKeyValueStorePurgeDomain(
     return static_cast<KVStore*>(keyValueStore->ctx)->PurgeDomain(domain);
 }
 
+void HAPPlatformKeyValueStoreBeginBatch(HAPPlatformKeyValueStoreRef keyValueStore) {
+    static_cast<KVStore*>(keyValueStore->ctx)->BeginBatch();
+}
+
+HAPError HAPPlatformKeyValueStoreCommitBatch(HAPPlatformKeyValueStoreRef keyValueStore) {
+    return static_cast<KVStore*>(keyValueStore->ctx)->CommitBatch();
+}
+
 void HAPPlatformKeyValueStoreCreate(
         HAPPlatformKeyValueStoreRef keyValueStore,
         const HAPPlatformKeyValueStoreOptions* options) {
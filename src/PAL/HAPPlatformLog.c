@@ -18,11 +18,73 @@
 #include "HAPPlatformLog.h"
 
 #include "mgos.h"
+#include "mgos_hap.h"
 #include "mongoose.h"
 
-HAPPlatformLogEnabledTypes HAPPlatformLogGetEnabledTypes(const HAPLogObject* log HAP_UNUSED) {
-    // Pass everything to mos logging subsystem.
-    return kHAPPlatformLogEnabledTypes_Debug;
+#define MAX_LOG_LEVEL_OVERRIDES 8
+
+// Per-category log level overrides. Categories without an override follow cs_log_level.
+static struct {
+    char* category;
+    enum cs_log_level level;
+} s_overrides[MAX_LOG_LEVEL_OVERRIDES];
+
+static const char* GetCategory(const HAPLogObject* log) {
+    return (log->category != NULL ? log->category : "HAP");
+}
+
+static enum cs_log_level GetLevel(const char* category) {
+    for (size_t i = 0; i < MAX_LOG_LEVEL_OVERRIDES; i++) {
+        if (s_overrides[i].category != NULL && strcmp(s_overrides[i].category, category) == 0) {
+            return s_overrides[i].level;
+        }
+    }
+    return cs_log_level;
+}
+
+bool mgos_hap_log_set_level(const char* category, int level) {
+    size_t free_slot = MAX_LOG_LEVEL_OVERRIDES;
+    for (size_t i = 0; i < MAX_LOG_LEVEL_OVERRIDES; i++) {
+        if (s_overrides[i].category == NULL) {
+            if (free_slot == MAX_LOG_LEVEL_OVERRIDES) {
+                free_slot = i;
+            }
+        } else if (strcmp(s_overrides[i].category, category) == 0) {
+            if (level == MGOS_HAP_LOG_LEVEL_DEFAULT) {
+                free(s_overrides[i].category);
+                s_overrides[i].category = NULL;
+            } else {
+                s_overrides[i].level = (enum cs_log_level) level;
+            }
+            return true;
+        }
+    }
+    if (level == MGOS_HAP_LOG_LEVEL_DEFAULT) {
+        return true;
+    }
+    if (free_slot == MAX_LOG_LEVEL_OVERRIDES) {
+        return false;
+    }
+    s_overrides[free_slot].category = strdup(category);
+    if (s_overrides[free_slot].category == NULL) {
+        return false;
+    }
+    s_overrides[free_slot].level = (enum cs_log_level) level;
+    return true;
+}
+
+HAPPlatformLogEnabledTypes HAPPlatformLogGetEnabledTypes(const HAPLogObject* log) {
+    // Messages that would be dropped by the mos logging subsystem are not formatted at all.
+    enum cs_log_level ll = GetLevel(GetCategory(log));
+    if (ll >= LL_DEBUG) {
+        return kHAPPlatformLogEnabledTypes_Debug;
+    } else if (ll >= LL_INFO) {
+        return kHAPPlatformLogEnabledTypes_Info;
+    } else if (ll >= LL_ERROR) {
+        // There is no errors-only type: Default messages are filtered out in HAPPlatformLogCapture.
+        return kHAPPlatformLogEnabledTypes_Default;
+    }
+    return kHAPPlatformLogEnabledTypes_None;
 }
 
 void HAPPlatformLogCapture(
@@ -31,10 +93,8 @@ void HAPPlatformLogCapture(
         const char* message,
         const void* _Nullable bufferBytes,
         size_t numBufferBytes) {
-    const char* category = log->category;
-    if (category == NULL) {
-        category = "HAP";
-    }
+    const char* category = GetCategory(log);
+    enum cs_log_level categoryLevel = GetLevel(category);
     enum cs_log_level ll = LL_VERBOSE_DEBUG;
     switch (type) {
         case kHAPLogType_Debug:
@@ -52,9 +112,16 @@ void HAPPlatformLogCapture(
             ll = LL_ERROR;
             break;
     }
+    if (ll > categoryLevel) {
+        return;
+    }
+    // Categories whose level is raised above the global level must not be dropped again by the global check.
+    if (categoryLevel > cs_log_level && ll > cs_log_level) {
+        ll = cs_log_level;
+    }
     LOG(ll, ("%s %s", category, message));
     // Only log dumps at level 4 and above.
-    if (numBufferBytes > 0 && cs_log_level >= LL_VERBOSE_DEBUG) {
+    if (numBufferBytes > 0 && categoryLevel >= LL_VERBOSE_DEBUG) {
         mg_hexdumpf(stderr, bufferBytes, numBufferBytes);
     }
 }
@@ -56,6 +56,14 @@ struct HAPPlatformServiceDiscovery {
     const char* name;
     const char* protocol;
     HAPNetworkPort port;
+
+    // Published TXT records: Sequence of NUL-terminated key, value length (1 byte), value.
+    uint8_t txtRecordBytes[kHAPPlatformServiceDiscovery_MaxTXTRecordBufferBytes];
+    size_t numTXTRecordBytes;
+    size_t numTXTRecords;
+
+    // Timer of pending TXT record update. 0 if no update is pending.
+    uintptr_t updateTimer;
     /**@endcond */
 };
 
@@ -21,6 +21,123 @@
 #include "mgos.h"
 #include "mgos_dns_sd.h"
 
+#define MAX_TXT_RECORDS 16
+
+/**
+ * Checks whether TXT records match the ones that have been stored last.
+ */
+static bool TXTRecordsAreEqual(
+        const HAPPlatformServiceDiscoveryRef serviceDiscovery,
+        const HAPPlatformServiceDiscoveryTXTRecord* txtRecords,
+        size_t numTXTRecords) {
+    if (numTXTRecords != serviceDiscovery->numTXTRecords) {
+        return false;
+    }
+    const uint8_t* p = serviceDiscovery->txtRecordBytes;
+    const uint8_t* end = p + serviceDiscovery->numTXTRecordBytes;
+    for (size_t i = 0; i < numTXTRecords; i++) {
+        size_t keyLen = strlen(txtRecords[i].key);
+        size_t valueLen = txtRecords[i].value.numBytes;
+        if ((size_t)(end - p) < keyLen + 2 + valueLen || memcmp(p, txtRecords[i].key, keyLen + 1) != 0 ||
+            p[keyLen + 1] != valueLen ||
+            (valueLen > 0 && memcmp(&p[keyLen + 2], txtRecords[i].value.bytes, valueLen) != 0)) {
+            return false;
+        }
+        p += keyLen + 2 + valueLen;
+    }
+    return p == end;
+}
+
+/**
+ * Checks whether TXT records can be stored.
+ */
+static bool TXTRecordsAreValid(
+        const HAPPlatformServiceDiscoveryRef serviceDiscovery,
+        const HAPPlatformServiceDiscoveryTXTRecord* txtRecords,
+        size_t numTXTRecords) {
+    if (numTXTRecords > MAX_TXT_RECORDS) {
+        LOG(LL_ERROR, ("Too many TXT records (%d).", (int) numTXTRecords));
+        return false;
+    }
+    size_t numBytes = 0;
+    for (size_t i = 0; i < numTXTRecords; i++) {
+        size_t valueLen = txtRecords[i].value.numBytes;
+        if (valueLen > UINT8_MAX) {
+            LOG(LL_ERROR, ("TXT record value too long (%d).", (int) valueLen));
+            return false;
+        }
+        numBytes += strlen(txtRecords[i].key) + 2 + valueLen;
+    }
+    if (numBytes > sizeof(serviceDiscovery->txtRecordBytes)) {
+        LOG(LL_ERROR, ("TXT records do not fit into buffer."));
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Stores TXT records to be published.
+ *
+ * If the records cannot be stored, no records are stored, so that outdated records are not published.
+ */
+static void StoreTXTRecords(
+        HAPPlatformServiceDiscoveryRef serviceDiscovery,
+        const HAPPlatformServiceDiscoveryTXTRecord* txtRecords,
+        size_t numTXTRecords) {
+    if (!TXTRecordsAreValid(serviceDiscovery, txtRecords, numTXTRecords)) {
+        LOG(LL_ERROR,
+            ("Publishing %s.%s without TXT records.", serviceDiscovery->name, serviceDiscovery->protocol));
+        serviceDiscovery->numTXTRecordBytes = 0;
+        serviceDiscovery->numTXTRecords = 0;
+        return;
+    }
+    uint8_t* p = serviceDiscovery->txtRecordBytes;
+    for (size_t i = 0; i < numTXTRecords; i++) {
+        size_t keyLen = strlen(txtRecords[i].key);
+        size_t valueLen = txtRecords[i].value.numBytes;
+        memcpy(p, txtRecords[i].key, keyLen + 1);
+        p[keyLen + 1] = (uint8_t) valueLen;
+        if (valueLen > 0) {
+            memcpy(&p[keyLen + 2], txtRecords[i].value.bytes, valueLen);
+        }
+        p += keyLen + 2 + valueLen;
+    }
+    serviceDiscovery->numTXTRecordBytes = p - serviceDiscovery->txtRecordBytes;
+    serviceDiscovery->numTXTRecords = numTXTRecords;
+}
+
+/**
+ * Publishes the service instance with the stored TXT records.
+ */
+static void Publish(HAPPlatformServiceDiscoveryRef serviceDiscovery) {
+    struct mgos_dns_sd_txt_entry txt[MAX_TXT_RECORDS + 1];
+    memset(txt, 0, sizeof(txt));
+    const uint8_t* p = serviceDiscovery->txtRecordBytes;
+    for (size_t i = 0; i < serviceDiscovery->numTXTRecords; i++) {
+        size_t keyLen = strlen((const char*) p);
+        txt[i].key = (const char*) p;
+        txt[i].value = mg_mk_str_n((const char*) &p[keyLen + 2], p[keyLen + 1]);
+        p += keyLen + 2 + p[keyLen + 1];
+    }
+    if (!mgos_dns_sd_add_service_instance(
+                serviceDiscovery->name, serviceDiscovery->protocol, serviceDiscovery->port, txt)) {
+        LOG(LL_ERROR, ("Failed to advertise %s.%s!", serviceDiscovery->name, serviceDiscovery->protocol));
+    }
+}
+
+static void UpdateTimerExpired(void* arg) {
+    HAPPlatformServiceDiscoveryRef serviceDiscovery = (HAPPlatformServiceDiscoveryRef) arg;
+    serviceDiscovery->updateTimer = MGOS_INVALID_TIMER_ID;
+    Publish(serviceDiscovery);
+}
+
+static void CancelUpdate(HAPPlatformServiceDiscoveryRef serviceDiscovery) {
+    if (serviceDiscovery->updateTimer != MGOS_INVALID_TIMER_ID) {
+        mgos_clear_timer((mgos_timer_id) serviceDiscovery->updateTimer);
+        serviceDiscovery->updateTimer = MGOS_INVALID_TIMER_ID;
+    }
+}
+
 void HAPPlatformServiceDiscoveryRegister(
         HAPPlatformServiceDiscoveryRef serviceDiscovery,
         const char* name,
@@ -28,34 +145,35 @@ void HAPPlatformServiceDiscoveryRegister(
         HAPNetworkPort port,
         HAPPlatformServiceDiscoveryTXTRecord* txtRecords,
         size_t numTXTRecords) {
-    struct mgos_dns_sd_txt_entry txt[numTXTRecords + 1];
-    memset(txt, 0, sizeof(txt));
-    for (size_t i = 0; i < numTXTRecords; i++) {
-        txt[i].key = txtRecords[i].key;
-        txt[i].value = mg_mk_str_n(txtRecords[i].value.bytes, txtRecords[i].value.numBytes);
-    }
-    if (!mgos_dns_sd_add_service_instance(name, protocol, port, txt)) {
-        LOG(LL_ERROR, ("Failed to advertise %s.%s!", name, protocol));
-    }
+    CancelUpdate(serviceDiscovery);
     serviceDiscovery->name = name;
     serviceDiscovery->protocol = protocol;
     serviceDiscovery->port = port;
+    StoreTXTRecords(serviceDiscovery, txtRecords, numTXTRecords);
+    Publish(serviceDiscovery);
 }
 
 void HAPPlatformServiceDiscoveryUpdateTXTRecords(
         HAPPlatformServiceDiscoveryRef serviceDiscovery,
         HAPPlatformServiceDiscoveryTXTRecord* txtRecords,
         size_t numTXTRecords) {
-    HAPPlatformServiceDiscoveryRegister(
-            serviceDiscovery,
-            serviceDiscovery->name,
-            serviceDiscovery->protocol,
-            serviceDiscovery->port,
-            txtRecords,
-            numTXTRecords);
+    // Nothing to do if the records did not change since they were last stored (published or pending).
+    if (TXTRecordsAreEqual(serviceDiscovery, txtRecords, numTXTRecords)) {
+        return;
+    }
+    StoreTXTRecords(serviceDiscovery, txtRecords, numTXTRecords);
+    // Defer publishing to the next event loop iteration, so that multiple changes made together
+    // (e.g. status flags and configuration number) result in a single announcement.
+    if (serviceDiscovery->updateTimer == MGOS_INVALID_TIMER_ID) {
+        serviceDiscovery->updateTimer = (uintptr_t) mgos_set_timer(0, 0, UpdateTimerExpired, serviceDiscovery);
+        if (serviceDiscovery->updateTimer == MGOS_INVALID_TIMER_ID) {
+            Publish(serviceDiscovery);
+        }
+    }
 }
 
 void HAPPlatformServiceDiscoveryStop(HAPPlatformServiceDiscoveryRef serviceDiscovery) {
+    CancelUpdate(serviceDiscovery);
     mgos_dns_sd_remove_service_instance(serviceDiscovery->name, serviceDiscovery->protocol, serviceDiscovery->port);
 }
 
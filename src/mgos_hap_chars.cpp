@@ -19,26 +19,13 @@
 
 #include <cstring>
 
-#include "HAPCharacteristic.h"
-
 #include "mgos_hap_accessory.hpp"
 #include "mgos_hap_service.hpp"
 
 namespace mgos {
 namespace hap {
 
-Characteristic::Characteristic(
-        uint16_t iid,
-        HAPCharacteristicFormat format,
-        const HAPUUID* type,
-        const char* debug_description)
-    : hap_char_({}) {
-    HAPBaseCharacteristic* c = reinterpret_cast<HAPBaseCharacteristic*>(&hap_char_.char_);
-    c->iid = iid;
-    c->format = format;
-    c->characteristicType = type;
-    c->debugDescription = debug_description;
-    hap_char_.inst = this;
+Characteristic::Characteristic() {
 }
 
 Characteristic::~Characteristic() {
@@ -52,10 +39,6 @@ void Characteristic::set_parent(const Service* parent) {
     parent_ = parent;
 }
 
-const HAPCharacteristic* Characteristic::hap_charactristic() {
-    return static_cast<const HAPCharacteristic*>(&hap_char_);
-}
-
 void Characteristic::RaiseEvent() {
     const Service* svc = parent();
     if (svc == nullptr)
@@ -66,15 +49,39 @@ void Characteristic::RaiseEvent() {
     HAPAccessoryServerRaiseEvent(acc->server(), GetHAPCharacteristic(), svc->GetHAPService(), acc->GetHAPAccessory());
 }
 
+// static
+void Characteristic::RaiseEvents(const std::vector<Characteristic*>& chars) {
+    HAPAccessoryServerRef* server = nullptr;
+    std::vector<HAPCharacteristicEvent> events;
+    events.reserve(chars.size());
+    for (Characteristic* c : chars) {
+        const Service* svc = c->parent();
+        if (svc == nullptr)
+            continue;
+        const Accessory* acc = svc->parent();
+        if (acc == nullptr || acc->server() == nullptr)
+            continue;
+        if (server != nullptr && acc->server() != server) {
+            HAPAccessoryServerRaiseEvents(server, events.data(), events.size());
+            events.clear();
+        }
+        server = acc->server();
+        events.push_back({ c->GetHAPCharacteristic(), svc->GetHAPService(), acc->GetHAPAccessory() });
+    }
+    if (!events.empty()) {
+        HAPAccessoryServerRaiseEvents(server, events.data(), events.size());
+    }
+}
+
 StringCharacteristic::StringCharacteristic(
         uint16_t iid,
         const HAPUUID* type,
         uint16_t max_length,
         const std::string& initial_value,
         const char* debug_description)
-    : Characteristic(iid, kHAPCharacteristicFormat_String, type, debug_description)
+    : TypedCharacteristic(iid, kHAPCharacteristicFormat_String, type, debug_description)
     , value_(initial_value) {
-    HAPStringCharacteristic* c = &hap_char_.char_.string;
+    HAPStringCharacteristic* c = &hap_char_.char_;
     c->constraints.maxLength = max_length;
     c->properties.readable = true;
     c->callbacks.handleRead = StringCharacteristic::HandleReadCB;
@@ -98,8 +105,7 @@ HAPError StringCharacteristic::HandleReadCB(
         char* value,
         size_t maxValueBytes,
         void* context) {
-    auto* hci = reinterpret_cast<const HAPCharacteristicWithInstance*>(request->characteristic);
-    auto* c = static_cast<const StringCharacteristic*>(hci->inst);
+    auto* c = static_cast<const StringCharacteristic*>(FromHAPCharacteristic(request->characteristic));
     size_t n = std::min(maxValueBytes - 1, c->value_.length());
     std::memcpy(value, c->value_.data(), n);
     value[n] = '\0';
@@ -117,10 +123,10 @@ TLV8Characteristic::TLV8Characteristic(
         bool write_response,
         bool control_point,
         const char* debug_description)
-    : Characteristic(iid, kHAPCharacteristicFormat_TLV8, type, debug_description)
+    : TypedCharacteristic(iid, kHAPCharacteristicFormat_TLV8, type, debug_description)
     , read_handler_(read_handler)
     , write_handler_(write_handler) {
-    HAPTLV8Characteristic* c = &hap_char_.char_.tlv8;
+    HAPTLV8Characteristic* c = &hap_char_.char_;
     c->properties.readable = true;
     c->properties.supportsEventNotification = supports_notification;
     c->callbacks.handleRead = TLV8Characteristic::HandleReadCB;
@@ -334,6 +334,59 @@ static void mgos_hap_reset_handler(
     (void) fi;
 }
 
+static void mgos_hap_set_log_level_handler(
+        struct mg_rpc_request_info* ri,
+        void* cb_arg,
+        struct mg_rpc_frame_info* fi,
+        struct mg_str args) {
+    char* category = NULL;
+    int level = MGOS_HAP_LOG_LEVEL_DEFAULT;
+    json_scanf(args.p, args.len, ri->args_fmt, &category, &level);
+
+    if (category == NULL) {
+        mg_rpc_send_errorf(ri, 400, "%s is required", "category");
+    } else if (level < MGOS_HAP_LOG_LEVEL_DEFAULT || level > LL_VERBOSE_DEBUG) {
+        mg_rpc_send_errorf(ri, 400, "invalid %s", "level");
+    } else if (!mgos_hap_log_set_level(category, level)) {
+        mg_rpc_send_errorf(ri, 500, "too many overrides");
+    } else {
+        mg_rpc_send_responsef(ri, NULL);
+    }
+
+    free(category);
+    (void) cb_arg;
+    (void) fi;
+}
+
+#if HAP_LOG_BINARY
+static void mgos_hap_get_binary_log_handler(
+        struct mg_rpc_request_info* ri,
+        void* cb_arg,
+        struct mg_rpc_frame_info* fi,
+        struct mg_str args) {
+    bool clear = false;
+    json_scanf(args.p, args.len, ri->args_fmt, &clear);
+
+    size_t num_bytes = 0;
+    uint8_t* bytes = malloc(kHAPLogBinary_MaxBytes);
+    if (bytes == NULL) {
+        mg_rpc_send_errorf(ri, 500, "out of memory");
+    } else if (HAPLogBinaryGetContents(bytes, kHAPLogBinary_MaxBytes, &num_bytes) != kHAPError_None) {
+        mg_rpc_send_errorf(ri, 500, "failed to get log");
+    } else {
+        // Decode offline with Tools/LogDecoder against the firmware ELF.
+        mg_rpc_send_responsef(ri, "{data: %V}", bytes, (int) num_bytes);
+        if (clear) {
+            HAPLogBinaryClear();
+        }
+    }
+
+    free(bytes);
+    (void) cb_arg;
+    (void) fi;
+}
+#endif
+
 static void simple_stop_cb(HAPAccessoryServerRef* _Nonnull server) {
     HAPAccessoryServerStop(server);
 }
@@ -363,6 +416,10 @@ void mgos_hap_add_rpc_service_cb(
             mgos_hap_setup_handler,
             NULL);
     mg_rpc_add_handler(c, "HAP.Reset", "{reset_server: %B, reset_code: %B}", mgos_hap_reset_handler, NULL);
+    mg_rpc_add_handler(c, "HAP.SetLogLevel", "{category: %Q, level: %d}", mgos_hap_set_log_level_handler, NULL);
+#if HAP_LOG_BINARY
+    mg_rpc_add_handler(c, "HAP.GetBinaryLog", "{clear: %B}", mgos_hap_get_binary_log_handler, NULL);
+#endif
 }
 
 #endif // defined(MGOS_HAVE_RPC_COMMON) && defined(MGOS_HAP_SIMPLE_CONFIG)
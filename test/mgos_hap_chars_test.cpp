@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2020 Deomid "rojer" Ryabkov
+ * All rights reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Host test for CachedScalarCharacteristic event suppression.
+
+#include "mgos_hap_chars.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            exit(1); \
+        } \
+    } while (0)
+
+namespace {
+
+// Number of events raised per characteristic.
+std::map<const mgos::hap::Characteristic*, int> events;
+
+const HAPUUID kTestType = { { 0x01 } };
+
+} // namespace
+
+// Stand-ins for the definitions in mgos_hap_chars.cpp, which need a running accessory server.
+namespace mgos {
+namespace hap {
+
+Characteristic::Characteristic() {
+}
+
+Characteristic::~Characteristic() {
+}
+
+const Service* Characteristic::parent() const {
+    return parent_;
+}
+
+void Characteristic::set_parent(const Service* parent) {
+    parent_ = parent;
+}
+
+void Characteristic::RaiseEvent() {
+    events[this]++;
+}
+
+} // namespace hap
+} // namespace mgos
+
+using mgos::hap::CachedFloatCharacteristic;
+using mgos::hap::CachedIntCharacteristic;
+
+static float Read(CachedFloatCharacteristic* ch) {
+    auto* c = reinterpret_cast<const HAPFloatCharacteristic*>(ch->GetHAPCharacteristic());
+    HAPFloatCharacteristicReadRequest request = {};
+    request.transportType = kHAPTransportType_IP;
+    request.characteristic = c;
+    float value = -1;
+    CHECK(c->callbacks.handleRead(nullptr, &request, &value, nullptr) == kHAPError_None);
+    return value;
+}
+
+static HAPError Write(CachedFloatCharacteristic* ch, float value) {
+    auto* c = reinterpret_cast<const HAPFloatCharacteristic*>(ch->GetHAPCharacteristic());
+    CHECK(c->properties.writable);
+    HAPFloatCharacteristicWriteRequest request = {};
+    request.transportType = kHAPTransportType_IP;
+    request.characteristic = c;
+    return c->callbacks.handleWrite(nullptr, &request, value, nullptr);
+}
+
+static void TestDeadband() {
+    CachedFloatCharacteristic ch(1, &kTestType, -100, 100, 0.1f, 20.0f, true, nullptr, 0.5f);
+
+    // Changes below the deadband are stored but do not raise events.
+    ch.set_value(20.25f);
+    CHECK(events[&ch] == 0);
+    CHECK(ch.value() == 20.25f);
+    CHECK(Read(&ch) == 20.25f);
+
+    // Slow drift is measured from the last notified value, so it eventually crosses the deadband.
+    ch.set_value(20.375f);
+    CHECK(events[&ch] == 0);
+    ch.set_value(20.5f);
+    CHECK(events[&ch] == 1);
+
+    // The reference moves to 20.5, a step back to 20.25 is suppressed.
+    ch.set_value(20.25f);
+    CHECK(events[&ch] == 1);
+    CHECK(Read(&ch) == 20.25f);
+
+    // Crossings in the negative direction are detected too.
+    ch.set_value(19.75f);
+    CHECK(events[&ch] == 2);
+
+    // Setting the notified value again is not a change.
+    ch.set_value(19.75f);
+    CHECK(events[&ch] == 2);
+}
+
+static void TestNoDeadband() {
+    CachedIntCharacteristic ch(2, &kTestType, 0, 10, 1, 5, true);
+    ch.set_value(5);
+    CHECK(events[&ch] == 0);
+    ch.set_value(6);
+    CHECK(events[&ch] == 1);
+    ch.set_value(5);
+    CHECK(events[&ch] == 2);
+}
+
+static void TestWrite() {
+    HAPError result = kHAPError_None;
+    float written = 0;
+    CachedFloatCharacteristic ch(
+            3,
+            &kTestType,
+            -100,
+            100,
+            0.1f,
+            20.0f,
+            true,
+            [&](HAPAccessoryServerRef*, const HAPFloatCharacteristicWriteRequest*, float value) {
+                written = value;
+                return result;
+            },
+            0.5f);
+
+    // Writes are reported even if they are within the deadband.
+    CHECK(Write(&ch, 20.25f) == kHAPError_None);
+    CHECK(written == 20.25f);
+    CHECK(ch.value() == 20.25f);
+    CHECK(Read(&ch) == 20.25f);
+    CHECK(events[&ch] == 1);
+
+    // The write becomes the new reference for set_value().
+    ch.set_value(20.5f);
+    CHECK(events[&ch] == 1);
+    ch.set_value(20.75f);
+    CHECK(events[&ch] == 2);
+
+    // Writing the current value does not raise an event.
+    CHECK(Write(&ch, 20.75f) == kHAPError_None);
+    CHECK(events[&ch] == 2);
+
+    // A rejected write leaves the value untouched.
+    result = kHAPError_InvalidData;
+    CHECK(Write(&ch, 50.0f) == kHAPError_InvalidData);
+    CHECK(written == 50.0f);
+    CHECK(ch.value() == 20.75f);
+    CHECK(Read(&ch) == 20.75f);
+    CHECK(events[&ch] == 2);
+}
+
+int main() {
+    TestDeadband();
+    TestNoDeadband();
+    TestWrite();
+    printf("PASSED\n");
+    return 0;
+}
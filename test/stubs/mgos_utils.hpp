@@ -0,0 +1,8 @@
+/*
+ * Host build stand-in for the mgos_utils.hpp header of the mongoose-os core.
+ */
+#pragma once
+
+#ifndef UNUSED_ARG
+#define UNUSED_ARG __attribute__((unused))
+#endif